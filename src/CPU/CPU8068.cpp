@@ -5,21 +5,86 @@
 #include "CPU8068.h"
 
 #include <cctype>
+#include <chrono>
 #include <cstdint>
+#include <ctime>
 #include <iostream>
+#include <utility>
 
+#include "../DOS/DosError.h"
+#include "../Devices/BiosDataArea.h"
 #include "../Exceptions/ProgramExitedException.h"
 #include "../Utils/logger.h"
+#include "../FPU/FPU.h"
+#include "../FPU/FPUMode.h"
 #include "CPUMode.h"
 
-CPU8068::CPU8068(const CPU_MODE cpu_mode)
-    : memory(MEMORY_SIZE, 0), cpu_mode(cpu_mode) {
+CPU8068::CPU8068(const CPU_MODE cpu_mode, const FPU_MODE fpu_mode)
+    : address_mask(MEMORY_SIZE - 1),
+      memory(cpu_mode >= CPU_MODE::CPU_80286 ? MEMORY_SIZE_80286
+                                             : MEMORY_SIZE),
+      cpu_mode(cpu_mode),
+      dispatch(dispatch_table(cpu_mode)),
+      fpu(FPU::create(fpu_mode)),
+      jump_taken(false),
+      cycle_counter(cpu_mode),
+      timing_enabled(false),
+      last_ea_segment(Sreg::DS),
+      last_ea_offset(0),
+      rep_iterations(0),
+      event_deadline(0),
+      event_countdown(0),
+      trace_first(0),
+      trace_last(0),
+      trace_started(false),
+      trace_CS(0),
+      trace_IP(0),
+      trace_registers{},
+      trace_before{},
+      trace_address(0),
+      trace_frame(0),
+      trace_frame_size(0),
+      watching(false),
+      watch_touched(false),
+      debug_stop_pending(false),
+      debug_resuming(false),
+      debug_report(false),
+      debug_signal(0),
+      coverage_start(0),
+      coverage_last(0),
+      stats_clock_base(0),
+      framebuffer(memory),
+      capture_interval(0),
+      irq0_pending(false),
+      interrupt_mask(0),
+      system_control(0),
+      irq1_pending(false),
+      keyboard_host(false),
+      host_poll_at(0),
+      dos_extended(0),
+      idle_loop{},
+      idle_poll{},
+      arena(memory),
+      psp_segment(0),
+      return_code(0),
+      disk_status(0),
+      ready_function(READY_ON_INPUT) {
   AX = BX = CX = DX = 0;
   SP = BP = SI = DI = 0;
   CS = DS = SS = ES = 0;
   IP = 0;
   FLAGS = 0;
   interrupt_delay = 0;
+
+  MSW = 0;
+  GDTR = IDTR = DescriptorTableRegister{0, 0xFFFF};
+  LDTR = SegmentDescriptor{0, 0, 0, 0};
+  update_segment_registers();
+
+  install_bios();
+  reset_timer();
+  reset_keyboard();
+  connect_ports();
 }
 
 void CPU8068::reset_registers() {
@@ -30,1241 +95,1537 @@ void CPU8068::reset_registers() {
 
 void CPU8068::execute() {
   while (true) {
-    const uint8_t opcode = mem8(CS, IP++);
+    if (debugger) {
+      debug_hook();
+    }
+    if (coverage_map) {
+      cover();
+    }
+    jump_taken = false;
+    const uint16_t start_CS = CS;
+    const uint16_t start_IP = IP;
+    const uint8_t start_CL = CL;
+    const uint32_t start_address =
+        trace || timing_enabled ? linear_address(Sreg::CS, IP) : 0;
+    if (trace) {
+      trace_before = register_set();
+      trace_address = start_address;
+    }
+
+    const uint8_t opcode = mem8(Sreg::CS, IP++);
     if (interrupt_delay) --interrupt_delay;
-    switch (opcode) {
-        // MOV
-        // mov AL   moffs8   (0xA0)
-        // mov AX   moffs16  (0xA1)
-      case 0xA0:
-      case 0xA1: {
-        const uint16_t address = mem16(CS, IP);
-        IP += 2;
-
-        const bool is_16bit = (opcode == 0xA1);
-        if (is_16bit) {
-          AX = mem16(DS, address);
-        } else {
-          AL = mem8(DS, address);
-        }
-        break;
-      }
-        // mov moffs8       AX  (0xA2)
-        // mov moffs16/32   AL  (0xA3)
-      case 0xA2:
-      case 0xA3: {
-        const uint16_t address = mem16(CS, IP);
-        IP += 2;
-
-        const bool is_16bit = (opcode == 0xA3);
-        if (is_16bit) {
-          mem16(DS, address) = AX;
-        } else {
-          mem8(DS, address) = AL;
-        }
-        break;
-      }
-        // MOVS   m8  m8         (0xA4)
-        // MOVSB  m8  m8         (0xA4)
-        // MOVS   m16 m16        (0xA5)
-        // MOVSW  m16 m16        (0xA5)
-      case 0xA4:
-      case 0xA5: {
-        const bool is_16bit = (opcode == 0xA5);
-        mov_es_di_ds_si(is_16bit ? 16 : 8);
-        break;
-      }
-        // CMPS   m8  m8         (0xA6)
-        // CMPSB  m8  m8         (0xA6)
-        // CMPS   m16 m16        (0xA7)
-        // CMPSW  m16 m16        (0xA7)
-      case 0xA6:
-      case 0xA7: {
-        const bool is_16bit = (opcode == 0xA7);
-        cmps_es_di_ds_si(is_16bit ? 16 : 8);
-        break;
-      }
-        // STOS   m8  m8         (0xAA)
-        // STOSB  m8  m8         (0xAA)
-        // STOS   m16 m16        (0xAB)
-        // STOSW  m16 m16        (0xAB)
-      case 0xAA:
-      case 0xAB: {
-        const bool is_16bit = (opcode == 0xAB);
-        stos_es_di(is_16bit ? 16 : 8);
-        break;
-      }
+    if (!(this->*dispatch.handlers[opcode])(opcode)) {
+      return;
+    }
 
-        // LODS   m8  m8         (0xAC)
-        // LODSB  m8  m8         (0xAC)
-        // LODS   m16 m16        (0xAD)
-        // LODSW  m16 m16        (0xAD)
-      case 0xAC:
-      case 0xAD: {
-        const bool is_16bit = (opcode == 0xAD);
-        lods_ds_si(is_16bit ? 16 : 8);
-        break;
-      }
-        // SCAS   m8  m8         (0xAE)
-        // SCASB  m8  m8         (0xAE)
-        // SCAS   m16 m16        (0xAF)
-        // SCASW  m16 m16        (0xAF)
-      case 0xAE:
-      case 0xAF: {
-        const bool is_16bit = (opcode == 0xAF);
-        scas_es_di(is_16bit ? 16 : 8);
-        break;
-      }
-        // B0 + r
-        // mov r8, imm8
-      case 0xB0:
-      case 0xB1:
-      case 0xB2:
-      case 0xB3:
-      case 0xB4:
-      case 0xB5:
-      case 0xB6:
-      case 0xB7: {
-        *reg8[opcode - 0xB0] = mem8(CS, IP++);
-        break;
-      }
-        // B8 + r
-        // mov r16, imm16
-      case 0xB8:
-      case 0xB9:
-      case 0xBA:
-      case 0xBB:
-      case 0xBC:
-      case 0xBD:
-      case 0xBE:
-      case 0xBF: {
-        *reg16[opcode - 0xB8] = mem16(CS, IP);
-        IP += 2;
-        break;
-      }
-        // mov r/m8      r8   (0x88)
-        // mov r/m16/32  r32  (0x89)
-      case 0x88:
-      case 0x89: {
-        const uint8_t mod_rm = mem8(CS, IP++);
-
-        const bool is_16bit = (opcode == 0x89);
-        mov_rm_reg(mod_rm, is_16bit ? 16 : 8);
-        break;
-      }
-        // mov r8     r/m8        (0x8A)
-        // mov r16/32 r/m16/32    (0x8B)
-      case 0x8A:
-      case 0x8B: {
-        const uint8_t mod_rm = mem8(CS, IP++);
-
-        const bool is_16bit = (opcode == 0x8B);
-        mov_reg_rm(mod_rm, is_16bit ? 16 : 8);
-        break;
-      }
-        // MOV m16   Sreg
-        // MOV r16   Sreg
-      case 0x8C: {
-        const uint8_t mod_rm = mem8(CS, IP++);
-        mov_rm_sreg(mod_rm, 16);
-        break;
-      }
-        // MOV Sreg m16
-        // MOV Sreg r16
-      case 0x8E: {
-        const uint8_t mod_rm = mem8(CS, IP++);
-        mov_sreg_rm(mod_rm, 16);
-        break;
-      }
-        // mov r/m8     imm8        (0xC6)
-        // mov r/m16/32 imm16/32    (0xC7)
-      case 0xC6:
-      case 0xC7: {
-        const uint8_t mod_rm = mem8(CS, IP++);
-
-        const bool is_16bit = (opcode == 0xC7);
-        mov_rm_imm(mod_rm, is_16bit ? 16 : 8);
-        break;
-      }
-        // INT
-        // int imm8
-      case 0xCD: {
-        const uint8_t num = mem8(CS, IP++);
-        interrupt(num);
-        break;
-      }
-        // ADD
-        // ADD  r/m8  r8
-        // ADD  r/m16 r16
-      case 0x00:
-      case 0x01: {
-        const uint8_t mod_rm = mem8(CS, IP++);
-
-        const bool is_16bit = (opcode == 0x01);
-        add_rm_reg(mod_rm, (is_16bit) ? 16 : 8);
-        break;
-      }
-        // ADD  r8  r/m8
-        // ADD  r16 r/m16
-      case 0x02:
-      case 0x03: {
-        const uint8_t mod_rm = mem8(CS, IP++);
-
-        const bool is_16bit = (opcode == 0x03);
-        add_reg_rm(mod_rm, (is_16bit) ? 16 : 8);
-        break;
-      }
-        // add AL imm8
-      case 0x04: {
-        const uint8_t rhs = mem8(CS, IP++);
-        const uint16_t result =
-            static_cast<uint16_t>(AL) + static_cast<uint16_t>(rhs);
-        set_flags_add(AL, rhs, result, 8);
-        AL = result & 0xFF;
-        break;
-      }
-        // add eAX imm16/32
-      case 0x05: {
-        const uint16_t rhs = mem16(CS, IP);
-        IP += 2;
-
-        const uint32_t result =
-            static_cast<uint32_t>(AX) + static_cast<uint32_t>(rhs);
-        set_flags_add(AX, rhs, result, 16);
-        AX = result & 0xFFFF;
-        break;
-      }
-        // ADC
-        // ADC  r/m8  r8
-        // ADC  r/m16 r16
-      case 0x10:
-      case 0x11: {
-        const uint8_t mod_rm = mem8(CS, IP++);
-
-        const bool is_16bit = (opcode == 0x11);
-        adc_rm_reg(mod_rm, (is_16bit) ? 16 : 8);
-        break;
-      }
-        // ADC  r8  r/m8
-        // ADC  r16 r/m16
-      case 0x12:
-      case 0x13: {
-        const uint8_t mod_rm = mem8(CS, IP++);
-
-        const bool is_16bit = (opcode == 0x13);
-        adc_reg_rm(mod_rm, (is_16bit) ? 16 : 8);
-        break;
-      }
-        // adc AL imm8
-      case 0x14: {
-        const uint8_t rhs = mem8(CS, IP++);
-        const uint16_t result = static_cast<uint16_t>(AL) +
-                                static_cast<uint16_t>(rhs) +
-                                static_cast<uint16_t>(CF());
-        set_flags_add(AL, rhs, result, 8);
-        AL = result & 0xFF;
-        break;
-      }
-        // adc eAX imm16/32
-      case 0x15: {
-        const uint16_t rhs = mem16(CS, IP);
-        IP += 2;
-
-        const uint32_t result = static_cast<uint32_t>(AX) +
-                                static_cast<uint32_t>(rhs) +
-                                static_cast<uint32_t>(CF());
-        set_flags_add(AX, rhs, result, 16);
-        AX = result & 0xFFFF;
-        break;
+    if (trace) {
+      trace_instruction(start_CS, start_IP);
+    }
+    if (timing_enabled) {
+      account_cycles(opcode, start_address, start_CS, start_IP, start_CL);
+    }
+    if (--event_countdown == 0) {
+      const uint16_t event_SP = SP;
+      run_events();
+      if (trace) {
+        trace_events(event_SP);
       }
-        // SUB
-        // SUB  r/m8  r8
-        // SUB  r/m16 r16
-      case 0x28:
-      case 0x29: {
-        const uint8_t mod_rm = mem8(CS, IP++);
-
-        const bool is_16bit = (opcode == 0x29);
-        sub_rm_reg(mod_rm, (is_16bit) ? 16 : 8);
-        break;
+    }
+  }
+}
+
+void CPU8068::enable_display(const double refresh_hz) {
+  display = std::make_unique<TextDisplay>(memory, refresh_hz);
+  events.schedule(EventScheduler::DISPLAY,
+                  virtual_clock() + DISPLAY_POLL_INSTRUCTIONS);
+  sync_events();
+}
+
+void CPU8068::close_display() {
+  events.cancel(EventScheduler::DISPLAY);
+  display.reset();
+}
+
+void CPU8068::enable_capture(std::unique_ptr<FrameCapture> capture,
+                             const uint32_t every_instructions) {
+  frame_capture = std::move(capture);
+  capture_interval = every_instructions;
+  events.schedule(EventScheduler::CAPTURE,
+                  virtual_clock() + every_instructions);
+  sync_events();
+}
+
+void CPU8068::close_capture() {
+  events.cancel(EventScheduler::CAPTURE);
+  if (frame_capture) {
+    frame_capture->capture(framebuffer);
+    frame_capture.reset();
+  }
+}
+
+void CPU8068::jump_short(const int8_t offset) {
+  const uint16_t end = IP;
+  jump_near(static_cast<uint16_t>(IP + offset));
+  if (offset < 0) {
+    watch_loop(end);
+  }
+}
+
+void CPU8068::jump_near(const uint16_t offset) {
+  IP = offset;
+  jump_taken = true;
+}
+
+void CPU8068::jump_far(const uint16_t segment, const uint16_t offset) {
+  IP = offset;
+  CS = segment;
+  update_segment_register(CS);
+  jump_taken = true;
+}
+
+bool CPU8068::execute_8086(const uint8_t opcode) {
+  switch (opcode) {
+      // MOV
+      // mov AL   moffs8   (0xA0)
+      // mov AX   moffs16  (0xA1)
+    case 0xA0:
+    case 0xA1: {
+      const uint16_t address = mem16(Sreg::CS, IP);
+      IP += 2;
+
+      const bool is_16bit = (opcode == 0xA1);
+      if (is_16bit) {
+        AX = mem16(Sreg::DS, address);
+      } else {
+        AL = mem8(Sreg::DS, address);
       }
-        // SUB  r8  r/m8
-        // SUB  r16 r/m16
-      case 0x2A:
-      case 0x2B: {
-        const uint8_t mod_rm = mem8(CS, IP++);
-
-        const bool is_16bit = (opcode == 0x2B);
-        sub_reg_rm(mod_rm, (is_16bit) ? 16 : 8);
-        break;
+      break;
+    }
+      // mov moffs8       AX  (0xA2)
+      // mov moffs16/32   AL  (0xA3)
+    case 0xA2:
+    case 0xA3: {
+      const uint16_t address = mem16(Sreg::CS, IP);
+      IP += 2;
+
+      const bool is_16bit = (opcode == 0xA3);
+      if (is_16bit) {
+        mem16(Sreg::DS, address) = AX;
+      } else {
+        mem8(Sreg::DS, address) = AL;
       }
-        // sub AL imm8
-      case 0x2C: {
-        const uint8_t rhs = mem8(CS, IP++);
-        const uint16_t result =
-            static_cast<uint16_t>(AL) - static_cast<uint16_t>(rhs);
-        set_flags_sub(AL, rhs, result, 8);
-        AL = result & 0xFF;
-        break;
+      break;
+    }
+      // MOVS   m8  m8         (0xA4)
+      // MOVSB  m8  m8         (0xA4)
+      // MOVS   m16 m16        (0xA5)
+      // MOVSW  m16 m16        (0xA5)
+    case 0xA4:
+    case 0xA5: {
+      const bool is_16bit = (opcode == 0xA5);
+      mov_es_di_ds_si(is_16bit ? 16 : 8);
+      break;
+    }
+      // CMPS   m8  m8         (0xA6)
+      // CMPSB  m8  m8         (0xA6)
+      // CMPS   m16 m16        (0xA7)
+      // CMPSW  m16 m16        (0xA7)
+    case 0xA6:
+    case 0xA7: {
+      const bool is_16bit = (opcode == 0xA7);
+      cmps_es_di_ds_si(is_16bit ? 16 : 8);
+      break;
+    }
+      // STOS   m8  m8         (0xAA)
+      // STOSB  m8  m8         (0xAA)
+      // STOS   m16 m16        (0xAB)
+      // STOSW  m16 m16        (0xAB)
+    case 0xAA:
+    case 0xAB: {
+      const bool is_16bit = (opcode == 0xAB);
+      stos_es_di(is_16bit ? 16 : 8);
+      break;
+    }
+
+      // LODS   m8  m8         (0xAC)
+      // LODSB  m8  m8         (0xAC)
+      // LODS   m16 m16        (0xAD)
+      // LODSW  m16 m16        (0xAD)
+    case 0xAC:
+    case 0xAD: {
+      const bool is_16bit = (opcode == 0xAD);
+      lods_ds_si(is_16bit ? 16 : 8);
+      break;
+    }
+      // SCAS   m8  m8         (0xAE)
+      // SCASB  m8  m8         (0xAE)
+      // SCAS   m16 m16        (0xAF)
+      // SCASW  m16 m16        (0xAF)
+    case 0xAE:
+    case 0xAF: {
+      const bool is_16bit = (opcode == 0xAF);
+      scas_es_di(is_16bit ? 16 : 8);
+      break;
+    }
+      // REPNE / REPNZ    (0xF2)
+      // REP / REPE / REPZ (0xF3)
+    case 0xF2:
+    case 0xF3: {
+      return rep_string(opcode);
+    }
+      // B0 + r
+      // mov r8, imm8
+    case 0xB0:
+    case 0xB1:
+    case 0xB2:
+    case 0xB3:
+    case 0xB4:
+    case 0xB5:
+    case 0xB6:
+    case 0xB7: {
+      *reg8[opcode - 0xB0] = mem8(Sreg::CS, IP++);
+      break;
+    }
+      // B8 + r
+      // mov r16, imm16
+    case 0xB8:
+    case 0xB9:
+    case 0xBA:
+    case 0xBB:
+    case 0xBC:
+    case 0xBD:
+    case 0xBE:
+    case 0xBF: {
+      *reg16[opcode - 0xB8] = mem16(Sreg::CS, IP);
+      IP += 2;
+      break;
+    }
+      // mov r/m8      r8   (0x88)
+      // mov r/m16/32  r32  (0x89)
+    case 0x88:
+    case 0x89: {
+      const uint8_t mod_rm = mem8(Sreg::CS, IP++);
+
+      const bool is_16bit = (opcode == 0x89);
+      mov_rm_reg(mod_rm, is_16bit ? 16 : 8);
+      break;
+    }
+      // mov r8     r/m8        (0x8A)
+      // mov r16/32 r/m16/32    (0x8B)
+    case 0x8A:
+    case 0x8B: {
+      const uint8_t mod_rm = mem8(Sreg::CS, IP++);
+
+      const bool is_16bit = (opcode == 0x8B);
+      mov_reg_rm(mod_rm, is_16bit ? 16 : 8);
+      break;
+    }
+      // MOV m16   Sreg
+      // MOV r16   Sreg
+    case 0x8C: {
+      const uint8_t mod_rm = mem8(Sreg::CS, IP++);
+      mov_rm_sreg(mod_rm, 16);
+      break;
+    }
+      // MOV Sreg m16
+      // MOV Sreg r16
+    case 0x8E: {
+      const uint8_t mod_rm = mem8(Sreg::CS, IP++);
+      mov_sreg_rm(mod_rm, 16);
+      break;
+    }
+      // mov r/m8     imm8        (0xC6)
+      // mov r/m16/32 imm16/32    (0xC7)
+    case 0xC6:
+    case 0xC7: {
+      const uint8_t mod_rm = mem8(Sreg::CS, IP++);
+
+      const bool is_16bit = (opcode == 0xC7);
+      mov_rm_imm(mod_rm, is_16bit ? 16 : 8);
+      break;
+    }
+      // INT
+      // int imm8
+    case 0xCD: {
+      const uint8_t num = mem8(Sreg::CS, IP++);
+      software_interrupt(num);
+      break;
+    }
+      // int3
+    case 0xCC: {
+      software_interrupt(3);
+      break;
+    }
+      // into
+    case 0xCE: {
+      if (OF()) {
+        software_interrupt(4);
       }
-        // sub eAX imm16/32
-      case 0x2D: {
-        const uint16_t rhs = mem16(CS, IP);
-        IP += 2;
-
-        const uint32_t result =
-            static_cast<uint32_t>(AX) - static_cast<uint32_t>(rhs);
-        set_flags_sub(AX, rhs, result, 16);
-        AX = result & 0xFFFF;
-        break;
+      break;
+    }
+      // in AL imm8 (0xE4), in AX imm8 (0xE5)
+    case 0xE4:
+    case 0xE5: {
+      const uint8_t port = mem8(Sreg::CS, IP++);
+      if (opcode == 0xE5) {
+        AX = port_in16(port);
+      } else {
+        AL = port_in8(port);
       }
-        // SBB
-        // SBB  r/m8  r8
-        // SBB  r/m16 r16
-      case 0x18:
-      case 0x19: {
-        const uint8_t mod_rm = mem8(CS, IP++);
-
-        const bool is_16bit = (opcode == 0x19);
-        sbb_rm_reg(mod_rm, (is_16bit) ? 16 : 8);
-        break;
+      break;
+    }
+      // out imm8 AL (0xE6), out imm8 AX (0xE7)
+    case 0xE6:
+    case 0xE7: {
+      const uint8_t port = mem8(Sreg::CS, IP++);
+      if (opcode == 0xE7) {
+        port_out16(port, AX);
+      } else {
+        port_out8(port, AL);
       }
-        // SBB  r8  r/m8
-        // SBB  r16 r/m16
-      case 0x1A:
-      case 0x1B: {
-        const uint8_t mod_rm = mem8(CS, IP++);
-
-        const bool is_16bit = (opcode == 0x1B);
-        sbb_reg_rm(mod_rm, (is_16bit) ? 16 : 8);
-        break;
+      break;
+    }
+      // in AL DX (0xEC), in AX DX (0xED)
+    case 0xEC:
+    case 0xED: {
+      if (opcode == 0xED) {
+        AX = port_in16(DX);
+      } else {
+        AL = port_in8(DX);
       }
-        // sbb AL imm8
-      case 0x1C: {
-        const uint8_t rhs = mem8(CS, IP++);
-        const uint16_t result = static_cast<uint16_t>(AL) -
-                                static_cast<uint16_t>(rhs) -
-                                static_cast<uint16_t>(CF());
-        set_flags_sub(AL, rhs, result, 8);
-        AL = result & 0xFF;
-        break;
+      break;
+    }
+      // out DX AL (0xEE), out DX AX (0xEF)
+    case 0xEE:
+    case 0xEF: {
+      if (opcode == 0xEF) {
+        port_out16(DX, AX);
+      } else {
+        port_out8(DX, AL);
       }
-        // sbb eAX imm16/32
-      case 0x1D: {
-        const uint16_t rhs = mem16(CS, IP);
-        IP += 2;
-
-        const uint32_t result = static_cast<uint32_t>(AX) -
-                                static_cast<uint32_t>(rhs) -
-                                static_cast<uint32_t>(CF());
-        set_flags_sub(AX, rhs, result, 16);
-        AX = result & 0xFFFF;
-        break;
+      break;
+    }
+      // iret
+    case 0xCF: {
+      const uint16_t new_IP = mem16(Sreg::SS, SP);
+      SP += 2;
+      const uint16_t new_CS = mem16(Sreg::SS, SP);
+      SP += 2;
+      FLAGS = mem16(Sreg::SS, SP);
+      FLAGS |= 0b0000'0000'0000'0010;
+      SP += 2;
+      jump_far(new_CS, new_IP);
+      break;
+    }
+      // ADD
+      // ADD  r/m8  r8
+      // ADD  r/m16 r16
+    case 0x00:
+    case 0x01: {
+      const uint8_t mod_rm = mem8(Sreg::CS, IP++);
+
+      const bool is_16bit = (opcode == 0x01);
+      add_rm_reg(mod_rm, (is_16bit) ? 16 : 8);
+      break;
+    }
+      // ADD  r8  r/m8
+      // ADD  r16 r/m16
+    case 0x02:
+    case 0x03: {
+      const uint8_t mod_rm = mem8(Sreg::CS, IP++);
+
+      const bool is_16bit = (opcode == 0x03);
+      add_reg_rm(mod_rm, (is_16bit) ? 16 : 8);
+      break;
+    }
+      // add AL imm8
+    case 0x04: {
+      const uint8_t rhs = mem8(Sreg::CS, IP++);
+      const uint16_t result =
+          static_cast<uint16_t>(AL) + static_cast<uint16_t>(rhs);
+      set_flags_add(AL, rhs, result, 8);
+      AL = result & 0xFF;
+      break;
+    }
+      // add eAX imm16/32
+    case 0x05: {
+      const uint16_t rhs = mem16(Sreg::CS, IP);
+      IP += 2;
+
+      const uint32_t result =
+          static_cast<uint32_t>(AX) + static_cast<uint32_t>(rhs);
+      set_flags_add(AX, rhs, result, 16);
+      AX = result & 0xFFFF;
+      break;
+    }
+      // ADC
+      // ADC  r/m8  r8
+      // ADC  r/m16 r16
+    case 0x10:
+    case 0x11: {
+      const uint8_t mod_rm = mem8(Sreg::CS, IP++);
+
+      const bool is_16bit = (opcode == 0x11);
+      adc_rm_reg(mod_rm, (is_16bit) ? 16 : 8);
+      break;
+    }
+      // ADC  r8  r/m8
+      // ADC  r16 r/m16
+    case 0x12:
+    case 0x13: {
+      const uint8_t mod_rm = mem8(Sreg::CS, IP++);
+
+      const bool is_16bit = (opcode == 0x13);
+      adc_reg_rm(mod_rm, (is_16bit) ? 16 : 8);
+      break;
+    }
+      // adc AL imm8
+    case 0x14: {
+      const uint8_t rhs = mem8(Sreg::CS, IP++);
+      const uint16_t result = static_cast<uint16_t>(AL) +
+                              static_cast<uint16_t>(rhs) +
+                              static_cast<uint16_t>(CF());
+      set_flags_add(AL, rhs, result, 8);
+      AL = result & 0xFF;
+      break;
+    }
+      // adc eAX imm16/32
+    case 0x15: {
+      const uint16_t rhs = mem16(Sreg::CS, IP);
+      IP += 2;
+
+      const uint32_t result = static_cast<uint32_t>(AX) +
+                              static_cast<uint32_t>(rhs) +
+                              static_cast<uint32_t>(CF());
+      set_flags_add(AX, rhs, result, 16);
+      AX = result & 0xFFFF;
+      break;
+    }
+      // SUB
+      // SUB  r/m8  r8
+      // SUB  r/m16 r16
+    case 0x28:
+    case 0x29: {
+      const uint8_t mod_rm = mem8(Sreg::CS, IP++);
+
+      const bool is_16bit = (opcode == 0x29);
+      sub_rm_reg(mod_rm, (is_16bit) ? 16 : 8);
+      break;
+    }
+      // SUB  r8  r/m8
+      // SUB  r16 r/m16
+    case 0x2A:
+    case 0x2B: {
+      const uint8_t mod_rm = mem8(Sreg::CS, IP++);
+
+      const bool is_16bit = (opcode == 0x2B);
+      sub_reg_rm(mod_rm, (is_16bit) ? 16 : 8);
+      break;
+    }
+      // sub AL imm8
+    case 0x2C: {
+      const uint8_t rhs = mem8(Sreg::CS, IP++);
+      const uint16_t result =
+          static_cast<uint16_t>(AL) - static_cast<uint16_t>(rhs);
+      set_flags_sub(AL, rhs, result, 8);
+      AL = result & 0xFF;
+      break;
+    }
+      // sub eAX imm16/32
+    case 0x2D: {
+      const uint16_t rhs = mem16(Sreg::CS, IP);
+      IP += 2;
+
+      const uint32_t result =
+          static_cast<uint32_t>(AX) - static_cast<uint32_t>(rhs);
+      set_flags_sub(AX, rhs, result, 16);
+      AX = result & 0xFFFF;
+      break;
+    }
+      // SBB
+      // SBB  r/m8  r8
+      // SBB  r/m16 r16
+    case 0x18:
+    case 0x19: {
+      const uint8_t mod_rm = mem8(Sreg::CS, IP++);
+
+      const bool is_16bit = (opcode == 0x19);
+      sbb_rm_reg(mod_rm, (is_16bit) ? 16 : 8);
+      break;
+    }
+      // SBB  r8  r/m8
+      // SBB  r16 r/m16
+    case 0x1A:
+    case 0x1B: {
+      const uint8_t mod_rm = mem8(Sreg::CS, IP++);
+
+      const bool is_16bit = (opcode == 0x1B);
+      sbb_reg_rm(mod_rm, (is_16bit) ? 16 : 8);
+      break;
+    }
+      // sbb AL imm8
+    case 0x1C: {
+      const uint8_t rhs = mem8(Sreg::CS, IP++);
+      const uint16_t result = static_cast<uint16_t>(AL) -
+                              static_cast<uint16_t>(rhs) -
+                              static_cast<uint16_t>(CF());
+      set_flags_sub(AL, rhs, result, 8);
+      AL = result & 0xFF;
+      break;
+    }
+      // sbb eAX imm16/32
+    case 0x1D: {
+      const uint16_t rhs = mem16(Sreg::CS, IP);
+      IP += 2;
+
+      const uint32_t result = static_cast<uint32_t>(AX) -
+                              static_cast<uint32_t>(rhs) -
+                              static_cast<uint32_t>(CF());
+      set_flags_sub(AX, rhs, result, 16);
+      AX = result & 0xFFFF;
+      break;
+    }
+      // INC
+      // INC r16/32
+    case 0x40:
+    case 0x41:
+    case 0x42:
+    case 0x43:
+    case 0x44:
+    case 0x45:
+    case 0x46:
+    case 0x47: {
+      const uint8_t oldCF = CF();
+
+      const uint32_t result = static_cast<uint32_t>(*reg16[opcode - 0x40]) +
+                              static_cast<uint32_t>(1);
+      set_flags_add(*reg16[opcode - 0x40], 1, result, 16);
+      *reg16[opcode - 0x40] = result;
+
+      SetCF(oldCF);
+      break;
+    }
+      // DEC
+      // DEC r16/32
+    case 0x48:
+    case 0x49:
+    case 0x4A:
+    case 0x4B:
+    case 0x4C:
+    case 0x4D:
+    case 0x4E:
+    case 0x4F: {
+      const uint8_t oldCF = CF();
+
+      const uint32_t result = static_cast<uint32_t>(*reg16[opcode - 0x48]) -
+                              static_cast<uint32_t>(1);
+      set_flags_sub(*reg16[opcode - 0x48], 1, result, 16);
+      *reg16[opcode - 0x48] = result;
+
+      SetCF(oldCF);
+      break;
+    }
+      // JMP
+      // JO e8
+    case 0x70: {
+      const int8_t offset = static_cast<int8_t>(mem8(Sreg::CS, IP++));
+      if (OF()) {
+        jump_short(offset);
       }
-        // INC
-        // INC r16/32
-      case 0x40:
-      case 0x41:
-      case 0x42:
-      case 0x43:
-      case 0x44:
-      case 0x45:
-      case 0x46:
-      case 0x47: {
-        const uint8_t oldCF = CF();
-
-        const uint32_t result = static_cast<uint32_t>(*reg16[opcode - 0x40]) +
-                                static_cast<uint32_t>(1);
-        set_flags_add(*reg16[opcode - 0x40], 1, result, 16);
-        *reg16[opcode - 0x40] = result;
-
-        SetCF(oldCF);
-        break;
+      break;
+    }
+      // JNO e8
+    case 0x71: {
+      const int8_t offset = static_cast<int8_t>(mem8(Sreg::CS, IP++));
+      if (!OF()) {
+        jump_short(offset);
       }
-        // DEC
-        // DEC r16/32
-      case 0x48:
-      case 0x49:
-      case 0x4A:
-      case 0x4B:
-      case 0x4C:
-      case 0x4D:
-      case 0x4E:
-      case 0x4F: {
-        const uint8_t oldCF = CF();
-
-        const uint32_t result = static_cast<uint32_t>(*reg16[opcode - 0x48]) -
-                                static_cast<uint32_t>(1);
-        set_flags_sub(*reg16[opcode - 0x48], 1, result, 16);
-        *reg16[opcode - 0x48] = result;
-
-        SetCF(oldCF);
-        break;
+      break;
+    }
+      // JB e8
+    case 0x72: {
+      const int8_t offset = static_cast<int8_t>(mem8(Sreg::CS, IP++));
+      if (CF()) {
+        jump_short(offset);
       }
-        // JMP
-        // JO e8
-      case 0x70: {
-        const int8_t offset = static_cast<int8_t>(mem8(CS, IP++));
-        if (OF()) {
-          IP += offset;
-        }
-        break;
+      break;
+    }
+      // JNB e8
+    case 0x73: {
+      const int8_t offset = static_cast<int8_t>(mem8(Sreg::CS, IP++));
+      if (!CF()) {
+        jump_short(offset);
       }
-        // JNO e8
-      case 0x71: {
-        const int8_t offset = static_cast<int8_t>(mem8(CS, IP++));
-        if (!OF()) {
-          IP += offset;
-        }
-        break;
+      break;
+    }
+      // JZ e8
+    case 0x74: {
+      const int8_t offset = static_cast<int8_t>(mem8(Sreg::CS, IP++));
+      if (ZF()) {
+        jump_short(offset);
       }
-        // JB e8
-      case 0x72: {
-        const int8_t offset = static_cast<int8_t>(mem8(CS, IP++));
-        if (CF()) {
-          IP += offset;
-        }
-        break;
+      break;
+    }
+      // JNZ e8
+    case 0x75: {
+      const int8_t offset = static_cast<int8_t>(mem8(Sreg::CS, IP++));
+      if (!ZF()) {
+        jump_short(offset);
       }
-        // JNB e8
-      case 0x73: {
-        const int8_t offset = static_cast<int8_t>(mem8(CS, IP++));
-        if (!CF()) {
-          IP += offset;
-        }
-        break;
+      break;
+    }
+      // JBE e8
+    case 0x76: {
+      const int8_t offset = static_cast<int8_t>(mem8(Sreg::CS, IP++));
+      if (CF() || ZF()) {
+        jump_short(offset);
       }
-        // JZ e8
-      case 0x74: {
-        const int8_t offset = static_cast<int8_t>(mem8(CS, IP++));
-        if (ZF()) {
-          IP += offset;
-        }
-        break;
+      break;
+    }
+      // JNBE e8
+    case 0x77: {
+      const int8_t offset = static_cast<int8_t>(mem8(Sreg::CS, IP++));
+      if (!CF() && !ZF()) {
+        jump_short(offset);
       }
-        // JNZ e8
-      case 0x75: {
-        const int8_t offset = static_cast<int8_t>(mem8(CS, IP++));
-        if (!ZF()) {
-          IP += offset;
-        }
-        break;
+      break;
+    }
+      // JS e8
+    case 0x78: {
+      const int8_t offset = static_cast<int8_t>(mem8(Sreg::CS, IP++));
+      if (SF()) {
+        jump_short(offset);
       }
-        // JBE e8
-      case 0x76: {
-        const int8_t offset = static_cast<int8_t>(mem8(CS, IP++));
-        if (CF() || ZF()) {
-          IP += offset;
-        }
-        break;
+      break;
+    }
+      // JNS e8
+    case 0x79: {
+      const int8_t offset = static_cast<int8_t>(mem8(Sreg::CS, IP++));
+      if (!SF()) {
+        jump_short(offset);
       }
-        // JNBE e8
-      case 0x77: {
-        const int8_t offset = static_cast<int8_t>(mem8(CS, IP++));
-        if (!CF() && !ZF()) {
-          IP += offset;
-        }
-        break;
+      break;
+    }
+      // JP e8
+    case 0x7A: {
+      const int8_t offset = static_cast<int8_t>(mem8(Sreg::CS, IP++));
+      if (PF()) {
+        jump_short(offset);
       }
-        // JS e8
-      case 0x78: {
-        const int8_t offset = static_cast<int8_t>(mem8(CS, IP++));
-        if (SF()) {
-          IP += offset;
-        }
-        break;
+      break;
+    }
+      // JNP e8
+    case 0x7B: {
+      const int8_t offset = static_cast<int8_t>(mem8(Sreg::CS, IP++));
+      if (!PF()) {
+        jump_short(offset);
       }
-        // JNS e8
-      case 0x79: {
-        const int8_t offset = static_cast<int8_t>(mem8(CS, IP++));
-        if (!SF()) {
-          IP += offset;
-        }
-        break;
+      break;
+    }
+      // JL e8
+    case 0x7C: {
+      const int8_t offset = static_cast<int8_t>(mem8(Sreg::CS, IP++));
+      if (SF() != OF()) {
+        jump_short(offset);
       }
-        // JP e8
-      case 0x7A: {
-        const int8_t offset = static_cast<int8_t>(mem8(CS, IP++));
-        if (PF()) {
-          IP += offset;
-        }
-        break;
+      break;
+    }
+      // JNL e8
+    case 0x7D: {
+      const int8_t offset = static_cast<int8_t>(mem8(Sreg::CS, IP++));
+      if (SF() == OF()) {
+        jump_short(offset);
       }
-        // JNP e8
-      case 0x7B: {
-        const int8_t offset = static_cast<int8_t>(mem8(CS, IP++));
-        if (!PF()) {
-          IP += offset;
-        }
-        break;
+      break;
+    }
+      // JLE e8
+    case 0x7E: {
+      const int8_t offset = static_cast<int8_t>(mem8(Sreg::CS, IP++));
+      if (ZF() && (SF() != OF())) {
+        jump_short(offset);
       }
-        // JL e8
-      case 0x7C: {
-        const int8_t offset = static_cast<int8_t>(mem8(CS, IP++));
-        if (SF() != OF()) {
-          IP += offset;
-        }
-        break;
+      break;
+    }
+      // JNLE e8
+    case 0x7F: {
+      const int8_t offset = static_cast<int8_t>(mem8(Sreg::CS, IP++));
+      if (!ZF() && (SF() == OF())) {
+        jump_short(offset);
       }
-        // JNL e8
-      case 0x7D: {
-        const int8_t offset = static_cast<int8_t>(mem8(CS, IP++));
-        if (SF() == OF()) {
-          IP += offset;
-        }
-        break;
+      break;
+    }
+      // jmp e16
+    case 0xE9: {
+      const int16_t offset = static_cast<int16_t>(mem16(Sreg::CS, IP));
+      IP += 2;
+      jump_near(static_cast<uint16_t>(IP + offset));
+      break;
+    }
+      // jmpf ptr16:16/32
+    case 0xEA: {
+      const uint16_t new_IP = mem16(Sreg::CS, IP);
+      IP += 2;
+
+      const uint16_t new_CS = mem16(Sreg::CS, IP);
+      jump_far(new_CS, new_IP);
+      break;
+    }
+      // jmp e8
+    case 0xEB: {
+      const int8_t offset = static_cast<int8_t>(mem8(Sreg::CS, IP++));
+      jump_short(offset);
+      break;
+    }
+      // loopnz eCX
+    case 0xE0: {
+      const int8_t offset = static_cast<int8_t>(mem8(Sreg::CS, IP++));
+      if (((--CX) != 0) && !ZF()) {
+        jump_near(static_cast<uint16_t>(IP + offset));
       }
-        // JLE e8
-      case 0x7E: {
-        const int8_t offset = static_cast<int8_t>(mem8(CS, IP++));
-        if (ZF() && (SF() != OF())) {
-          IP += offset;
-        }
-        break;
+      break;
+    }
+      // loopz eCX
+    case 0xE1: {
+      const int8_t offset = static_cast<int8_t>(mem8(Sreg::CS, IP++));
+      if (((--CX) != 0) && ZF()) {
+        jump_near(static_cast<uint16_t>(IP + offset));
       }
-        // JNLE e8
-      case 0x7F: {
-        const int8_t offset = static_cast<int8_t>(mem8(CS, IP++));
-        if (!ZF() && (SF() == OF())) {
-          IP += offset;
-        }
-        break;
+      break;
+    }
+      // loop eCX
+    case 0xE2: {
+      const int8_t offset = static_cast<int8_t>(mem8(Sreg::CS, IP++));
+      if ((--CX) != 0) {
+        jump_near(static_cast<uint16_t>(IP + offset));
       }
-        // jmp e16
-      case 0xE9: {
-        const int16_t offset = static_cast<int16_t>(mem16(CS, IP));
-        IP += 2;
-        IP += offset;
-        break;
+      break;
+    }
+      // loop eCX
+    case 0xE3: {
+      const int8_t offset = static_cast<int8_t>(mem8(Sreg::CS, IP++));
+      if (CX == 0) {
+        jump_near(static_cast<uint16_t>(IP + offset));
       }
-        // jmpf ptr16:16/32
-      case 0xEA: {
-        const uint16_t new_IP = mem16(CS, IP);
-        IP += 2;
+      break;
+    }
+      // callf ptr16:16/32
+    case 0x9A: {
+      const uint16_t new_IP = mem16(Sreg::CS, IP);
+      IP += 2;
 
-        const uint16_t new_CS = mem16(CS, IP);
-        IP += 2;
+      const uint16_t new_CS = mem16(Sreg::CS, IP);
+      IP += 2;
 
-        IP = new_IP;
-        CS = new_CS;
-        break;
-      }
-        // jmp e8
-      case 0xEB: {
-        const int8_t offset = static_cast<int8_t>(mem8(CS, IP++));
-        IP += offset;
-        break;
-      }
-        // loopnz eCX
-      case 0xE0: {
-        const int8_t offset = static_cast<int8_t>(mem8(CS, IP++));
-        if (((--CX) != 0) && !ZF()) {
-          IP += offset;
-        }
-        break;
-      }
-        // loopz eCX
-      case 0xE1: {
-        const int8_t offset = static_cast<int8_t>(mem8(CS, IP++));
-        if (((--CX) != 0) && ZF()) {
-          IP += offset;
-        }
-        break;
-      }
-        // loop eCX
-      case 0xE2: {
-        const int8_t offset = static_cast<int8_t>(mem8(CS, IP++));
-        if ((--CX) != 0) {
-          IP += offset;
-        }
-        break;
-      }
-        // loop eCX
-      case 0xE3: {
-        const int8_t offset = static_cast<int8_t>(mem8(CS, IP++));
-        if (CX == 0) {
-          IP += offset;
-        }
-        break;
-      }
-        // callf ptr16:16/32
-      case 0x9A: {
-        const uint16_t new_IP = mem16(CS, IP);
-        IP += 2;
+      SP -= 2;
+      mem16(Sreg::SS, SP) = CS;
+      SP -= 2;
+      mem16(Sreg::SS, SP) = IP;
 
-        const uint16_t new_CS = mem16(CS, IP);
-        IP += 2;
+      jump_far(new_CS, new_IP);
+      break;
+    }
+      // call e16
+    case 0xE8: {
+      const int16_t offset = static_cast<int16_t>(mem16(Sreg::CS, IP));
+      IP += 2;
 
-        SP -= 2;
-        mem16(SS, SP) = CS;
-        SP -= 2;
-        mem16(SS, SP) = IP;
+      SP -= 2;
+      mem16(Sreg::SS, SP) = IP;
 
-        IP = new_IP;
-        CS = new_CS;
-        break;
-      }
-        // call e16
-      case 0xE8: {
-        const int16_t offset = static_cast<int16_t>(mem16(CS, IP));
-        IP += 2;
+      jump_near(static_cast<uint16_t>(IP + offset));
+      break;
+    }
+      // RET
+      // retn imm16
+    case 0xC2: {
+      const uint16_t val = mem16(Sreg::CS, IP);
 
-        SP -= 2;
-        mem16(SS, SP) = IP;
+      jump_near(mem16(Sreg::SS, SP));
+      SP += 2;
 
-        IP += offset;
-        break;
-      }
-        // RET
-        // retn imm16
-      case 0xC2: {
-        const uint16_t val = mem16(CS, IP);
-        IP += 2;
+      SP += val;
+      break;
+    }
+      // retn
+    case 0xC3: {
+      jump_near(mem16(Sreg::SS, SP));
+      SP += 2;
+      break;
+    }
+      // LES /r
+      // LDS /r
+    case 0xC4:
+    case 0xC5: {
+      const uint8_t mod_rm = mem8(Sreg::CS, IP++);
+      const bool is_lds = (opcode == 0xC5);
 
-        IP = mem16(SS, SP);
-        SP += 2;
+      les_lds(mod_rm, is_lds);
 
-        SP += val;
-        break;
-      }
-        // retn
-      case 0xC3: {
-        IP = mem16(SS, SP);
-        SP += 2;
-        break;
-      }
-        // LES /r
-        // LDS /r
-      case 0xC4:
-      case 0xC5: {
-        const uint8_t mod_rm = mem8(CS, IP++);
-        const bool is_lds = (opcode == 0xC5);
+      break;
+    }
+      // retf imm16
+    case 0xCA: {
+      const uint16_t val = mem16(Sreg::CS, IP);
 
-        les_lds(mod_rm, is_lds);
+      const uint16_t new_IP = mem16(Sreg::SS, SP);
+      SP += 2;
+      const uint16_t new_CS = mem16(Sreg::SS, SP);
+      SP += 2;
+      jump_far(new_CS, new_IP);
 
-        break;
-      }
-        // retf imm16
-      case 0xCA: {
-        const uint16_t val = mem16(CS, IP);
-        IP += 2;
-
-        IP = mem16(SS, SP);
-        SP += 2;
-        CS = mem16(SS, SP);
-        SP += 2;
-
-        SP += val;
-        break;
-      }
-        // retf
-      case 0xCB: {
-        IP = mem16(SS, SP);
-        SP += 2;
-        CS = mem16(SS, SP);
-        SP += 2;
-
-        break;
-      }
-        // DAA
-      case 0x27: {
-        DAA();
-        break;
-      }
-        // DAS
-      case 0x2F: {
-        DAS();
-        break;
-      }
-        // AAA
-      case 0x37: {
-        AAA();
-        break;
-      }
-        // AAS
-      case 0x3F: {
-        AAS();
-        break;
-      }
-        // AAM
-      case 0xD4: {
-        const uint8_t base = mem8(CS, IP++);
-        AAM(base);
-        break;
-      }
-        // AAD
-      case 0xD5: {
-        const uint8_t base = mem8(CS, IP++);
-        AAD(base);
-        break;
-      }
-        // CMP
-        // cmp r/m8  r8      (0x38)
-        // cmp r/m16 r16     (0x39)
-      case 0x38:
-      case 0x39: {
-        const uint8_t mod_rm = mem8(CS, IP++);
-        const bool is_16bit = (opcode == 0x39);
-        cmp_rm_reg(mod_rm, is_16bit ? 16 : 8);
-        break;
-      }
-        // cmp r8  r/m8     (0x3A)
-        // cmp r16 r/m16    (0x3B)
-      case 0x3A:
-      case 0x3B: {
-        const uint8_t mod_rm = mem8(CS, IP++);
-        const bool is_16bit = (opcode == 0x3B);
-        cmp_reg_rm(mod_rm, is_16bit ? 16 : 8);
-        break;
-      }
-        // cmp AL imm8
-      case 0x3C: {
-        const uint8_t rhs = mem8(CS, IP++);
-        const uint16_t result =
-            static_cast<uint16_t>(AL) - static_cast<uint16_t>(rhs);
-        set_flags_sub(AL, rhs, result, 8);
-        break;
-      }
-        // cmp eAX imm16/32
-      case 0x3D: {
-        const uint16_t rhs = mem16(CS, IP);
-        IP += 2;
-
-        const uint32_t result =
-            static_cast<uint32_t>(AX) - static_cast<uint32_t>(rhs);
-        set_flags_sub(AX, rhs, result, 16);
-        break;
-      }
-        /*
-         * 80   /6   XOR   r/m8   imm8
-         * 80   /0   ADD   r/m8   imm8
-         * 80   /1   OR    r/m8   imm8
-         * 80   /7   CMP   r/m8   imm8
-         * 80   /2   ADC   r/m8   imm8
-         * 80   /3   SBB   r/m8   imm8
-         * 80   /4   AND   r/m8   imm8
-         * 80   /5   SUB   r/m8   imm8
-         */
-
-        /*
-         * 81   /6   XOR   r/m16   imm16
-         * 81   /0   ADD   r/m16   imm16
-         * 81   /1   OR    r/m16   imm16
-         * 81   /7   CMP   r/m16   imm16
-         * 81   /2   ADC   r/m16   imm16
-         * 81   /3   SBB   r/m16   imm16
-         * 81   /4   AND   r/m16   imm16
-         * 81   /5   SUB   r/m16   imm16
-         */
-      case 0x80:
-      case 0x82:  // There is historical reason, but in 99% percent, 0x82 is
-                  // same as 0x80. 0x80 uses a sign-extended immediate   (but
-                  // both uses 8 bits imm8 and 8 bit register, so no need to
-                  // extend) 0x82 uses a zero - extended immediate
-      case 0x81: {
-        const uint8_t mod_rm = mem8(CS, IP++);
-        const bool is_16bit = (opcode == 0x81);
-        instr_80_81_82(mod_rm, (is_16bit) ? 16 : 8);
-
-        break;
-      }
-      case 0x83: /* Sign extended */ {
-        const uint8_t mod_rm = mem8(CS, IP++);
-        instr_83(mod_rm);
-        break;
-      }
-        // TEST
-        // test r/m8  r8      (0x84)
-        // test r/m16 r16     (0x85)
-      case 0x84:
-      case 0x85: {
-        const uint8_t mod_rm = mem8(CS, IP++);
-        const bool is_16bit = (opcode == 0x85);
-        test_rm_reg(mod_rm, (is_16bit) ? 16 : 8);
-
-        break;
-      }
-        // XCHG
-        // xchg r8   r/m8     (0x86)
-        // xchg r16  r/m16    (0x87)
-      case 0x86:
-      case 0x87: {
-        const uint8_t mod_rm = mem8(CS, IP++);
-        const bool is_16bit = (opcode == 0x87);
-        xchg_reg_rm(mod_rm, (is_16bit) ? 16 : 8);
-
-        break;
-      }
-        // NOP
-        // XCHG AX, AX
-      case 0x90: {
-        break;
-      }
-        // 0x90+r XCHG AX, r16
-      case 0x91:
-      case 0x92:
-      case 0x93:
-      case 0x94:
-      case 0x95:
-      case 0x96:
-      case 0x97: {
-        const uint16_t temp = *reg16[opcode - 0x90];
-        uint16_t& rhs = *reg16[opcode - 0x90];
-        rhs = AX;
-        AX = temp;
-        break;
-      }
-        // SHIFTS
-        // D0 0   ROL r/m8    1
-        // D0 1   ROR r/m8    1
-        // D0 2   RCL r/m8    1
-        // D0 3   RCR r/m8    1
-        // D0 4   SHL r/m8    1
-        // D0 5   SHR r/m8    1
-        // D0 6   SAL r/m8    1
-        // D0 7   SAR r/m8    1
-        //
-        // D1 0   ROL r/m16   1
-        // D1 1   ROR r/m16   1
-        // D1 2   RCL r/m16   1
-        // D1 3   RCR r/m16   1
-        // D1 4   SHL r/m16   1
-        // D1 5   SHR r/m16   1
-        // D1 6   SAL r/m16   1
-        // D1 7   SAR r/m16   1
-      case 0xD0:
-      case 0xD1: {
-        const uint8_t mod_rm = mem8(CS, IP++);
-        const bool is_16bit = (opcode == 0xD1);
-        instr_d0_d1_d2_d3_c0_c1(mod_rm, (is_16bit) ? 16 : 8, 1);
-
-        break;
-      }
-        // D2 0   ROL r/m8    CL
-        // D2 1   ROR r/m8    CL
-        // D2 2   RCL r/m8    CL
-        // D2 3   RCR r/m8    CL
-        // D2 4   SHL r/m8    CL
-        // D2 5   SHR r/m8    CL
-        // D2 6   SAL r/m8    CL
-        // D2 7   SAR r/m8    CL
-        //
-        // D3 0   ROL r/m16   CL
-        // D3 1   ROR r/m16   CL
-        // D3 2   RCL r/m16   CL
-        // D3 3   RCR r/m16   CL
-        // D3 4   SHL r/m16   CL
-        // D3 5   SHR r/m16   CL
-        // D3 6   SAL r/m16   CL
-        // D3 7   SAR r/m16   CL
-      case 0xD2:
-      case 0xD3: {
-        const uint8_t mod_rm = mem8(CS, IP++);
-        const bool is_16bit = (opcode == 0xD3);
-        instr_d0_d1_d2_d3_c0_c1(mod_rm, (is_16bit) ? 16 : 8, CL);
-
-        break;
-      }
-      // XLAT
-      case 0xD7: {
-        // zero_extend can be simple static_cast
-        AL = mem8(DS, BX + static_cast<uint16_t>(AL));
-        break;
-      }
+      SP += val;
+      break;
+    }
+      // retf
+    case 0xCB: {
+      const uint16_t new_IP = mem16(Sreg::SS, SP);
+      SP += 2;
+      const uint16_t new_CS = mem16(Sreg::SS, SP);
+      SP += 2;
+      jump_far(new_CS, new_IP);
+      break;
+    }
+      // DAA
+    case 0x27: {
+      DAA();
+      break;
+    }
+      // DAS
+    case 0x2F: {
+      DAS();
+      break;
+    }
+      // AAA
+    case 0x37: {
+      AAA();
+      break;
+    }
+      // AAS
+    case 0x3F: {
+      AAS();
+      break;
+    }
+      // AAM
+    case 0xD4: {
+      const uint8_t base = mem8(Sreg::CS, IP++);
+      AAM(base);
+      break;
+    }
+      // AAD
+    case 0xD5: {
+      const uint8_t base = mem8(Sreg::CS, IP++);
+      AAD(base);
+      break;
+    }
+      // CMP
+      // cmp r/m8  r8      (0x38)
+      // cmp r/m16 r16     (0x39)
+    case 0x38:
+    case 0x39: {
+      const uint8_t mod_rm = mem8(Sreg::CS, IP++);
+      const bool is_16bit = (opcode == 0x39);
+      cmp_rm_reg(mod_rm, is_16bit ? 16 : 8);
+      break;
+    }
+      // cmp r8  r/m8     (0x3A)
+      // cmp r16 r/m16    (0x3B)
+    case 0x3A:
+    case 0x3B: {
+      const uint8_t mod_rm = mem8(Sreg::CS, IP++);
+      const bool is_16bit = (opcode == 0x3B);
+      cmp_reg_rm(mod_rm, is_16bit ? 16 : 8);
+      break;
+    }
+      // cmp AL imm8
+    case 0x3C: {
+      const uint8_t rhs = mem8(Sreg::CS, IP++);
+      const uint16_t result =
+          static_cast<uint16_t>(AL) - static_cast<uint16_t>(rhs);
+      set_flags_sub(AL, rhs, result, 8);
+      break;
+    }
+      // cmp eAX imm16/32
+    case 0x3D: {
+      const uint16_t rhs = mem16(Sreg::CS, IP);
+      IP += 2;
+
+      const uint32_t result =
+          static_cast<uint32_t>(AX) - static_cast<uint32_t>(rhs);
+      set_flags_sub(AX, rhs, result, 16);
+      break;
+    }
+      /*
+       * 80   /6   XOR   r/m8   imm8
+       * 80   /0   ADD   r/m8   imm8
+       * 80   /1   OR    r/m8   imm8
+       * 80   /7   CMP   r/m8   imm8
+       * 80   /2   ADC   r/m8   imm8
+       * 80   /3   SBB   r/m8   imm8
+       * 80   /4   AND   r/m8   imm8
+       * 80   /5   SUB   r/m8   imm8
+       */
+
+      /*
+       * 81   /6   XOR   r/m16   imm16
+       * 81   /0   ADD   r/m16   imm16
+       * 81   /1   OR    r/m16   imm16
+       * 81   /7   CMP   r/m16   imm16
+       * 81   /2   ADC   r/m16   imm16
+       * 81   /3   SBB   r/m16   imm16
+       * 81   /4   AND   r/m16   imm16
+       * 81   /5   SUB   r/m16   imm16
+       */
+    case 0x80:
+    case 0x82:  // There is historical reason, but in 99% percent, 0x82 is
+                // same as 0x80. 0x80 uses a sign-extended immediate   (but
+                // both uses 8 bits imm8 and 8 bit register, so no need to
+                // extend) 0x82 uses a zero - extended immediate
+    case 0x81: {
+      const uint8_t mod_rm = mem8(Sreg::CS, IP++);
+      const bool is_16bit = (opcode == 0x81);
+      instr_80_81_82(mod_rm, (is_16bit) ? 16 : 8);
 
-        // C0 0   ROL r/m8    imm8
-        // C0 1   ROR r/m8    imm8
-        // C0 2   RCL r/m8    imm8
-        // C0 3   RCR r/m8    imm8
-        // C0 4   SHL r/m8    imm8
-        // C0 5   SHR r/m8    imm8
-        // C0 6   SAL r/m8    imm8
-        // C0 7   SAR r/m8    imm8
-        //
-        // C1 0   ROL r/m16   imm8
-        // C1 1   ROR r/m16   imm8
-        // C1 2   RCL r/m16   imm8
-        // C1 3   RCR r/m16   imm8
-        // C1 4   SHL r/m16   imm8
-        // C1 5   SHR r/m16   imm8
-        // C1 6   SAL r/m16   imm8
-        // C1 7   SAR r/m16   imm8
-      case 0xC0:
-      case 0xC1: {
-        const uint8_t mod_rm = mem8(CS, IP++);
-        const uint8_t times = mem8(CS, IP++);
-        const bool is_16bit = (opcode == 0xC1);
-        instr_d0_d1_d2_d3_c0_c1(mod_rm, (is_16bit) ? 16 : 8, times);
-
-        break;
-      }
-        // PUSH 50+r
-      case 0x50:
-      case 0x51:
-      case 0x52:
-      case 0x53:
-      case 0x55:
-      case 0x56:
-      case 0x57: {
-        SP -= 2;
-        mem16(SS, SP) = *reg16[opcode - 0x50];
-        break;
-      }
-        // PUSHF
-      case 0x9C: {
-        SP -= 2;
-        mem16(SS, SP) = FLAGS;
-        break;
-      }
-        // POPF
-      case 0x9D: {
-        FLAGS = mem16(SS, SP);
-        FLAGS |= 0b0000'0000'0000'0010;
-        SP += 2;
-        break;
-      }
-        // SAHF
-      case 0x9E: {
-        const uint8_t ah = AH & 0b1101'0111;
-        FLAGS &= 0b1111'1111'0000'0000;
-        FLAGS |= ah;
-        FLAGS |= 0b0000'0000'0000'0010;
-        break;
-      }
-        // LAHF
-      case 0x9F: {
-        const uint8_t flags =
-            static_cast<uint8_t>(FLAGS & 0b0000'0000'1101'0111);
-        AH = flags;
-        break;
-      }
-        // Special SP case
-      case 0x54: {
-        if (cpu_mode <= CPU_MODE::CPU_80186) {
-          SP -= 2;
-          mem16(SS, SP) = SP;
-        } else {
-          const uint16_t origSP = SP;
-          SP -= 2;
-          mem16(SS, SP) = origSP;
-        }
+      break;
+    }
+    case 0x83: /* Sign extended */ {
+      const uint8_t mod_rm = mem8(Sreg::CS, IP++);
+      instr_83(mod_rm);
+      break;
+    }
+      // TEST
+      // test r/m8  r8      (0x84)
+      // test r/m16 r16     (0x85)
+    case 0x84:
+    case 0x85: {
+      const uint8_t mod_rm = mem8(Sreg::CS, IP++);
+      const bool is_16bit = (opcode == 0x85);
+      test_rm_reg(mod_rm, (is_16bit) ? 16 : 8);
 
-        break;
-      }
-        // PUSH ES
-      case 0x06: {
-        SP -= 2;
-        mem16(SS, SP) = ES;
-        break;
-      }
-        // PUSH SS
-      case 0x16: {
-        SP -= 2;
-        mem16(SS, SP) = SS;
-        break;
-      }
-        // PUSH DS
-      case 0x1E: {
-        SP -= 2;
-        mem16(SS, SP) = DS;
-        break;
-      }
-        // PUSH imm16
-      case 0x68: {
-        const uint16_t val = mem16(CS, IP);
-        IP += 2;
+      break;
+    }
+      // test AL  imm8      (0xA8)
+      // test AX  imm16     (0xA9)
+    case 0xA8: {
+      const uint8_t rhs = mem8(Sreg::CS, IP++);
+      set_flags_logical(AL & rhs, 8);
+      SetCF(0);
+      SetOF(0);
+      break;
+    }
+    case 0xA9: {
+      const uint16_t rhs = mem16(Sreg::CS, IP);
+      IP += 2;
+      set_flags_logical(AX & rhs, 16);
+      SetCF(0);
+      SetOF(0);
+      break;
+    }
+      // XCHG
+      // xchg r8   r/m8     (0x86)
+      // xchg r16  r/m16    (0x87)
+    case 0x86:
+    case 0x87: {
+      const uint8_t mod_rm = mem8(Sreg::CS, IP++);
+      const bool is_16bit = (opcode == 0x87);
+      xchg_reg_rm(mod_rm, (is_16bit) ? 16 : 8);
+
+      break;
+    }
+      // NOP
+      // XCHG AX, AX
+    case 0x90: {
+      break;
+    }
+      // 0x90+r XCHG AX, r16
+    case 0x91:
+    case 0x92:
+    case 0x93:
+    case 0x94:
+    case 0x95:
+    case 0x96:
+    case 0x97: {
+      const uint16_t temp = *reg16[opcode - 0x90];
+      uint16_t& rhs = *reg16[opcode - 0x90];
+      rhs = AX;
+      AX = temp;
+      break;
+    }
+      // SHIFTS
+      // D0 0   ROL r/m8    1
+      // D0 1   ROR r/m8    1
+      // D0 2   RCL r/m8    1
+      // D0 3   RCR r/m8    1
+      // D0 4   SHL r/m8    1
+      // D0 5   SHR r/m8    1
+      // D0 6   SAL r/m8    1
+      // D0 7   SAR r/m8    1
+      //
+      // D1 0   ROL r/m16   1
+      // D1 1   ROR r/m16   1
+      // D1 2   RCL r/m16   1
+      // D1 3   RCR r/m16   1
+      // D1 4   SHL r/m16   1
+      // D1 5   SHR r/m16   1
+      // D1 6   SAL r/m16   1
+      // D1 7   SAR r/m16   1
+    case 0xD0:
+    case 0xD1: {
+      const uint8_t mod_rm = mem8(Sreg::CS, IP++);
+      const bool is_16bit = (opcode == 0xD1);
+      instr_d0_d1_d2_d3_c0_c1(mod_rm, (is_16bit) ? 16 : 8, 1);
+
+      break;
+    }
+      // D2 0   ROL r/m8    CL
+      // D2 1   ROR r/m8    CL
+      // D2 2   RCL r/m8    CL
+      // D2 3   RCR r/m8    CL
+      // D2 4   SHL r/m8    CL
+      // D2 5   SHR r/m8    CL
+      // D2 6   SAL r/m8    CL
+      // D2 7   SAR r/m8    CL
+      //
+      // D3 0   ROL r/m16   CL
+      // D3 1   ROR r/m16   CL
+      // D3 2   RCL r/m16   CL
+      // D3 3   RCR r/m16   CL
+      // D3 4   SHL r/m16   CL
+      // D3 5   SHR r/m16   CL
+      // D3 6   SAL r/m16   CL
+      // D3 7   SAR r/m16   CL
+    case 0xD2:
+    case 0xD3: {
+      const uint8_t mod_rm = mem8(Sreg::CS, IP++);
+      const bool is_16bit = (opcode == 0xD3);
+      instr_d0_d1_d2_d3_c0_c1(mod_rm, (is_16bit) ? 16 : 8, CL);
+
+      break;
+    }
+    // XLAT
+    case 0xD7: {
+      // zero_extend can be simple static_cast
+      AL = mem8(Sreg::DS, BX + static_cast<uint16_t>(AL));
+      break;
+    }
+      // ESC, coprocessor instructions
+    case 0xD8:
+    case 0xD9:
+    case 0xDA:
+    case 0xDB:
+    case 0xDC:
+    case 0xDD:
+    case 0xDE:
+    case 0xDF: {
+      const uint8_t mod_rm = mem8(Sreg::CS, IP++);
+      esc(opcode, mod_rm);
+      break;
+    }
 
+      // PUSH 50+r
+    case 0x50:
+    case 0x51:
+    case 0x52:
+    case 0x53:
+    case 0x55:
+    case 0x56:
+    case 0x57: {
+      SP -= 2;
+      mem16(Sreg::SS, SP) = *reg16[opcode - 0x50];
+      break;
+    }
+      // PUSHF
+    case 0x9C: {
+      SP -= 2;
+      mem16(Sreg::SS, SP) = FLAGS;
+      break;
+    }
+      // POPF
+    case 0x9D: {
+      FLAGS = mem16(Sreg::SS, SP);
+      FLAGS |= 0b0000'0000'0000'0010;
+      SP += 2;
+      break;
+    }
+      // SAHF
+    case 0x9E: {
+      const uint8_t ah = AH & 0b1101'0111;
+      FLAGS &= 0b1111'1111'0000'0000;
+      FLAGS |= ah;
+      FLAGS |= 0b0000'0000'0000'0010;
+      break;
+    }
+      // LAHF
+    case 0x9F: {
+      const uint8_t flags =
+          static_cast<uint8_t>(FLAGS & 0b0000'0000'1101'0111);
+      AH = flags;
+      break;
+    }
+      // Special SP case
+    case 0x54: {
+      if (cpu_mode <= CPU_MODE::CPU_80186) {
         SP -= 2;
-        mem16(SS, SP) = val;
-        break;
-      }
-        // PUSH imm8 (sign extend)
-      case 0x6A: {
-        const uint16_t val = sign_extend(mem8(CS, IP++));
+        mem16(Sreg::SS, SP) = SP;
+      } else {
+        const uint16_t origSP = SP;
         SP -= 2;
-        mem16(SS, SP) = val;
-        break;
-      }
-        // POP 58+r
-      case 0x58:
-      case 0x59:
-      case 0x5A:
-      case 0x5B:
-      case 0x5C:
-      case 0x5D:
-      case 0x5E:
-      case 0x5F: {
-        *reg16[opcode - 0x58] = mem16(SS, SP);
-        SP += 2;
-        break;
-      }
-        // POP ES
-      case 0x07: {
-        ES = mem16(SS, SP);
-        SP += 2;
-        update_segment_register(ES);
-        break;
-      }
-        // POP SS
-      case 0x17: {
-        SS = mem16(SS, SP);
-        SP += 2;
-        interrupt_delay = 2;
-        update_segment_register(SS);
-        break;
-      }
-        // POP DS
-      case 0x1F: {
-        DS = mem16(SS, SP);
-        SP += 2;
-        update_segment_register(DS);
-        break;
+        mem16(Sreg::SS, SP) = origSP;
       }
-        // FE 0   INC r/m8
-        // FE 1   DEC r/m8
-      case 0xFE: {
-        const uint8_t mod_rm = mem8(CS, IP++);
-        instr_fe(mod_rm);
-        break;
-      }
-        // FF 0   INC    r/m16
-        // FF 1   DEC    r/m16
-        // FF 2   CALL   r/m16
-        // FF 3   CALLF  r/m16
-        // FF 4   JUMP   r/m16
-        // FF 5   JUMPF  r/m16
-        // FF 6   PUSH   r/m16
-      case 0xFF: {
-        const uint8_t mod_rm = mem8(CS, IP++);
-        instr_ff(mod_rm);
-        break;
-      }
-        // OR
-        // OR  r/m8  r8
-        // OR  r/m16 r16
-      case 0x08:
-      case 0x09: {
-        const uint8_t mod_rm = mem8(CS, IP++);
-
-        const bool is_16bit = (opcode == 0x09);
-        or_rm_reg(mod_rm, (is_16bit) ? 16 : 8);
-        break;
-      }
-        // OR  r8  r/m8
-        // OR  r16 r/m16
-      case 0x0A:
-      case 0x0B: {
-        const uint8_t mod_rm = mem8(CS, IP++);
-
-        const bool is_16bit = (opcode == 0x0B);
-        or_reg_rm(mod_rm, (is_16bit) ? 16 : 8);
-        break;
-      }
-        // OR AL imm8
-      case 0x0C: {
-        const uint8_t rhs = mem8(CS, IP++);
-        const uint16_t result =
-            static_cast<uint16_t>(AL) | static_cast<uint16_t>(rhs);
-        set_flags_logical(result, 8);
-        AL = result & 0xFF;
-        break;
-      }
-        // OR eAX imm16/32
-      case 0x0D: {
-        const uint16_t rhs = mem16(CS, IP);
-        IP += 2;
-
-        const uint32_t result =
-            static_cast<uint32_t>(AX) | static_cast<uint32_t>(rhs);
-        set_flags_logical(result, 16);
-        AX = result & 0xFFFF;
-        break;
-      }
-        // AND
-        // AND  r/m8  r8
-        // AND  r/m16 r16
-      case 0x20:
-      case 0x21: {
-        const uint8_t mod_rm = mem8(CS, IP++);
-
-        const bool is_16bit = (opcode == 0x21);
-        and_rm_reg(mod_rm, (is_16bit) ? 16 : 8);
-        break;
-      }
-        // AND  r8  r/m8
-        // AND  r16 r/m16
-      case 0x22:
-      case 0x23: {
-        const uint8_t mod_rm = mem8(CS, IP++);
-
-        const bool is_16bit = (opcode == 0x23);
-        and_reg_rm(mod_rm, (is_16bit) ? 16 : 8);
-        break;
-      }
-        // AND AL imm8
-      case 0x24: {
-        const uint8_t rhs = mem8(CS, IP++);
-        const uint16_t result =
-            static_cast<uint16_t>(AL) & static_cast<uint16_t>(rhs);
-        set_flags_logical(result, 8);
-        AL = result & 0xFF;
-        break;
-      }
-        // AND eAX imm16/32
-      case 0x25: {
-        const uint16_t rhs = mem16(CS, IP);
-        IP += 2;
-
-        const uint32_t result =
-            static_cast<uint32_t>(AX) & static_cast<uint32_t>(rhs);
-        set_flags_logical(result, 16);
-        AX = result & 0xFFFF;
-        break;
-      }
-        // XOR
-        // XOR  r/m8  r8
-        // XOR  r/m16 r16
-      case 0x30:
-      case 0x31: {
-        const uint8_t mod_rm = mem8(CS, IP++);
-
-        const bool is_16bit = (opcode == 0x31);
-        xor_rm_reg(mod_rm, (is_16bit) ? 16 : 8);
-        break;
-      }
-        // XOR  r8  r/m8
-        // XOR  r16 r/m16
-      case 0x32:
-      case 0x33: {
-        const uint8_t mod_rm = mem8(CS, IP++);
-
-        const bool is_16bit = (opcode == 0x33);
-        xor_reg_rm(mod_rm, (is_16bit) ? 16 : 8);
-        break;
-      }
-        // XOR AL imm8
-      case 0x34: {
-        const uint8_t rhs = mem8(CS, IP++);
-        const uint16_t result =
-            static_cast<uint16_t>(AL) ^ static_cast<uint16_t>(rhs);
-        set_flags_logical(result, 8);
-        AL = result & 0xFF;
-        break;
-      }
-        // XOR eAX imm16/32
-      case 0x35: {
-        const uint16_t rhs = mem16(CS, IP);
-        IP += 2;
-
-        const uint32_t result =
-            static_cast<uint32_t>(AX) ^ static_cast<uint32_t>(rhs);
-        set_flags_logical(result, 16);
-        AX = result & 0xFFFF;
-        break;
-      }
-        // LEA /r [address]
-      case 0x8D: {
-        const uint8_t mod_rm = mem8(CS, IP++);
 
-        lea_reg_rm(mod_rm);
-        break;
-      }
-        // CBW
-      case 0x98: {
-        AX = sign_extend(AL);
-        break;
-      }
-        // CWD
-      case 0x99: {
-        if (AX & 0b1000'0000'0000'0000) {
-          DX = 0b1111'1111'1111'1111;
-        } else {
-          DX = 0b0000'0000'0000'0000;
-        }
-        break;
-      }
-        // FWAIT
-      case 0x9B: {
-        // We don't have a 0x8087 implementation
-        break;
-      }
-        // HLT
-      case 0xF4: {
-        /*
-          Will be revised later
-        */
-        throw ProgramExitedException{0};
-      }
-        // CMC
-      case 0xF5: {
-        SetCF(CF() ? 0 : 1);
-        break;
-      }
-        // CLC
-      case 0xF8: {
-        SetCF(0);
-        break;
-      }
-        // STC
-      case 0xF9: {
-        SetCF(1);
-        break;
-      }
-        // CLI
-      case 0xFA: {
-        SetIF(0);
-        break;
-      }
-        // STI
-      case 0xFB: {
-        SetIF(1);
-        interrupt_delay = 2;
-        break;
-      }
-        // CLD
-      case 0xFC: {
-        SetDF(0);
-        break;
-      }
-        // STD
-      case 0xFD: {
-        SetDF(1);
-        break;
+      break;
+    }
+      // PUSH ES
+    case 0x06: {
+      SP -= 2;
+      mem16(Sreg::SS, SP) = ES;
+      break;
+    }
+      // PUSH SS
+    case 0x16: {
+      SP -= 2;
+      mem16(Sreg::SS, SP) = SS;
+      break;
+    }
+      // PUSH DS
+    case 0x1E: {
+      SP -= 2;
+      mem16(Sreg::SS, SP) = DS;
+      break;
+    }
+      // POP 58+r
+    case 0x58:
+    case 0x59:
+    case 0x5A:
+    case 0x5B:
+    case 0x5C:
+    case 0x5D:
+    case 0x5E:
+    case 0x5F: {
+      *reg16[opcode - 0x58] = mem16(Sreg::SS, SP);
+      SP += 2;
+      break;
+    }
+      // POP ES
+    case 0x07: {
+      ES = mem16(Sreg::SS, SP);
+      SP += 2;
+      update_segment_register(ES);
+      break;
+    }
+      // POP SS
+    case 0x17: {
+      SS = mem16(Sreg::SS, SP);
+      SP += 2;
+      interrupt_delay = 2;
+      update_segment_register(SS);
+      break;
+    }
+      // POP DS
+    case 0x1F: {
+      DS = mem16(Sreg::SS, SP);
+      SP += 2;
+      update_segment_register(DS);
+      break;
+    }
+      // FE 0   INC r/m8
+      // FE 1   DEC r/m8
+    case 0xFE: {
+      const uint8_t mod_rm = mem8(Sreg::CS, IP++);
+      instr_fe(mod_rm);
+      break;
+    }
+      // FF 0   INC    r/m16
+      // FF 1   DEC    r/m16
+      // FF 2   CALL   r/m16
+      // FF 3   CALLF  r/m16
+      // FF 4   JUMP   r/m16
+      // FF 5   JUMPF  r/m16
+      // FF 6   PUSH   r/m16
+    case 0xFF: {
+      const uint8_t mod_rm = mem8(Sreg::CS, IP++);
+      instr_ff(mod_rm);
+      break;
+    }
+      // OR
+      // OR  r/m8  r8
+      // OR  r/m16 r16
+    case 0x08:
+    case 0x09: {
+      const uint8_t mod_rm = mem8(Sreg::CS, IP++);
+
+      const bool is_16bit = (opcode == 0x09);
+      or_rm_reg(mod_rm, (is_16bit) ? 16 : 8);
+      break;
+    }
+      // OR  r8  r/m8
+      // OR  r16 r/m16
+    case 0x0A:
+    case 0x0B: {
+      const uint8_t mod_rm = mem8(Sreg::CS, IP++);
+
+      const bool is_16bit = (opcode == 0x0B);
+      or_reg_rm(mod_rm, (is_16bit) ? 16 : 8);
+      break;
+    }
+      // OR AL imm8
+    case 0x0C: {
+      const uint8_t rhs = mem8(Sreg::CS, IP++);
+      const uint16_t result =
+          static_cast<uint16_t>(AL) | static_cast<uint16_t>(rhs);
+      set_flags_logical(result, 8);
+      AL = result & 0xFF;
+      break;
+    }
+      // OR eAX imm16/32
+    case 0x0D: {
+      const uint16_t rhs = mem16(Sreg::CS, IP);
+      IP += 2;
+
+      const uint32_t result =
+          static_cast<uint32_t>(AX) | static_cast<uint32_t>(rhs);
+      set_flags_logical(result, 16);
+      AX = result & 0xFFFF;
+      break;
+    }
+      // AND
+      // AND  r/m8  r8
+      // AND  r/m16 r16
+    case 0x20:
+    case 0x21: {
+      const uint8_t mod_rm = mem8(Sreg::CS, IP++);
+
+      const bool is_16bit = (opcode == 0x21);
+      and_rm_reg(mod_rm, (is_16bit) ? 16 : 8);
+      break;
+    }
+      // AND  r8  r/m8
+      // AND  r16 r/m16
+    case 0x22:
+    case 0x23: {
+      const uint8_t mod_rm = mem8(Sreg::CS, IP++);
+
+      const bool is_16bit = (opcode == 0x23);
+      and_reg_rm(mod_rm, (is_16bit) ? 16 : 8);
+      break;
+    }
+      // AND AL imm8
+    case 0x24: {
+      const uint8_t rhs = mem8(Sreg::CS, IP++);
+      const uint16_t result =
+          static_cast<uint16_t>(AL) & static_cast<uint16_t>(rhs);
+      set_flags_logical(result, 8);
+      AL = result & 0xFF;
+      break;
+    }
+      // AND eAX imm16/32
+    case 0x25: {
+      const uint16_t rhs = mem16(Sreg::CS, IP);
+      IP += 2;
+
+      const uint32_t result =
+          static_cast<uint32_t>(AX) & static_cast<uint32_t>(rhs);
+      set_flags_logical(result, 16);
+      AX = result & 0xFFFF;
+      break;
+    }
+      // XOR
+      // XOR  r/m8  r8
+      // XOR  r/m16 r16
+    case 0x30:
+    case 0x31: {
+      const uint8_t mod_rm = mem8(Sreg::CS, IP++);
+
+      const bool is_16bit = (opcode == 0x31);
+      xor_rm_reg(mod_rm, (is_16bit) ? 16 : 8);
+      break;
+    }
+      // XOR  r8  r/m8
+      // XOR  r16 r/m16
+    case 0x32:
+    case 0x33: {
+      const uint8_t mod_rm = mem8(Sreg::CS, IP++);
+
+      const bool is_16bit = (opcode == 0x33);
+      xor_reg_rm(mod_rm, (is_16bit) ? 16 : 8);
+      break;
+    }
+      // XOR AL imm8
+    case 0x34: {
+      const uint8_t rhs = mem8(Sreg::CS, IP++);
+      const uint16_t result =
+          static_cast<uint16_t>(AL) ^ static_cast<uint16_t>(rhs);
+      set_flags_logical(result, 8);
+      AL = result & 0xFF;
+      break;
+    }
+      // XOR eAX imm16/32
+    case 0x35: {
+      const uint16_t rhs = mem16(Sreg::CS, IP);
+      IP += 2;
+
+      const uint32_t result =
+          static_cast<uint32_t>(AX) ^ static_cast<uint32_t>(rhs);
+      set_flags_logical(result, 16);
+      AX = result & 0xFFFF;
+      break;
+    }
+      // LEA /r [address]
+    case 0x8D: {
+      const uint8_t mod_rm = mem8(Sreg::CS, IP++);
+
+      lea_reg_rm(mod_rm);
+      break;
+    }
+      // CBW
+    case 0x98: {
+      AX = sign_extend(AL);
+      break;
+    }
+      // CWD
+    case 0x99: {
+      if (AX & 0b1000'0000'0000'0000) {
+        DX = 0b1111'1111'1111'1111;
+      } else {
+        DX = 0b0000'0000'0000'0000;
       }
-      default:
-        mylog("Unsupported opcode '%.02X'", static_cast<int>(opcode));
-        return;
+      break;
+    }
+      // FWAIT
+    case 0x9B: {
+      // The FPU finishes every instruction before the CPU moves on
+      break;
+    }
+      // HLT
+    case 0xF4: {
+      halt();
+      break;
+    }
+      // CMC
+    case 0xF5: {
+      SetCF(CF() ? 0 : 1);
+      break;
+    }
+      // CLC
+    case 0xF8: {
+      SetCF(0);
+      break;
+    }
+      // STC
+    case 0xF9: {
+      SetCF(1);
+      break;
+    }
+      // CLI
+    case 0xFA: {
+      SetIF(0);
+      break;
+    }
+      // STI
+    case 0xFB: {
+      SetIF(1);
+      interrupt_delay = 2;
+      break;
+    }
+      // CLD
+    case 0xFC: {
+      SetDF(0);
+      break;
+    }
+      // STD
+    case 0xFD: {
+      SetDF(1);
+      break;
     }
+    default:
+      mylog("Unsupported opcode '%.02X'", static_cast<int>(opcode));
+      return false;
+  }
+
+  return true;
+}
+
+bool CPU8068::protected_mode() const { return MSW & MSW_PE; }
+
+uint32_t CPU8068::linear_address(const uint16_t segment,
+                                 const uint16_t offset) const {
+  return ((segment * SEGMENT_MULTIPLIER) + offset) & address_mask;
+}
+
+uint32_t CPU8068::linear_address(const Sreg segment,
+                                 const uint16_t offset) const {
+  const size_t index = static_cast<size_t>(segment);
+  if (!protected_mode()) {
+    return ((*sregs[index] * SEGMENT_MULTIPLIER) + offset) & address_mask;
+  }
+  return (segment_cache[index].base + offset) & address_mask;
+}
+
+uint8_t& CPU8068::mem8(const Sreg segment, const uint16_t offset) {
+  const uint32_t address = linear_address(segment, offset);
+  if (watching && watch_pages[address >> DEBUG_PAGE_BITS]) {
+    watch_access(address, 1);
   }
+  return memory[address];
 }
 
-uint8_t& CPU8068::mem8(const uint16_t CS, const uint16_t IP) {
-  return memory[(CS * SEGMENT_MULTIPLIER) + IP];
+uint16_t& CPU8068::mem16(const Sreg segment, const uint16_t offset) {
+  const uint32_t address = linear_address(segment, offset);
+  if (watching && (watch_pages[address >> DEBUG_PAGE_BITS] ||
+                   watch_pages[(address + 1) >> DEBUG_PAGE_BITS])) {
+    watch_access(address, 2);
+  }
+  return *reinterpret_cast<uint16_t*>(&memory[address]);
 }
 
-uint16_t& CPU8068::mem16(const uint16_t CS, const uint16_t IP) {
-  return *reinterpret_cast<uint16_t*>(&memory[(CS * SEGMENT_MULTIPLIER) + IP]);
+uint8_t& CPU8068::mem8(const uint16_t segment, const uint16_t offset) {
+  const uint32_t address = linear_address(segment, offset);
+  if (watching && watch_pages[address >> DEBUG_PAGE_BITS]) {
+    watch_access(address, 1);
+  }
+  return memory[address];
+}
+
+uint16_t& CPU8068::mem16(const uint16_t segment, const uint16_t offset) {
+  const uint32_t address = linear_address(segment, offset);
+  if (watching && (watch_pages[address >> DEBUG_PAGE_BITS] ||
+                   watch_pages[(address + 1) >> DEBUG_PAGE_BITS])) {
+    watch_access(address, 2);
+  }
+  return *reinterpret_cast<uint16_t*>(&memory[address]);
+}
+
+ReplayLog& CPU8068::replay_log() { return replay; }
+
+void CPU8068::set_ready_hook(std::function<void()> hook,
+                             const int dos_function) {
+  ready_hook = std::move(hook);
+  ready_function = dos_function;
+}
+
+bool CPU8068::is_ready_point() const {
+  if (ready_function != READY_ON_INPUT) {
+    return AH == ready_function;
+  }
+
+  switch (AH) {
+    case 0x01:  // Character input with echo
+    case 0x06:  // Direct console I/O
+    case 0x07:  // Direct character input
+    case 0x08:  // Character input without echo
+    case 0x0A:  // Buffered input
+    case 0x0B:  // Check input status
+    case 0x0C:  // Flush buffer and input
+    case 0x3F:  // Read from file or device
+      return true;
+    default:
+      return false;
+  }
 }
 
 void CPU8068::interrupt(const uint8_t num) {
   switch (num) {
+    case 0x08:
+      timer_tick();
+      break;
+    case 0x09:
+      keyboard_interrupt();
+      break;
+    case 0x10:
+      video_interrupt();
+      break;
+      // Equipment list and memory size, as POST left them in the data area
+    case 0x11:
+      AX = mem16(0, BiosDataArea::EQUIPMENT);
+      break;
+    case 0x12:
+      AX = mem16(0, BiosDataArea::MEMORY_SIZE);
+      break;
+    case 0x13:
+      disk_interrupt();
+      break;
+    case 0x16:
+      keyboard_service();
+      break;
+    case 0x1A:
+      time_of_day_interrupt();
+      break;
+      // User timer tick, for programs to hook
+    case 0x1C:
+      break;
+      // Program terminate, what a RET to the start of the PSP ends up in
+    case 0x20:
+      terminate_process(0, TERMINATE_NORMAL);
+      break;
     case 0x21:
       dos_interrupt();
       break;
+    case 0x25:
+      absolute_disk_interrupt(false);
+      break;
+    case 0x26:
+      absolute_disk_interrupt(true);
+      break;
     default:
       mylog("Unsupported interrupt");
       break;
   }
 }
 
+/*
+  Local wall clock in centiseconds since 1980-01-01 00:00, the DOS epoch.
+  Kept as a single number so the replay log can store it as a small delta.
+*/
+static uint64_t local_clock_now() {
+  using namespace std::chrono;
+
+  const system_clock::time_point now = system_clock::now();
+  const std::time_t seconds = system_clock::to_time_t(now);
+  const std::tm local = *std::localtime(&seconds);
+  const uint64_t centiseconds =
+      duration_cast<milliseconds>(now.time_since_epoch()).count() % 1000 / 10;
+
+  const sys_days today{year{local.tm_year + 1900} /
+                       month{static_cast<unsigned>(local.tm_mon + 1)} /
+                       day{static_cast<unsigned>(local.tm_mday)}};
+  const sys_days epoch{year{1980} / January / day{1}};
+  const uint64_t days = (today - epoch).count();
+
+  return (((days * 24 + local.tm_hour) * 60 + local.tm_min) * 60 +
+          local.tm_sec) *
+             100 +
+         centiseconds;
+}
+
 void CPU8068::dos_interrupt() {
+  counters.dos_calls[AH].add();
+  update_stats();
+
+  if (ready_hook && is_ready_point()) {
+    const std::function<void()> hook = std::move(ready_hook);
+    ready_hook = nullptr;
+
+    IP -= 2;
+    hook();
+    IP += 2;
+  }
+
+  if (dos_console_input(AH)) {
+    return;
+  }
+
   switch (AH) {
+      // Program terminate
+    case 0x00: {
+      terminate_process(0, TERMINATE_NORMAL);
+      break;
+    }
     case 0x02: {
       std::cout << static_cast<char>(DL);
+      counters.console_write_bytes.add();
       break;
     }
     case 0x09: {
-      const uint8_t* string = &mem8(DS, DX);
+      const uint8_t* string = &mem8(Sreg::DS, DX);
 
       constexpr int32_t MAX_STRING_LENGTH = SEGMENT_SIZE;
       int32_t len = 0;
@@ -1275,6 +1636,7 @@ void CPU8068::dos_interrupt() {
         }
       }
 
+      counters.console_write_bytes.add(static_cast<uint64_t>(len - 1));
       while (*string != '$') {
         if (isprint(*string) || *string == '\t' || *string == '\r' ||
             *string == '\n' || *string == '\a') {
@@ -1290,10 +1652,116 @@ void CPU8068::dos_interrupt() {
       }
       break;
     }
-    case 0x4C:
-      throw ProgramExitedException{AL};
+      // Get system date
+    case 0x2A: {
+      using namespace std::chrono;
+
+      const uint64_t clock = replay.clock(local_clock_now);
+      const sys_days date{sys_days{year{1980} / January / day{1}} +
+                          days{clock / (100 * 60 * 60 * 24)}};
+      const year_month_day ymd{date};
+
+      CX = static_cast<uint16_t>(static_cast<int>(ymd.year()));
+      DH = static_cast<uint8_t>(static_cast<unsigned>(ymd.month()));
+      DL = static_cast<uint8_t>(static_cast<unsigned>(ymd.day()));
+      AL = static_cast<uint8_t>(weekday{date}.c_encoding());
+      break;
+    }
+      // Get system time
+    case 0x2C: {
+      const uint64_t clock = replay.clock(local_clock_now);
+      const uint64_t centiseconds_of_day = clock % (100 * 60 * 60 * 24);
+
+      CH = static_cast<uint8_t>(centiseconds_of_day / (100 * 60 * 60));
+      CL = static_cast<uint8_t>(centiseconds_of_day / (100 * 60) % 60);
+      DH = static_cast<uint8_t>(centiseconds_of_day / 100 % 60);
+      DL = static_cast<uint8_t>(centiseconds_of_day % 100);
+      break;
+    }
+      // Set interrupt vector
+    case 0x25: {
+      mem16(0, AL * 4) = DX;
+      mem16(0, AL * 4 + 2) = DS;
+      break;
+    }
+      // Get interrupt vector
+    case 0x35: {
+      BX = mem16(0, AL * 4);
+      ES = mem16(0, AL * 4 + 2);
+      update_segment_register(ES);
+      break;
+    }
+      // Allocate memory
+    case 0x48: {
+      uint16_t segment = 0;
+      uint16_t largest = 0;
+      const DosError error = arena.allocate(BX, psp_segment, segment, largest);
+      if (error == DosError::NONE) {
+        AX = segment;
+      } else if (error == DosError::NOT_ENOUGH_MEMORY) {
+        BX = largest;
+      }
+      set_dos_result(error);
+      break;
+    }
+      // Free allocated memory
+    case 0x49: {
+      set_dos_result(arena.free(ES));
+      break;
+    }
+      // Resize memory block
+    case 0x4A: {
+      uint16_t largest = 0;
+      const DosError error = arena.resize(ES, BX, largest);
+      if (error == DosError::NOT_ENOUGH_MEMORY) {
+        BX = largest;
+      }
+      set_dos_result(error);
+      break;
+    }
+      // Terminate and stay resident
+    case 0x31: {
+      terminate_process(AL, TERMINATE_RESIDENT, DX);
+      break;
+    }
+      // Load and execute program
+    case 0x4B: {
+      dos_exec();
+      break;
+    }
+      // Terminate with return code
+    case 0x4C: {
+      terminate_process(AL, TERMINATE_NORMAL);
+      break;
+    }
+      // Get return code of the last child, it can only be read once
+    case 0x4D: {
+      AX = return_code;
+      return_code = 0;
+      SetCF(0);
+      break;
+    }
+      // Set / get current PSP
+    case 0x50: {
+      psp_segment = BX;
+      break;
+    }
+    case 0x51:
+    case 0x62: {
+      BX = psp_segment;
+      break;
+    }
     default:
       mylog("Unsupported interrupt");
       break;
   }
 }
+
+void CPU8068::set_dos_result(const DosError error) {
+  if (error == DosError::NONE) {
+    SetCF(0);
+    return;
+  }
+  AX = static_cast<uint16_t>(error);
+  SetCF(1);
+}
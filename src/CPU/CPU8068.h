@@ -5,22 +5,151 @@
 #ifndef CPU8068_H
 #define CPU8068_H
 
+#include <cstddef>
+#include <array>
 #include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_set>
 #include <vector>
 
 #include "CPUMode.h"
+#include "CycleCounter.h"
+#include "Descriptor.h"
+#include "EventScheduler.h"
+#include "Memory.h"
+#include "PortMap.h"
+#include "Stats.h"
+#include "../Devices/DiskImage.h"
+#include "../Devices/FrameCapture.h"
+#include "../Devices/Framebuffer.h"
+#include "../Devices/IntervalTimer.h"
+#include "../Devices/Keyboard.h"
+#include "../Devices/TextDisplay.h"
+#include "../DOS/DosError.h"
+#include "../DOS/ImageCache.h"
+#include "../DOS/MemoryArena.h"
+#include "../DOS/ProgramImage.h"
+#include "../FPU/FPU.h"
+#include "../FPU/FPUMode.h"
+#include "../Utils/ConsoleInput.h"
+#include "../Utils/CoverageMap.h"
+#include "../Utils/GdbStub.h"
+#include "../Utils/KeyScript.h"
+#include "../Utils/ReplayLog.h"
+#include "../Utils/TraceWriter.h"
 
 class LoadToCPU;
+class Snapshot;
 
 #pragma pack(push, 1)
 class CPU8068 {
  public:
-  CPU8068(CPU_MODE cpu_mode);
+  CPU8068(CPU_MODE cpu_mode, FPU_MODE fpu_mode);
   void reset_registers();
   void execute();
 
-  uint8_t& mem8(uint16_t CS, uint16_t IP);
-  uint16_t& mem16(uint16_t CS, uint16_t IP);
+  /*
+    Every CPU mode gets its own opcode table, built once, so instructions
+    that only exist on later processors cost nothing to check for.
+    A handler returns false when execution has to stop.
+  */
+  using OpcodeHandler = bool (CPU8068::*)(uint8_t opcode);
+  struct DispatchTable {
+    std::array<OpcodeHandler, 256> handlers;
+    // String instructions that a REP prefix repeats
+    std::array<bool, 256> repeatable;
+  };
+  static const DispatchTable& dispatch_table(CPU_MODE cpu_mode);
+
+  bool execute_8086(uint8_t opcode);
+  bool execute_8086_alias(uint8_t opcode);
+  bool execute_80186(uint8_t opcode);
+  bool execute_80286(uint8_t opcode);
+  bool rep_string(uint8_t prefix);
+
+  /*
+    Cycle accounting is off by default, target_mhz == 0 runs as fast
+    as the host allows
+  */
+  void enable_timing(double target_mhz);
+  [[nodiscard]] const CycleCounter& timing() const;
+  // start_address is where the instruction was fetched from, linear
+  void account_cycles(uint8_t opcode, uint32_t start_address,
+                      uint16_t start_CS, uint16_t start_IP, uint8_t start_CL);
+
+  /*
+    Counters of the run so far, safe to read from any thread while the
+    CPU runs. update_stats brings the instruction count up to the
+    current instruction, on the CPU thread only.
+  */
+  [[nodiscard]] const Stats& stats() const;
+  void update_stats();
+
+  /*
+    Draws the text screen on the terminal refresh_hz times a second of
+    host time, close_display draws the last frame and stops
+  */
+  void enable_display(double refresh_hz);
+  void close_display();
+  /*
+    Hands the graphics screen to capture every every_instructions
+    instructions, close_capture takes a last frame and stops
+  */
+  void enable_capture(std::unique_ptr<FrameCapture> capture,
+                      uint32_t every_instructions);
+  void close_capture();
+  /*
+    Keys come from script at the times it gives instead of from the
+    terminal
+  */
+  void enable_key_script(std::unique_ptr<KeyScript> script);
+  /*
+    Records every instruction that starts at a linear address in
+    [first, last] to writer, with the registers and memory it changed
+  */
+  void enable_trace(std::unique_ptr<TraceWriter> writer, uint32_t first,
+                    uint32_t last);
+  /*
+    Serves a GDB client on stub: the guest stops before its next
+    instruction and runs when the client says so. close_debugger tells
+    the client the program exited with code.
+  */
+  void enable_debugger(std::unique_ptr<GdbStub> stub);
+  void close_debugger(int code);
+  /*
+    Marks the bytes of every instruction that runs in a coverage map.
+    coverage() returns it, up to date with the instruction last run.
+  */
+  void enable_coverage();
+  CoverageMap& coverage();
+
+  // Record or replay every external input the guest sees
+  [[nodiscard]] ReplayLog& replay_log();
+
+  /*
+    hook runs once, the first time the guest makes the INT 21h call
+    dos_function (by default the first request for input). While it runs
+    CS:IP is on the INT 21h instruction, so state captured there re-issues
+    the call when resumed.
+  */
+  void set_ready_hook(std::function<void()> hook,
+                      int dos_function = READY_ON_INPUT);
+  constexpr static int READY_ON_INPUT = -1;
+
+  // Segment registers in sreg encoding order, the index of their cache
+  enum class Sreg : uint8_t { ES, CS, SS, DS };
+  /*
+    Guest memory through a segment register, by its cached base in
+    protected mode. The uint16_t forms take a real mode paragraph in any
+    mode, for the DOS and BIOS structures the services address directly.
+  */
+  uint8_t& mem8(Sreg segment, uint16_t offset);
+  uint16_t& mem16(Sreg segment, uint16_t offset);
+  uint8_t& mem8(uint16_t segment, uint16_t offset);
+  uint16_t& mem16(uint16_t segment, uint16_t offset);
   uint16_t sign_extend(uint8_t val);
   bool is_AF(uint16_t lhs, uint16_t rhs, uint32_t result);
   uint32_t ROL(uint32_t val, uint8_t width, uint8_t count,
@@ -38,9 +167,95 @@ class CPU8068 {
   uint32_t SAR(uint32_t val, uint8_t width, uint8_t count,
                uint8_t& last_bit_rotated);
 
-  // For now, not implementing the interrupt table
+  /*
+    Every real mode vector starts out on a stub in the BIOS ROM at F000h
+    that hands the call to interrupt(). An INT whose vector still points
+    at its stub skips the stub and is serviced in place; one the guest
+    has hooked goes through the vector table like on a real machine.
+  */
+  void install_bios();
+  void software_interrupt(uint8_t num);
+  // Pushes FLAGS, CS and IP and jumps to the handler in the vector table
+  void enter_interrupt(uint8_t num);
+  // Whether the guest has pointed vector num away from its stub
+  [[nodiscard]] bool hooked(uint8_t num) const;
+  // Whether the INT num being serviced was issued by its own stub
+  [[nodiscard]] bool in_stub(uint8_t num) const;
+  /*
+    Processor exception for the instruction that starts at start_IP: the
+    guest's handler runs with that instruction as the return address.
+    The BIOS has no handler for them, so with the vector still on its
+    stub (or in protected mode, which has no IDT here) this logs and
+    returns false to stop, rather than fault again forever.
+  */
+  bool raise_fault(uint8_t num, uint16_t start_IP);
+  constexpr static uint8_t BOUND_VECTOR = 5;
+  constexpr static uint8_t INVALID_OPCODE_VECTOR = 6;
+  // The BIOS and DOS services themselves
   void interrupt(uint8_t num);
   void dos_interrupt();
+  // CF and AX the way INT 21h reports success or failure
+  void set_dos_result(DosError error);
+  /*
+    DOS processes. All of their state is in guest memory, the PSP of a
+    child holds where to return to (0Ah) and its parent (16h), the
+    parent's PSP its stack at the time of the EXEC (2Eh).
+  */
+  struct ExecArguments {
+    // 0 copies the environment of the current program
+    uint16_t environment{0};
+    // Length, text, CR, as it goes to PSP:80h
+    std::vector<uint8_t> tail{0, '\r'};
+    std::vector<uint8_t> fcb1, fcb2;
+  };
+  struct ProcessStart {
+    uint16_t CS, IP, SS, SP;
+  };
+  DosError create_process(const ProgramImage& image, std::string_view path,
+                          const ExecArguments& arguments, uint16_t& psp,
+                          ProcessStart& start);
+  void enter_process(uint16_t psp, const ProcessStart& start);
+  // Returns to the parent, or ends the emulation for the first program
+  void terminate_process(uint8_t code, uint8_t type,
+                         uint16_t keep_paragraphs = 0);
+  void dos_exec();
+  constexpr static uint8_t TERMINATE_NORMAL = 0;
+  constexpr static uint8_t TERMINATE_RESIDENT = 3;
+
+  /*
+    Disk images behind INT 13h: the floppy is BIOS drive 00h and DOS
+    drive A:, the hard disk 80h and C:. attach_disk picks the slot from
+    the kind of image.
+  */
+  void attach_disk(std::unique_ptr<DiskImage> disk);
+  // INT 10h, the video BIOS
+  void video_interrupt();
+  // INT 10h 10h
+  void video_palette();
+  void disk_interrupt();
+  // INT 08h, IRQ0: the BIOS tick count. INT 1Ah reads and sets it
+  void timer_tick();
+  void time_of_day_interrupt();
+  // INT 25h and 26h, sectors counted from the start of the DOS volume
+  void absolute_disk_interrupt(bool write);
+  constexpr static uint8_t ABSOLUTE_READ_VECTOR = 0x25;
+  constexpr static uint8_t ABSOLUTE_WRITE_VECTOR = 0x26;
+
+  // INT 09h, IRQ1: scan codes into the BIOS buffer. INT 16h reads it
+  void keyboard_interrupt();
+  void keyboard_service();
+
+  // Console input functions 01h-0Ch, false for anything else
+  bool dos_console_input(uint8_t function);
+  /*
+    Console input as DOS sees it: keys in the BIOS buffer first, then
+    the key script or the terminal
+  */
+  bool console_read(uint8_t& byte);
+  bool console_ready();
+  // The terminal, through the replay log
+  bool host_read(uint8_t& byte);
+  bool host_ready();
 
   void adjust_flags(uint32_t result, uint8_t width);
 
@@ -88,6 +303,29 @@ class CPU8068 {
   void stos_es_di(uint8_t width);
   void cmps_es_di_ds_si(uint8_t width);
   void scas_es_di(uint8_t width);
+  void ins_es_di(uint8_t width);
+  void outs_ds_si(uint8_t width);
+
+  // 80186
+  void pusha();
+  void popa();
+  // start is the IP of the opcode, where a failed check faults
+  bool bound(uint8_t mod_rm, uint16_t start);
+  void imul_reg_rm_imm(uint8_t mod_rm, bool is_imm8);
+  void enter(uint16_t size, uint8_t level);
+  void leave();
+
+  // 80286
+  void instr_0f_00(uint8_t mod_rm);
+  void instr_0f_01(uint8_t mod_rm);
+  void lar_lsl(uint8_t mod_rm, bool is_lsl);
+  void arpl(uint8_t mod_rm);
+
+  // I/O ports, through the port map
+  uint8_t port_in8(uint16_t port);
+  uint16_t port_in16(uint16_t port);
+  void port_out8(uint16_t port, uint8_t val);
+  void port_out16(uint16_t port, uint16_t val);
 
   void instr_80_81_82(uint8_t mod_rm, uint8_t width);
   void instr_83(uint8_t mod_rm);
@@ -97,10 +335,18 @@ class CPU8068 {
 
   void les_lds(uint8_t mod_rm, bool is_lds);
 
-  bool get_address_mode_rm(uint8_t mode, uint8_t r_m, uint16_t& segment,
+  // Hands D8-DF over to the coprocessor, if there is one
+  void esc(uint8_t opcode, uint8_t mod_rm);
+
+  bool get_address_mode_rm(uint8_t mode, uint8_t r_m, Sreg& segment,
                            uint16_t& address);
 
-  void update_segment_register(uint16_t reg);
+  /*
+    Must follow every load of ES, CS, SS or DS. Refreshes the descriptor
+    cache of that register, reading the descriptor table in protected mode.
+  */
+  void update_segment_register(const uint16_t& reg);
+  void update_segment_registers();
 
   void DAA();
   void DAS();
@@ -110,6 +356,7 @@ class CPU8068 {
   void AAD(uint8_t base);
 
   friend class LoadToCPU;
+  friend class Snapshot;
 
  private:
   union {
@@ -144,11 +391,36 @@ class CPU8068 {
   uint16_t CS, DS, SS, ES;
   uint16_t IP;
 
+  /*
+    Hidden part of the segment registers, in sreg encoding order.
+    Memory accesses only ever use the cached base, the descriptor tables
+    are read when a segment register is loaded.
+  */
+  constexpr static size_t SEGMENT_REGISTER_COUNT = 4;
+  SegmentDescriptor segment_cache[SEGMENT_REGISTER_COUNT];
+  uint16_t* const sregs[SEGMENT_REGISTER_COUNT] = {&ES, &CS, &SS, &DS};
+
+  // Machine status word, only the low 4 bits exist on the 80286
+  static constexpr uint16_t MSW_PE = 1 << 0;
+  static constexpr uint16_t MSW_TS = 1 << 3;
+  static constexpr uint16_t MSW_MASK = 0x000F;
+  uint16_t MSW;
+  DescriptorTableRegister GDTR, IDTR;
+  SegmentDescriptor LDTR;
+
+  [[nodiscard]] bool protected_mode() const;
+  [[nodiscard]] uint32_t linear_address(uint16_t segment,
+                                        uint16_t offset) const;
+  [[nodiscard]] uint32_t linear_address(Sreg segment, uint16_t offset) const;
+  bool read_descriptor(uint16_t selector, SegmentDescriptor& descriptor);
+  bool get_rm16(uint8_t mod_rm, uint16_t*& operand);
+
   static constexpr uint16_t CF_MASK = 1 << 0;
   static constexpr uint16_t PF_MASK = 1 << 2;
   static constexpr uint16_t AF_MASK = 1 << 4;
   static constexpr uint16_t ZF_MASK = 1 << 6;
   static constexpr uint16_t SF_MASK = 1 << 7;
+  static constexpr uint16_t TF_MASK = 1 << 8;
   static constexpr uint16_t IF_MASK = 1 << 9;
   static constexpr uint16_t DF_MASK = 1 << 10;
   static constexpr uint16_t OF_MASK = 1 << 11;
@@ -178,10 +450,311 @@ class CPU8068 {
   uint16_t* reg16[REGISTER_COUNT] = {&AX, &CX, &DX, &BX, &SP, &BP, &SI, &DI};
 
   constexpr static size_t MEMORY_SIZE = 1 * 1024 * 1024;
+  // 24 address lines on the 80286
+  constexpr static size_t MEMORY_SIZE_80286 = 16 * 1024 * 1024;
+  constexpr static uint32_t A20_LINE = 0x100000;
+  // Follows the A20 gate on the 80286, see gate_a20()
+  uint32_t address_mask;
   constexpr static size_t SEGMENT_MULTIPLIER = 16; // << 4
   constexpr static size_t SEGMENT_SIZE = 64 * 1024;
-  std::vector<uint8_t> memory;
+  Memory memory;
   CPU_MODE cpu_mode;
+  const DispatchTable& dispatch;
+  std::unique_ptr<FPU> fpu;
+
+  /*
+    Set by the instruction that just ran, or the interrupt entered after
+    it, when CS:IP moved other than onto the next instruction. Timing
+    and coverage go by it rather than guess jumps from how far IP went.
+  */
+  bool jump_taken;
+  void jump_near(uint16_t offset);
+  void jump_far(uint16_t segment, uint16_t offset);
+
+  CycleCounter cycle_counter;
+  bool timing_enabled;
+  // Last r/m memory operand, for the odd address penalty and traces
+  Sreg last_ea_segment;
+  uint16_t last_ea_offset;
+
+  // AX, BX, CX, DX, SP, BP, SI, DI, DS, ES, SS and FLAGS, to compare states
+  using RegisterSet = std::array<uint16_t, 12>;
+  [[nodiscard]] RegisterSet register_set() const;
+  // Iterations done by the last REP prefixed instruction
+  uint32_t rep_iterations;
+
+  ReplayLog replay;
+  ConsoleInput console;
+
+  /*
+    Virtual time runs in timer input clocks, one per instruction, so
+    device events come at the same instruction on every run.
+    event_countdown is the number of instructions left until
+    event_deadline, the earliest deadline in events.
+  */
+  EventScheduler events;
+  uint64_t event_deadline;
+  uint32_t event_countdown;
+  // Waits longer than this are split, the countdown is 32 bits
+  constexpr static uint32_t MAX_EVENT_WAIT = 1u << 30;
+  [[nodiscard]] uint64_t virtual_clock() const;
+  void set_virtual_clock(uint64_t now);
+  // After anything that schedules or cancels an event
+  void sync_events();
+  void run_events();
+  // Jumps the clock to now, passed events run once the instruction ends
+  void advance_clock(uint64_t now);
+
+  std::unique_ptr<TraceWriter> trace;
+  uint32_t trace_first;
+  uint32_t trace_last;
+  // State after the last record, what the next one is encoded against
+  bool trace_started;
+  uint16_t trace_CS;
+  uint16_t trace_IP;
+  RegisterSet trace_registers;
+  // Registers as the instruction in progress found them, and its address
+  RegisterSet trace_before;
+  uint32_t trace_address;
+  void trace_instruction(uint16_t start_CS, uint16_t start_IP);
+  /*
+    Frames that events pushed to enter IRQ handlers between instructions,
+    written out with the next record. event_SP is SP before the events.
+  */
+  uint32_t trace_frame;
+  uint16_t trace_frame_size;
+  void trace_events(uint16_t event_SP);
+
+  /*
+    Breakpoints are linear addresses checked before each instruction.
+    breakpoint_pages has a bit per 4 KB page holding any, so instructions
+    elsewhere cost a bit test and never reach the set.
+  */
+  std::unique_ptr<GdbStub> debugger;
+  std::unordered_set<uint32_t> breakpoints;
+  std::vector<bool> breakpoint_pages;
+  constexpr static uint32_t DEBUG_PAGE_BITS = 12;
+  /*
+    Watchpoints work the same way on data: mem8 and mem16 check
+    watch_pages, and only accesses to a watched page are compared with
+    the ranges. A write watchpoint touched by an instruction keeps its
+    bytes from before, and once the instruction is done it fires if they
+    changed. mem8 and mem16 do not tell reads from writes, so read and
+    access watchpoints fire on any touch. Instruction fetches count as
+    accesses, BIOS and disk transfers done by the host do not.
+  */
+  enum WatchType : uint8_t { WATCH_WRITE = 2, WATCH_READ = 3, WATCH_ACCESS = 4 };
+  struct Watchpoint {
+    WatchType type;
+    uint32_t address;
+    uint32_t length;
+    bool touched;
+    std::vector<uint8_t> before;
+  };
+  std::vector<Watchpoint> watchpoints;
+  std::vector<bool> watch_pages;
+  // Any watchpoint set, all mem8 and mem16 test otherwise
+  bool watching;
+  // Some range was touched by the instruction in progress
+  bool watch_touched;
+  void watch_access(uint32_t address, uint32_t size);
+  // Stop reply for the first watchpoint the last instruction fired, if any
+  bool watch_fired(std::string& reply);
+  bool set_watchpoint(WatchType type, uint32_t address, uint32_t length,
+                      bool on);
+  // How often a running guest looks for the client's Ctrl-C
+  constexpr static uint64_t DEBUGGER_POLL_INSTRUCTIONS = 64 * 1024;
+  // Stop before the next instruction, after a step or an interrupt
+  bool debug_stop_pending;
+  // Run the next instruction even if it is on a breakpoint
+  bool debug_resuming;
+  // Whether the stop is reported, not on the one at attach
+  bool debug_report;
+  uint8_t debug_signal;
+  void debug_hook();
+  // Handles packet, true when the guest resumes
+  bool debug_command(const std::string& packet, std::string& reply);
+  void debugger_event();
+  void set_breakpoint(uint32_t address, bool on);
+  void detach_debugger();
+
+  /*
+    Instructions running one after the other form a block, marked with
+    one range OR once an instruction starts somewhere else, so a loop
+    costs a compare per instruction and one mark per iteration.
+  */
+  std::unique_ptr<CoverageMap> coverage_map;
+  // Start of the block and of its last instruction, linear
+  uint32_t coverage_start;
+  uint32_t coverage_last;
+  // Longer steps than this end the block even without jump_taken
+  constexpr static uint32_t MAX_COVERED_LENGTH = 15;
+  void cover();
+
+  Stats counters;
+  // Clock the run started at, a restored snapshot starts past 0
+  uint64_t stats_clock_base;
+
+  std::unique_ptr<TextDisplay> display;
+  // Instructions between checks of the display's frame clock
+  constexpr static uint32_t DISPLAY_POLL_INSTRUCTIONS = 16 * 1024;
+
+  // Text page of the current mode as the BIOS data area describes it
+  struct TextScreen {
+    uint32_t base;
+    uint8_t columns;
+    uint8_t rows;
+  };
+  bool text_screen(uint8_t page, TextScreen& screen) const;
+  void set_video_mode(uint8_t value);
+  void scroll_text(uint8_t page, uint8_t lines, uint8_t attribute, uint8_t top,
+                   uint8_t left, uint8_t bottom, uint8_t right, bool up);
+  /*
+    BIOS teletype: control characters, wrapping and scrolling. attribute
+    -1 keeps the one in the cell. The text the terminal should show is
+    appended to stream unless that is null.
+  */
+  void teletype(uint8_t page, uint8_t character, int attribute,
+                std::string* stream);
+  // Where teletype output to page goes, null when it is not streamed
+  std::string* video_stream(uint8_t page);
+  std::string stream_buffer;
+
+  Framebuffer framebuffer;
+  std::unique_ptr<FrameCapture> frame_capture;
+  uint32_t capture_interval;
+
+  IntervalTimer pit;
+  // IRQ0 raised but held off by IF, an interrupt shadow or the mask
+  bool irq0_pending;
+  // Interrupt controller mask register (21h), bit 0 holds off IRQ0
+  uint8_t interrupt_mask;
+  // Port 61h, timer 2 gate and speaker bits
+  uint8_t system_control;
+  PortMap ports;
+  void connect_ports();
+  // CGA/MDA status register, retrace timed by the virtual clock
+  [[nodiscard]] uint8_t video_status() const;
+  constexpr static uint8_t TIMER_VECTOR = 0x08;
+  void reset_timer();
+  // After anything that can move the next IRQ0
+  void schedule_timer();
+  void timer_event();
+  // HLT skips ahead to the next interrupt
+  void halt();
+  // IF, the interrupt shadow and the mask let irq through
+  [[nodiscard]] bool can_interrupt(uint8_t irq) const;
+
+  Keyboard keyboard;
+  std::unique_ptr<KeyScript> key_script;
+  // IRQ1 raised but held off
+  bool irq1_pending;
+  // The program has used the keyboard, so the terminal is polled for keys
+  bool keyboard_host;
+  uint64_t host_poll_at;
+  // Scan code DOS hands out after the 0 of an extended key
+  uint8_t dos_extended;
+  constexpr static uint8_t KEYBOARD_VECTOR = 0x09;
+  constexpr static uint64_t HOST_POLL_CLOCKS = IntervalTimer::FREQUENCY / 100;
+  void reset_keyboard();
+  // Masks address line 20 off unless the 8042 output port lets it through
+  void gate_a20();
+  // After anything that can move the next keyboard byte or IRQ1
+  void schedule_keyboard();
+  void keyboard_event();
+  void use_keyboard();
+  // Script strokes that are due, when the keyboard has room for them
+  void feed_script(uint64_t now);
+  void poll_host();
+  // Scan codes of a key typed on the terminal, escape sequences decoded
+  bool host_stroke(uint8_t byte, std::vector<uint8_t>& codes);
+  // Blocks for a key on the terminal, false at the end of its input
+  bool host_key();
+  // A key in the BIOS buffer, or a byte or stroke on its way there
+  [[nodiscard]] bool keyboard_pending() const;
+  /*
+    Runs the keyboard ahead in virtual time, with the BIOS handler
+    inline, until a key is in the buffer. False if none is coming.
+  */
+  bool wait_for_key();
+  bool peek_key(uint16_t& key);
+  void remove_key();
+  // Type-ahead DOS drops, the BIOS buffer included
+  void flush_keys();
+  bool store_key(uint16_t key);
+  [[nodiscard]] uint16_t translate_key(uint8_t scan, bool extended,
+                                       uint8_t shift_flags) const;
+  bool keyboard_read(uint8_t& byte);
+  bool keyboard_ready();
+
+  /*
+    Idle loops. A short loop that keeps coming back to its head with the
+    same registers after the same number of clocks, and whose body writes
+    nothing, runs the same way until an event or the status port it polls
+    changes what it reads. The clock skips whole iterations up to that
+    point, so the program gets there in the same state it would have
+    running them. Polling services called over and over with the same
+    registers skip ahead the same way, once the guest loop around the
+    call passes the same check.
+  */
+  struct IdleWatch {
+    // Loop head or polling call, linear
+    uint32_t address;
+    // Loops: the jump back ends at end, the body is [head, end)
+    uint16_t end;
+    RegisterSet registers;
+    // Clock of the last visit and the one before it
+    uint64_t clock;
+    uint64_t period;
+    uint8_t repeats;
+    enum : uint8_t { UNKNOWN, IDLE, BUSY } body;
+    bool reads_port;
+    uint16_t port;
+  };
+  IdleWatch idle_loop;
+  IdleWatch idle_poll;
+  // Visits alike in a row before skipping
+  constexpr static uint8_t IDLE_REPEATS = 4;
+  constexpr static uint16_t IDLE_LOOP_BYTES = 32;
+  constexpr static uint64_t IDLE_MAX_PERIOD = 256;
+  // Taken short jump, a backward one may close an idle loop
+  void jump_short(int8_t offset);
+  void watch_loop(uint16_t end);
+  // True when watch has seen the same visit IDLE_REPEATS times in a row
+  bool idle_repeat(IdleWatch& watch, uint32_t address, uint16_t end);
+  bool idle_body(uint16_t head, uint16_t end, IdleWatch& watch);
+  // Length of the read-only instruction at CS:at, 0 if it may write
+  uint16_t idle_instruction(uint16_t head, uint16_t at, IdleWatch& watch);
+  bool polling_loop(uint16_t call, IdleWatch& watch);
+  /*
+    From polling services that found nothing to return, call is the IP
+    of the INT instruction that asked
+  */
+  void polling_idle(uint16_t call);
+  constexpr static uint16_t INT_LENGTH = 2;
+  // Skips whole periods of watch that end before until and the next event
+  void skip_idle(IdleWatch& watch, uint64_t until);
+  // Clock up to which reads of port give the same value, 0 if they may not
+  [[nodiscard]] uint64_t port_stable_until(uint16_t port) const;
+
+  MemoryArena arena;
+  // PSP of the running program, owner of the memory it allocates
+  uint16_t psp_segment;
+  // Exit code and termination type of the last child, for 4Dh
+  uint16_t return_code;
+  ImageCache image_cache;
+
+  std::unique_ptr<DiskImage> floppy_disk;
+  std::unique_ptr<DiskImage> hard_disk;
+  // Status of the last INT 13h call, for 01h
+  uint8_t disk_status;
+  [[nodiscard]] DiskImage* bios_drive(uint8_t drive) const;
+  uint8_t disk_transfer(DiskImage& disk, uint32_t lba, uint32_t count,
+                        uint16_t segment, uint16_t offset, bool write);
+
+  std::function<void()> ready_hook;
+  int ready_function;
+  [[nodiscard]] bool is_ready_point() const;
 
   /*
     Dumb implementation for 'Interrupt boundary delay'
@@ -0,0 +1,506 @@
+#include "CycleCounter.h"
+
+#include <algorithm>
+#include <initializer_list>
+#include <thread>
+
+#include "CPUMode.h"
+
+namespace {
+
+constexpr uint8_t ALU_OPCODES[] = {0x00, 0x08, 0x10, 0x18,
+                                   0x20, 0x28, 0x30, 0x38};
+
+void set(CycleTable& table, const std::initializer_list<uint8_t> opcodes,
+         const uint8_t reg, const uint8_t mem = 0, const uint8_t transfers = 0) {
+  for (const uint8_t opcode : opcodes) {
+    table.reg[opcode] = reg;
+    table.mem[opcode] = mem;
+    table.transfers[opcode] = transfers;
+  }
+}
+
+void set_range(CycleTable& table, const uint8_t first, const uint8_t last,
+               const uint8_t reg) {
+  for (int opcode = first; opcode <= last; opcode++) {
+    table.reg[opcode] = reg;
+  }
+}
+
+void set_alu(CycleTable& table, const uint8_t rm_reg_reg,
+             const uint8_t rm_reg_mem, const uint8_t reg_rm_mem,
+             const uint8_t acc_imm) {
+  for (const uint8_t base : ALU_OPCODES) {
+    // CMP never writes back its result
+    const bool is_cmp = base == 0x38;
+    set(table, {base, static_cast<uint8_t>(base + 1)}, rm_reg_reg,
+        is_cmp ? reg_rm_mem : rm_reg_mem, is_cmp ? 1 : 2);
+    set(table, {static_cast<uint8_t>(base + 2), static_cast<uint8_t>(base + 3)},
+        rm_reg_reg, reg_rm_mem, 1);
+    set(table, {static_cast<uint8_t>(base + 4), static_cast<uint8_t>(base + 5)},
+        acc_imm);
+  }
+}
+
+void set_rep(CycleTable& table, const std::initializer_list<uint8_t> opcodes,
+             const uint8_t start, const uint8_t each) {
+  for (const uint8_t opcode : opcodes) {
+    table.rep_start[opcode] = start;
+    table.rep_each[opcode] = each;
+  }
+}
+
+void set_branches(CycleTable& table, const uint8_t jcc_not_taken,
+                  const uint8_t jcc_taken, const uint8_t loop_not_taken,
+                  const uint8_t loop_taken) {
+  for (int opcode = 0x70; opcode <= 0x7F; opcode++) {
+    table.reg[opcode] = jcc_not_taken;
+    table.taken[opcode] = jcc_taken - jcc_not_taken;
+  }
+  for (int opcode = 0xE0; opcode <= 0xE3; opcode++) {
+    table.reg[opcode] = loop_not_taken;
+    table.taken[opcode] = loop_taken - loop_not_taken;
+  }
+}
+
+CycleTable make_8086_table() {
+  CycleTable t;
+  set_alu(t, 3, 16, 9, 4);
+  set(t, {0x80, 0x81, 0x82, 0x83}, 4, 17, 2);
+  t.cmp_mem_imm = 10;
+  set(t, {0x84, 0x85}, 3, 9, 1);
+  set(t, {0xA8, 0xA9}, 4);
+  set(t, {0x86, 0x87}, 4, 17, 2);
+  set_range(t, 0x90, 0x97, 3);
+  set(t, {0x88, 0x89}, 2, 9, 1);
+  set(t, {0x8A, 0x8B}, 2, 8, 1);
+  set(t, {0x8C}, 2, 9, 1);
+  set(t, {0x8E}, 2, 8, 1);
+  set(t, {0x8D}, 2, 2);
+  set(t, {0xC4, 0xC5}, 16, 16, 2);
+  set(t, {0xC6, 0xC7}, 4, 10, 1);
+  set(t, {0xA0, 0xA1, 0xA2, 0xA3}, 10);
+  set_range(t, 0xB0, 0xBF, 4);
+  set_range(t, 0x40, 0x4F, 2);
+  set(t, {0xFE}, 3, 15, 2);
+  set(t, {0xFF}, 3, 15, 2);
+  t.ff_reg = {3, 3, 16, 0, 11, 0, 11, 0};
+  t.ff_mem = {15, 15, 21, 37, 18, 24, 16, 0};
+  set_range(t, 0x50, 0x57, 11);
+  set_range(t, 0x58, 0x5F, 8);
+  set(t, {0x06, 0x0E, 0x16, 0x1E}, 10);
+  set(t, {0x07, 0x17, 0x1F}, 8);
+  set(t, {0x8F}, 8, 17, 1);
+  set(t, {0x9C}, 10);
+  set(t, {0x9D}, 8);
+  set(t, {0x9E, 0x9F}, 4);
+  set(t, {0xD0, 0xD1}, 2, 15, 2);
+  set(t, {0xD2, 0xD3}, 8, 20, 2);
+  set_branches(t, 4, 16, 5, 17);
+  t.taken[0xE1] = 12;
+  t.reg[0xE3] = 6;
+  t.taken[0xE3] = 12;
+  set(t, {0xE8}, 19);
+  set(t, {0x9A}, 28);
+  set(t, {0xE9, 0xEA, 0xEB}, 15);
+  set(t, {0xC2}, 12);
+  set(t, {0xC3}, 8);
+  set(t, {0xCA}, 17);
+  set(t, {0xCB}, 18);
+  set(t, {0xCD}, 51);
+  set(t, {0xCC}, 52);
+  set(t, {0xCF}, 24);
+  set(t, {0xE4, 0xE5, 0xE6, 0xE7}, 10);
+  set(t, {0xEC, 0xED, 0xEE, 0xEF}, 8);
+  set(t, {0x27, 0x2F}, 4);
+  set(t, {0x37, 0x3F}, 8);
+  set(t, {0xD4}, 83);
+  set(t, {0xD5}, 60);
+  set(t, {0xD7}, 11);
+  set(t, {0x98}, 2);
+  set(t, {0x99}, 5);
+  set(t, {0xF4, 0xF5, 0xF8, 0xF9, 0xFA, 0xFB, 0xFC, 0xFD}, 2);
+  set(t, {0x9B}, 3);
+  set(t, {0xD8, 0xD9, 0xDA, 0xDB, 0xDC, 0xDD, 0xDE, 0xDF}, 2, 8, 1);
+  set(t, {0xA4, 0xA5}, 18);
+  set(t, {0xA6, 0xA7}, 22);
+  set(t, {0xAA, 0xAB}, 11);
+  set(t, {0xAC, 0xAD}, 12);
+  set(t, {0xAE, 0xAF}, 15);
+  set_rep(t, {0xA4, 0xA5}, 9, 17);
+  set_rep(t, {0xA6, 0xA7}, 9, 22);
+  set_rep(t, {0xAA, 0xAB}, 9, 10);
+  set_rep(t, {0xAC, 0xAD}, 9, 13);
+  set_rep(t, {0xAE, 0xAF}, 9, 15);
+
+  // The undecoded 80186 opcodes run as their 8086 aliases
+  for (int opcode = 0x60; opcode <= 0x6F; opcode++) {
+    t.reg[opcode] = t.reg[opcode + 0x10];
+    t.taken[opcode] = t.taken[opcode + 0x10];
+  }
+  for (const uint8_t opcode : {0xC0, 0xC1, 0xC8, 0xC9}) {
+    t.reg[opcode] = t.reg[opcode + 0x02];
+  }
+
+  // [BX+SI] [BX+DI] [BP+SI] [BP+DI] [SI] [DI] [disp16] [BX]
+  constexpr uint8_t ea_no_disp[8] = {7, 8, 8, 7, 5, 5, 0, 5};
+  constexpr uint8_t ea_disp[8] = {11, 12, 12, 11, 9, 9, 9, 9};
+  std::copy(std::begin(ea_no_disp), std::end(ea_no_disp), t.ea_no_disp);
+  std::copy(std::begin(ea_disp), std::end(ea_disp), t.ea_disp);
+  t.ea_direct = 6;
+
+  t.shift_per_bit = 4;
+  t.odd_word_penalty = 4;
+  t.queue_size = 6;
+  t.bus_cycle = 4;
+  return t;
+}
+
+/*
+  The 80186 has a dedicated address unit, its documented clock counts
+  already include the EA calculation
+*/
+CycleTable make_80186_table() {
+  CycleTable t;
+  set_alu(t, 3, 10, 10, 4);
+  set(t, {0x80, 0x81, 0x82, 0x83}, 4, 16, 2);
+  t.cmp_mem_imm = 10;
+  set(t, {0x84, 0x85}, 3, 10, 1);
+  set(t, {0xA8, 0xA9}, 4);
+  set(t, {0x86, 0x87}, 4, 17, 2);
+  set_range(t, 0x90, 0x97, 3);
+  set(t, {0x88, 0x89}, 2, 12, 1);
+  set(t, {0x8A, 0x8B}, 2, 9, 1);
+  set(t, {0x8C}, 2, 11, 1);
+  set(t, {0x8E}, 2, 9, 1);
+  set(t, {0x8D}, 6, 6);
+  set(t, {0xC4, 0xC5}, 18, 18, 2);
+  set(t, {0xC6, 0xC7}, 4, 12, 1);
+  set(t, {0xA0, 0xA1, 0xA2, 0xA3}, 8);
+  set_range(t, 0xB0, 0xBF, 4);
+  set_range(t, 0x40, 0x4F, 3);
+  set(t, {0xFE}, 3, 15, 2);
+  set(t, {0xFF}, 3, 15, 2);
+  t.ff_reg = {3, 3, 13, 0, 11, 0, 10, 0};
+  t.ff_mem = {15, 15, 19, 38, 17, 26, 16, 0};
+  set_range(t, 0x50, 0x57, 10);
+  set_range(t, 0x58, 0x5F, 10);
+  set(t, {0x06, 0x0E, 0x16, 0x1E}, 9);
+  set(t, {0x07, 0x17, 0x1F}, 8);
+  set(t, {0x8F}, 10, 20, 1);
+  set(t, {0x9C}, 9);
+  set(t, {0x9D}, 8);
+  set(t, {0x9E}, 3);
+  set(t, {0x9F}, 2);
+  set(t, {0xD0, 0xD1}, 2, 15, 2);
+  set(t, {0xD2, 0xD3, 0xC0, 0xC1}, 5, 17, 2);
+  set_branches(t, 4, 13, 5, 15);
+  t.reg[0xE0] = 6;
+  t.taken[0xE0] = 10;
+  set(t, {0xE8}, 15);
+  set(t, {0x9A}, 23);
+  set(t, {0xE9, 0xEA, 0xEB}, 14);
+  set(t, {0xC2}, 18);
+  set(t, {0xC3}, 16);
+  set(t, {0xCA}, 25);
+  set(t, {0xCB}, 22);
+  set(t, {0xCD}, 47);
+  set(t, {0xCC}, 45);
+  set(t, {0xCF}, 28);
+  set(t, {0xE4, 0xE5}, 10);
+  set(t, {0xE6, 0xE7}, 9);
+  set(t, {0xEC, 0xED}, 8);
+  set(t, {0xEE, 0xEF}, 7);
+  set(t, {0x27, 0x2F}, 4);
+  set(t, {0x37, 0x3F}, 8);
+  set(t, {0xD4}, 19);
+  set(t, {0xD5}, 15);
+  set(t, {0xD7}, 11);
+  set(t, {0x98}, 2);
+  set(t, {0x99}, 4);
+  set(t, {0xF4, 0xF5, 0xF8, 0xF9, 0xFA, 0xFB, 0xFC, 0xFD}, 2);
+  set(t, {0x9B}, 6);
+  set(t, {0xD8, 0xD9, 0xDA, 0xDB, 0xDC, 0xDD, 0xDE, 0xDF}, 6, 6, 1);
+  set(t, {0xA4, 0xA5}, 14);
+  set(t, {0xA6, 0xA7}, 22);
+  set(t, {0xAA, 0xAB}, 10);
+  set(t, {0xAC, 0xAD}, 12);
+  set(t, {0xAE, 0xAF}, 15);
+  set(t, {0x68, 0x6A}, 10);
+  set(t, {0x60}, 36);
+  set(t, {0x61}, 51);
+  set(t, {0x62}, 35, 35, 2);
+  set(t, {0x69, 0x6B}, 25, 28, 1);
+  set(t, {0x6C, 0x6D, 0x6E, 0x6F}, 14);
+  set(t, {0xC8}, 15);
+  set(t, {0xC9}, 8);
+  set_rep(t, {0xA4, 0xA5}, 8, 8);
+  set_rep(t, {0xA6, 0xA7}, 5, 22);
+  set_rep(t, {0xAA, 0xAB}, 6, 9);
+  set_rep(t, {0xAC, 0xAD}, 6, 11);
+  set_rep(t, {0xAE, 0xAF}, 5, 15);
+  set_rep(t, {0x6C, 0x6D, 0x6E, 0x6F}, 8, 8);
+
+  t.shift_per_bit = 1;
+  t.odd_word_penalty = 4;
+  t.queue_size = 6;
+  t.bus_cycle = 4;
+  return t;
+}
+
+/*
+  Branch clock counts on the 80286 depend on the length of the target
+  instruction (the "m" term), which is taken as 2 bytes here
+*/
+CycleTable make_80286_table() {
+  CycleTable t;
+  set_alu(t, 2, 7, 7, 3);
+  set(t, {0x80, 0x81, 0x82, 0x83}, 3, 7, 2);
+  t.cmp_mem_imm = 6;
+  set(t, {0x84, 0x85}, 2, 6, 1);
+  set(t, {0xA8, 0xA9}, 3);
+  set(t, {0x86, 0x87}, 3, 5, 2);
+  set_range(t, 0x90, 0x97, 3);
+  set(t, {0x88, 0x89}, 2, 3, 1);
+  set(t, {0x8A, 0x8B}, 2, 5, 1);
+  set(t, {0x8C}, 2, 3, 1);
+  set(t, {0x8E}, 2, 5, 1);
+  set(t, {0x8D}, 3, 3);
+  set(t, {0xC4, 0xC5}, 7, 7, 2);
+  set(t, {0xC6, 0xC7}, 2, 3, 1);
+  set(t, {0xA0, 0xA1}, 5);
+  set(t, {0xA2, 0xA3}, 3);
+  set_range(t, 0xB0, 0xBF, 2);
+  set_range(t, 0x40, 0x4F, 2);
+  set(t, {0xFE}, 2, 7, 2);
+  set(t, {0xFF}, 2, 7, 2);
+  t.ff_reg = {2, 2, 9, 0, 9, 0, 3, 0};
+  t.ff_mem = {7, 7, 13, 18, 13, 17, 5, 0};
+  set_range(t, 0x50, 0x57, 3);
+  set_range(t, 0x58, 0x5F, 5);
+  set(t, {0x06, 0x0E, 0x16, 0x1E}, 3);
+  set(t, {0x07, 0x17, 0x1F}, 5);
+  set(t, {0x8F}, 5, 5, 1);
+  set(t, {0x9C}, 3);
+  set(t, {0x9D}, 5);
+  set(t, {0x9E, 0x9F}, 2);
+  set(t, {0xD0, 0xD1}, 2, 7, 2);
+  set(t, {0xD2, 0xD3, 0xC0, 0xC1}, 5, 8, 2);
+  set_branches(t, 3, 9, 4, 10);
+  set(t, {0xE8}, 9);
+  set(t, {0x9A}, 15);
+  set(t, {0xE9, 0xEB}, 9);
+  set(t, {0xEA}, 13);
+  set(t, {0xC2, 0xC3}, 13);
+  set(t, {0xCA, 0xCB}, 17);
+  set(t, {0xCD, 0xCC}, 25);
+  set(t, {0xCF}, 19);
+  set(t, {0xE4, 0xE5, 0xEC, 0xED}, 5);
+  set(t, {0xE6, 0xE7, 0xEE, 0xEF}, 3);
+  set(t, {0x27, 0x2F, 0x37, 0x3F}, 3);
+  set(t, {0xD4}, 16);
+  set(t, {0xD5}, 14);
+  set(t, {0xD7}, 5);
+  set(t, {0x98, 0x99}, 2);
+  set(t, {0xF4, 0xF5, 0xF8, 0xF9, 0xFA, 0xFB, 0xFC, 0xFD}, 2);
+  set(t, {0x9B}, 3);
+  set(t, {0xD8, 0xD9, 0xDA, 0xDB, 0xDC, 0xDD, 0xDE, 0xDF}, 9, 9, 1);
+  set(t, {0xA4, 0xA5}, 5);
+  set(t, {0xA6, 0xA7}, 8);
+  set(t, {0xAA, 0xAB}, 3);
+  set(t, {0xAC, 0xAD}, 5);
+  set(t, {0xAE, 0xAF}, 7);
+  set(t, {0x68, 0x6A}, 3);
+  set(t, {0x60}, 17);
+  set(t, {0x61}, 19);
+  set(t, {0x62}, 13, 13, 2);
+  set(t, {0x69, 0x6B}, 21, 24, 1);
+  set(t, {0x6C, 0x6D, 0x6E, 0x6F}, 5);
+  set(t, {0xC8}, 11);
+  set(t, {0xC9}, 5);
+  set_rep(t, {0xA4, 0xA5}, 5, 4);
+  set_rep(t, {0xA6, 0xA7}, 5, 9);
+  set_rep(t, {0xAA, 0xAB}, 4, 3);
+  set_rep(t, {0xAC, 0xAD}, 5, 4);
+  set_rep(t, {0xAE, 0xAF}, 5, 8);
+  set_rep(t, {0x6C, 0x6D, 0x6E, 0x6F}, 5, 4);
+  // All two byte opcodes share one entry, costed like LAR / LSL
+  set(t, {0x0F}, 14, 16, 1);
+  set(t, {0x63}, 10, 11, 2);
+
+  // Only base + index + displacement costs an extra clock
+  constexpr uint8_t ea_disp[8] = {1, 1, 1, 1, 0, 0, 0, 0};
+  std::copy(std::begin(ea_disp), std::end(ea_disp), t.ea_disp);
+
+  t.shift_per_bit = 1;
+  t.odd_word_penalty = 2;
+  t.queue_size = 6;
+  t.bus_cycle = 2;
+  return t;
+}
+
+}  // namespace
+
+const CycleTable& CycleCounter::table_for(const CPU_MODE cpu_mode) {
+  static const CycleTable table_8086 = make_8086_table();
+  static const CycleTable table_80186 = make_80186_table();
+  static const CycleTable table_80286 = make_80286_table();
+
+  switch (cpu_mode) {
+    case CPU_MODE::CPU_80186:
+      return table_80186;
+    case CPU_MODE::CPU_80286:
+      return table_80286;
+    case CPU_MODE::CPU_8086:
+    default:
+      return table_8086;
+  }
+}
+
+CycleCounter::CycleCounter(const CPU_MODE cpu_mode)
+    : table(table_for(cpu_mode)),
+      cycle_count(0),
+      instruction_count(0),
+      queue_bytes(0),
+      mhz(0.0),
+      next_throttle_check(0),
+      throttle_base(0) {}
+
+void CycleCounter::set_target_mhz(const double target_mhz) {
+  mhz = target_mhz > 0.0 ? target_mhz : 0.0;
+  throttle_start = std::chrono::steady_clock::now();
+  throttle_base = cycle_count;
+  next_throttle_check = cycle_count + cycles_per_slice();
+}
+
+void CycleCounter::reset() {
+  cycle_count = 0;
+  instruction_count = 0;
+  queue_bytes = 0;
+  set_target_mhz(mhz);
+}
+
+void CycleCounter::account(const uint8_t opcode, const uint8_t mod_rm,
+                           const uint16_t length, const uint16_t ea_offset,
+                           const uint8_t count) {
+  const uint8_t mode = (mod_rm >> 6) & 0b11;
+  const uint8_t reg = (mod_rm >> 3) & 0b111;
+  const uint8_t r_m = mod_rm & 0b111;
+  const bool has_memory_operand = table.mem[opcode] != 0 && mode != 0b11;
+
+  uint32_t clocks = table.reg[opcode];
+  uint8_t transfers = 0;
+  if (has_memory_operand) {
+    clocks = table.mem[opcode];
+    transfers = table.transfers[opcode];
+
+    if (mode == 0b00) {
+      clocks += (r_m == 0b110) ? table.ea_direct : table.ea_no_disp[r_m];
+    } else {
+      clocks += table.ea_disp[r_m];
+    }
+  }
+
+  switch (opcode) {
+    case 0x80:
+    case 0x81:
+    case 0x82:
+    case 0x83:
+      if (reg == 0b111 && has_memory_operand) {
+        clocks += table.cmp_mem_imm;
+        clocks -= table.mem[opcode];
+        transfers = 1;
+      }
+      break;
+    case 0xFF:
+      clocks += has_memory_operand ? table.ff_mem[reg] : table.ff_reg[reg];
+      clocks -= has_memory_operand ? table.mem[opcode] : table.reg[opcode];
+      break;
+    case 0xD2:
+    case 0xD3:
+    case 0xC0:
+    case 0xC1:
+      clocks += static_cast<uint32_t>(count) * table.shift_per_bit;
+      break;
+    default:
+      break;
+  }
+
+  // Bit 0 of the opcode is the 'w' bit for all instructions with a word
+  // memory operand that can end up on an odd address
+  if (has_memory_operand && (opcode & 1) && (ea_offset & 1)) {
+    clocks += static_cast<uint32_t>(table.odd_word_penalty) * transfers;
+  }
+
+  retire(clocks, length, transfers, table.taken[opcode]);
+}
+
+void CycleCounter::account_repeated(const uint8_t opcode, const uint16_t length,
+                                    const uint32_t iterations) {
+  // Not a string instruction, the prefix is ignored by the CPU
+  if (table.rep_each[opcode] == 0) {
+    account(opcode, 0, length, 0, 1);
+    return;
+  }
+
+  const uint32_t clocks =
+      table.rep_start[opcode] + table.rep_each[opcode] * iterations;
+  // The bus is busy for most of a repeated string instruction
+  const uint8_t transfers =
+      static_cast<uint8_t>(std::min<uint32_t>(iterations, 0xFF));
+  retire(clocks, length, transfers, 0);
+}
+
+void CycleCounter::retire(uint32_t clocks, const uint16_t length,
+                          const uint8_t transfers, const uint8_t taken) {
+  /*
+    Prefetch queue approximation: the bus interface unit fills the queue
+    while the execution unit is busy and the bus is free. A control
+    transfer flushes it, so the next instruction waits for its bytes.
+  */
+  if (length == 0) {
+    clocks += taken;
+    queue_bytes = 0;
+  } else {
+    uint32_t stall = 0;
+    if (length > queue_bytes) {
+      stall = (length - queue_bytes + 1) / 2 * table.bus_cycle;
+      queue_bytes = 0;
+    } else {
+      queue_bytes -= static_cast<uint8_t>(length);
+    }
+
+    const uint32_t bus_busy = static_cast<uint32_t>(transfers) * table.bus_cycle;
+    const uint32_t bus_free = clocks > bus_busy ? clocks - bus_busy : 0;
+    const uint32_t fetched = bus_free / table.bus_cycle * 2;
+    queue_bytes = static_cast<uint8_t>(
+        std::min<uint32_t>(table.queue_size, queue_bytes + fetched));
+    clocks += stall;
+  }
+
+  cycle_count += clocks;
+  instruction_count++;
+
+  if (mhz > 0.0 && cycle_count >= next_throttle_check) {
+    throttle();
+  }
+}
+
+uint64_t CycleCounter::cycles_per_slice() const {
+  // One millisecond of guest time
+  return static_cast<uint64_t>(mhz * 1000.0);
+}
+
+void CycleCounter::throttle() {
+  const double guest_ns =
+      static_cast<double>(cycle_count - throttle_base) * 1000.0 / mhz;
+  const auto host_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           std::chrono::steady_clock::now() - throttle_start)
+                           .count();
+
+  if (guest_ns > static_cast<double>(host_ns)) {
+    std::this_thread::sleep_for(std::chrono::nanoseconds(
+        static_cast<int64_t>(guest_ns) - static_cast<int64_t>(host_ns)));
+  }
+  next_throttle_check = cycle_count + cycles_per_slice();
+}
@@ -0,0 +1,101 @@
+#ifndef CYCLECOUNTER_H
+#define CYCLECOUNTER_H
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+#include "CPUMode.h"
+
+/*
+  Per CPU mode timing data, taken from the Intel programmer's reference
+  for each processor. All values are clocks.
+
+  reg   -> register / accumulator / immediate form (or the only form)
+  mem   -> memory form of a ModR/M instruction, without the EA cost,
+           0 when the opcode has no ModR/M byte
+  taken -> extra clocks when a conditional branch is taken
+  transfers -> bus transfers of the memory operand (2 for read-modify-write)
+  rep_start / rep_each -> string instruction under a REP prefix, as
+                          rep_start + rep_each * iterations
+*/
+struct CycleTable {
+  std::array<uint8_t, 256> reg{};
+  std::array<uint8_t, 256> mem{};
+  std::array<uint8_t, 256> taken{};
+  std::array<uint8_t, 256> transfers{};
+  std::array<uint8_t, 256> rep_start{};
+  std::array<uint8_t, 256> rep_each{};
+
+  // EA calculation for mode 00 and mode 01/10, indexed by r/m
+  uint8_t ea_no_disp[8]{};
+  uint8_t ea_disp[8]{};
+  uint8_t ea_direct{};
+
+  // CMP r/m, imm does not write back, FF is a group of unrelated instructions
+  uint8_t cmp_mem_imm{};
+  std::array<uint8_t, 8> ff_reg{};
+  std::array<uint8_t, 8> ff_mem{};
+
+  // Extra clocks per bit for shift / rotate with a count
+  uint8_t shift_per_bit{};
+  // Extra clocks for a word transfer on an odd address
+  uint8_t odd_word_penalty{};
+
+  // Bus interface unit
+  uint8_t queue_size{};
+  uint8_t bus_cycle{};
+};
+
+class CycleCounter {
+ public:
+  explicit CycleCounter(CPU_MODE cpu_mode);
+
+  /*
+    target_mhz == 0 runs unthrottled, otherwise the host sleeps whenever
+    the guest gets ahead of a real CPU running at that frequency
+  */
+  void set_target_mhz(double target_mhz);
+  void reset();
+
+  /*
+    Called once per retired instruction, only when timing is enabled.
+
+    length      -> bytes fetched, 0 when the instruction transferred control
+    mod_rm      -> ModR/M byte, only looked at for opcodes that have one
+    ea_offset   -> offset of the last memory operand
+    count       -> shift / rotate count
+  */
+  void account(uint8_t opcode, uint8_t mod_rm, uint16_t length,
+               uint16_t ea_offset, uint8_t count);
+
+  /*
+    Same as account() for a string instruction under a REP prefix,
+    iterations is the number of times the instruction actually ran
+  */
+  void account_repeated(uint8_t opcode, uint16_t length, uint32_t iterations);
+
+  [[nodiscard]] uint64_t cycles() const { return cycle_count; }
+  [[nodiscard]] uint64_t instructions() const { return instruction_count; }
+  [[nodiscard]] double target_mhz() const { return mhz; }
+
+  static const CycleTable& table_for(CPU_MODE cpu_mode);
+
+ private:
+  void retire(uint32_t clocks, uint16_t length, uint8_t transfers,
+              uint8_t taken);
+  void throttle();
+  [[nodiscard]] uint64_t cycles_per_slice() const;
+
+  const CycleTable& table;
+  uint64_t cycle_count;
+  uint64_t instruction_count;
+  uint8_t queue_bytes;
+
+  double mhz;
+  uint64_t next_throttle_check;
+  uint64_t throttle_base;
+  std::chrono::steady_clock::time_point throttle_start;
+};
+
+#endif  // CYCLECOUNTER_H
@@ -0,0 +1,47 @@
+#ifndef DESCRIPTOR_H
+#define DESCRIPTOR_H
+
+#include <cstdint>
+
+/*
+  80286 segment descriptor, as kept in the hidden part of a segment
+  register. In real mode base is just selector * 16.
+
+  In memory a descriptor is 8 bytes:
+    u16 limit, u24 base, u8 access rights, u16 reserved
+*/
+struct SegmentDescriptor {
+  uint16_t selector;
+  uint32_t base;
+  uint16_t limit;
+  uint8_t access;
+};
+
+// GDTR / IDTR
+struct DescriptorTableRegister {
+  uint32_t base;
+  uint16_t limit;
+};
+
+namespace Descriptor {
+constexpr uint8_t SIZE = 8;
+
+constexpr uint16_t SELECTOR_RPL_MASK = 0b011;
+constexpr uint16_t SELECTOR_TI_MASK = 0b100;
+constexpr uint16_t SELECTOR_INDEX_MASK = 0xFFF8;
+
+constexpr uint8_t ACCESS_ACCESSED = 1 << 0;
+// Readable for code, writable for data
+constexpr uint8_t ACCESS_READ_WRITE = 1 << 1;
+constexpr uint8_t ACCESS_CODE = 1 << 3;
+// Code or data segment, clear for system descriptors and gates
+constexpr uint8_t ACCESS_SEGMENT = 1 << 4;
+constexpr uint8_t ACCESS_DPL_SHIFT = 5;
+constexpr uint8_t ACCESS_PRESENT = 1 << 7;
+
+// What a segment register holds after reset or a real mode load
+constexpr uint8_t ACCESS_REAL_MODE =
+    ACCESS_PRESENT | ACCESS_SEGMENT | ACCESS_READ_WRITE | ACCESS_ACCESSED;
+}  // namespace Descriptor
+
+#endif  // DESCRIPTOR_H
@@ -0,0 +1,98 @@
+#include "EventScheduler.h"
+
+#include <cstddef>
+#include <cstdint>
+
+EventScheduler::EventScheduler() : heap{}, size(0) { position.fill(NONE); }
+
+bool EventScheduler::Entry::operator<(const Entry& other) const {
+  return when != other.when ? when < other.when : event < other.event;
+}
+
+void EventScheduler::place(const size_t index, const Entry& entry) {
+  heap[index] = entry;
+  position[entry.event] = index;
+}
+
+void EventScheduler::sift_up(size_t index) {
+  const Entry entry = heap[index];
+  while (index > 0) {
+    const size_t parent = (index - 1) / 2;
+    if (!(entry < heap[parent])) {
+      break;
+    }
+    place(index, heap[parent]);
+    index = parent;
+  }
+  place(index, entry);
+}
+
+void EventScheduler::sift_down(size_t index) {
+  const Entry entry = heap[index];
+  while (true) {
+    size_t child = index * 2 + 1;
+    if (child >= size) {
+      break;
+    }
+    if (child + 1 < size && heap[child + 1] < heap[child]) {
+      child++;
+    }
+    if (!(heap[child] < entry)) {
+      break;
+    }
+    place(index, heap[child]);
+    index = child;
+  }
+  place(index, entry);
+}
+
+void EventScheduler::remove_at(const size_t index) {
+  position[heap[index].event] = NONE;
+  size--;
+  if (index == size) {
+    return;
+  }
+  // The last entry fills the gap and goes whichever way it belongs
+  const Entry moved = heap[size];
+  place(index, moved);
+  sift_up(index);
+  sift_down(position[moved.event]);
+}
+
+void EventScheduler::schedule(const Event event, const uint64_t when) {
+  size_t index = position[event];
+  if (index == NONE) {
+    index = size++;
+  }
+  place(index, Entry{when, event});
+  sift_up(index);
+  sift_down(position[event]);
+}
+
+void EventScheduler::cancel(const Event event) {
+  if (position[event] != NONE) {
+    remove_at(position[event]);
+  }
+}
+
+void EventScheduler::shift(const uint64_t delta) {
+  // The order stays the same, so the heap does too
+  for (size_t i = 0; i < size; i++) {
+    heap[i].when += delta;
+  }
+}
+
+uint64_t EventScheduler::next() const { return size ? heap[0].when : NEVER; }
+
+uint64_t EventScheduler::when(const Event event) const {
+  return position[event] == NONE ? NEVER : heap[position[event]].when;
+}
+
+bool EventScheduler::take_due(const uint64_t now, Event& event) {
+  if (!size || heap[0].when > now) {
+    return false;
+  }
+  event = heap[0].event;
+  remove_at(0);
+  return true;
+}
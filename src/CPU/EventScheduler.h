@@ -0,0 +1,68 @@
+#ifndef EVENTSCHEDULER_H
+#define EVENTSCHEDULER_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/*
+  Deadlines of the device events, on the virtual clock, in a binary
+  min-heap. Each kind of event is pending at most once; scheduling it
+  again moves it. The CPU only counts down to the earliest deadline, so
+  however many devices there are, an instruction pays for one counter.
+
+  Events due at the same clock come out in the order of this enum, so
+  runs stay reproducible.
+*/
+class EventScheduler {
+ public:
+  enum Event : uint8_t {
+    // IRQ0, or a retry of one that was held off
+    TIMER,
+    // A keyboard byte, script stroke or terminal poll is due, or IRQ1 retried
+    KEYBOARD,
+    // The text screen checks its frame clock
+    DISPLAY,
+    // A graphics frame is due for capture
+    CAPTURE,
+    // A debugger client is polled for Ctrl-C
+    DEBUGGER,
+    EVENT_COUNT
+  };
+
+  EventScheduler();
+
+  void schedule(Event event, uint64_t when);
+  void cancel(Event event);
+  // Moves every pending deadline by delta, when the clock is set
+  void shift(uint64_t delta);
+
+  // Earliest deadline, NEVER when nothing is pending
+  [[nodiscard]] uint64_t next() const;
+  // Deadline of event, NEVER when it is not pending
+  [[nodiscard]] uint64_t when(Event event) const;
+  // Removes the earliest event if it is due at now
+  bool take_due(uint64_t now, Event& event);
+
+  constexpr static uint64_t NEVER = UINT64_MAX;
+
+ private:
+  struct Entry {
+    uint64_t when;
+    Event event;
+    bool operator<(const Entry& other) const;
+  };
+
+  void place(size_t index, const Entry& entry);
+  void sift_up(size_t index);
+  void sift_down(size_t index);
+  void remove_at(size_t index);
+
+  std::array<Entry, EVENT_COUNT> heap;
+  size_t size;
+  // Index in heap of every event, NONE when not pending
+  std::array<size_t, EVENT_COUNT> position;
+  constexpr static size_t NONE = EVENT_COUNT;
+};
+
+#endif  // EVENTSCHEDULER_H
@@ -0,0 +1,139 @@
+#include "Memory.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+
+#include "../Utils/logger.h"
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+std::shared_ptr<SharedImage> SharedImage::create(const uint8_t* data,
+                                                 const size_t size) {
+  std::shared_ptr<SharedImage> image{new SharedImage};
+  image->copy.reset(new uint8_t[size]);
+  std::memcpy(image->copy.get(), data, size);
+  image->view = image->copy.get();
+  image->image_size = size;
+  return image;
+}
+
+SharedImage::~SharedImage() = default;
+
+// One spare page past the end, a word access on the last byte stays mapped
+Memory::Memory(const size_t size)
+    : base(new uint8_t[size + 4096]()),
+      memory_size(size),
+      mapping_size(size + 4096) {}
+
+Memory::~Memory() { delete[] base; }
+
+void Memory::map_copy_on_write(const SharedImage& image) {
+  std::memcpy(base, image.data(), std::min(image.size(), memory_size));
+}
+
+#else
+
+static int create_anonymous_file(const size_t size) {
+#ifdef __linux__
+  const int fd = memfd_create("x8086-image", MFD_CLOEXEC);
+#else
+  char name[] = "/tmp/x8086-image-XXXXXX";
+  const int fd = mkstemp(name);
+  if (fd >= 0) {
+    unlink(name);
+  }
+#endif
+  if (fd < 0) {
+    return -1;
+  }
+  if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+std::shared_ptr<SharedImage> SharedImage::create(const uint8_t* data,
+                                                 const size_t size) {
+  const int fd = create_anonymous_file(size);
+  if (fd < 0) {
+    mylog("Cannot create shared memory image");
+    return nullptr;
+  }
+
+  size_t written = 0;
+  while (written < size) {
+    const ssize_t n = pwrite(fd, data + written, size - written,
+                             static_cast<off_t>(written));
+    if (n <= 0) {
+      mylog("Cannot write shared memory image");
+      close(fd);
+      return nullptr;
+    }
+    written += static_cast<size_t>(n);
+  }
+
+  void* view = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  if (view == MAP_FAILED) {
+    mylog("Cannot map shared memory image");
+    close(fd);
+    return nullptr;
+  }
+
+  std::shared_ptr<SharedImage> image{new SharedImage};
+  image->fd = fd;
+  image->view = static_cast<const uint8_t*>(view);
+  image->image_size = size;
+  return image;
+}
+
+SharedImage::~SharedImage() {
+  if (view) {
+    munmap(const_cast<uint8_t*>(view), image_size);
+  }
+  if (fd >= 0) {
+    close(fd);
+  }
+}
+
+// One spare page past the end, a word access on the last byte stays mapped
+Memory::Memory(const size_t size)
+    : base(nullptr),
+      memory_size(size),
+      mapping_size(size + static_cast<size_t>(sysconf(_SC_PAGESIZE))) {
+  void* mapping = mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mapping == MAP_FAILED) {
+    throw std::bad_alloc{};
+  }
+  base = static_cast<uint8_t*>(mapping);
+}
+
+Memory::~Memory() { munmap(base, mapping_size); }
+
+void Memory::map_copy_on_write(const SharedImage& image) {
+  const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  const size_t size = std::min(image.size(), memory_size);
+
+  // Only whole pages can be shared, a partial tail is copied
+  const size_t shared = size / page_size * page_size;
+  if (shared != 0 &&
+      mmap(base, shared, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED,
+           image.fd, 0) == MAP_FAILED) {
+    mylog("Cannot map memory image copy-on-write, copying instead");
+    std::memcpy(base, image.data(), size);
+    return;
+  }
+  std::memcpy(base + shared, image.data() + shared, size - shared);
+}
+
+#endif
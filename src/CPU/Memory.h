@@ -0,0 +1,69 @@
+#ifndef MEMORY_H
+#define MEMORY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/*
+  Read-only memory image that any number of Memory instances can map
+  copy-on-write. Backed by an anonymous file where the host supports it,
+  so pages stay shared between instances until one of them writes.
+*/
+class SharedImage {
+ public:
+  static std::shared_ptr<SharedImage> create(const uint8_t* data, size_t size);
+  ~SharedImage();
+  SharedImage(const SharedImage&) = delete;
+  SharedImage& operator=(const SharedImage&) = delete;
+
+  [[nodiscard]] const uint8_t* data() const { return view; }
+  [[nodiscard]] size_t size() const { return image_size; }
+
+ private:
+  SharedImage() = default;
+
+  int fd{-1};
+  const uint8_t* view{nullptr};
+  size_t image_size{0};
+#ifdef _WIN32
+  std::unique_ptr<uint8_t[]> copy;
+#endif
+
+  friend class Memory;
+};
+
+/*
+  Guest physical memory. Behaves like the std::vector it replaces, but
+  owns its pages directly so a snapshot can be mapped in without copying.
+*/
+class Memory {
+ public:
+  explicit Memory(size_t size);
+  ~Memory();
+  Memory(const Memory&) = delete;
+  Memory& operator=(const Memory&) = delete;
+
+  uint8_t& operator[](const size_t index) { return base[index]; }
+  const uint8_t& operator[](const size_t index) const { return base[index]; }
+
+  [[nodiscard]] uint8_t* data() { return base; }
+  [[nodiscard]] const uint8_t* data() const { return base; }
+  [[nodiscard]] size_t size() const { return memory_size; }
+  uint8_t* begin() { return base; }
+  uint8_t* end() { return base + memory_size; }
+
+  /*
+    Replaces the whole content with image. Pages are only copied when
+    the guest writes to them, unless the host cannot share pages, in
+    which case this is a plain copy.
+  */
+  void map_copy_on_write(const SharedImage& image);
+
+ private:
+  uint8_t* base;
+  size_t memory_size;
+  size_t mapping_size;
+};
+
+#endif  // MEMORY_H
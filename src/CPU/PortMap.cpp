@@ -0,0 +1,40 @@
+#include "PortMap.h"
+
+#include <cstdint>
+#include <memory>
+
+uint8_t PortMap::float_high(void* device, const uint16_t port) {
+  (void)device;
+  (void)port;
+  return 0xFF;
+}
+
+void PortMap::ignore(void* device, const uint16_t port, const uint8_t value) {
+  (void)device;
+  (void)port;
+  (void)value;
+}
+
+PortMap::Page PortMap::unconnected = [] {
+  Page page{};
+  page.handlers.fill(Handler{nullptr, &PortMap::float_high, &PortMap::ignore});
+  return page;
+}();
+
+PortMap::PortMap() : pages{} { pages.fill(&unconnected); }
+
+void PortMap::connect(const uint16_t first, const uint16_t last, void* device,
+                      const ReadHandler read, const WriteHandler write) {
+  for (uint32_t port = first; port <= last; port++) {
+    const uint8_t number = static_cast<uint8_t>(port >> 8);
+    if (pages[number] == &unconnected) {
+      connected.push_back(std::make_unique<Page>(unconnected));
+      pages[number] = connected.back().get();
+    }
+
+    Handler& handler = pages[number]->handlers[port & 0xFF];
+    handler.device = device;
+    handler.read = read ? read : &PortMap::float_high;
+    handler.write = write ? write : &PortMap::ignore;
+  }
+}
@@ -0,0 +1,58 @@
+#ifndef PORTMAP_H
+#define PORTMAP_H
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/*
+  The 64K I/O ports as 256 pages of 256 handlers. Devices connect read
+  and write callbacks to a range of ports, which gives the pages that
+  range touches a table of their own; every other page shares one
+  table where reads float high and writes go nowhere. A port access is
+  two loads and an indirect call, with no branch on whether anything
+  is connected.
+*/
+class PortMap {
+ public:
+  using ReadHandler = uint8_t (*)(void* device, uint16_t port);
+  using WriteHandler = void (*)(void* device, uint16_t port, uint8_t value);
+
+  PortMap();
+  PortMap(const PortMap&) = delete;
+  PortMap& operator=(const PortMap&) = delete;
+
+  // Either handler may be null, that direction then stays unconnected
+  void connect(uint16_t first, uint16_t last, void* device, ReadHandler read,
+               WriteHandler write);
+
+  uint8_t read(const uint16_t port) const {
+    const Handler& handler = pages[port >> 8]->handlers[port & 0xFF];
+    return handler.read(handler.device, port);
+  }
+  void write(const uint16_t port, const uint8_t value) const {
+    const Handler& handler = pages[port >> 8]->handlers[port & 0xFF];
+    handler.write(handler.device, port, value);
+  }
+
+ private:
+  struct Handler {
+    void* device;
+    ReadHandler read;
+    WriteHandler write;
+  };
+  struct Page {
+    std::array<Handler, 256> handlers;
+  };
+
+  static uint8_t float_high(void* device, uint16_t port);
+  static void ignore(void* device, uint16_t port, uint8_t value);
+  // Shared by every page nothing is connected to, never written
+  static Page unconnected;
+
+  std::array<Page*, 256> pages;
+  std::vector<std::unique_ptr<Page>> connected;
+};
+
+#endif  // PORTMAP_H
@@ -0,0 +1,71 @@
+#include "Stats.h"
+
+#include <cinttypes>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <string_view>
+
+#include "../Utils/logger.h"
+
+namespace {
+void put_number(std::string& out, const char* name, const uint64_t value) {
+  char text[64];
+  std::snprintf(text, sizeof(text), "  \"%s\": %" PRIu64 ",\n", name, value);
+  out += text;
+}
+
+// Keys are the vector or function number in hex, as "21"
+void put_table(std::string& out, const char* name,
+               const std::array<Stats::Counter, 256>& counters,
+               const bool last) {
+  out += "  \"";
+  out += name;
+  out += "\": {";
+  const char* separator = "";
+  for (size_t number = 0; number < counters.size(); number++) {
+    const uint64_t value = counters[number].get();
+    if (!value) {
+      continue;
+    }
+    char text[48];
+    std::snprintf(text, sizeof(text), "%s\"%02zX\": %" PRIu64, separator,
+                  number, value);
+    out += text;
+    separator = ", ";
+  }
+  out += last ? "}\n" : "},\n";
+}
+}  // namespace
+
+std::string Stats::to_json() const {
+  std::string out = "{\n";
+  put_number(out, "instructions", instructions.get());
+  put_number(out, "idle_clocks", idle_clocks.get());
+  put_number(out, "skipped_clocks", skipped_clocks.get());
+  put_number(out, "rep_iterations", rep_iterations.get());
+  put_number(out, "disk_read_bytes", disk_read_bytes.get());
+  put_number(out, "disk_write_bytes", disk_write_bytes.get());
+  put_number(out, "console_read_bytes", console_read_bytes.get());
+  put_number(out, "console_write_bytes", console_write_bytes.get());
+  put_table(out, "interrupts", interrupts, false);
+  put_table(out, "dos_calls", dos_calls, true);
+  out += "}\n";
+  return out;
+}
+
+bool Stats::save(const std::string_view path) const {
+  const std::string json = to_json();
+  if (path == "-") {
+    std::fputs(json.c_str(), stderr);
+    return true;
+  }
+
+  std::ofstream file{std::string{path}};
+  if (!file.is_open()) {
+    mylog("Cannot open stats file '%s' for writing", std::string{path}.c_str());
+    return false;
+  }
+  file << json;
+  return file.good();
+}
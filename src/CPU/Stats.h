@@ -0,0 +1,65 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/*
+  Counters of what the guest did, one set per CPU. Only the CPU thread
+  writes them and any thread may read them while it runs: each counter
+  is a relaxed atomic, so an update is a plain load and store with no
+  lock and a reader sees every counter whole, if not all of them at the
+  same instant.
+*/
+class Stats {
+ public:
+  class Counter {
+   public:
+    void add(const uint64_t count = 1) {
+      value.store(value.load(std::memory_order_relaxed) + count,
+                  std::memory_order_relaxed);
+    }
+    void set(const uint64_t count) {
+      value.store(count, std::memory_order_relaxed);
+    }
+    [[nodiscard]] uint64_t get() const {
+      return value.load(std::memory_order_relaxed);
+    }
+
+   private:
+    std::atomic<uint64_t> value{0};
+  };
+  static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+  /*
+    Instructions retired, polling loops the idle skipper jumped over
+    included since they end in the same state. The CPU brings it up to
+    date when events run and on every DOS call, not per instruction.
+  */
+  Counter instructions;
+  // Clocks that passed without instructions, in HLT or waiting for a key
+  Counter idle_clocks;
+  // Clocks the idle skipper took off polling loops
+  Counter skipped_clocks;
+  Counter rep_iterations;
+  // Interrupts entered per vector, INT instructions and IRQs alike
+  std::array<Counter, 256> interrupts;
+  // INT 21h calls per AH
+  std::array<Counter, 256> dos_calls;
+  // Sectors moved by INT 13h, 25h and 26h
+  Counter disk_read_bytes;
+  Counter disk_write_bytes;
+  // Characters through the DOS console functions
+  Counter console_read_bytes;
+  Counter console_write_bytes;
+
+  // One JSON object, vectors and functions that were never used left out
+  [[nodiscard]] std::string to_json() const;
+  // JSON to path, or to stderr for "-"
+  bool save(std::string_view path) const;
+};
+
+#endif  // STATS_H
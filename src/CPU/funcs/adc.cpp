@@ -34,7 +34,7 @@ void CPU8068::adc_rm_reg(const uint8_t mod_rm, const uint8_t width) {
     }
   } else if (mode == 0b00 || mode == 0b01 || mode == 0b10) {
     uint16_t address;
-    uint16_t segment;
+    Sreg segment;
     if (!get_address_mode_rm(mode, r_m, segment, address)) {
       mylog("Unsupported r/m bit");
       return;
@@ -96,7 +96,7 @@ void CPU8068::adc_reg_rm(const uint8_t mod_rm, const uint8_t width) {
     }
   } else if (mode == 0b00 || mode == 0b01 || mode == 0b10) {
     uint16_t address;
-    uint16_t segment;
+    Sreg segment;
     if (!get_address_mode_rm(mode, r_m, segment, address)) {
       mylog("Unsupported r/m bit");
       return;
@@ -0,0 +1,176 @@
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+#include "../../Devices/BiosDataArea.h"
+#include "../../Utils/logger.h"
+#include "../CPU8068.h"
+
+namespace {
+constexpr uint16_t BIOS_SEGMENT = 0xF000;
+// One stub per vector, STUB_SIZE bytes apart
+constexpr uint16_t STUBS = 0xE000;
+constexpr uint16_t STUB_SIZE = 8;
+// IP after the INT in a stub, which follows an STI
+constexpr uint16_t STUB_RETURN = 3;
+// The ROM image covers the stubs up to the end of the segment
+constexpr uint16_t ROM_START = STUBS;
+constexpr uint32_t ROM_SIZE = 0x10000 - ROM_START;
+// Release date and machine model where programs look for them
+constexpr uint16_t DATE = 0xFFF5;
+constexpr char ROM_DATE[] = "01/10/86";
+constexpr uint16_t MODEL = 0xFFFE;
+constexpr uint8_t MODEL_PC = 0xFF;
+constexpr uint8_t MODEL_AT = 0xFC;
+constexpr uint16_t CONVENTIONAL_KB = 640;
+
+constexpr uint8_t STI = 0xFB;
+constexpr uint8_t INT = 0xCD;
+constexpr uint8_t RETF_POP = 0xCA;
+constexpr uint8_t RETF = 0xCB;
+constexpr uint8_t IRET = 0xCF;
+constexpr uint8_t USER_TIMER_VECTOR = 0x1C;
+
+constexpr uint16_t stub(const uint8_t num) { return STUBS + num * STUB_SIZE; }
+}  // namespace
+
+/*
+  The vector table, the BIOS data area and the ROM stubs are the same
+  for every machine, so they are put together once at compile time and
+  copied in whole instead of running anything like a POST. Only what
+  depends on the options is patched in after.
+*/
+void CPU8068::install_bios() {
+  struct Image {
+    std::array<uint8_t, BiosDataArea::END> low;
+    std::array<uint8_t, ROM_SIZE> rom;
+  };
+  static constexpr Image IMAGE = [] {
+    Image image{};
+    const auto put16 = [&image](const uint32_t address, const uint16_t value) {
+      image.low[address] = static_cast<uint8_t>(value);
+      image.low[address + 1] = static_cast<uint8_t>(value >> 8);
+    };
+
+    for (int num = 0; num < 256; num++) {
+      const uint8_t vector = static_cast<uint8_t>(num);
+      /*
+        Services return with RETF 2 so the flags they set reach the
+        caller. The timer tick calls INT 1Ch and ends with IRET, as does
+        the keyboard interrupt. DOS absolute disk reads and writes
+        leave the caller's flags on the stack, so theirs is a plain RETF.
+      */
+      const std::array<uint8_t, STUB_SIZE> service = {STI, INT, vector,
+                                                      RETF_POP, 2, 0};
+      const std::array<uint8_t, STUB_SIZE> tick = {
+          STI, INT, vector, INT, USER_TIMER_VECTOR, IRET};
+      const std::array<uint8_t, STUB_SIZE> irq = {STI, INT, vector, IRET};
+      const std::array<uint8_t, STUB_SIZE> absolute = {STI, INT, vector, RETF};
+      const std::array<uint8_t, STUB_SIZE>& code =
+          vector == TIMER_VECTOR      ? tick
+          : vector == KEYBOARD_VECTOR ? irq
+          : vector == ABSOLUTE_READ_VECTOR || vector == ABSOLUTE_WRITE_VECTOR
+              ? absolute
+              : service;
+      for (uint16_t i = 0; i < STUB_SIZE; i++) {
+        image.rom[stub(vector) - ROM_START + i] = code[i];
+      }
+      put16(vector * 4, stub(vector));
+      put16(vector * 4 + 2, BIOS_SEGMENT);
+    }
+    for (uint16_t i = 0; i < sizeof(ROM_DATE) - 1; i++) {
+      image.rom[DATE - ROM_START + i] = static_cast<uint8_t>(ROM_DATE[i]);
+    }
+
+    put16(BiosDataArea::EQUIPMENT, BiosDataArea::EQUIPMENT_COLOR_80);
+    put16(BiosDataArea::MEMORY_SIZE, CONVENTIONAL_KB);
+    put16(BiosDataArea::KEYBOARD_HEAD, BiosDataArea::KEYBOARD_BUFFER);
+    put16(BiosDataArea::KEYBOARD_TAIL, BiosDataArea::KEYBOARD_BUFFER);
+    put16(BiosDataArea::KEYBOARD_START, BiosDataArea::KEYBOARD_BUFFER);
+    put16(BiosDataArea::KEYBOARD_END, BiosDataArea::KEYBOARD_BUFFER_END);
+    // 80x25 colour text with the cursor on lines 6-7, as a mode 03h set
+    image.low[BiosDataArea::VIDEO_MODE] = 0x03;
+    put16(BiosDataArea::COLUMNS, 80);
+    put16(BiosDataArea::PAGE_SIZE, 0x1000);
+    put16(BiosDataArea::CURSOR_SHAPE, 0x0607);
+    put16(BiosDataArea::CRTC_PORT, 0x3D4);
+    image.low[BiosDataArea::LAST_ROW] = 24;
+    put16(BiosDataArea::CHARACTER_HEIGHT, 16);
+    return image;
+  }();
+
+  std::memcpy(&memory[0], IMAGE.low.data(), IMAGE.low.size());
+  uint8_t* rom = &memory[BIOS_SEGMENT * SEGMENT_MULTIPLIER + ROM_START];
+  std::memcpy(rom, IMAGE.rom.data(), IMAGE.rom.size());
+
+  if (fpu) {
+    memory[BiosDataArea::EQUIPMENT] |= BiosDataArea::EQUIPMENT_FPU;
+  }
+  rom[MODEL - ROM_START] =
+      cpu_mode >= CPU_MODE::CPU_80286 ? MODEL_AT : MODEL_PC;
+}
+
+void CPU8068::software_interrupt(const uint8_t num) {
+  // There is no interrupt descriptor table, protected mode calls go direct
+  if (protected_mode()) {
+    counters.interrupts[num].add();
+    interrupt(num);
+    return;
+  }
+
+  // The tick stub does more than the service, it always runs
+  const bool unhooked = !hooked(num) && num != TIMER_VECTOR;
+  // A call that reached its stub was counted on the way in
+  if (in_stub(num)) {
+    interrupt(num);
+    return;
+  }
+  if (unhooked) {
+    counters.interrupts[num].add();
+    interrupt(num);
+    return;
+  }
+  enter_interrupt(num);
+}
+
+bool CPU8068::hooked(const uint8_t num) const {
+  const uint8_t* entry = &memory[num * 4];
+  const uint16_t offset = static_cast<uint16_t>(entry[0] | entry[1] << 8);
+  const uint16_t segment = static_cast<uint16_t>(entry[2] | entry[3] << 8);
+  return segment != BIOS_SEGMENT || offset != stub(num);
+}
+
+bool CPU8068::in_stub(const uint8_t num) const {
+  return CS == BIOS_SEGMENT && IP == stub(num) + STUB_RETURN;
+}
+
+bool CPU8068::raise_fault(const uint8_t num, const uint16_t start_IP) {
+  IP = start_IP;
+  if (protected_mode() || !hooked(num)) {
+    mylog("Unhandled exception %.02X at %.04X:%.04X", static_cast<int>(num),
+          static_cast<int>(CS), static_cast<int>(IP));
+    return false;
+  }
+  enter_interrupt(num);
+  return true;
+}
+
+bool CPU8068::can_interrupt(const uint8_t irq) const {
+  return (FLAGS & IF_MASK) && interrupt_delay < 2 &&
+         !(interrupt_mask & 1 << irq);
+}
+
+void CPU8068::enter_interrupt(const uint8_t num) {
+  counters.interrupts[num].add();
+  SP -= 2;
+  mem16(Sreg::SS, SP) = FLAGS;
+  SP -= 2;
+  mem16(Sreg::SS, SP) = CS;
+  SP -= 2;
+  mem16(Sreg::SS, SP) = IP;
+  FLAGS &= ~(IF_MASK | TF_MASK);
+
+  const uint8_t* entry = &memory[num * 4];
+  jump_far(static_cast<uint16_t>(entry[2] | entry[3] << 8),
+           static_cast<uint16_t>(entry[0] | entry[1] << 8));
+}
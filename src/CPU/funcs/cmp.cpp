@@ -29,7 +29,7 @@ void CPU8068::cmp_rm_reg(const uint8_t mod_rm, const uint8_t width) {
     }
   } else if (mode == 0b00 || mode == 0b01 || mode == 0b10) {
     uint16_t address;
-    uint16_t segment;
+    Sreg segment;
     if (!get_address_mode_rm(mode, r_m, segment, address)) {
       mylog("Unsupported r/m bit");
       return;
@@ -78,7 +78,7 @@ void CPU8068::cmp_reg_rm(uint8_t mod_rm, uint8_t width) {
     }
   } else if (mode == 0b00 || mode == 0b01 || mode == 0b10) {
     uint16_t address;
-    uint16_t segment;
+    Sreg segment;
     if (!get_address_mode_rm(mode, r_m, segment, address)) {
       mylog("Unsupported r/m bit");
       return;
@@ -0,0 +1,32 @@
+#include <cstdint>
+#include <memory>
+
+#include "../../Utils/CoverageMap.h"
+#include "../CPU8068.h"
+
+void CPU8068::enable_coverage() {
+  coverage_map = std::make_unique<CoverageMap>();
+  // An empty block, nothing has run yet
+  coverage_start = 1;
+  coverage_last = 0;
+}
+
+CoverageMap& CPU8068::coverage() {
+  coverage_map->mark(coverage_start, coverage_last + 1);
+  return *coverage_map;
+}
+
+void CPU8068::cover() {
+  /*
+    As with traces, how far this instruction starts from the one before
+    gives that one's length, unless it jumped. Of a jump only the first
+    byte is known, and the block ends there. The step is checked as well
+    for what moves CS:IP outside of instructions, like the debugger.
+  */
+  const uint32_t address = linear_address(Sreg::CS, IP);
+  if (jump_taken || address - coverage_last - 1 >= MAX_COVERED_LENGTH) {
+    coverage_map->mark(coverage_start, coverage_last + 1);
+    coverage_start = address;
+  }
+  coverage_last = address;
+}
@@ -0,0 +1,418 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "../../Exceptions/ProgramExitedException.h"
+#include "../../Utils/GdbStub.h"
+#include "../CPU8068.h"
+#include "../EventScheduler.h"
+
+namespace {
+// Stop reasons, as gdb numbers signals
+constexpr uint8_t SIGNAL_INTERRUPT = 2;
+constexpr uint8_t SIGNAL_TRAP = 5;
+
+// gdb's i386 register file: EAX ECX EDX EBX ESP EBP ESI EDI EIP EFLAGS CS SS DS ES FS GS
+constexpr size_t GDB_REGISTERS = 16;
+
+constexpr char HEX[] = "0123456789abcdef";
+
+void put_hex8(std::string& out, const uint8_t value) {
+  out += HEX[value >> 4];
+  out += HEX[value & 15];
+}
+
+// A register as gdb wants it, 32 bits little endian
+void put_register(std::string& out, const uint32_t value) {
+  for (int shift = 0; shift < 32; shift += 8) {
+    put_hex8(out, static_cast<uint8_t>(value >> shift));
+  }
+}
+
+int hex_digit(const char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+bool parse_hex(const std::string& text, size_t& at, uint32_t& value) {
+  const size_t start = at;
+  value = 0;
+  while (at < text.size() && hex_digit(text[at]) >= 0) {
+    value = value << 4 | static_cast<uint32_t>(hex_digit(text[at++]));
+  }
+  return at > start;
+}
+
+bool parse_byte(const std::string& text, const size_t at, uint8_t& value) {
+  if (at + 2 > text.size() || hex_digit(text[at]) < 0 ||
+      hex_digit(text[at + 1]) < 0) {
+    return false;
+  }
+  value = static_cast<uint8_t>(hex_digit(text[at]) << 4 |
+                               hex_digit(text[at + 1]));
+  return true;
+}
+
+// Inverse of put_register
+bool parse_register(const std::string& text, const size_t at,
+                    uint32_t& value) {
+  value = 0;
+  for (int i = 0; i < 4; i++) {
+    uint8_t byte;
+    if (!parse_byte(text, at + i * 2, byte)) {
+      return false;
+    }
+    value |= static_cast<uint32_t>(byte) << (i * 8);
+  }
+  return true;
+}
+}  // namespace
+
+void CPU8068::enable_debugger(std::unique_ptr<GdbStub> stub) {
+  debugger = std::move(stub);
+  breakpoint_pages.assign((memory.size() >> DEBUG_PAGE_BITS) + 1, false);
+  watch_pages.assign(breakpoint_pages.size(), false);
+  // Clients expect to find the guest stopped when they connect
+  debug_stop_pending = true;
+  debug_report = false;
+  debug_signal = SIGNAL_TRAP;
+  events.schedule(EventScheduler::DEBUGGER,
+                  virtual_clock() + DEBUGGER_POLL_INSTRUCTIONS);
+  sync_events();
+}
+
+void CPU8068::close_debugger(const int code) {
+  if (!debugger) {
+    return;
+  }
+  std::string reply = "W";
+  put_hex8(reply, static_cast<uint8_t>(code));
+  debugger->send(reply);
+  detach_debugger();
+}
+
+void CPU8068::detach_debugger() {
+  debugger.reset();
+  breakpoints.clear();
+  breakpoint_pages.clear();
+  watchpoints.clear();
+  watch_pages.clear();
+  watching = false;
+  watch_touched = false;
+  debug_stop_pending = false;
+  events.cancel(EventScheduler::DEBUGGER);
+  sync_events();
+}
+
+void CPU8068::debugger_event() {
+  if (debugger->interrupted()) {
+    debug_stop_pending = true;
+    debug_report = true;
+    debug_signal = SIGNAL_INTERRUPT;
+  }
+  events.schedule(EventScheduler::DEBUGGER,
+                  virtual_clock() + DEBUGGER_POLL_INSTRUCTIONS);
+}
+
+void CPU8068::debug_hook() {
+  std::string reply;
+  if (watch_touched && watch_fired(reply)) {
+    debug_signal = SIGNAL_TRAP;
+  } else {
+    // The instruction the client resumed on runs, breakpoint or not
+    if (debug_resuming) {
+      debug_resuming = false;
+      return;
+    }
+    if (!debug_stop_pending) {
+      const uint32_t address = linear_address(Sreg::CS, IP);
+      if (!breakpoint_pages[address >> DEBUG_PAGE_BITS] ||
+          !breakpoints.count(address)) {
+        return;
+      }
+      debug_report = true;
+      debug_signal = SIGNAL_TRAP;
+    }
+    if (debug_report) {
+      reply = "S";
+      put_hex8(reply, debug_signal);
+    }
+  }
+  debug_stop_pending = false;
+  // The client went away if either fails, the guest runs on by itself
+  if (!reply.empty() && !debugger->send(reply)) {
+    detach_debugger();
+    return;
+  }
+
+  std::string packet;
+  while (true) {
+    if (!debugger->receive(packet)) {
+      detach_debugger();
+      return;
+    }
+    reply.clear();
+    if (debug_command(packet, reply)) {
+      return;
+    }
+    if (!debugger->send(reply)) {
+      detach_debugger();
+      return;
+    }
+  }
+}
+
+bool CPU8068::debug_command(const std::string& packet, std::string& reply) {
+  const char command = packet.empty() ? '\0' : packet[0];
+  switch (command) {
+    case '?':
+      reply = "S";
+      put_hex8(reply, debug_signal);
+      return false;
+    case 'g': {
+      const uint32_t values[GDB_REGISTERS] = {AX, CX, DX, BX, SP, BP, SI, DI,
+                                              IP, FLAGS, CS, SS, DS, ES, 0, 0};
+      for (const uint32_t value : values) {
+        put_register(reply, value);
+      }
+      return false;
+    }
+    case 'G':
+    case 'P': {
+      // G sets them all in order, P one: P<number>=<value>
+      size_t at = 1;
+      uint32_t first = 0;
+      if (command == 'P' && (!parse_hex(packet, at, first) ||
+                             at >= packet.size() || packet[at++] != '=')) {
+        reply = "E01";
+        return false;
+      }
+      uint16_t* targets[GDB_REGISTERS] = {&AX, &CX, &DX, &BX, &SP, &BP,
+                                          &SI, &DI, &IP, &FLAGS, &CS, &SS,
+                                          &DS, &ES, nullptr, nullptr};
+      const uint32_t last = command == 'P' ? first + 1 : GDB_REGISTERS;
+      for (uint32_t number = first; number < last; number++, at += 8) {
+        uint32_t value;
+        if (number >= GDB_REGISTERS || !parse_register(packet, at, value)) {
+          break;
+        }
+        if (targets[number]) {
+          *targets[number] = static_cast<uint16_t>(value);
+        }
+      }
+      update_segment_registers();
+      reply = "OK";
+      return false;
+    }
+    case 'p': {
+      size_t at = 1;
+      uint32_t number = 0;
+      if (!parse_hex(packet, at, number) || number >= GDB_REGISTERS) {
+        reply = "E01";
+        return false;
+      }
+      const uint32_t values[GDB_REGISTERS] = {AX, CX, DX, BX, SP, BP, SI, DI,
+                                              IP, FLAGS, CS, SS, DS, ES, 0, 0};
+      put_register(reply, values[number]);
+      return false;
+    }
+      // m<address>,<length> and M<address>,<length>:<bytes>, linear addresses
+    case 'm':
+    case 'M': {
+      size_t at = 1;
+      uint32_t address = 0;
+      uint32_t length = 0;
+      if (!parse_hex(packet, at, address) || at >= packet.size() ||
+          packet[at++] != ',' || !parse_hex(packet, at, length) ||
+          address >= memory.size() || length > memory.size() - address) {
+        reply = "E01";
+        return false;
+      }
+      if (command == 'm') {
+        for (uint32_t i = 0; i < length; i++) {
+          put_hex8(reply, memory[address + i]);
+        }
+        return false;
+      }
+      if (at >= packet.size() || packet[at++] != ':') {
+        reply = "E01";
+        return false;
+      }
+      for (uint32_t i = 0; i < length; i++) {
+        uint8_t byte;
+        if (!parse_byte(packet, at + i * 2, byte)) {
+          reply = "E01";
+          return false;
+        }
+        memory[address + i] = byte;
+      }
+      reply = "OK";
+      return false;
+    }
+      /*
+        Z0 / Z1 (software / hardware) breakpoints are the same thing
+        here, nothing is patched into guest memory. Z2 / Z3 / Z4 are
+        write, read and access watchpoints: Z<type>,<address>,<length>
+      */
+    case 'Z':
+    case 'z': {
+      size_t at = 3;
+      uint32_t address = 0;
+      uint32_t length = 1;
+      if (packet.size() < 3 || packet[1] < '0' || packet[1] > '4' ||
+          packet[2] != ',' || !parse_hex(packet, at, address)) {
+        return false;
+      }
+      if (packet[1] <= '1') {
+        set_breakpoint(address, command == 'Z');
+        reply = "OK";
+        return false;
+      }
+      if (at >= packet.size() || packet[at++] != ',' ||
+          !parse_hex(packet, at, length) ||
+          !set_watchpoint(static_cast<WatchType>(packet[1] - '0'), address,
+                          length, command == 'Z')) {
+        reply = "E01";
+        return false;
+      }
+      reply = "OK";
+      return false;
+    }
+    case 'c':
+    case 's':
+      debug_resuming = true;
+      debug_stop_pending = command == 's';
+      debug_report = true;
+      debug_signal = SIGNAL_TRAP;
+      return true;
+    case 'D':
+      debugger->send("OK");
+      detach_debugger();
+      return true;
+    case 'k':
+      detach_debugger();
+      throw ProgramExitedException{0};
+    case 'H':
+    case 'T':
+      reply = "OK";
+      return false;
+    case 'q':
+      if (packet.rfind("qSupported", 0) == 0) {
+        reply = "PacketSize=4000";
+      } else if (packet == "qAttached") {
+        reply = "1";
+      } else if (packet == "qfThreadInfo") {
+        reply = "m1";
+      } else if (packet == "qsThreadInfo") {
+        reply = "l";
+      } else if (packet == "qC") {
+        reply = "QC1";
+      }
+      return false;
+    default:
+      // Empty, as the protocol answers anything it does not support
+      return false;
+  }
+}
+
+void CPU8068::set_breakpoint(const uint32_t address, const bool on) {
+  const uint32_t page = address >> DEBUG_PAGE_BITS;
+  if (page >= breakpoint_pages.size()) {
+    return;
+  }
+  if (on) {
+    breakpoints.insert(address);
+    breakpoint_pages[page] = true;
+    return;
+  }
+
+  breakpoints.erase(address);
+  bool used = false;
+  for (const uint32_t other : breakpoints) {
+    used = used || other >> DEBUG_PAGE_BITS == page;
+  }
+  breakpoint_pages[page] = used;
+}
+
+void CPU8068::watch_access(const uint32_t address, const uint32_t size) {
+  for (Watchpoint& watch : watchpoints) {
+    if (watch.touched || address + size <= watch.address ||
+        address >= watch.address + watch.length) {
+      continue;
+    }
+    if (watch.type == WATCH_WRITE) {
+      const uint8_t* bytes = memory.data() + watch.address;
+      watch.before.assign(bytes, bytes + watch.length);
+    }
+    watch.touched = true;
+    watch_touched = true;
+  }
+}
+
+bool CPU8068::watch_fired(std::string& reply) {
+  watch_touched = false;
+  for (Watchpoint& watch : watchpoints) {
+    if (!watch.touched) {
+      continue;
+    }
+    watch.touched = false;
+    const bool fired =
+        watch.type != WATCH_WRITE ||
+        !std::equal(watch.before.begin(), watch.before.end(),
+                    memory.data() + watch.address);
+    if (!fired || !reply.empty()) {
+      continue;
+    }
+    const char* kind = watch.type == WATCH_WRITE  ? "watch"
+                       : watch.type == WATCH_READ ? "rwatch"
+                                                  : "awatch";
+    char stop[32];
+    std::snprintf(stop, sizeof(stop), "T%02x%s:%x;", SIGNAL_TRAP, kind,
+                  watch.address);
+    reply = stop;
+  }
+  return !reply.empty();
+}
+
+bool CPU8068::set_watchpoint(const WatchType type, const uint32_t address,
+                             const uint32_t length, const bool on) {
+  if (!length || address >= memory.size() ||
+      length > memory.size() - address) {
+    return false;
+  }
+  if (on) {
+    watchpoints.push_back(Watchpoint{type, address, length, false, {}});
+  } else {
+    const auto found = std::find_if(
+        watchpoints.begin(), watchpoints.end(), [&](const Watchpoint& watch) {
+          return watch.type == type && watch.address == address &&
+                 watch.length == length;
+        });
+    if (found == watchpoints.end()) {
+      return false;
+    }
+    watchpoints.erase(found);
+  }
+
+  std::fill(watch_pages.begin(), watch_pages.end(), false);
+  for (const Watchpoint& watch : watchpoints) {
+    const uint32_t last = watch.address + watch.length - 1;
+    for (uint32_t page = watch.address >> DEBUG_PAGE_BITS;
+         page <= last >> DEBUG_PAGE_BITS; page++) {
+      watch_pages[page] = true;
+    }
+  }
+  watching = !watchpoints.empty();
+  return true;
+}
@@ -0,0 +1,261 @@
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include "../../Devices/BiosDataArea.h"
+#include "../../Devices/DiskImage.h"
+#include "../CPU8068.h"
+
+// INT 13h status codes, returned in AH with CF set on failure
+constexpr static uint8_t DISK_OK = 0x00;
+constexpr static uint8_t DISK_BAD_COMMAND = 0x01;
+constexpr static uint8_t DISK_WRITE_PROTECTED = 0x03;
+constexpr static uint8_t DISK_SECTOR_NOT_FOUND = 0x04;
+// The buffer wraps around its segment, or runs off the end of memory
+constexpr static uint8_t DISK_BOUNDARY = 0x09;
+constexpr static uint8_t DISK_TIMEOUT = 0x80;
+
+constexpr static uint8_t HARD_DISK = 0x80;
+// DOS drive numbers for INT 25h/26h, 0 = A:
+constexpr static uint8_t DOS_DRIVE_A = 0;
+constexpr static uint8_t DOS_DRIVE_C = 2;
+// CX of INT 25h/26h when DS:BX points to a packet instead
+constexpr static uint16_t LARGE_VOLUME_PACKET = 0xFFFF;
+
+void CPU8068::attach_disk(std::unique_ptr<DiskImage> disk) {
+  // The data area lists the drives for programs that look before asking
+  if (disk->is_floppy()) {
+    floppy_disk = std::move(disk);
+    memory[BiosDataArea::EQUIPMENT] |= BiosDataArea::EQUIPMENT_FLOPPY;
+  } else {
+    hard_disk = std::move(disk);
+    memory[BiosDataArea::HARD_DISKS] = 1;
+  }
+}
+
+DiskImage* CPU8068::bios_drive(const uint8_t drive) const {
+  if (drive == 0) {
+    return floppy_disk.get();
+  }
+  if (drive == HARD_DISK) {
+    return hard_disk.get();
+  }
+  return nullptr;
+}
+
+uint8_t CPU8068::disk_transfer(DiskImage& disk, const uint32_t lba,
+                               const uint32_t count, const uint16_t segment,
+                               const uint16_t offset, const bool write) {
+  const uint32_t bytes = count * DiskImage::SECTOR_SIZE;
+  const uint32_t address = linear_address(segment, offset);
+  // Contiguous in guest memory, so the whole transfer is one copy
+  if (offset + bytes > SEGMENT_SIZE || address + bytes > memory.size()) {
+    return DISK_BOUNDARY;
+  }
+
+  if (write) {
+    if (!disk.is_writable()) {
+      return DISK_WRITE_PROTECTED;
+    }
+    if (!disk.write(lba, count, memory.data() + address)) {
+      return DISK_SECTOR_NOT_FOUND;
+    }
+    counters.disk_write_bytes.add(bytes);
+    return DISK_OK;
+  }
+  if (!disk.read(lba, count, memory.data() + address)) {
+    return DISK_SECTOR_NOT_FOUND;
+  }
+  counters.disk_read_bytes.add(bytes);
+  return DISK_OK;
+}
+
+void CPU8068::disk_interrupt() {
+  DiskImage* disk = bios_drive(DL);
+  uint8_t status = DISK_OK;
+
+  switch (AH) {
+      // Reset disk system
+    case 0x00: {
+      status = disk ? DISK_OK : DISK_TIMEOUT;
+      break;
+    }
+      // Status of last operation, which is the only call that keeps it
+    case 0x01: {
+      AH = disk_status;
+      SetCF(disk_status != DISK_OK);
+      return;
+    }
+      // Read sectors, write sectors, verify sectors
+      // AL count, CH cylinder, CL sector and cylinder bits 8-9, DH head
+    case 0x02:
+    case 0x03:
+    case 0x04: {
+      if (!disk) {
+        status = DISK_TIMEOUT;
+        break;
+      }
+      const uint16_t cylinder = CH | (CL & 0xC0) << 2;
+      uint32_t lba = 0;
+      if (AL == 0 || !disk->to_lba(cylinder, DH, CL & 0x3F, lba) ||
+          lba + AL > disk->sector_count()) {
+        status = DISK_SECTOR_NOT_FOUND;
+      } else if (AH != 0x04) {
+        status = disk_transfer(*disk, lba, AL, ES, BX, AH == 0x03);
+      }
+      // Sectors transferred, all or nothing
+      if (status != DISK_OK) {
+        AL = 0;
+      }
+      break;
+    }
+      // Drive parameters
+    case 0x08: {
+      if (!disk) {
+        status = DISK_TIMEOUT;
+        break;
+      }
+      const uint16_t last_cylinder = disk->cylinders() - 1;
+      CH = static_cast<uint8_t>(last_cylinder);
+      CL = static_cast<uint8_t>(disk->sectors_per_track() |
+                                (last_cylinder >> 2 & 0xC0));
+      DH = static_cast<uint8_t>(disk->heads() - 1);
+      // One drive of each kind
+      DL = 1;
+      BL = disk->floppy_type();
+      // No diskette parameter table to point to
+      ES = 0;
+      DI = 0;
+      AL = 0;
+      break;
+    }
+      // Disk type, CX:DX sector count for hard disks
+    case 0x15: {
+      if (!disk) {
+        AH = 0x00;
+        SetCF(0);
+        return;
+      }
+      if (disk->is_floppy()) {
+        // Floppy without change line support
+        AH = 0x01;
+      } else {
+        AH = 0x03;
+        CX = static_cast<uint16_t>(disk->sector_count() >> 16);
+        DX = static_cast<uint16_t>(disk->sector_count());
+      }
+      SetCF(0);
+      disk_status = DISK_OK;
+      return;
+    }
+      // Extensions installation check
+    case 0x41: {
+      if (!disk || disk->is_floppy() || BX != 0x55AA) {
+        status = DISK_BAD_COMMAND;
+        break;
+      }
+      BX = 0xAA55;
+      // Version 1.x, packet access functions only
+      CX = 0x0001;
+      AH = 0x01;
+      SetCF(0);
+      disk_status = DISK_OK;
+      return;
+    }
+      /*
+        Extended read and write, DS:SI points to the packet
+          u8 size  u8 reserved  u16 count  u16 offset  u16 segment
+          u64 first sector
+      */
+    case 0x42:
+    case 0x43: {
+      if (!disk || disk->is_floppy()) {
+        status = DISK_BAD_COMMAND;
+        break;
+      }
+      uint16_t& count = mem16(Sreg::DS, SI + 2);
+      const uint16_t offset = mem16(Sreg::DS, SI + 4);
+      const uint16_t segment = mem16(Sreg::DS, SI + 6);
+      const uint32_t lba =
+          mem16(Sreg::DS, SI + 8) | mem16(Sreg::DS, SI + 10) << 16;
+      const bool beyond_32_bits =
+          mem16(Sreg::DS, SI + 12) || mem16(Sreg::DS, SI + 14);
+      if (beyond_32_bits || lba > disk->sector_count() ||
+          count > disk->sector_count() - lba) {
+        status = DISK_SECTOR_NOT_FOUND;
+      } else {
+        status = disk_transfer(*disk, lba, count, segment, offset, AH == 0x43);
+      }
+      if (status != DISK_OK) {
+        count = 0;
+      }
+      break;
+    }
+    default: {
+      status = DISK_BAD_COMMAND;
+      break;
+    }
+  }
+
+  disk_status = status;
+  AH = status;
+  SetCF(status != DISK_OK);
+}
+
+void CPU8068::absolute_disk_interrupt(const bool write) {
+  DiskImage* disk = AL == DOS_DRIVE_A   ? floppy_disk.get()
+                    : AL == DOS_DRIVE_C ? hard_disk.get()
+                                        : nullptr;
+
+  /*
+    CX FFFFh is the form for volumes over 32 MiB, DS:BX points to
+      u32 first sector  u16 count  u16 offset  u16 segment
+  */
+  uint32_t sector = DX;
+  uint32_t count = CX;
+  uint16_t segment = DS;
+  uint16_t offset = BX;
+  if (CX == LARGE_VOLUME_PACKET) {
+    sector = mem16(Sreg::DS, BX) | mem16(Sreg::DS, BX + 2) << 16;
+    count = mem16(Sreg::DS, BX + 4);
+    offset = mem16(Sreg::DS, BX + 6);
+    segment = mem16(Sreg::DS, BX + 8);
+  }
+
+  // AH the BIOS error, AL the device driver one
+  uint16_t error = 0;
+  if (!disk) {
+    // Attachment failed, unknown unit
+    error = 0x8001;
+  } else if (sector > disk->sector_count() - disk->volume_start() ||
+             count > disk->sector_count() - disk->volume_start() - sector) {
+    // Sector not found
+    error = 0x0408;
+  } else {
+    const uint8_t status = disk_transfer(*disk, disk->volume_start() + sector,
+                                         count, segment, offset, write);
+    if (status == DISK_WRITE_PROTECTED) {
+      error = 0x0300;
+    } else if (status != DISK_OK) {
+      // General failure
+      error = status << 8 | 0x0C;
+    }
+  }
+
+  if (error) {
+    AX = error;
+    SetCF(1);
+  } else {
+    SetCF(0);
+  }
+
+  /*
+    DOS returns with a RETF, callers pop the flags it leaves on the stack.
+    Serviced in place there is no INT frame, so push them here; a hooked
+    call that chained to the stub has its own frame's flags left there.
+  */
+  if (!in_stub(write ? ABSOLUTE_WRITE_VECTOR : ABSOLUTE_READ_VECTOR)) {
+    SP -= 2;
+    mem16(Sreg::SS, SP) = FLAGS;
+  }
+}
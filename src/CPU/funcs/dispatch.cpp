@@ -0,0 +1,73 @@
+#include <cstdint>
+
+#include "../CPU8068.h"
+#include "../CPUMode.h"
+
+static CPU8068::DispatchTable make_8086_table() {
+  CPU8068::DispatchTable table{};
+  table.handlers.fill(&CPU8068::execute_8086);
+
+  /*
+    The 8086 does not decode these, they behave like their neighbours:
+    60-6F are Jcc (70-7F), C0/C1 are RET (C2/C3), C8/C9 are RETF (CA/CB)
+  */
+  for (int opcode = 0x60; opcode <= 0x6F; opcode++) {
+    table.handlers[opcode] = &CPU8068::execute_8086_alias;
+  }
+  for (const uint8_t opcode : {0xC0, 0xC1, 0xC8, 0xC9}) {
+    table.handlers[opcode] = &CPU8068::execute_8086_alias;
+  }
+
+  for (int opcode = 0xA4; opcode <= 0xAF; opcode++) {
+    table.repeatable[opcode] = opcode != 0xA8 && opcode != 0xA9;
+  }
+  return table;
+}
+
+static CPU8068::DispatchTable make_80186_table() {
+  CPU8068::DispatchTable table = make_8086_table();
+  for (const uint8_t opcode : {0x60, 0x61, 0x62, 0x68, 0x69, 0x6A, 0x6B, 0x6C,
+                               0x6D, 0x6E, 0x6F, 0xC0, 0xC1, 0xC8, 0xC9}) {
+    table.handlers[opcode] = &CPU8068::execute_80186;
+  }
+  // Undefined on the 80186, they raise INT 6
+  table.handlers[0x0F] = &CPU8068::execute_80186;
+  for (int opcode = 0x63; opcode <= 0x67; opcode++) {
+    table.handlers[opcode] = &CPU8068::execute_80186;
+  }
+
+  for (int opcode = 0x6C; opcode <= 0x6F; opcode++) {
+    table.repeatable[opcode] = true;
+  }
+  return table;
+}
+
+static CPU8068::DispatchTable make_80286_table() {
+  CPU8068::DispatchTable table = make_80186_table();
+  table.handlers[0x0F] = &CPU8068::execute_80286;
+  table.handlers[0x63] = &CPU8068::execute_80286;
+  return table;
+}
+
+const CPU8068::DispatchTable& CPU8068::dispatch_table(const CPU_MODE cpu_mode) {
+  static const DispatchTable table_8086 = make_8086_table();
+  static const DispatchTable table_80186 = make_80186_table();
+  static const DispatchTable table_80286 = make_80286_table();
+
+  switch (cpu_mode) {
+    case CPU_MODE::CPU_80186:
+      return table_80186;
+    case CPU_MODE::CPU_80286:
+      return table_80286;
+    case CPU_MODE::CPU_8086:
+    default:
+      return table_8086;
+  }
+}
+
+bool CPU8068::execute_8086_alias(const uint8_t opcode) {
+  if (opcode >= 0x60 && opcode <= 0x6F) {
+    return execute_8086(opcode + 0x10);
+  }
+  return execute_8086(opcode + 0x02);
+}
@@ -0,0 +1,166 @@
+#include <cstdint>
+#include <iostream>
+
+#include "../../Utils/ReplayLog.h"
+#include "../CPU8068.h"
+
+// Console read result standing for the end of redirected input
+constexpr static uint64_t END_OF_INPUT = 0x100;
+// What DOS hands out for reads past the end of input, Ctrl-Z
+constexpr static uint8_t DOS_EOF = 0x1A;
+
+bool CPU8068::console_read(uint8_t& byte) {
+  // A finished key script is the end of the input
+  if (keyboard_read(byte) || (!key_script && host_read(byte))) {
+    counters.console_read_bytes.add();
+    return true;
+  }
+  return false;
+}
+
+bool CPU8068::console_ready() {
+  return keyboard_ready() || (!key_script && host_ready());
+}
+
+bool CPU8068::host_read(uint8_t& byte) {
+  // Whatever the program printed as a prompt has to be out first
+  if (display) {
+    display->refresh();
+  }
+  std::cout.flush();
+
+  const uint64_t value =
+      replay.input(ReplayEvent::CONSOLE_READ, [this]() -> uint64_t {
+        uint8_t live;
+        return console.read(live) ? live : END_OF_INPUT;
+      });
+  if (value == END_OF_INPUT) {
+    return false;
+  }
+  byte = static_cast<uint8_t>(value);
+  return true;
+}
+
+bool CPU8068::host_ready() {
+  return replay.input(ReplayEvent::CONSOLE_READY, [this]() -> uint64_t {
+           return console.ready() ? 1 : 0;
+         }) != 0;
+}
+
+bool CPU8068::dos_console_input(const uint8_t function) {
+  switch (function) {
+      // Character input with echo
+    case 0x01: {
+      uint8_t byte;
+      if (!console_read(byte)) {
+        byte = DOS_EOF;
+      }
+      std::cout << static_cast<char>(byte);
+      counters.console_write_bytes.add();
+      AL = byte;
+      return true;
+    }
+      // Direct console I/O, DL == FF reads without waiting
+    case 0x06: {
+      if (DL != 0xFF) {
+        std::cout << static_cast<char>(DL);
+        counters.console_write_bytes.add();
+        return true;
+      }
+
+      uint8_t byte;
+      if (console_ready() && console_read(byte)) {
+        AL = byte;
+        SetZF(0);
+      } else {
+        AL = 0;
+        SetZF(1);
+        polling_idle(IP - INT_LENGTH);
+      }
+      return true;
+    }
+      // Direct character input / character input without echo
+    case 0x07:
+    case 0x08: {
+      uint8_t byte;
+      if (!console_read(byte)) {
+        byte = DOS_EOF;
+      }
+      AL = byte;
+      return true;
+    }
+      /*
+        Buffered input into DS:DX, byte 0 is the buffer size, byte 1 gets
+        the length read, the line follows terminated by a CR that is not
+        counted
+      */
+    case 0x0A: {
+      const uint8_t size = mem8(Sreg::DS, DX);
+      if (size == 0) {
+        return true;
+      }
+
+      uint8_t length = 0;
+      while (true) {
+        uint8_t byte;
+        if (!console_read(byte)) {
+          byte = '\r';
+        }
+
+        if (byte == '\r') {
+          mem8(Sreg::DS, DX + 2 + length) = '\r';
+          std::cout << '\r';
+          break;
+        }
+        if (byte == '\b') {
+          if (length) {
+            length--;
+            // Same erase sequence as the output functions use
+            std::cout << "\x1b[1D \x1b[1D";
+          }
+          continue;
+        }
+        // The CR always needs room
+        if (length + 1 >= size) {
+          std::cout << '\a';
+          continue;
+        }
+
+        mem8(Sreg::DS, DX + 2 + length++) = byte;
+        std::cout << static_cast<char>(byte);
+        counters.console_write_bytes.add();
+      }
+      mem8(Sreg::DS, DX + 1) = length;
+      return true;
+    }
+      // Check input status
+    case 0x0B: {
+      AL = console_ready() ? 0xFF : 0x00;
+      if (!AL) {
+        polling_idle(IP - INT_LENGTH);
+      }
+      return true;
+    }
+      // Flush input buffer, then run input function AL
+    case 0x0C: {
+      // Replayed runs never look at the live console
+      if (replay.mode() != ReplayMode::REPLAY) {
+        console.flush();
+      }
+      flush_keys();
+
+      switch (AL) {
+        case 0x01:
+        case 0x06:
+        case 0x07:
+        case 0x08:
+        case 0x0A:
+          return dos_console_input(AL);
+        default:
+          return true;
+      }
+    }
+    default:
+      return false;
+  }
+}
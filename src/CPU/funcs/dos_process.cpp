@@ -0,0 +1,305 @@
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../../DOS/DosError.h"
+#include "../../DOS/HostPath.h"
+#include "../../DOS/MemoryArena.h"
+#include "../../DOS/ProgramImage.h"
+#include "../../Exceptions/ProgramExitedException.h"
+#include "../../Utils/logger.h"
+#include "../CPU8068.h"
+
+// Program segment prefix fields
+constexpr static uint16_t PSP_SIZE = 0x100;
+constexpr static uint16_t PSP_PARAGRAPHS = PSP_SIZE / 16;
+constexpr static uint16_t PSP_END_SEGMENT = 0x02;
+constexpr static uint16_t PSP_TERMINATE_ADDRESS = 0x0A;
+constexpr static uint16_t PSP_PARENT = 0x16;
+constexpr static uint16_t PSP_HANDLES = 0x18;
+constexpr static uint16_t PSP_ENVIRONMENT = 0x2C;
+constexpr static uint16_t PSP_SAVED_STACK = 0x2E;
+constexpr static uint16_t PSP_HANDLE_COUNT = 0x32;
+constexpr static uint16_t PSP_HANDLE_POINTER = 0x34;
+constexpr static uint16_t PSP_DOS_CALL = 0x50;
+constexpr static uint16_t PSP_FCB1 = 0x5C;
+constexpr static uint16_t PSP_FCB2 = 0x6C;
+constexpr static uint16_t PSP_TAIL = 0x80;
+
+constexpr static uint16_t FCB_SIZE = 16;
+constexpr static size_t MAX_TAIL_LENGTH = 126;
+constexpr static size_t MAX_ENVIRONMENT_SIZE = 32 * 1024;
+constexpr static size_t MAX_PATH_LENGTH = 128;
+
+static uint16_t paragraphs_for(const size_t bytes) {
+  return static_cast<uint16_t>((bytes + 15) / 16);
+}
+
+DosError CPU8068::create_process(const ProgramImage& image,
+                                 const std::string_view path,
+                                 const ExecArguments& arguments,
+                                 uint16_t& psp, ProcessStart& start) {
+  if (!image.is_exe && image.load_module.size() > 0x10000 - PSP_SIZE - 2) {
+    mylog("COM file cannot exceed 64kB memory in size");
+    return DosError::INVALID_FORMAT;
+  }
+
+  // Strings, an empty one, then a count of 1 and the program path
+  std::vector<uint8_t> environment;
+  uint16_t source = arguments.environment;
+  if (source == 0 && psp_segment != 0) {
+    source = mem16(psp_segment, PSP_ENVIRONMENT);
+  }
+  if (source != 0) {
+    for (uint16_t offset = 0; offset < MAX_ENVIRONMENT_SIZE; offset++) {
+      const uint8_t byte = mem8(source, offset);
+      if (byte == 0 && (environment.empty() || environment.back() == 0)) {
+        break;
+      }
+      environment.push_back(byte);
+    }
+  }
+  environment.push_back(0);
+  environment.push_back(1);
+  environment.push_back(0);
+  environment.insert(environment.end(), path.begin(), path.end());
+  environment.push_back(0);
+
+  uint16_t environment_segment = 0;
+  uint16_t largest = 0;
+  DosError error =
+      arena.allocate(paragraphs_for(environment.size()),
+                     MemoryArena::OWNER_DOS, environment_segment, largest);
+  if (error != DosError::NONE) {
+    return error;
+  }
+  for (size_t i = 0; i < environment.size(); i++) {
+    mem8(environment_segment, static_cast<uint16_t>(i)) = environment[i];
+  }
+
+  // A COM program gets the largest block, an MZ one what its header asks
+  const uint32_t module_paragraphs = paragraphs_for(image.load_module.size());
+  uint32_t needed = paragraphs_for(PSP_SIZE + image.load_module.size() + 2);
+  uint32_t wanted = 0xFFFF;
+  if (image.is_exe) {
+    needed = PSP_PARAGRAPHS + module_paragraphs + image.min_paragraphs;
+    wanted = std::min<uint32_t>(
+        PSP_PARAGRAPHS + module_paragraphs + image.max_paragraphs, 0xFFFF);
+    wanted = std::max(wanted, needed);
+  }
+
+  arena.allocate(0xFFFF, MemoryArena::OWNER_DOS, psp, largest);
+  const uint32_t size = std::min<uint32_t>(largest, wanted);
+  if (size < needed) {
+    arena.free(environment_segment);
+    return DosError::NOT_ENOUGH_MEMORY;
+  }
+  error = arena.allocate(static_cast<uint16_t>(size), MemoryArena::OWNER_DOS,
+                         psp, largest);
+  if (error != DosError::NONE) {
+    arena.free(environment_segment);
+    return error;
+  }
+  arena.change_owner(psp, psp);
+  arena.change_owner(environment_segment, psp);
+
+  for (uint16_t offset = 0; offset < PSP_SIZE; offset++) {
+    mem8(psp, offset) = 0;
+  }
+  mem8(psp, 0x00) = 0xCD;
+  mem8(psp, 0x01) = 0x20;
+  mem16(psp, PSP_END_SEGMENT) = static_cast<uint16_t>(psp + size);
+  // Back to right after the EXEC, the first program is its own parent
+  mem16(psp, PSP_TERMINATE_ADDRESS) = IP;
+  mem16(psp, PSP_TERMINATE_ADDRESS + 2) = CS;
+  mem16(psp, PSP_PARENT) = psp_segment ? psp_segment : psp;
+  // stdin, stdout, stderr, stdaux, stdprn, the rest closed
+  constexpr uint8_t HANDLES[] = {1, 1, 1, 0, 2};
+  for (uint16_t i = 0; i < 20; i++) {
+    mem8(psp, PSP_HANDLES + i) = i < std::size(HANDLES) ? HANDLES[i] : 0xFF;
+  }
+  mem16(psp, PSP_ENVIRONMENT) = environment_segment;
+  mem16(psp, PSP_HANDLE_COUNT) = 20;
+  mem16(psp, PSP_HANDLE_POINTER) = PSP_HANDLES;
+  mem16(psp, PSP_HANDLE_POINTER + 2) = psp;
+  mem8(psp, PSP_DOS_CALL) = 0xCD;
+  mem8(psp, PSP_DOS_CALL + 1) = 0x21;
+  mem8(psp, PSP_DOS_CALL + 2) = 0xCB;
+
+  for (const auto& [offset, fcb] :
+       {std::pair{PSP_FCB1, &arguments.fcb1},
+        std::pair{PSP_FCB2, &arguments.fcb2}}) {
+    for (uint16_t i = 0; i < FCB_SIZE; i++) {
+      // Unused FCBs are blank, drive 0 and an all spaces name
+      const uint8_t blank = (i >= 1 && i <= 11) ? ' ' : 0;
+      mem8(psp, offset + i) = i < fcb->size() ? (*fcb)[i] : blank;
+    }
+  }
+
+  const size_t tail_length =
+      std::min<size_t>(arguments.tail.empty() ? 0 : arguments.tail[0],
+                       MAX_TAIL_LENGTH);
+  mem8(psp, PSP_TAIL) = static_cast<uint8_t>(tail_length);
+  for (size_t i = 0; i < tail_length; i++) {
+    mem8(psp, PSP_TAIL + 1 + i) =
+        i + 1 < arguments.tail.size() ? arguments.tail[i + 1] : ' ';
+  }
+  mem8(psp, PSP_TAIL + 1 + tail_length) = '\r';
+
+  if (image.is_exe) {
+    const uint16_t load_segment = psp + PSP_PARAGRAPHS;
+    const std::vector<uint8_t>& module = image.relocated(load_segment);
+    for (size_t i = 0; i < module.size(); i++) {
+      memory[(static_cast<size_t>(load_segment) * 16 + i) & address_mask] =
+          module[i];
+    }
+
+    start.CS = load_segment + image.initial_CS;
+    start.IP = image.initial_IP;
+    start.SS = load_segment + image.initial_SS;
+    start.SP = image.initial_SP;
+  } else {
+    std::copy(image.load_module.begin(), image.load_module.end(),
+              &mem8(psp, PSP_SIZE));
+
+    start.CS = start.SS = psp;
+    start.IP = PSP_SIZE;
+    // A near RET from the top level lands on the INT 20h in the PSP
+    start.SP = size >= 0x1000 ? 0xFFFE : static_cast<uint16_t>(size * 16 - 2);
+    mem16(psp, start.SP) = 0;
+  }
+  return DosError::NONE;
+}
+
+void CPU8068::enter_process(const uint16_t psp, const ProcessStart& start) {
+  psp_segment = psp;
+  CS = start.CS;
+  IP = start.IP;
+  SS = start.SS;
+  SP = start.SP;
+  DS = ES = psp;
+  update_segment_registers();
+  jump_taken = true;
+}
+
+void CPU8068::terminate_process(const uint8_t code, const uint8_t type,
+                                const uint16_t keep_paragraphs) {
+  const uint16_t psp = psp_segment;
+  const uint16_t parent = psp ? mem16(psp, PSP_PARENT) : 0;
+  if (parent == 0 || parent == psp) {
+    throw ProgramExitedException{code};
+  }
+
+  return_code = static_cast<uint16_t>((type << 8) | code);
+  if (type == TERMINATE_RESIDENT) {
+    uint16_t largest = 0;
+    arena.resize(psp, std::max(keep_paragraphs, PSP_PARAGRAPHS), largest);
+  } else {
+    arena.free_owned_by(psp);
+  }
+
+  psp_segment = parent;
+  IP = mem16(psp, PSP_TERMINATE_ADDRESS);
+  CS = mem16(psp, PSP_TERMINATE_ADDRESS + 2);
+  SP = mem16(parent, PSP_SAVED_STACK);
+  SS = mem16(parent, PSP_SAVED_STACK + 2);
+  update_segment_registers();
+  jump_taken = true;
+  SetCF(0);
+}
+
+/*
+  INT 21h 4Bh, DS:DX is the program, ES:BX the parameter block.
+  AL = 00h load and run, 01h load only (for debuggers), 03h load an
+  overlay at a given segment.
+*/
+void CPU8068::dos_exec() {
+  std::string path;
+  for (uint16_t i = 0; i < MAX_PATH_LENGTH; i++) {
+    const uint8_t c = mem8(Sreg::DS, DX + i);
+    if (c == 0) {
+      break;
+    }
+    path.push_back(static_cast<char>(c));
+  }
+
+  const std::shared_ptr<const ProgramImage> image =
+      image_cache.get(to_host_path(path));
+  if (!image) {
+    set_dos_result(DosError::FILE_NOT_FOUND);
+    return;
+  }
+
+  switch (AL) {
+    case 0x00:
+    case 0x01: {
+      ExecArguments arguments;
+      arguments.environment = mem16(Sreg::ES, BX);
+
+      const uint16_t tail_offset = mem16(Sreg::ES, BX + 2);
+      const uint16_t tail_segment = mem16(Sreg::ES, BX + 4);
+      const uint8_t tail_length = mem8(tail_segment, tail_offset);
+      arguments.tail.clear();
+      for (uint16_t i = 0; i <= tail_length; i++) {
+        arguments.tail.push_back(mem8(tail_segment, tail_offset + i));
+      }
+
+      for (const auto& [pointer, fcb] :
+           {std::pair{uint16_t{6}, &arguments.fcb1},
+            std::pair{uint16_t{10}, &arguments.fcb2}}) {
+        const uint16_t offset = mem16(Sreg::ES, BX + pointer);
+        const uint16_t segment = mem16(Sreg::ES, BX + pointer + 2);
+        for (uint16_t i = 0; i < FCB_SIZE; i++) {
+          fcb->push_back(mem8(segment, offset + i));
+        }
+      }
+
+      // The parent continues on this stack once the child is done
+      if (psp_segment != 0) {
+        mem16(psp_segment, PSP_SAVED_STACK) = SP;
+        mem16(psp_segment, PSP_SAVED_STACK + 2) = SS;
+      }
+
+      uint16_t psp = 0;
+      ProcessStart start{};
+      const DosError error =
+          create_process(*image, path, arguments, psp, start);
+      if (error != DosError::NONE) {
+        set_dos_result(error);
+        return;
+      }
+
+      if (AL == 0x01) {
+        mem16(Sreg::ES, BX + 0x0E) = start.SP;
+        mem16(Sreg::ES, BX + 0x10) = start.SS;
+        mem16(Sreg::ES, BX + 0x12) = start.IP;
+        mem16(Sreg::ES, BX + 0x14) = start.CS;
+        psp_segment = psp;
+        set_dos_result(DosError::NONE);
+        return;
+      }
+
+      enter_process(psp, start);
+      AX = 0;
+      SetCF(0);
+      break;
+    }
+    case 0x03: {
+      const uint16_t load_segment = mem16(Sreg::ES, BX);
+      const uint16_t relocation = mem16(Sreg::ES, BX + 2);
+      const std::vector<uint8_t>& module = image->relocated(relocation);
+      for (size_t i = 0; i < module.size(); i++) {
+        memory[(static_cast<size_t>(load_segment) * 16 + i) & address_mask] =
+            module[i];
+      }
+      set_dos_result(DosError::NONE);
+      break;
+    }
+    default:
+      set_dos_result(DosError::INVALID_FUNCTION);
+      break;
+  }
+}
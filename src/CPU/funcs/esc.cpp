@@ -0,0 +1,37 @@
+#include <cstdint>
+
+#include "../../Utils/logger.h"
+#include "../CPU8068.h"
+#include "../CPUMode.h"
+
+void CPU8068::esc(const uint8_t opcode, const uint8_t mod_rm) {
+  const uint8_t mode = ((mod_rm >> 6) & 0b011);
+  const uint8_t r_m = ((mod_rm >> 0) & 0b111);
+
+  // The CPU always computes the address, even without a coprocessor
+  uint8_t* operand = nullptr;
+  if (mode != 0b11) {
+    uint16_t address;
+    Sreg segment;
+    if (!get_address_mode_rm(mode, r_m, segment, address)) {
+      mylog("Unsupported r/m bit");
+      return;
+    }
+    operand = &mem8(segment, address);
+  }
+
+  if (!fpu) {
+    return;
+  }
+
+  // FSTSW AX, added with the 80287
+  if (opcode == 0xDF && mod_rm == 0xE0 && cpu_mode >= CPU_MODE::CPU_80286) {
+    AX = fpu->status_word();
+    return;
+  }
+
+  if (!fpu->execute(opcode, mod_rm, operand)) {
+    mylog("Unsupported FPU instruction '%.02X %.02X'",
+          static_cast<int>(opcode), static_cast<int>(mod_rm));
+  }
+}
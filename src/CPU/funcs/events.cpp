@@ -0,0 +1,75 @@
+#include <algorithm>
+#include <cstdint>
+
+#include "../CPU8068.h"
+#include "../EventScheduler.h"
+
+uint64_t CPU8068::virtual_clock() const {
+  return event_deadline - event_countdown;
+}
+
+void CPU8068::set_virtual_clock(const uint64_t now) {
+  stats_clock_base += now - virtual_clock();
+  events.shift(now - virtual_clock());
+  event_deadline = now;
+  event_countdown = 0;
+  sync_events();
+}
+
+void CPU8068::sync_events() {
+  const uint64_t now = virtual_clock();
+  const uint64_t next = events.next();
+  // Due already, it runs after the instruction in progress
+  event_countdown = next <= now ? 1
+                                : static_cast<uint32_t>(std::min<uint64_t>(
+                                      next - now, MAX_EVENT_WAIT));
+  event_deadline = now + event_countdown;
+}
+
+void CPU8068::advance_clock(const uint64_t now) {
+  if (now > virtual_clock()) {
+    counters.idle_clocks.add(now - virtual_clock());
+    event_deadline = now + 1;
+    event_countdown = 1;
+  }
+}
+
+void CPU8068::run_events() {
+  const uint64_t now = event_deadline;
+  EventScheduler::Event event{};
+  while (events.take_due(now, event)) {
+    switch (event) {
+      case EventScheduler::TIMER:
+        timer_event();
+        break;
+      case EventScheduler::KEYBOARD:
+        keyboard_event();
+        break;
+      case EventScheduler::DISPLAY:
+        display->tick();
+        events.schedule(EventScheduler::DISPLAY,
+                        now + DISPLAY_POLL_INSTRUCTIONS);
+        break;
+      case EventScheduler::CAPTURE:
+        frame_capture->capture(framebuffer);
+        events.schedule(EventScheduler::CAPTURE, now + capture_interval);
+        break;
+      case EventScheduler::DEBUGGER:
+        if (debugger) {
+          debugger_event();
+        }
+        break;
+      default:
+        break;
+    }
+  }
+  sync_events();
+  update_stats();
+}
+
+const Stats& CPU8068::stats() const { return counters; }
+
+void CPU8068::update_stats() {
+  counters.instructions.set(virtual_clock() - stats_clock_base -
+                            counters.idle_clocks.get());
+}
@@ -0,0 +1,243 @@
+#include <algorithm>
+#include <cstdint>
+
+#include "../../Devices/IntervalTimer.h"
+#include "../CPU8068.h"
+
+namespace {
+// Bytes taken by a ModRM byte and the displacement after it
+uint16_t mod_rm_length(const uint8_t mod_rm) {
+  switch (mod_rm >> 6) {
+    case 0:
+      return (mod_rm & 7) == 6 ? 3 : 1;
+    case 1:
+      return 2;
+    case 2:
+      return 3;
+    default:
+      return 1;
+  }
+}
+}  // namespace
+
+void CPU8068::watch_loop(const uint16_t end) {
+  if (!idle_repeat(idle_loop, linear_address(Sreg::CS, IP), end)) {
+    return;
+  }
+  if (idle_loop.body == IdleWatch::UNKNOWN) {
+    idle_loop.body =
+        idle_body(IP, end, idle_loop) ? IdleWatch::IDLE : IdleWatch::BUSY;
+  }
+  if (idle_loop.body == IdleWatch::IDLE) {
+    skip_idle(idle_loop, idle_loop.reads_port
+                             ? port_stable_until(idle_loop.port)
+                             : IntervalTimer::NEVER);
+  }
+}
+
+void CPU8068::polling_idle(const uint16_t call) {
+  if (!idle_repeat(idle_poll, linear_address(Sreg::CS, call), 0)) {
+    return;
+  }
+  // Rewound onto the INT, no guest code runs between the calls
+  if (IP == call) {
+    skip_idle(idle_poll, IntervalTimer::NEVER);
+    return;
+  }
+  if (idle_poll.body == IdleWatch::UNKNOWN) {
+    idle_poll.body =
+        polling_loop(call, idle_poll) ? IdleWatch::IDLE : IdleWatch::BUSY;
+  }
+  if (idle_poll.body == IdleWatch::IDLE) {
+    skip_idle(idle_poll, idle_poll.reads_port
+                             ? port_stable_until(idle_poll.port)
+                             : IntervalTimer::NEVER);
+  }
+}
+
+bool CPU8068::idle_repeat(IdleWatch& watch, const uint32_t address,
+                          const uint16_t end) {
+  // Paced and single stepped runs go through every instruction
+  if (timing_enabled || FLAGS & TF_MASK) {
+    return false;
+  }
+  const uint64_t now = virtual_clock();
+  const RegisterSet registers = register_set();
+  if (address != watch.address || end != watch.end) {
+    watch = IdleWatch{address, end,   registers, now, 0,
+                      0,       IdleWatch::UNKNOWN, false, 0};
+    return false;
+  }
+
+  const uint64_t period = now - watch.clock;
+  const bool alike = registers == watch.registers && period == watch.period &&
+                     period <= IDLE_MAX_PERIOD;
+  watch.registers = registers;
+  watch.clock = now;
+  watch.period = period;
+  if (!alike) {
+    watch.repeats = 0;
+    return false;
+  }
+  if (watch.repeats < IDLE_REPEATS) {
+    watch.repeats++;
+    return false;
+  }
+  return true;
+}
+
+/*
+  Decodes the loop body once. Anything that may write memory, call out,
+  jump back past the head or read a port that changes on its own makes
+  the loop busy. Forward jumps out of the loop are fine, that is how it
+  ends.
+*/
+bool CPU8068::idle_body(const uint16_t head, const uint16_t end,
+                        IdleWatch& watch) {
+  const uint16_t size = static_cast<uint16_t>(end - head);
+  if (size > IDLE_LOOP_BYTES) {
+    return false;
+  }
+
+  watch.reads_port = false;
+  uint16_t at = head;
+  while (static_cast<uint16_t>(at - head) < size) {
+    const uint16_t length = idle_instruction(head, at, watch);
+    if (!length) {
+      return false;
+    }
+    at += length;
+  }
+  return at == end;
+}
+
+uint16_t CPU8068::idle_instruction(const uint16_t head, const uint16_t at,
+                                   IdleWatch& watch) {
+  const uint8_t opcode = mem8(Sreg::CS, at);
+  const uint8_t mod_rm = mem8(Sreg::CS, at + 1);
+  const bool to_register = mod_rm >> 6 == 3;
+  uint16_t length = 0;
+  bool reads_port = false;
+  uint16_t port = 0;
+
+  if (opcode < 0x40 && (opcode & 7) < 6) {
+    // ALU group, only CMP leaves the r/m operand alone
+    const uint8_t form = opcode & 7;
+    if (form < 2 && opcode >> 3 != 7 && !to_register) {
+      return 0;
+    }
+    length = form < 4 ? 1 + mod_rm_length(mod_rm) : form == 4 ? 2 : 3;
+  } else if ((opcode >= 0x40 && opcode <= 0x4F) ||
+             (opcode >= 0x90 && opcode <= 0x99) || opcode == 0x9E ||
+             opcode == 0x9F || (opcode >= 0xF8 && opcode <= 0xFD)) {
+    length = 1;
+  } else if ((opcode >= 0x70 && opcode <= 0x7F) || opcode == 0xEB) {
+    const int target = static_cast<uint16_t>(at - head) + 2 +
+                       static_cast<int8_t>(mod_rm);
+    if (target < 0) {
+      return 0;
+    }
+    length = 2;
+  } else if (opcode >= 0x80 && opcode <= 0x83) {
+    if (!to_register && (mod_rm >> 3 & 7) != 7) {
+      return 0;
+    }
+    length = 1 + mod_rm_length(mod_rm) + (opcode == 0x81 ? 2 : 1);
+  } else if (opcode == 0x84 || opcode == 0x85 || opcode == 0x8A ||
+             opcode == 0x8B || opcode == 0x8E) {
+    length = 1 + mod_rm_length(mod_rm);
+  } else if (opcode == 0x86 || opcode == 0x87 || opcode == 0x88 ||
+             opcode == 0x89 || opcode == 0x8C ||
+             (opcode >= 0xD0 && opcode <= 0xD3)) {
+    if (!to_register) {
+      return 0;
+    }
+    length = 1 + mod_rm_length(mod_rm);
+  } else if (opcode == 0xA0 || opcode == 0xA1 || opcode == 0xA9) {
+    length = 3;
+  } else if (opcode == 0xA8) {
+    length = 2;
+  } else if (opcode >= 0xB0 && opcode <= 0xBF) {
+    length = opcode < 0xB8 ? 2 : 3;
+  } else if (opcode == 0xE4 || opcode == 0xE5) {
+    reads_port = true;
+    port = mod_rm;
+    length = 2;
+  } else if (opcode == 0xEC || opcode == 0xED) {
+    // DX is the same on every pass
+    reads_port = true;
+    port = DX;
+    length = 1;
+  } else {
+    return 0;
+  }
+
+  if (reads_port) {
+    // One port at most, its next change bounds the skip
+    if (!port_stable_until(port) ||
+        (watch.reads_port && watch.port != port)) {
+      return 0;
+    }
+    watch.reads_port = true;
+    watch.port = port;
+  }
+  return length;
+}
+
+/*
+  The loop around a polling INT at call: from the INT onwards to the
+  branch that goes back to or before it, then from that branch's target
+  up to the INT. Both parts must pass as an idle body would, or skipped
+  iterations would leave out what they write.
+*/
+bool CPU8068::polling_loop(const uint16_t call, IdleWatch& watch) {
+  watch.reads_port = false;
+  const uint16_t after = call + INT_LENGTH;
+  uint16_t at = after;
+  while (static_cast<uint16_t>(at - call) < IDLE_LOOP_BYTES) {
+    const uint8_t opcode = mem8(Sreg::CS, at);
+    if ((opcode >= 0x70 && opcode <= 0x7F) || opcode == 0xEB) {
+      const uint16_t head = static_cast<uint16_t>(
+          at + 2 + static_cast<int8_t>(mem8(Sreg::CS, at + 1)));
+      const uint16_t back = static_cast<uint16_t>(call - head);
+      if (back <= IDLE_LOOP_BYTES) {
+        if (static_cast<uint16_t>(at + 2 - head) > IDLE_LOOP_BYTES) {
+          return false;
+        }
+        uint16_t before = head;
+        while (before != call) {
+          const uint16_t length = idle_instruction(head, before, watch);
+          if (!length || static_cast<uint16_t>(before + length - head) >
+                             static_cast<uint16_t>(call - head)) {
+            return false;
+          }
+          before += length;
+        }
+        return true;
+      }
+    }
+    const uint16_t length = idle_instruction(after, at, watch);
+    if (!length) {
+      return false;
+    }
+    at += length;
+  }
+  return false;
+}
+
+void CPU8068::skip_idle(IdleWatch& watch, const uint64_t until) {
+  /*
+    The instruction in progress ends one clock from now, and so does the
+    one a whole number of periods later. Events and the port change must
+    not come before that end.
+  */
+  const uint64_t now = virtual_clock();
+  const uint64_t target = std::min(until, event_deadline);
+  if (target <= now + 1) {
+    return;
+  }
+  const uint64_t skipped = (target - now - 1) / watch.period * watch.period;
+  event_countdown -= static_cast<uint32_t>(skipped);
+  counters.skipped_clocks.add(skipped);
+  watch.clock += skipped;
+}
@@ -0,0 +1,203 @@
+#include <cstdint>
+
+#include "../../Utils/logger.h"
+#include "../CPU8068.h"
+
+bool CPU8068::execute_80186(const uint8_t opcode) {
+  switch (opcode) {
+      // PUSHA
+    case 0x60: {
+      pusha();
+      break;
+    }
+      // POPA
+    case 0x61: {
+      popa();
+      break;
+    }
+      // BOUND r16 m16&16
+    case 0x62: {
+      const uint16_t start = IP - 1;
+      const uint8_t mod_rm = mem8(Sreg::CS, IP++);
+      return bound(mod_rm, start);
+    }
+      // PUSH imm16
+    case 0x68: {
+      const uint16_t val = mem16(Sreg::CS, IP);
+      IP += 2;
+
+      SP -= 2;
+      mem16(Sreg::SS, SP) = val;
+      break;
+    }
+      // PUSH imm8 (sign extend)
+    case 0x6A: {
+      const uint16_t val = sign_extend(mem8(Sreg::CS, IP++));
+      SP -= 2;
+      mem16(Sreg::SS, SP) = val;
+      break;
+    }
+      // IMUL r16 r/m16 imm16  (0x69)
+      // IMUL r16 r/m16 imm8   (0x6B)
+    case 0x69:
+    case 0x6B: {
+      const uint8_t mod_rm = mem8(Sreg::CS, IP++);
+      imul_reg_rm_imm(mod_rm, opcode == 0x6B);
+      break;
+    }
+      // INSB  (0x6C)
+      // INSW  (0x6D)
+    case 0x6C:
+    case 0x6D: {
+      const bool is_16bit = (opcode == 0x6D);
+      ins_es_di(is_16bit ? 16 : 8);
+      break;
+    }
+      // OUTSB  (0x6E)
+      // OUTSW  (0x6F)
+    case 0x6E:
+    case 0x6F: {
+      const bool is_16bit = (opcode == 0x6F);
+      outs_ds_si(is_16bit ? 16 : 8);
+      break;
+    }
+      // C0 /r  shift / rotate r/m8  imm8
+      // C1 /r  shift / rotate r/m16 imm8
+      // (same group as D0-D3, see there)
+    case 0xC0:
+    case 0xC1: {
+      const uint8_t mod_rm = mem8(Sreg::CS, IP++);
+      const uint8_t times = mem8(Sreg::CS, IP++);
+      const bool is_16bit = (opcode == 0xC1);
+      instr_d0_d1_d2_d3_c0_c1(mod_rm, (is_16bit) ? 16 : 8, times);
+
+      break;
+    }
+      // ENTER imm16 imm8
+    case 0xC8: {
+      const uint16_t size = mem16(Sreg::CS, IP);
+      IP += 2;
+      const uint8_t level = mem8(Sreg::CS, IP++);
+      enter(size, level);
+      break;
+    }
+      // LEAVE
+    case 0xC9: {
+      leave();
+      break;
+    }
+    default:
+      // 0Fh and 63h-67h are undefined on the 80186
+      return raise_fault(INVALID_OPCODE_VECTOR, IP - 1);
+  }
+
+  return true;
+}
+
+void CPU8068::pusha() {
+  const uint16_t origSP = SP;
+  for (const uint16_t val : {AX, CX, DX, BX, origSP, BP, SI, DI}) {
+    SP -= 2;
+    mem16(Sreg::SS, SP) = val;
+  }
+}
+
+void CPU8068::popa() {
+  // SP is popped into nothing
+  for (uint16_t* reg : {&DI, &SI, &BP, &SP, &BX, &DX, &CX, &AX}) {
+    if (reg != &SP) {
+      *reg = mem16(Sreg::SS, SP);
+    }
+    SP += 2;
+  }
+}
+
+bool CPU8068::bound(const uint8_t mod_rm, const uint16_t start) {
+  const uint8_t mode = ((mod_rm >> 6) & 0b011);
+  const uint8_t reg = ((mod_rm >> 3) & 0b111);
+  const uint8_t r_m = ((mod_rm >> 0) & 0b111);
+
+  if (mode == 0b11) {
+    return raise_fault(INVALID_OPCODE_VECTOR, start);
+  }
+
+  uint16_t address;
+  Sreg segment;
+  if (!get_address_mode_rm(mode, r_m, segment, address)) {
+    mylog("Unsupported r/m bit");
+    return true;
+  }
+
+  const int16_t index = static_cast<int16_t>(*reg16[reg]);
+  const int16_t lower = static_cast<int16_t>(mem16(segment, address));
+  const int16_t upper =
+      static_cast<int16_t>(mem16(segment, static_cast<uint16_t>(address + 2)));
+  if (index < lower || index > upper) {
+    return raise_fault(BOUND_VECTOR, start);
+  }
+  return true;
+}
+
+void CPU8068::imul_reg_rm_imm(const uint8_t mod_rm, const bool is_imm8) {
+  const uint8_t mode = ((mod_rm >> 6) & 0b011);
+  const uint8_t reg = ((mod_rm >> 3) & 0b111);
+  const uint8_t r_m = ((mod_rm >> 0) & 0b111);
+
+  uint16_t lhs;
+  if (mode == 0b11) {
+    lhs = *reg16[r_m];
+  } else {
+    uint16_t address;
+    Sreg segment;
+    if (!get_address_mode_rm(mode, r_m, segment, address)) {
+      mylog("Unsupported r/m bit");
+      return;
+    }
+    lhs = mem16(segment, address);
+  }
+
+  uint16_t rhs;
+  if (is_imm8) {
+    rhs = sign_extend(mem8(Sreg::CS, IP++));
+  } else {
+    rhs = mem16(Sreg::CS, IP);
+    IP += 2;
+  }
+
+  const int32_t result = static_cast<int32_t>(static_cast<int16_t>(lhs)) *
+                         static_cast<int32_t>(static_cast<int16_t>(rhs));
+  *reg16[reg] = static_cast<uint16_t>(result);
+
+  // Set when the result does not fit in the signed 16-bit destination
+  const uint8_t overflow = result != static_cast<int16_t>(result);
+  SetCF(overflow);
+  SetOF(overflow);
+}
+
+void CPU8068::enter(const uint16_t size, uint8_t level) {
+  level &= 0b1'1111;
+
+  SP -= 2;
+  mem16(Sreg::SS, SP) = BP;
+  const uint16_t frame = SP;
+
+  if (level > 0) {
+    for (uint8_t i = 1; i < level; i++) {
+      BP -= 2;
+      const uint16_t outer = mem16(Sreg::SS, BP);
+      SP -= 2;
+      mem16(Sreg::SS, SP) = outer;
+    }
+    SP -= 2;
+    mem16(Sreg::SS, SP) = frame;
+  }
+
+  BP = frame;
+  SP -= size;
+}
+
+void CPU8068::leave() {
+  SP = BP;
+  BP = mem16(Sreg::SS, SP);
+  SP += 2;
+}
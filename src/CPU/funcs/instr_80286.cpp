@@ -0,0 +1,234 @@
+#include <cstdint>
+
+#include "../../Utils/logger.h"
+#include "../CPU8068.h"
+#include "../Descriptor.h"
+
+bool CPU8068::execute_80286(const uint8_t opcode) {
+  switch (opcode) {
+      // Two byte opcodes
+    case 0x0F: {
+      const uint16_t start = IP - 1;
+      const uint8_t second = mem8(Sreg::CS, IP++);
+      // LAR, LSL and the 0F 00 group only exist in protected mode
+      if (!protected_mode() && (second == 0x00 || second == 0x02 ||
+                                second == 0x03)) {
+        return raise_fault(INVALID_OPCODE_VECTOR, start);
+      }
+      switch (second) {
+          // SLDT STR LLDT LTR VERR VERW
+        case 0x00: {
+          const uint8_t mod_rm = mem8(Sreg::CS, IP++);
+          instr_0f_00(mod_rm);
+          break;
+        }
+          // SGDT SIDT LGDT LIDT SMSW LMSW
+        case 0x01: {
+          const uint8_t mod_rm = mem8(Sreg::CS, IP++);
+          instr_0f_01(mod_rm);
+          break;
+        }
+          // LAR r16 r/m16  (0x02)
+          // LSL r16 r/m16  (0x03)
+        case 0x02:
+        case 0x03: {
+          const uint8_t mod_rm = mem8(Sreg::CS, IP++);
+          lar_lsl(mod_rm, second == 0x03);
+          break;
+        }
+          // CLTS
+        case 0x06: {
+          MSW &= ~MSW_TS;
+          break;
+        }
+        default:
+          return raise_fault(INVALID_OPCODE_VECTOR, start);
+      }
+      break;
+    }
+      // ARPL r/m16 r16
+    case 0x63: {
+      if (!protected_mode()) {
+        return raise_fault(INVALID_OPCODE_VECTOR, IP - 1);
+      }
+      const uint8_t mod_rm = mem8(Sreg::CS, IP++);
+      arpl(mod_rm);
+      break;
+    }
+    default:
+      mylog("Unsupported opcode '%.02X'", static_cast<int>(opcode));
+      return false;
+  }
+
+  return true;
+}
+
+void CPU8068::instr_0f_00(const uint8_t mod_rm) {
+  const uint8_t reg = ((mod_rm >> 3) & 0b111);
+
+  uint16_t* operand;
+  if (!get_rm16(mod_rm, operand)) {
+    return;
+  }
+
+  switch (reg) {
+      // SLDT r/m16
+    case 0b000:
+      *operand = LDTR.selector;
+      break;
+      // LLDT r/m16
+    case 0b010: {
+      const uint16_t selector = *operand;
+      if ((selector & Descriptor::SELECTOR_INDEX_MASK) == 0) {
+        LDTR = SegmentDescriptor{selector, 0, 0, 0};
+        break;
+      }
+      if (selector & Descriptor::SELECTOR_TI_MASK) {
+        mylog("LLDT with a selector in the LDT");
+        break;
+      }
+
+      SegmentDescriptor descriptor{};
+      if (!read_descriptor(selector, descriptor)) {
+        mylog("LLDT selector %.04X is outside the GDT",
+              static_cast<int>(selector));
+        break;
+      }
+      LDTR = descriptor;
+      break;
+    }
+      // VERR r/m16  (0b100)
+      // VERW r/m16  (0b101)
+    case 0b100:
+    case 0b101: {
+      SegmentDescriptor descriptor{};
+      const bool valid = read_descriptor(*operand, descriptor) &&
+                         (descriptor.access & Descriptor::ACCESS_SEGMENT);
+      const bool is_code = descriptor.access & Descriptor::ACCESS_CODE;
+      const bool read_write = descriptor.access & Descriptor::ACCESS_READ_WRITE;
+
+      // Data is always readable, code is never writable
+      const bool allowed =
+          (reg == 0b100) ? (!is_code || read_write) : (!is_code && read_write);
+      SetZF(valid && allowed);
+      break;
+    }
+    default:
+      // The task register is not modelled
+      mylog("Unsupported reg bit in 0F 00");
+      break;
+  }
+}
+
+void CPU8068::instr_0f_01(const uint8_t mod_rm) {
+  const uint8_t mode = ((mod_rm >> 6) & 0b011);
+  const uint8_t reg = ((mod_rm >> 3) & 0b111);
+  const uint8_t r_m = ((mod_rm >> 0) & 0b111);
+
+  switch (reg) {
+      // SGDT m  (0b000)
+      // SIDT m  (0b001)
+      // LGDT m  (0b010)
+      // LIDT m  (0b011)
+    case 0b000:
+    case 0b001:
+    case 0b010:
+    case 0b011: {
+      if (mode == 0b11) {
+        mylog("Invalid register operand in 0F 01");
+        return;
+      }
+
+      uint16_t address;
+      Sreg segment;
+      if (!get_address_mode_rm(mode, r_m, segment, address)) {
+        mylog("Unsupported r/m bit");
+        return;
+      }
+
+      // u16 limit, u24 base, the last byte is 0xFF on the 80286
+      DescriptorTableRegister& table = (reg & 1) ? IDTR : GDTR;
+      if (reg & 0b010) {
+        table.limit = mem16(segment, address);
+        table.base = mem16(segment, address + 2) |
+                     (mem8(segment, address + 4) << 16);
+      } else {
+        mem16(segment, address) = table.limit;
+        mem16(segment, address + 2) = table.base & 0xFFFF;
+        mem8(segment, address + 4) = (table.base >> 16) & 0xFF;
+        mem8(segment, address + 5) = 0xFF;
+      }
+      break;
+    }
+      // SMSW r/m16
+    case 0b100: {
+      uint16_t* operand;
+      if (get_rm16(mod_rm, operand)) {
+        // Reserved bits read as 1
+        *operand = MSW | static_cast<uint16_t>(~MSW_MASK);
+      }
+      break;
+    }
+      // LMSW r/m16
+    case 0b110: {
+      uint16_t* operand;
+      if (!get_rm16(mod_rm, operand)) {
+        break;
+      }
+
+      /*
+        PE can only be set, the way back to real mode is a reset.
+        The segment registers keep their real mode bases until they are
+        loaded again, normally by the far jump right after LMSW.
+      */
+      MSW = (*operand & MSW_MASK) | (MSW & MSW_PE);
+      break;
+    }
+    default:
+      mylog("Unsupported reg bit in 0F 01");
+      break;
+  }
+}
+
+void CPU8068::lar_lsl(const uint8_t mod_rm, const bool is_lsl) {
+  const uint8_t reg = ((mod_rm >> 3) & 0b111);
+
+  uint16_t* operand;
+  if (!get_rm16(mod_rm, operand)) {
+    return;
+  }
+
+  SegmentDescriptor descriptor{};
+  if (!read_descriptor(*operand, descriptor) ||
+      (*operand & Descriptor::SELECTOR_INDEX_MASK) == 0) {
+    SetZF(0);
+    return;
+  }
+
+  // LSL only makes sense for segments, LAR also reports system descriptors
+  if (is_lsl && !(descriptor.access & Descriptor::ACCESS_SEGMENT)) {
+    SetZF(0);
+    return;
+  }
+
+  *reg16[reg] = is_lsl ? descriptor.limit
+                       : static_cast<uint16_t>(descriptor.access << 8);
+  SetZF(1);
+}
+
+void CPU8068::arpl(const uint8_t mod_rm) {
+  const uint8_t reg = ((mod_rm >> 3) & 0b111);
+
+  uint16_t* operand;
+  if (!get_rm16(mod_rm, operand)) {
+    return;
+  }
+
+  const uint16_t requested = *reg16[reg] & Descriptor::SELECTOR_RPL_MASK;
+  if ((*operand & Descriptor::SELECTOR_RPL_MASK) < requested) {
+    *operand = (*operand & ~Descriptor::SELECTOR_RPL_MASK) | requested;
+    SetZF(1);
+  } else {
+    SetZF(0);
+  }
+}
@@ -0,0 +1,561 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "../../Devices/BiosDataArea.h"
+#include "../../Devices/Keyboard.h"
+#include "../../Exceptions/ProgramExitedException.h"
+#include "../../Utils/KeyScript.h"
+#include "../../Utils/logger.h"
+#include "../CPU8068.h"
+
+namespace {
+uint16_t read16(const Memory& memory, const uint32_t address) {
+  return static_cast<uint16_t>(memory[address] | memory[address + 1] << 8);
+}
+
+void write16(Memory& memory, const uint32_t address, const uint16_t value) {
+  memory[address] = static_cast<uint8_t>(value);
+  memory[address + 1] = static_cast<uint8_t>(value >> 8);
+}
+
+// Shift flag bits at 0040:0017
+constexpr uint8_t RIGHT_SHIFT = 0x01;
+constexpr uint8_t LEFT_SHIFT = 0x02;
+constexpr uint8_t CTRL = 0x04;
+constexpr uint8_t ALT = 0x08;
+constexpr uint8_t SCROLL_LOCK = 0x10;
+constexpr uint8_t NUM_LOCK = 0x20;
+constexpr uint8_t CAPS_LOCK = 0x40;
+constexpr uint8_t INSERT = 0x80;
+// At 0040:0096
+constexpr uint8_t LAST_WAS_E0 = 0x02;
+
+constexpr uint8_t EXTENDED_PREFIX = 0xE0;
+constexpr uint8_t BREAK = 0x80;
+
+// Keypad 7 to keypad ., with Ctrl, then with NumLock
+constexpr uint8_t KEYPAD_FIRST = 0x47;
+constexpr uint8_t KEYPAD_LAST = 0x53;
+constexpr uint8_t KEYPAD_CTRL[] = {0x77, 0x8D, 0x84, 0x8E, 0x73, 0x8F, 0x74,
+                                   0x90, 0x75, 0x91, 0x76, 0x92, 0x93};
+constexpr char KEYPAD_DIGITS[] = "789-456+1230.";
+
+// Keys with an ASCII code under Ctrl besides the letters
+constexpr std::pair<uint8_t, uint8_t> CTRL_CODES[] = {
+    {0x01, 0x1B}, {0x03, 0x00}, {0x07, 0x1E}, {0x0C, 0x1F}, {0x0E, 0x7F},
+    {0x1A, 0x1B}, {0x1B, 0x1D}, {0x1C, 0x0A}, {0x2B, 0x1C}, {0x39, 0x20}};
+
+// Longest stroke of a character: Shift or Ctrl, the key, and both released
+constexpr size_t CHARACTER_STROKE = 4;
+
+// Key a terminal escape sequence ESC [ <number> <final> stands for
+std::string_view terminal_key(const uint8_t final, const uint32_t number) {
+  constexpr std::pair<uint8_t, std::string_view> LETTERS[] = {
+      {'A', "Up"},   {'B', "Down"}, {'C', "Right"}, {'D', "Left"}, {'H', "Home"},
+      {'F', "End"},  {'P', "F1"},   {'Q', "F2"},    {'R', "F3"},   {'S', "F4"}};
+  constexpr std::string_view NUMBERED[] = {
+      "",    "Home", "Ins", "Del", "End", "PgUp", "PgDn", "Home", "End", "",
+      "",    "F1",   "F2",  "F3",  "F4",  "F5",   "",     "F6",   "F7",  "F8",
+      "F9",  "F10",  "",    "F11", "F12"};
+  if (final == '~') {
+    return number < std::size(NUMBERED) ? NUMBERED[number] : "";
+  }
+  for (const auto& [letter, name] : LETTERS) {
+    if (letter == final) {
+      return name;
+    }
+  }
+  return "";
+}
+
+uint16_t key_of(const uint8_t scan, const uint8_t ascii) {
+  return static_cast<uint16_t>(scan << 8 | ascii);
+}
+
+/*
+  INT 16h 00h and 01h predate the enhanced keyboard: its grey keys read
+  as the keypad ones and keys only it has are dropped
+*/
+bool standard_key(uint16_t& key) {
+  const uint8_t scan = key >> 8;
+  const uint8_t ascii = key & 0xFF;
+  if (scan == EXTENDED_PREFIX) {
+    key = key_of(ascii == '/' ? 0x35 : 0x1C, ascii);
+    return true;
+  }
+  if (scan > 0x84) {
+    return false;
+  }
+  if (ascii == EXTENDED_PREFIX && scan) {
+    key = key_of(scan, 0);
+  }
+  return true;
+}
+}  // namespace
+
+void CPU8068::enable_key_script(std::unique_ptr<KeyScript> script) {
+  key_script = std::move(script);
+  keyboard_host = false;
+  schedule_keyboard();
+}
+
+void CPU8068::reset_keyboard() {
+  keyboard.reset();
+  gate_a20();
+  irq1_pending = false;
+  keyboard_host = false;
+  host_poll_at = 0;
+  dos_extended = 0;
+  memory[BiosDataArea::SHIFT_FLAGS] = 0;
+  memory[BiosDataArea::KEYBOARD_STATUS] = 0;
+  write16(memory, BiosDataArea::KEYBOARD_HEAD, BiosDataArea::KEYBOARD_BUFFER);
+  write16(memory, BiosDataArea::KEYBOARD_TAIL, BiosDataArea::KEYBOARD_BUFFER);
+  write16(memory, BiosDataArea::KEYBOARD_START, BiosDataArea::KEYBOARD_BUFFER);
+  write16(memory, BiosDataArea::KEYBOARD_END,
+          BiosDataArea::KEYBOARD_BUFFER_END);
+  schedule_keyboard();
+}
+
+void CPU8068::gate_a20() {
+  // Below the 80286 there is no line 20 to gate and the mask stays 1 MiB
+  const auto lines = static_cast<uint32_t>(memory.size() - 1);
+  address_mask = keyboard.a20_enabled() ? lines : lines & ~A20_LINE;
+}
+
+void CPU8068::use_keyboard() {
+  if (!key_script && !keyboard_host) {
+    keyboard_host = true;
+    host_poll_at = virtual_clock();
+    schedule_keyboard();
+  }
+}
+
+void CPU8068::schedule_keyboard() {
+  uint64_t deadline = keyboard.next_load();
+  // Held off like IRQ0, tried again after the next instruction
+  if (irq1_pending && !(interrupt_mask & 2)) {
+    deadline = virtual_clock() + 1;
+  }
+  // A stroke waits for the one before it to be sent
+  if (key_script && keyboard.room() == Keyboard::BUFFER_SIZE) {
+    deadline = std::min(deadline, key_script->next());
+  }
+  if (keyboard_host) {
+    deadline = std::min(deadline, host_poll_at);
+  }
+
+  if (deadline == Keyboard::NEVER) {
+    events.cancel(EventScheduler::KEYBOARD);
+  } else {
+    events.schedule(EventScheduler::KEYBOARD, deadline);
+  }
+  sync_events();
+}
+
+void CPU8068::keyboard_event() {
+  const uint64_t now = virtual_clock();
+  feed_script(now);
+  if (keyboard_host && now >= host_poll_at) {
+    poll_host();
+    host_poll_at = now + HOST_POLL_CLOCKS;
+  }
+  if (keyboard.load(now)) {
+    irq1_pending = true;
+  }
+  if (irq1_pending) {
+    if (protected_mode()) {
+      irq1_pending = false;
+    } else if (can_interrupt(1)) {
+      irq1_pending = false;
+      enter_interrupt(KEYBOARD_VECTOR);
+    }
+  }
+  schedule_keyboard();
+}
+
+void CPU8068::feed_script(const uint64_t now) {
+  std::vector<uint8_t> codes;
+  if (key_script && keyboard.room() == Keyboard::BUFFER_SIZE &&
+      key_script->take(now, codes)) {
+    keyboard.send(codes);
+  }
+}
+
+void CPU8068::poll_host() {
+  // Room for an Esc and the key after it that were not a sequence
+  std::vector<uint8_t> codes;
+  while (keyboard.room() >= 2 * CHARACTER_STROKE && host_ready()) {
+    uint8_t byte = 0;
+    if (!host_read(byte)) {
+      return;
+    }
+    codes.clear();
+    if (host_stroke(byte, codes)) {
+      keyboard.send(codes);
+    }
+  }
+}
+
+bool CPU8068::host_stroke(const uint8_t byte, std::vector<uint8_t>& codes) {
+  uint8_t next = 0;
+  if (byte != 0x1B || !host_ready() || !host_read(next)) {
+    return Keyboard::encode_character(byte, codes);
+  }
+  if (next != '[' && next != 'O') {
+    Keyboard::encode_character(byte, codes);
+    Keyboard::encode_character(next, codes);
+    return true;
+  }
+
+  // Modifiers after a ; are dropped, the key is sent plain
+  uint32_t number = 0;
+  bool in_number = true;
+  uint8_t final = 0;
+  while (host_ready() && host_read(final)) {
+    if (final >= '0' && final <= '9') {
+      number = in_number ? number * 10 + (final - '0') : number;
+    } else if (final == ';') {
+      in_number = false;
+    } else {
+      return Keyboard::encode_key(terminal_key(final, number), codes);
+    }
+  }
+  return false;
+}
+
+bool CPU8068::host_key() {
+  if (key_script) {
+    return false;
+  }
+  keyboard_host = true;
+  std::vector<uint8_t> codes;
+  while (codes.empty()) {
+    uint8_t byte = 0;
+    if (!host_read(byte)) {
+      return false;
+    }
+    host_stroke(byte, codes);
+  }
+  keyboard.send(codes);
+  schedule_keyboard();
+  return true;
+}
+
+bool CPU8068::keyboard_pending() const {
+  return irq1_pending || keyboard.output_full() ||
+         keyboard.next_load() != Keyboard::NEVER ||
+         (key_script && key_script->next() != KeyScript::NEVER);
+}
+
+bool CPU8068::wait_for_key() {
+  uint16_t key = 0;
+  while (!peek_key(key)) {
+    if (keyboard.output_full()) {
+      irq1_pending = false;
+      keyboard_interrupt();
+      continue;
+    }
+    uint64_t next = keyboard.next_load();
+    if (key_script && keyboard.room() == Keyboard::BUFFER_SIZE) {
+      next = std::min(next, key_script->next());
+    }
+    if (next == Keyboard::NEVER) {
+      schedule_keyboard();
+      return false;
+    }
+    advance_clock(next);
+    const uint64_t now = virtual_clock();
+    feed_script(now);
+    keyboard.load(now);
+  }
+  schedule_keyboard();
+  return true;
+}
+
+bool CPU8068::peek_key(uint16_t& key) {
+  const uint16_t head = read16(memory, BiosDataArea::KEYBOARD_HEAD);
+  if (head == read16(memory, BiosDataArea::KEYBOARD_TAIL)) {
+    return false;
+  }
+  key = read16(memory, BiosDataArea::BASE + head);
+  return true;
+}
+
+void CPU8068::remove_key() {
+  uint16_t head = read16(memory, BiosDataArea::KEYBOARD_HEAD) + 2;
+  if (head >= read16(memory, BiosDataArea::KEYBOARD_END)) {
+    head = read16(memory, BiosDataArea::KEYBOARD_START);
+  }
+  write16(memory, BiosDataArea::KEYBOARD_HEAD, head);
+}
+
+void CPU8068::flush_keys() {
+  write16(memory, BiosDataArea::KEYBOARD_HEAD,
+          read16(memory, BiosDataArea::KEYBOARD_TAIL));
+  dos_extended = 0;
+}
+
+bool CPU8068::store_key(const uint16_t key) {
+  const uint16_t tail = read16(memory, BiosDataArea::KEYBOARD_TAIL);
+  uint16_t next = tail + 2;
+  if (next >= read16(memory, BiosDataArea::KEYBOARD_END)) {
+    next = read16(memory, BiosDataArea::KEYBOARD_START);
+  }
+  // Full, the key is lost where a real BIOS would beep
+  if (next == read16(memory, BiosDataArea::KEYBOARD_HEAD)) {
+    return false;
+  }
+  write16(memory, BiosDataArea::BASE + tail, key);
+  write16(memory, BiosDataArea::KEYBOARD_TAIL, next);
+  return true;
+}
+
+void CPU8068::keyboard_interrupt() {
+  const uint8_t code = keyboard.read(Keyboard::DATA_PORT, virtual_clock());
+  schedule_keyboard();
+
+  uint8_t& flags = memory[BiosDataArea::SHIFT_FLAGS];
+  uint8_t& status = memory[BiosDataArea::KEYBOARD_STATUS];
+  if (code == EXTENDED_PREFIX) {
+    status |= LAST_WAS_E0;
+    return;
+  }
+  const bool extended = status & LAST_WAS_E0;
+  status &= ~LAST_WAS_E0;
+  const bool released = code & BREAK;
+  const uint8_t scan = code & ~BREAK;
+
+  uint8_t held = 0;
+  uint8_t toggled = 0;
+  switch (scan) {
+    case 0x2A:
+      // E0 2A is a fake shift around grey keys
+      held = extended ? 0 : LEFT_SHIFT;
+      break;
+    case 0x36:
+      held = extended ? 0 : RIGHT_SHIFT;
+      break;
+    case 0x1D:
+      held = CTRL;
+      break;
+    case 0x38:
+      held = ALT;
+      break;
+    case 0x3A:
+      toggled = CAPS_LOCK;
+      break;
+    case 0x45:
+      toggled = NUM_LOCK;
+      break;
+    case 0x46:
+      toggled = SCROLL_LOCK;
+      break;
+    default:
+      break;
+  }
+  if (held || (scan == 0x2A || scan == 0x36)) {
+    flags = released ? flags & ~held : flags | held;
+    return;
+  }
+  if (released) {
+    return;
+  }
+  if (toggled) {
+    flags ^= toggled;
+    return;
+  }
+  if (scan == 0x52 && !(flags & (CTRL | ALT))) {
+    flags ^= INSERT;
+  }
+
+  const uint16_t key = translate_key(scan, extended, flags);
+  if (key) {
+    store_key(key);
+  }
+}
+
+uint16_t CPU8068::translate_key(const uint8_t scan, const bool extended,
+                                const uint8_t shift_flags) const {
+  const bool shift = shift_flags & (LEFT_SHIFT | RIGHT_SHIFT);
+  const bool ctrl = shift_flags & CTRL;
+  const bool alt = shift_flags & ALT;
+
+  const bool keypad = scan >= KEYPAD_FIRST && scan <= KEYPAD_LAST;
+  if (extended) {
+    // Grey keys: keypad Enter and /, and the cursor block
+    if (scan == 0x1C) {
+      return key_of(EXTENDED_PREFIX, ctrl ? 0x0A : 0x0D);
+    }
+    if (scan == 0x35) {
+      return key_of(EXTENDED_PREFIX, '/');
+    }
+    if (!keypad || scan == 0x4A || scan == 0x4C || scan == 0x4E) {
+      return 0;
+    }
+    if (alt) {
+      return key_of(static_cast<uint8_t>(scan + 0x50), 0);
+    }
+    return key_of(ctrl ? KEYPAD_CTRL[scan - KEYPAD_FIRST] : scan,
+                  EXTENDED_PREFIX);
+  }
+
+  // F1-F10, then F11 and F12
+  if (scan >= 0x3B && scan <= 0x44) {
+    const uint8_t base = alt ? 0x68 : ctrl ? 0x5E : shift ? 0x54 : 0x3B;
+    return key_of(static_cast<uint8_t>(base + scan - 0x3B), 0);
+  }
+  if (scan == 0x57 || scan == 0x58) {
+    const uint8_t base = alt ? 0x8B : ctrl ? 0x89 : shift ? 0x87 : 0x85;
+    return key_of(static_cast<uint8_t>(base + scan - 0x57), 0);
+  }
+  if (keypad) {
+    // No Alt+keypad character entry
+    if (alt) {
+      return 0;
+    }
+    if (ctrl) {
+      return key_of(KEYPAD_CTRL[scan - KEYPAD_FIRST], 0);
+    }
+    const char digit = KEYPAD_DIGITS[scan - KEYPAD_FIRST];
+    if (digit == '-' || digit == '+' ||
+        static_cast<bool>(shift_flags & NUM_LOCK) != shift) {
+      return key_of(scan, static_cast<uint8_t>(digit));
+    }
+    return key_of(scan, 0);
+  }
+  if (scan == 0x37) {
+    return alt ? key_of(0x37, 0) : ctrl ? key_of(0x96, 0) : key_of(0x37, '*');
+  }
+  if (scan > Keyboard::LAST_MAIN_KEY) {
+    return 0;
+  }
+
+  const uint8_t lower = Keyboard::character(scan, false);
+  const bool letter = lower >= 'a' && lower <= 'z';
+  if (alt) {
+    // The top row gets codes of its own, the rest only the scan code
+    if (scan >= 0x02 && scan <= 0x0D) {
+      return key_of(static_cast<uint8_t>(scan + 0x76), 0);
+    }
+    return key_of(scan, scan == 0x39 ? ' ' : 0);
+  }
+  if (ctrl) {
+    if (letter) {
+      return key_of(scan, static_cast<uint8_t>(lower - 'a' + 1));
+    }
+    if (scan == 0x0F) {
+      return key_of(0x94, 0);
+    }
+    for (const auto& [key_scan, ascii] : CTRL_CODES) {
+      if (key_scan == scan) {
+        return key_of(scan, ascii);
+      }
+    }
+    return 0;
+  }
+
+  // Caps Lock works the other way round on letters only
+  const bool shifted = letter && (shift_flags & CAPS_LOCK) ? !shift : shift;
+  const uint8_t ascii = Keyboard::character(scan, shifted);
+  // Shift+Tab is the only main block key with no character
+  if (!ascii && scan != 0x0F) {
+    return 0;
+  }
+  return key_of(scan, ascii);
+}
+
+void CPU8068::keyboard_service() {
+  use_keyboard();
+  const bool enhanced = AH >= 0x10;
+  switch (AH) {
+      // Wait for a key and take it
+    case 0x00:
+    case 0x10: {
+      while (true) {
+        uint16_t key = 0;
+        if (peek_key(key)) {
+          remove_key();
+          if (enhanced || standard_key(key)) {
+            AX = key;
+            return;
+          }
+          continue;
+        }
+        /*
+          Keys on their way come through IRQ1 and the INT 09h handler, the
+          INT runs again until they are in
+        */
+        if (keyboard_pending() && !protected_mode() && (FLAGS & IF_MASK) &&
+            !(interrupt_mask & 2)) {
+          IP -= 2;
+          polling_idle(IP);
+          return;
+        }
+        if (!wait_for_key() && !host_key()) {
+          mylog("Keyboard input ended");
+          throw ProgramExitedException{0};
+        }
+      }
+    }
+      // Whether a key is waiting, ZF clear and AX the key if so
+    case 0x01:
+    case 0x11: {
+      uint16_t key = 0;
+      while (peek_key(key)) {
+        if (enhanced || standard_key(key)) {
+          AX = key;
+          SetZF(0);
+          return;
+        }
+        remove_key();
+      }
+      SetZF(1);
+      polling_idle(IP - INT_LENGTH);
+      break;
+    }
+    case 0x02:
+      AL = memory[BiosDataArea::SHIFT_FLAGS];
+      break;
+      // Store CX as a key, AL 1 when the buffer is full
+    case 0x05:
+      AL = store_key(CX) ? 0 : 1;
+      break;
+    default:
+      mylog("Unsupported interrupt");
+      break;
+  }
+}
+
+bool CPU8068::keyboard_read(uint8_t& byte) {
+  if (dos_extended) {
+    byte = dos_extended;
+    dos_extended = 0;
+    return true;
+  }
+  uint16_t key = 0;
+  if (!peek_key(key) &&
+      !(keyboard_pending() && wait_for_key() && peek_key(key))) {
+    return false;
+  }
+  remove_key();
+  // Extended keys come out as a 0, then the scan code
+  const uint8_t ascii = key & 0xFF;
+  if (!ascii || (ascii == EXTENDED_PREFIX && key >> 8 != EXTENDED_PREFIX)) {
+    byte = 0;
+    dos_extended = static_cast<uint8_t>(key >> 8);
+  } else {
+    byte = ascii;
+  }
+  return true;
+}
+
+bool CPU8068::keyboard_ready() {
+  uint16_t key = 0;
+  return dos_extended || peek_key(key);
+}
@@ -14,7 +14,7 @@ void CPU8068::lea_reg_rm(uint8_t mod_rm) {
   }
 
   uint16_t address;
-  uint16_t segment;
+  Sreg segment;
   if (!get_address_mode_rm(mode, r_m, segment, address)) {
     mylog("Unsupported r/m bit");
     return;
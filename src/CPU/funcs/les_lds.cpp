@@ -15,7 +15,7 @@ void CPU8068::les_lds(const uint8_t mod_rm, const bool is_lds) {
   }
 
   uint16_t addr_offset;
-  uint16_t addr_segment;
+  Sreg addr_segment;
   if (!get_address_mode_rm(mode, r_m, addr_segment, addr_offset)) {
     mylog("Unsupported r/m bit");
     return;
@@ -27,7 +27,9 @@ void CPU8068::les_lds(const uint8_t mod_rm, const bool is_lds) {
   *reg16[reg] = data;
   if (is_lds) {
     DS = segment;
+    update_segment_register(DS);
   } else {
     ES = segment;
+    update_segment_register(ES);
   }
 }
\ No newline at end of file
@@ -13,10 +13,14 @@ void CPU8068::mov_rm_reg(const uint8_t mod_rm, const uint8_t width) {
   const uint8_t r_m = ((mod_rm >> 0) & 0b111);
 
   if (mode == 0b11) {
-    *reg8[r_m] = *reg8[reg];
+    if (width == 8) {
+      *reg8[r_m] = *reg8[reg];
+    } else if (width == 16) {
+      *reg16[r_m] = *reg16[reg];
+    }
   } else if (mode == 0b00 || mode == 0b01 || mode == 0b10) {
     uint16_t address;
-    uint16_t segment;
+    Sreg segment;
     if (!get_address_mode_rm(mode, r_m, segment, address)) {
       mylog("Unsupported r/m bit");
       return;
@@ -47,19 +51,19 @@ void CPU8068::mov_rm_imm(const uint8_t mod_rm, const uint8_t width) {
   }
 
   if (mode == 0b11) {
-    *reg8[r_m] = mem8(CS, IP++);
+    *reg8[r_m] = mem8(Sreg::CS, IP++);
   } else if (mode == 0b00 || mode == 0b01 || mode == 0b10) {
     uint16_t address;
-    uint16_t segment;
+    Sreg segment;
     if (!get_address_mode_rm(mode, r_m, segment, address)) {
       mylog("Unsupported r/m bit");
       return;
     }
 
     if (width == 8) {
-      mem8(segment, address) = mem8(CS, IP++);
+      mem8(segment, address) = mem8(Sreg::CS, IP++);
     } else if (width == 16) {
-      mem16(segment, address) = mem16(CS, IP);
+      mem16(segment, address) = mem16(Sreg::CS, IP);
       IP += 2;
     }
   } else {
@@ -80,7 +84,7 @@ void CPU8068::mov_reg_rm(const uint8_t mod_rm, const uint8_t width) {
     *reg8[reg] = *reg8[r_m];
   } else if (mode == 0b00 || mode == 0b01 || mode == 0b10) {
     uint16_t address;
-    uint16_t segment;
+    Sreg segment;
     if (!get_address_mode_rm(mode, r_m, segment, address)) {
       mylog("Unsupported r/m bit");
       return;
@@ -130,26 +134,26 @@ void CPU8068::mov_rm_sreg(uint8_t mod_rm, uint8_t width) {
     return;
   }
 
-  const uint16_t segment = (reg == 0b000)   ? ES
-                           : (reg == 0b010) ? SS
-                           : (reg == 0b011) ? DS
-                                            : static_cast<uint16_t>(-1);
-  if (segment == static_cast<uint16_t>(-1)) {
+  const uint16_t value = (reg == 0b000)   ? ES
+                         : (reg == 0b010) ? SS
+                         : (reg == 0b011) ? DS
+                                          : static_cast<uint16_t>(-1);
+  if (value == static_cast<uint16_t>(-1)) {
     mylog("Unsupported reg in mov_rm_sreg");
     return;
   }
 
   if (mode == 0b11) {
-    *reg16[r_m] = segment;
+    *reg16[r_m] = value;
   } else if (mode == 0b00 || mode == 0b01 || mode == 0b10) {
     uint16_t address;
-    uint16_t segment;
+    Sreg segment;
     if (!get_address_mode_rm(mode, r_m, segment, address)) {
       mylog("Unsupported r/m bit");
       return;
     }
 
-    mem16(segment, address) = segment;
+    mem16(segment, address) = value;
   } else {
     mylog("Unsupported 0x8C");
   }
@@ -181,15 +185,17 @@ void CPU8068::mov_sreg_rm(uint8_t mod_rm, uint8_t width) {
 
   if (mode == 0b11) {
     *resultant_segment_register = *reg16[r_m];
+    update_segment_register(*resultant_segment_register);
   } else if (mode == 0b00 || mode == 0b01 || mode == 0b10) {
     uint16_t address;
-    uint16_t segment;
+    Sreg segment;
     if (!get_address_mode_rm(mode, r_m, segment, address)) {
       mylog("Unsupported r/m bit");
       return;
     }
 
     *resultant_segment_register = mem16(segment, address);
+    update_segment_register(*resultant_segment_register);
   } else {
     mylog("Unsupported 0x8E");
   }
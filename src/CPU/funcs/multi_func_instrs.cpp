@@ -20,14 +20,14 @@ void CPU8068::instr_80_81_82(const uint8_t mod_rm, const uint8_t width) {
       case 0b000: {
         if (width == 8) {
           const uint8_t lhs = *reg8[r_m];
-          const uint8_t rhs = mem8(CS, IP++);
+          const uint8_t rhs = mem8(Sreg::CS, IP++);
           const uint16_t result = lhs + rhs;
           set_flags_add(lhs, rhs, result, width);
 
           *reg8[r_m] = static_cast<uint8_t>(result);
         } else {
           const uint16_t lhs = *reg16[r_m];
-          const uint16_t rhs = mem16(CS, IP);
+          const uint16_t rhs = mem16(Sreg::CS, IP);
           IP += 2;
 
           const uint32_t result = lhs + rhs;
@@ -40,14 +40,14 @@ void CPU8068::instr_80_81_82(const uint8_t mod_rm, const uint8_t width) {
       case 0b001: {
         if (width == 8) {
           const uint8_t lhs = *reg8[r_m];
-          const uint8_t rhs = mem8(CS, IP++);
+          const uint8_t rhs = mem8(Sreg::CS, IP++);
           const uint8_t result = lhs | rhs;
           set_flags_logical(result, width);
 
           *reg8[r_m] = result;
         } else {
           const uint16_t lhs = *reg16[r_m];
-          const uint16_t rhs = mem16(CS, IP);
+          const uint16_t rhs = mem16(Sreg::CS, IP);
           IP += 2;
 
           const uint16_t result = lhs | rhs;
@@ -61,14 +61,14 @@ void CPU8068::instr_80_81_82(const uint8_t mod_rm, const uint8_t width) {
         const uint8_t cf = CF();
         if (width == 8) {
           const uint8_t lhs = *reg8[r_m];
-          const uint8_t rhs = mem8(CS, IP++);
+          const uint8_t rhs = mem8(Sreg::CS, IP++);
           const uint16_t result = lhs + rhs + cf;
           set_flags_add(lhs, rhs + cf, result, width);
 
           *reg8[r_m] = static_cast<uint8_t>(result);
         } else {
           const uint16_t lhs = *reg16[r_m];
-          const uint16_t rhs = mem16(CS, IP);
+          const uint16_t rhs = mem16(Sreg::CS, IP);
           IP += 2;
 
           const uint32_t result = lhs + rhs + cf;
@@ -82,14 +82,14 @@ void CPU8068::instr_80_81_82(const uint8_t mod_rm, const uint8_t width) {
         const uint8_t cf = CF();
         if (width == 8) {
           const uint8_t lhs = *reg8[r_m];
-          const uint8_t rhs = mem8(CS, IP++);
+          const uint8_t rhs = mem8(Sreg::CS, IP++);
           const uint16_t result = lhs - rhs - cf;
           set_flags_sub(lhs, rhs + cf, result, width);
 
           *reg8[r_m] = static_cast<uint8_t>(result);
         } else {
           const uint16_t lhs = *reg16[r_m];
-          const uint16_t rhs = mem16(CS, IP);
+          const uint16_t rhs = mem16(Sreg::CS, IP);
           IP += 2;
 
           const uint32_t result = lhs - rhs - cf;
@@ -102,14 +102,14 @@ void CPU8068::instr_80_81_82(const uint8_t mod_rm, const uint8_t width) {
       case 0b100: {
         if (width == 8) {
           const uint8_t lhs = *reg8[r_m];
-          const uint8_t rhs = mem8(CS, IP++);
+          const uint8_t rhs = mem8(Sreg::CS, IP++);
           const uint8_t result = lhs & rhs;
           set_flags_logical(result, width);
 
           *reg8[r_m] = result;
         } else {
           const uint16_t lhs = *reg16[r_m];
-          const uint16_t rhs = mem16(CS, IP);
+          const uint16_t rhs = mem16(Sreg::CS, IP);
           IP += 2;
 
           const uint16_t result = lhs & rhs;
@@ -122,14 +122,14 @@ void CPU8068::instr_80_81_82(const uint8_t mod_rm, const uint8_t width) {
       case 0b101: {
         if (width == 8) {
           const uint8_t lhs = *reg8[r_m];
-          const uint8_t rhs = mem8(CS, IP++);
+          const uint8_t rhs = mem8(Sreg::CS, IP++);
           const uint16_t result = lhs - rhs;
           set_flags_sub(lhs, rhs, result, width);
 
           *reg8[r_m] = static_cast<uint8_t>(result);
         } else {
           const uint16_t lhs = *reg16[r_m];
-          const uint16_t rhs = mem16(CS, IP);
+          const uint16_t rhs = mem16(Sreg::CS, IP);
           IP += 2;
 
           const uint32_t result = lhs - rhs;
@@ -142,14 +142,14 @@ void CPU8068::instr_80_81_82(const uint8_t mod_rm, const uint8_t width) {
       case 0b110: {
         if (width == 8) {
           const uint8_t lhs = *reg8[r_m];
-          const uint8_t rhs = mem8(CS, IP++);
+          const uint8_t rhs = mem8(Sreg::CS, IP++);
           const uint8_t result = lhs ^ rhs;
           set_flags_logical(result, width);
 
           *reg8[r_m] = result;
         } else {
           const uint16_t lhs = *reg16[r_m];
-          const uint16_t rhs = mem16(CS, IP);
+          const uint16_t rhs = mem16(Sreg::CS, IP);
           IP += 2;
 
           const uint16_t result = lhs ^ rhs;
@@ -162,12 +162,12 @@ void CPU8068::instr_80_81_82(const uint8_t mod_rm, const uint8_t width) {
       case 0b111: {
         if (width == 8) {
           const uint8_t lhs = *reg8[r_m];
-          const uint8_t rhs = mem8(CS, IP++);
+          const uint8_t rhs = mem8(Sreg::CS, IP++);
           const uint16_t result = lhs - rhs;
           set_flags_sub(lhs, rhs, result, width);
         } else {
           const uint16_t lhs = *reg16[r_m];
-          const uint16_t rhs = mem16(CS, IP);
+          const uint16_t rhs = mem16(Sreg::CS, IP);
           IP += 2;
 
           const uint32_t result = lhs - rhs;
@@ -181,7 +181,7 @@ void CPU8068::instr_80_81_82(const uint8_t mod_rm, const uint8_t width) {
     }
   } else if (mode == 0b00 || mode == 0b01 || mode == 0b10) {
     uint16_t address;
-    uint16_t segment;
+    Sreg segment;
     if (!get_address_mode_rm(mode, r_m, segment, address)) {
       mylog("Unsupported r/m bit");
       return;
@@ -191,14 +191,14 @@ void CPU8068::instr_80_81_82(const uint8_t mod_rm, const uint8_t width) {
       case 0b000: {
         if (width == 8) {
           const uint8_t lhs = mem8(segment, address);
-          const uint8_t rhs = mem8(CS, IP++);
+          const uint8_t rhs = mem8(Sreg::CS, IP++);
           const uint16_t result = lhs + rhs;
           set_flags_add(lhs, rhs, result, width);
 
           mem8(segment, address) = static_cast<uint8_t>(result);
         } else {
           const uint16_t lhs = mem16(segment, address);
-          const uint16_t rhs = mem16(CS, IP);
+          const uint16_t rhs = mem16(Sreg::CS, IP);
           IP += 2;
 
           const uint32_t result = lhs + rhs;
@@ -211,14 +211,14 @@ void CPU8068::instr_80_81_82(const uint8_t mod_rm, const uint8_t width) {
       case 0b001: {
         if (width == 8) {
           const uint8_t lhs = mem8(segment, address);
-          const uint8_t rhs = mem8(CS, IP++);
+          const uint8_t rhs = mem8(Sreg::CS, IP++);
           const uint8_t result = lhs | rhs;
           set_flags_logical(result, width);
 
           mem8(segment, address) = result;
         } else {
           const uint16_t lhs = mem16(segment, address);
-          const uint16_t rhs = mem16(CS, IP);
+          const uint16_t rhs = mem16(Sreg::CS, IP);
           IP += 2;
 
           const uint16_t result = lhs | rhs;
@@ -232,14 +232,14 @@ void CPU8068::instr_80_81_82(const uint8_t mod_rm, const uint8_t width) {
         const uint8_t cf = CF();
         if (width == 8) {
           const uint8_t lhs = mem8(segment, address);
-          const uint8_t rhs = mem8(CS, IP++);
+          const uint8_t rhs = mem8(Sreg::CS, IP++);
           const uint16_t result = lhs + rhs + cf;
           set_flags_add(lhs, rhs + cf, result, width);
 
           mem8(segment, address) = static_cast<uint8_t>(result);
         } else {
           const uint16_t lhs = mem16(segment, address);
-          const uint16_t rhs = mem16(CS, IP);
+          const uint16_t rhs = mem16(Sreg::CS, IP);
           IP += 2;
 
           const uint32_t result = lhs + rhs + cf;
@@ -253,14 +253,14 @@ void CPU8068::instr_80_81_82(const uint8_t mod_rm, const uint8_t width) {
         const uint8_t cf = CF();
         if (width == 8) {
           const uint8_t lhs = mem8(segment, address);
-          const uint8_t rhs = mem8(CS, IP++);
+          const uint8_t rhs = mem8(Sreg::CS, IP++);
           const uint16_t result = lhs - rhs - cf;
           set_flags_sub(lhs, rhs + cf, result, width);
 
           mem8(segment, address) = static_cast<uint8_t>(result);
         } else {
           const uint16_t lhs = mem16(segment, address);
-          const uint16_t rhs = mem16(CS, IP);
+          const uint16_t rhs = mem16(Sreg::CS, IP);
           IP += 2;
 
           const uint32_t result = lhs - rhs - cf;
@@ -273,14 +273,14 @@ void CPU8068::instr_80_81_82(const uint8_t mod_rm, const uint8_t width) {
       case 0b100: {
         if (width == 8) {
           const uint8_t lhs = mem8(segment, address);
-          const uint8_t rhs = mem8(CS, IP++);
+          const uint8_t rhs = mem8(Sreg::CS, IP++);
           const uint8_t result = lhs & rhs;
           set_flags_logical(result, width);
 
           mem8(segment, address) = result;
         } else {
           const uint16_t lhs = mem16(segment, address);
-          const uint16_t rhs = mem16(CS, IP);
+          const uint16_t rhs = mem16(Sreg::CS, IP);
           IP += 2;
 
           const uint16_t result = lhs & rhs;
@@ -293,14 +293,14 @@ void CPU8068::instr_80_81_82(const uint8_t mod_rm, const uint8_t width) {
       case 0b101: {
         if (width == 8) {
           const uint8_t lhs = mem8(segment, address);
-          const uint8_t rhs = mem8(CS, IP++);
+          const uint8_t rhs = mem8(Sreg::CS, IP++);
           const uint16_t result = lhs - rhs;
           set_flags_sub(lhs, rhs, result, width);
 
           mem8(segment, address) = static_cast<uint8_t>(result);
         } else {
           const uint16_t lhs = mem16(segment, address);
-          const uint16_t rhs = mem16(CS, IP);
+          const uint16_t rhs = mem16(Sreg::CS, IP);
           IP += 2;
 
           const uint32_t result = lhs - rhs;
@@ -313,14 +313,14 @@ void CPU8068::instr_80_81_82(const uint8_t mod_rm, const uint8_t width) {
       case 0b110: {
         if (width == 8) {
           const uint8_t lhs = mem8(segment, address);
-          const uint8_t rhs = mem8(CS, IP++);
+          const uint8_t rhs = mem8(Sreg::CS, IP++);
           const uint8_t result = lhs ^ rhs;
           set_flags_logical(result, width);
 
           mem8(segment, address) = result;
         } else {
           const uint16_t lhs = mem16(segment, address);
-          const uint16_t rhs = mem16(CS, IP);
+          const uint16_t rhs = mem16(Sreg::CS, IP);
           IP += 2;
 
           const uint16_t result = lhs ^ rhs;
@@ -333,12 +333,12 @@ void CPU8068::instr_80_81_82(const uint8_t mod_rm, const uint8_t width) {
       case 0b111: {
         if (width == 8) {
           const uint8_t lhs = mem8(segment, address);
-          const uint8_t rhs = mem8(CS, IP++);
+          const uint8_t rhs = mem8(Sreg::CS, IP++);
           const uint16_t result = lhs - rhs;
           set_flags_sub(lhs, rhs, result, width);
         } else {
           const uint16_t lhs = mem16(segment, address);
-          const uint16_t rhs = mem16(CS, IP);
+          const uint16_t rhs = mem16(Sreg::CS, IP);
           IP += 2;
 
           const uint32_t result = lhs - rhs;
@@ -362,7 +362,7 @@ void CPU8068::instr_83(const uint8_t mod_rm) {
     switch (reg) {
       case 0b000: {
         const uint16_t lhs = *reg16[r_m];
-        const uint16_t rhs = sign_extend(mem8(CS, IP++));
+        const uint16_t rhs = sign_extend(mem8(Sreg::CS, IP++));
 
         const uint32_t result = lhs + rhs;
         set_flags_add(lhs, rhs, result, 16);
@@ -372,7 +372,7 @@ void CPU8068::instr_83(const uint8_t mod_rm) {
       }
       case 0b001: {
         const uint16_t lhs = *reg16[r_m];
-        const uint16_t rhs = sign_extend(mem8(CS, IP++));
+        const uint16_t rhs = sign_extend(mem8(Sreg::CS, IP++));
 
         const uint16_t result = lhs | rhs;
         set_flags_logical(result, 16);
@@ -383,7 +383,7 @@ void CPU8068::instr_83(const uint8_t mod_rm) {
       case 0b010: {
         const uint8_t cf = CF();
         const uint16_t lhs = *reg16[r_m];
-        const uint16_t rhs = sign_extend(mem8(CS, IP++));
+        const uint16_t rhs = sign_extend(mem8(Sreg::CS, IP++));
 
         const uint32_t result = lhs + rhs + cf;
         set_flags_add(lhs, rhs + cf, result, 16);
@@ -394,7 +394,7 @@ void CPU8068::instr_83(const uint8_t mod_rm) {
       case 0b011: {
         const uint8_t cf = CF();
         const uint16_t lhs = *reg16[r_m];
-        const uint16_t rhs = sign_extend(mem8(CS, IP++));
+        const uint16_t rhs = sign_extend(mem8(Sreg::CS, IP++));
 
         const uint32_t result = lhs - rhs - cf;
         set_flags_sub(lhs, rhs + cf, result, 16);
@@ -404,7 +404,7 @@ void CPU8068::instr_83(const uint8_t mod_rm) {
       }
       case 0b100: {
         const uint16_t lhs = *reg16[r_m];
-        const uint16_t rhs = sign_extend(mem8(CS, IP++));
+        const uint16_t rhs = sign_extend(mem8(Sreg::CS, IP++));
 
         const uint16_t result = lhs & rhs;
         set_flags_logical(result, 16);
@@ -414,7 +414,7 @@ void CPU8068::instr_83(const uint8_t mod_rm) {
       }
       case 0b101: {
         const uint16_t lhs = *reg16[r_m];
-        const uint16_t rhs = sign_extend(mem8(CS, IP++));
+        const uint16_t rhs = sign_extend(mem8(Sreg::CS, IP++));
 
         const uint32_t result = lhs - rhs;
         set_flags_sub(lhs, rhs, result, 16);
@@ -424,7 +424,7 @@ void CPU8068::instr_83(const uint8_t mod_rm) {
       }
       case 0b110: {
         const uint16_t lhs = *reg16[r_m];
-        const uint16_t rhs = sign_extend(mem8(CS, IP++));
+        const uint16_t rhs = sign_extend(mem8(Sreg::CS, IP++));
 
         const uint16_t result = lhs ^ rhs;
         set_flags_logical(result, 16);
@@ -434,7 +434,7 @@ void CPU8068::instr_83(const uint8_t mod_rm) {
       }
       case 0b111: {
         const uint16_t lhs = *reg16[r_m];
-        const uint16_t rhs = sign_extend(mem8(CS, IP++));
+        const uint16_t rhs = sign_extend(mem8(Sreg::CS, IP++));
 
         const uint32_t result = lhs - rhs;
         set_flags_sub(lhs, rhs, result, 16);
@@ -446,7 +446,7 @@ void CPU8068::instr_83(const uint8_t mod_rm) {
     }
   } else if (mode == 0b00 || mode == 0b01 || mode == 0b10) {
     uint16_t address;
-    uint16_t segment;
+    Sreg segment;
     if (!get_address_mode_rm(mode, r_m, segment, address)) {
       mylog("Unsupported r/m bit");
       return;
@@ -455,7 +455,7 @@ void CPU8068::instr_83(const uint8_t mod_rm) {
     switch (reg) {
       case 0b000: {
         const uint16_t lhs = mem16(segment, address);
-        const uint16_t rhs = sign_extend(mem8(CS, IP++));
+        const uint16_t rhs = sign_extend(mem8(Sreg::CS, IP++));
 
         const uint32_t result = lhs + rhs;
         set_flags_add(lhs, rhs, result, 16);
@@ -465,7 +465,7 @@ void CPU8068::instr_83(const uint8_t mod_rm) {
       }
       case 0b001: {
         const uint16_t lhs = mem16(segment, address);
-        const uint16_t rhs = sign_extend(mem8(CS, IP++));
+        const uint16_t rhs = sign_extend(mem8(Sreg::CS, IP++));
 
         const uint16_t result = lhs | rhs;
         set_flags_logical(result, 16);
@@ -476,7 +476,7 @@ void CPU8068::instr_83(const uint8_t mod_rm) {
       case 0b010: {
         const uint8_t cf = CF();
         const uint16_t lhs = mem16(segment, address);
-        const uint16_t rhs = sign_extend(mem8(CS, IP++));
+        const uint16_t rhs = sign_extend(mem8(Sreg::CS, IP++));
 
         const uint32_t result = lhs + rhs + cf;
         set_flags_add(lhs, rhs + cf, result, 16);
@@ -487,7 +487,7 @@ void CPU8068::instr_83(const uint8_t mod_rm) {
       case 0b011: {
         const uint8_t cf = CF();
         const uint16_t lhs = mem16(segment, address);
-        const uint16_t rhs = sign_extend(mem8(CS, IP++));
+        const uint16_t rhs = sign_extend(mem8(Sreg::CS, IP++));
 
         const uint32_t result = lhs - rhs - cf;
         set_flags_sub(lhs, rhs + cf, result, 16);
@@ -497,7 +497,7 @@ void CPU8068::instr_83(const uint8_t mod_rm) {
       }
       case 0b100: {
         const uint16_t lhs = mem16(segment, address);
-        const uint16_t rhs = sign_extend(mem8(CS, IP++));
+        const uint16_t rhs = sign_extend(mem8(Sreg::CS, IP++));
 
         const uint16_t result = lhs & rhs;
         set_flags_logical(result, 16);
@@ -507,7 +507,7 @@ void CPU8068::instr_83(const uint8_t mod_rm) {
       }
       case 0b101: {
         const uint16_t lhs = mem16(segment, address);
-        const uint16_t rhs = sign_extend(mem8(CS, IP++));
+        const uint16_t rhs = sign_extend(mem8(Sreg::CS, IP++));
 
         const uint32_t result = lhs - rhs;
         set_flags_sub(lhs, rhs, result, 16);
@@ -517,7 +517,7 @@ void CPU8068::instr_83(const uint8_t mod_rm) {
       }
       case 0b110: {
         const uint16_t lhs = mem16(segment, address);
-        const uint16_t rhs = sign_extend(mem8(CS, IP++));
+        const uint16_t rhs = sign_extend(mem8(Sreg::CS, IP++));
 
         const uint16_t result = lhs ^ rhs;
         set_flags_logical(result, 16);
@@ -527,7 +527,7 @@ void CPU8068::instr_83(const uint8_t mod_rm) {
       }
       case 0b111: {
         const uint16_t lhs = mem16(segment, address);
-        const uint16_t rhs = sign_extend(mem8(CS, IP++));
+        const uint16_t rhs = sign_extend(mem8(Sreg::CS, IP++));
 
         const uint32_t result = lhs - rhs;
         set_flags_sub(lhs, rhs, result, 16);
@@ -831,7 +831,7 @@ void CPU8068::instr_fe(uint8_t mod_rm) {
         set_flags_logical(++(*reg8[r_m]), 8);
       } else if (mode == 0b00 || mode == 0b01 || mode == 0b10) {
         uint16_t address;
-        uint16_t segment;
+        Sreg segment;
         if (!get_address_mode_rm(mode, r_m, segment, address)) {
           mylog("Unsupported r/m bit");
           return;
@@ -849,7 +849,7 @@ void CPU8068::instr_fe(uint8_t mod_rm) {
         set_flags_logical(--(*reg8[r_m]), 8);
       } else if (mode == 0b00 || mode == 0b01 || mode == 0b10) {
         uint16_t address;
-        uint16_t segment;
+        Sreg segment;
         if (!get_address_mode_rm(mode, r_m, segment, address)) {
           mylog("Unsupported r/m bit");
           return;
@@ -878,7 +878,7 @@ void CPU8068::instr_ff(uint8_t mod_rm) {
         set_flags_logical(++(*reg16[r_m]), 16);
       } else if (mode == 0b00 || mode == 0b01 || mode == 0b10) {
         uint16_t address;
-        uint16_t segment;
+        Sreg segment;
         if (!get_address_mode_rm(mode, r_m, segment, address)) {
           mylog("Unsupported r/m bit");
           return;
@@ -896,7 +896,7 @@ void CPU8068::instr_ff(uint8_t mod_rm) {
         set_flags_logical(--(*reg16[r_m]), 16);
       } else if (mode == 0b00 || mode == 0b01 || mode == 0b10) {
         uint16_t address;
-        uint16_t segment;
+        Sreg segment;
         if (!get_address_mode_rm(mode, r_m, segment, address)) {
           mylog("Unsupported r/m bit");
           return;
@@ -915,7 +915,7 @@ void CPU8068::instr_ff(uint8_t mod_rm) {
         newIP = *reg16[r_m];
       } else if (mode == 0b00 || mode == 0b01 || mode == 0b10) {
         uint16_t address;
-        uint16_t segment;
+        Sreg segment;
         if (!get_address_mode_rm(mode, r_m, segment, address)) {
           mylog("Unsupported r/m bit");
           return;
@@ -928,8 +928,8 @@ void CPU8068::instr_ff(uint8_t mod_rm) {
       }
 
       SP -= 2;
-      mem16(SS, SP) = IP;
-      IP = newIP;
+      mem16(Sreg::SS, SP) = IP;
+      jump_near(newIP);
       break;
     }
     case 0b011: {
@@ -940,7 +940,7 @@ void CPU8068::instr_ff(uint8_t mod_rm) {
         return;
       } else if (mode == 0b00 || mode == 0b01 || mode == 0b10) {
         uint16_t address;
-        uint16_t segment;
+        Sreg segment;
         if (!get_address_mode_rm(mode, r_m, segment, address)) {
           mylog("Unsupported r/m bit");
           return;
@@ -954,11 +954,10 @@ void CPU8068::instr_ff(uint8_t mod_rm) {
       }
 
       SP -= 2;
-      mem16(SS, SP) = CS;
+      mem16(Sreg::SS, SP) = CS;
       SP -= 2;
-      mem16(SS, SP) = IP;
-      IP = newIP;
-      CS = newCS;
+      mem16(Sreg::SS, SP) = IP;
+      jump_far(newCS, newIP);
       break;
     }
     case 0b100: {
@@ -967,7 +966,7 @@ void CPU8068::instr_ff(uint8_t mod_rm) {
         newIP = *reg16[r_m];
       } else if (mode == 0b00 || mode == 0b01 || mode == 0b10) {
         uint16_t address;
-        uint16_t segment;
+        Sreg segment;
         if (!get_address_mode_rm(mode, r_m, segment, address)) {
           mylog("Unsupported r/m bit");
           return;
@@ -979,7 +978,7 @@ void CPU8068::instr_ff(uint8_t mod_rm) {
         return;
       }
 
-      IP = newIP;
+      jump_near(newIP);
       break;
     }
     case 0b101: {
@@ -990,7 +989,7 @@ void CPU8068::instr_ff(uint8_t mod_rm) {
         return;
       } else if (mode == 0b00 || mode == 0b01 || mode == 0b10) {
         uint16_t address;
-        uint16_t segment;
+        Sreg segment;
         if (!get_address_mode_rm(mode, r_m, segment, address)) {
           mylog("Unsupported r/m bit");
           return;
@@ -1003,24 +1002,23 @@ void CPU8068::instr_ff(uint8_t mod_rm) {
         return;
       }
 
-      IP = newIP;
-      CS = newCS;
+      jump_far(newCS, newIP);
       break;
     }
     case 0b110: {
       if (mode == 0b11) {
         SP -= 2;
-        mem16(SS, SP) = *reg16[r_m];
+        mem16(Sreg::SS, SP) = *reg16[r_m];
       } else if (mode == 0b00 || mode == 0b01 || mode == 0b10) {
         uint16_t address;
-        uint16_t segment;
+        Sreg segment;
         if (!get_address_mode_rm(mode, r_m, segment, address)) {
           mylog("Unsupported r/m bit");
           return;
         }
 
         SP -= 2;
-        mem16(SS, SP) = mem16(segment, address);
+        mem16(Sreg::SS, SP) = mem16(segment, address);
       } else {
         mylog("Unsupported 0xFF");
         return;
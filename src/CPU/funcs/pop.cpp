@@ -13,14 +13,14 @@ void CPU8068::pop_rm(uint8_t mod_rm) {
     return;
   }
 
-  const uint16_t val = mem16(SS, SP);
+  const uint16_t val = mem16(Sreg::SS, SP);
   SP += 2;
 
   if (mode == 0b11) {
     *reg16[r_m] = val;
   } else if (mode == 0b00 || mode == 0b01 || mode == 0b10) {
     uint16_t address;
-    uint16_t segment;
+    Sreg segment;
     if (!get_address_mode_rm(mode, r_m, segment, address)) {
       mylog("Unsupported r/m bit");
       return;
@@ -0,0 +1,173 @@
+#include <algorithm>
+#include <cstdint>
+
+#include "../../Devices/Framebuffer.h"
+#include "../../Devices/IntervalTimer.h"
+#include "../../Devices/Keyboard.h"
+#include "../CPU8068.h"
+
+namespace {
+// Master interrupt controller, of which only the mask is kept
+constexpr uint16_t PIC_COMMAND = 0x20;
+constexpr uint16_t PIC_DATA = 0x21;
+constexpr uint16_t SYSTEM_CONTROL = 0x61;
+constexpr uint16_t MONOCHROME_STATUS = 0x3BA;
+constexpr uint16_t COLOR_STATUS = 0x3DA;
+
+// 60 Hz frames of 262 lines, 200 of them visible, in timer clocks
+constexpr uint32_t FRAME_CLOCKS = IntervalTimer::FREQUENCY / 60;
+constexpr uint32_t LINE_CLOCKS = FRAME_CLOCKS / 262;
+constexpr uint32_t VISIBLE_LINES = 200;
+constexpr uint32_t VERTICAL_RETRACE_LINE = 224;
+constexpr uint32_t VERTICAL_RETRACE_LINES = 16;
+// Memory refresh toggles bit 4 of port 61h every 15 us
+constexpr uint32_t REFRESH_CLOCKS = 18;
+
+CPU8068& cpu_of(void* device) { return *static_cast<CPU8068*>(device); }
+
+uint8_t video_status_at(const uint64_t now) {
+  const uint32_t clock = static_cast<uint32_t>(now % FRAME_CLOCKS);
+  const uint32_t line = clock / LINE_CLOCKS;
+  uint8_t status = 0;
+  // Bit 0, nothing is being drawn: between lines or below the picture
+  if (line >= VISIBLE_LINES || clock % LINE_CLOCKS >= LINE_CLOCKS * 3 / 4) {
+    status |= 0x01;
+  }
+  if (line >= VERTICAL_RETRACE_LINE &&
+      line < VERTICAL_RETRACE_LINE + VERTICAL_RETRACE_LINES) {
+    status |= 0x08;
+  }
+  return status;
+}
+
+// First clock after now where the status may change: a line start or end
+uint64_t next_status_edge(const uint64_t now) {
+  const uint64_t frame = now - now % FRAME_CLOCKS;
+  const uint32_t clock = static_cast<uint32_t>(now % FRAME_CLOCKS);
+  const uint32_t start = clock / LINE_CLOCKS * LINE_CLOCKS;
+  uint32_t edge = start + LINE_CLOCKS * 3 / 4;
+  if (clock >= edge) {
+    edge = start + LINE_CLOCKS;
+  }
+  return frame + std::min(edge, FRAME_CLOCKS);
+}
+}  // namespace
+
+void CPU8068::connect_ports() {
+  ports.connect(
+      IntervalTimer::FIRST_PORT, IntervalTimer::CONTROL_PORT, this,
+      [](void* device, const uint16_t port) {
+        CPU8068& cpu = cpu_of(device);
+        return cpu.pit.read(port, cpu.virtual_clock());
+      },
+      [](void* device, const uint16_t port, const uint8_t value) {
+        CPU8068& cpu = cpu_of(device);
+        cpu.pit.write(port, value, cpu.virtual_clock());
+        cpu.schedule_timer();
+      });
+
+  // End of interrupt commands need no answer, nothing is in service
+  ports.connect(
+      PIC_COMMAND, PIC_DATA, this,
+      [](void* device, const uint16_t port) -> uint8_t {
+        return port == PIC_DATA ? cpu_of(device).interrupt_mask : 0;
+      },
+      [](void* device, const uint16_t port, const uint8_t value) {
+        if (port == PIC_DATA) {
+          cpu_of(device).interrupt_mask = value;
+          cpu_of(device).schedule_timer();
+          cpu_of(device).schedule_keyboard();
+        }
+      });
+
+  ports.connect(
+      SYSTEM_CONTROL, SYSTEM_CONTROL, this,
+      [](void* device, const uint16_t port) -> uint8_t {
+        (void)port;
+        const CPU8068& cpu = cpu_of(device);
+        const bool refresh = cpu.virtual_clock() / REFRESH_CLOCKS & 1;
+        return static_cast<uint8_t>((cpu.system_control & 0x0F) |
+                                    (refresh ? 0x10 : 0));
+      },
+      [](void* device, const uint16_t port, const uint8_t value) {
+        (void)port;
+        cpu_of(device).system_control = value;
+      });
+
+  const PortMap::ReadHandler keyboard_read = [](void* device,
+                                                const uint16_t port) {
+    CPU8068& cpu = cpu_of(device);
+    cpu.use_keyboard();
+    const uint8_t value = cpu.keyboard.read(port, cpu.virtual_clock());
+    cpu.schedule_keyboard();
+    return value;
+  };
+  const PortMap::WriteHandler keyboard_write =
+      [](void* device, const uint16_t port, const uint8_t value) {
+        CPU8068& cpu = cpu_of(device);
+        cpu.keyboard.write(port, value);
+        cpu.gate_a20();
+        cpu.schedule_keyboard();
+      };
+  ports.connect(Keyboard::DATA_PORT, Keyboard::DATA_PORT, this, keyboard_read,
+                keyboard_write);
+  ports.connect(Keyboard::STATUS_PORT, Keyboard::STATUS_PORT, this,
+                keyboard_read, keyboard_write);
+
+  const PortMap::ReadHandler status = [](void* device, const uint16_t port) {
+    (void)port;
+    return cpu_of(device).video_status();
+  };
+  ports.connect(MONOCHROME_STATUS, MONOCHROME_STATUS, this, status, nullptr);
+  ports.connect(COLOR_STATUS, COLOR_STATUS, this, status, nullptr);
+
+  ports.connect(
+      Framebuffer::DAC_FIRST_PORT, Framebuffer::DAC_LAST_PORT, &framebuffer,
+      [](void* device, const uint16_t port) {
+        return static_cast<Framebuffer*>(device)->read_dac_port(port);
+      },
+      [](void* device, const uint16_t port, const uint8_t value) {
+        static_cast<Framebuffer*>(device)->write_dac_port(port, value);
+      });
+}
+
+uint8_t CPU8068::video_status() const {
+  return video_status_at(virtual_clock());
+}
+
+uint64_t CPU8068::port_stable_until(const uint16_t port) const {
+  switch (port) {
+    case MONOCHROME_STATUS:
+    case COLOR_STATUS: {
+      const uint64_t now = virtual_clock();
+      const uint8_t status = video_status_at(now);
+      uint64_t clock = next_status_edge(now);
+      while (video_status_at(clock) == status) {
+        clock = next_status_edge(clock);
+      }
+      return clock;
+    }
+    case PIC_DATA:
+    case Keyboard::DATA_PORT:
+    case Keyboard::STATUS_PORT:
+      // Only the program itself and events change these
+      return IntervalTimer::NEVER;
+    default:
+      return 0;
+  }
+}
+
+uint8_t CPU8068::port_in8(const uint16_t port) { return ports.read(port); }
+
+uint16_t CPU8068::port_in16(const uint16_t port) {
+  return static_cast<uint16_t>(port_in8(port) | (port_in8(port + 1) << 8));
+}
+
+void CPU8068::port_out8(const uint16_t port, const uint8_t val) {
+  ports.write(port, val);
+}
+
+void CPU8068::port_out16(const uint16_t port, const uint16_t val) {
+  port_out8(port, static_cast<uint8_t>(val & 0xFF));
+  port_out8(port + 1, static_cast<uint8_t>(val >> 8));
+}
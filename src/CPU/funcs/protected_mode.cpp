@@ -0,0 +1,104 @@
+#include <cstdint>
+
+#include "../../Utils/logger.h"
+#include "../CPU8068.h"
+#include "../Descriptor.h"
+
+void CPU8068::update_segment_register(const uint16_t& reg) {
+  size_t index = 0;
+  while (index < SEGMENT_REGISTER_COUNT && sregs[index] != &reg) {
+    index++;
+  }
+  if (index == SEGMENT_REGISTER_COUNT) {
+    mylog("update_segment_register called with a non segment register");
+    return;
+  }
+
+  SegmentDescriptor& cache = segment_cache[index];
+  if (!protected_mode()) {
+    cache = SegmentDescriptor{reg,
+                              static_cast<uint32_t>(reg * SEGMENT_MULTIPLIER),
+                              0xFFFF, Descriptor::ACCESS_REAL_MODE};
+    return;
+  }
+
+  // Null selector, only valid for ES and DS until it is used
+  if ((reg & Descriptor::SELECTOR_INDEX_MASK) == 0 &&
+      !(reg & Descriptor::SELECTOR_TI_MASK)) {
+    if (&reg == &CS || &reg == &SS) {
+      mylog("Null selector loaded into %s", &reg == &CS ? "CS" : "SS");
+    }
+    cache = SegmentDescriptor{reg, 0, 0, 0};
+    return;
+  }
+
+  SegmentDescriptor descriptor{};
+  if (!read_descriptor(reg, descriptor)) {
+    mylog("Selector %.04X is outside the descriptor table",
+          static_cast<int>(reg));
+  } else if (!(descriptor.access & Descriptor::ACCESS_PRESENT)) {
+    mylog("Selector %.04X is not present", static_cast<int>(reg));
+  } else if (!(descriptor.access & Descriptor::ACCESS_SEGMENT)) {
+    mylog("Selector %.04X is not a code or data segment",
+          static_cast<int>(reg));
+  }
+  cache = descriptor;
+}
+
+void CPU8068::update_segment_registers() {
+  update_segment_register(ES);
+  update_segment_register(CS);
+  update_segment_register(SS);
+  update_segment_register(DS);
+}
+
+/*
+  Fetches a descriptor from the GDT or the current LDT. The accessed bit
+  is set in memory the way the CPU does on a segment load.
+*/
+bool CPU8068::read_descriptor(const uint16_t selector,
+                              SegmentDescriptor& descriptor) {
+  const bool is_local = selector & Descriptor::SELECTOR_TI_MASK;
+  const uint32_t table_base = is_local ? LDTR.base : GDTR.base;
+  const uint16_t table_limit = is_local ? LDTR.limit : GDTR.limit;
+  const uint16_t offset = selector & Descriptor::SELECTOR_INDEX_MASK;
+
+  descriptor = SegmentDescriptor{selector, 0, 0, 0};
+  if ((is_local && (LDTR.selector & Descriptor::SELECTOR_INDEX_MASK) == 0) ||
+      offset + Descriptor::SIZE - 1 > table_limit) {
+    return false;
+  }
+
+  uint8_t* entry = &memory[(table_base + offset) & address_mask];
+  descriptor.limit = static_cast<uint16_t>(entry[0] | (entry[1] << 8));
+  descriptor.base = entry[2] | (entry[3] << 8) | (entry[4] << 16);
+  descriptor.access = entry[5];
+
+  if (descriptor.access & Descriptor::ACCESS_SEGMENT) {
+    entry[5] |= Descriptor::ACCESS_ACCESSED;
+    descriptor.access |= Descriptor::ACCESS_ACCESSED;
+  }
+  return true;
+}
+
+/*
+  Points operand at the register or memory word selected by mod_rm
+*/
+bool CPU8068::get_rm16(const uint8_t mod_rm, uint16_t*& operand) {
+  const uint8_t mode = ((mod_rm >> 6) & 0b011);
+  const uint8_t r_m = ((mod_rm >> 0) & 0b111);
+
+  if (mode == 0b11) {
+    operand = reg16[r_m];
+    return true;
+  }
+
+  uint16_t address;
+  Sreg segment;
+  if (!get_address_mode_rm(mode, r_m, segment, address)) {
+    mylog("Unsupported r/m bit");
+    return false;
+  }
+  operand = &mem16(segment, address);
+  return true;
+}
@@ -10,7 +10,7 @@ void CPU8068::mov_es_di_ds_si(uint8_t width) {
   }
 
   if (width == 16) {
-    mem16(ES, DI) = mem16(DS, SI);
+    mem16(Sreg::ES, DI) = mem16(Sreg::DS, SI);
     if (DF()) {
       DI -= 2;
       SI -= 2;
@@ -19,7 +19,7 @@ void CPU8068::mov_es_di_ds_si(uint8_t width) {
       SI += 2;
     }
   } else {
-    mem8(ES, DI) = mem8(DS, SI);
+    mem8(Sreg::ES, DI) = mem8(Sreg::DS, SI);
     if (DF()) {
       DI -= 1;
       SI -= 1;
@@ -37,14 +37,14 @@ void CPU8068::lods_ds_si(uint8_t width) {
   }
 
   if (width == 16) {
-    AX = mem16(DS, SI);
+    AX = mem16(Sreg::DS, SI);
     if (DF()) {
       SI -= 2;
     } else {
       SI += 2;
     }
   } else if (width == 8) {
-    AL = mem8(DS, SI);
+    AL = mem8(Sreg::DS, SI);
     if (DF()) {
       SI -= 1;
     } else {
@@ -60,14 +60,14 @@ void CPU8068::stos_es_di(uint8_t width) {
   }
 
   if (width == 16) {
-    mem16(ES, DI) = AX;
+    mem16(Sreg::ES, DI) = AX;
     if (DF()) {
       DI -= 2;
     } else {
       DI += 2;
     }
   } else if (width == 8) {
-    mem8(ES, DI) = AL;
+    mem8(Sreg::ES, DI) = AL;
     if (DF()) {
       DI -= 1;
     } else {
@@ -83,8 +83,8 @@ void CPU8068::cmps_es_di_ds_si(uint8_t width) {
   }
 
   if (width == 16) {
-    const uint32_t lhs = mem16(DS, SI);
-    const uint32_t rhs = mem16(ES, DI);
+    const uint32_t lhs = mem16(Sreg::DS, SI);
+    const uint32_t rhs = mem16(Sreg::ES, DI);
     const uint32_t result = lhs - rhs;
     set_flags_sub(lhs, rhs, result, 16);
     if (DF()) {
@@ -95,8 +95,8 @@ void CPU8068::cmps_es_di_ds_si(uint8_t width) {
       SI += 2;
     }
   } else if (width == 8) {
-    const uint16_t lhs = mem8(DS, SI);
-    const uint16_t rhs = mem8(ES, DI);
+    const uint16_t lhs = mem8(Sreg::DS, SI);
+    const uint16_t rhs = mem8(Sreg::ES, DI);
     const uint16_t result = lhs - rhs;
     set_flags_sub(lhs, rhs, result, 8);
     if (DF()) {
@@ -117,7 +117,7 @@ void CPU8068::scas_es_di(uint8_t width) {
 
   if (width == 16) {
     const uint32_t lhs = AX;
-    const uint32_t rhs = mem16(ES, DI);
+    const uint32_t rhs = mem16(Sreg::ES, DI);
     const uint32_t result = lhs - rhs;
     set_flags_sub(lhs, rhs, result, 16);
     if (DF()) {
@@ -127,7 +127,7 @@ void CPU8068::scas_es_di(uint8_t width) {
     }
   } else if (width == 8) {
     const uint16_t lhs = AL;
-    const uint16_t rhs = mem8(ES, DI);
+    const uint16_t rhs = mem8(Sreg::ES, DI);
     const uint16_t result = lhs - rhs;
     set_flags_sub(lhs, rhs, result, 8);
     if (DF()) {
@@ -137,3 +137,83 @@ void CPU8068::scas_es_di(uint8_t width) {
     }
   }
 }
+
+void CPU8068::ins_es_di(uint8_t width) {
+  if (width != 8 && width != 16) {
+    mylog("Unsupported width in ins_es_di");
+    return;
+  }
+
+  if (width == 16) {
+    mem16(Sreg::ES, DI) = port_in16(DX);
+    if (DF()) {
+      DI -= 2;
+    } else {
+      DI += 2;
+    }
+  } else if (width == 8) {
+    mem8(Sreg::ES, DI) = port_in8(DX);
+    if (DF()) {
+      DI -= 1;
+    } else {
+      DI += 1;
+    }
+  }
+}
+
+void CPU8068::outs_ds_si(uint8_t width) {
+  if (width != 8 && width != 16) {
+    mylog("Unsupported width in outs_ds_si");
+    return;
+  }
+
+  if (width == 16) {
+    port_out16(DX, mem16(Sreg::DS, SI));
+    if (DF()) {
+      SI -= 2;
+    } else {
+      SI += 2;
+    }
+  } else if (width == 8) {
+    port_out8(DX, mem8(Sreg::DS, SI));
+    if (DF()) {
+      SI -= 1;
+    } else {
+      SI += 1;
+    }
+  }
+}
+
+/*
+  REP / REPE / REPZ   (0xF3)
+  REPNE / REPNZ       (0xF2)
+
+  Only string instructions are repeated, anything else after the prefix
+  runs once as if it was not there. CMPS and SCAS also stop on ZF.
+*/
+bool CPU8068::rep_string(const uint8_t prefix) {
+  const uint8_t opcode = mem8(Sreg::CS, IP++);
+  const OpcodeHandler handler = dispatch.handlers[opcode];
+  rep_iterations = 0;
+
+  if (!dispatch.repeatable[opcode]) {
+    return (this->*handler)(opcode);
+  }
+
+  const bool checks_zf = opcode == 0xA6 || opcode == 0xA7 ||
+                         opcode == 0xAE || opcode == 0xAF;
+  while (CX != 0) {
+    if (!(this->*handler)(opcode)) {
+      return false;
+    }
+    CX--;
+    rep_iterations++;
+
+    if (checks_zf && (prefix == 0xF3 ? !ZF() : ZF())) {
+      break;
+    }
+  }
+
+  counters.rep_iterations.add(rep_iterations);
+  return true;
+}
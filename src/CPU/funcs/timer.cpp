@@ -0,0 +1,112 @@
+#include <algorithm>
+#include <cstdint>
+
+#include "../../Devices/BiosDataArea.h"
+#include "../../Devices/IntervalTimer.h"
+#include "../../Exceptions/ProgramExitedException.h"
+#include "../../Utils/logger.h"
+#include "../CPU8068.h"
+
+namespace {
+uint32_t read32(const Memory& memory, const uint32_t address) {
+  return memory[address] | memory[address + 1] << 8 |
+         memory[address + 2] << 16 |
+         static_cast<uint32_t>(memory[address + 3]) << 24;
+}
+
+void write32(Memory& memory, const uint32_t address, const uint32_t value) {
+  for (uint32_t i = 0; i < 4; i++) {
+    memory[address + i] = static_cast<uint8_t>(value >> (i * 8));
+  }
+}
+}  // namespace
+
+void CPU8068::reset_timer() {
+  irq0_pending = false;
+  pit.reset(virtual_clock());
+  schedule_timer();
+}
+
+void CPU8068::schedule_timer() {
+  /*
+    A held off IRQ0 is tried again after the next instruction. While it
+    is masked it waits for the mask to change instead.
+  */
+  const bool retry = irq0_pending && !(interrupt_mask & 1);
+  const uint64_t deadline = retry ? virtual_clock() + 1 : pit.next_irq();
+  if (deadline == IntervalTimer::NEVER) {
+    events.cancel(EventScheduler::TIMER);
+  } else {
+    events.schedule(EventScheduler::TIMER, deadline);
+  }
+  sync_events();
+}
+
+void CPU8068::timer_event() {
+  if (pit.irq(virtual_clock())) {
+    irq0_pending = true;
+  }
+  if (irq0_pending) {
+    if (protected_mode()) {
+      // Nothing to deliver it through, the tick is lost
+      irq0_pending = false;
+    } else if (can_interrupt(0)) {
+      irq0_pending = false;
+      enter_interrupt(TIMER_VECTOR);
+    }
+  }
+  schedule_timer();
+}
+
+void CPU8068::halt() {
+  // Keyboard events wake it as well, a terminal poll even with no key
+  const uint64_t wake =
+      std::min(irq0_pending ? virtual_clock() + 1 : pit.next_irq(),
+               events.when(EventScheduler::KEYBOARD));
+  if (!(FLAGS & IF_MASK) || protected_mode() ||
+      wake == IntervalTimer::NEVER) {
+    // Nothing will ever wake it up
+    throw ProgramExitedException{0};
+  }
+  // The idle clocks pass at once, the interrupt comes right after HLT
+  const uint64_t now = virtual_clock();
+  event_deadline = wake;
+  event_countdown = 1;
+  counters.idle_clocks.add(virtual_clock() - now);
+}
+
+void CPU8068::timer_tick() {
+  uint32_t ticks = read32(memory, BiosDataArea::TIMER_TICKS) + 1;
+  if (ticks >= BiosDataArea::TICKS_PER_DAY) {
+    ticks = 0;
+    memory[BiosDataArea::TIMER_OVERFLOW] = 1;
+  }
+  write32(memory, BiosDataArea::TIMER_TICKS, ticks);
+}
+
+void CPU8068::time_of_day_interrupt() {
+  switch (AH) {
+      // Read tick count to CX:DX, AL tells whether midnight passed
+    case 0x00: {
+      const uint32_t ticks = read32(memory, BiosDataArea::TIMER_TICKS);
+      CX = static_cast<uint16_t>(ticks >> 16);
+      DX = static_cast<uint16_t>(ticks);
+      AL = memory[BiosDataArea::TIMER_OVERFLOW];
+      memory[BiosDataArea::TIMER_OVERFLOW] = 0;
+      polling_idle(IP - INT_LENGTH);
+      break;
+    }
+      // Set tick count from CX:DX
+    case 0x01: {
+      write32(memory, BiosDataArea::TIMER_TICKS,
+              static_cast<uint32_t>(CX) << 16 | DX);
+      memory[BiosDataArea::TIMER_OVERFLOW] = 0;
+      break;
+    }
+    default:
+      // No real time clock, what the PC and XT BIOS report
+      mylog("Unsupported interrupt");
+      SetCF(1);
+      break;
+  }
+}
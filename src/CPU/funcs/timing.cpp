@@ -0,0 +1,56 @@
+#include <cstdint>
+
+#include "../CPU8068.h"
+#include "../CPUMode.h"
+#include "../CycleCounter.h"
+
+void CPU8068::enable_timing(const double target_mhz) {
+  timing_enabled = true;
+  cycle_counter.set_target_mhz(target_mhz);
+}
+
+const CycleCounter& CPU8068::timing() const { return cycle_counter; }
+
+void CPU8068::account_cycles(const uint8_t opcode,
+                             const uint32_t start_address,
+                             const uint16_t start_CS, const uint16_t start_IP,
+                             const uint8_t start_CL) {
+  /*
+    Instruction lengths are not tracked by the decoder, after anything
+    but a taken jump (which also flushes the prefetch queue) it is how
+    far IP moved. An instruction rewound to run again moved none.
+  */
+  const uint16_t fetched = IP - start_IP;
+  const bool sequential = !jump_taken && CS == start_CS && fetched != 0;
+
+  /*
+    Code bytes are read straight from memory: through mem8 they would
+    count as accesses for watchpoints, and CS may hold a selector
+  */
+  const uint8_t mod_rm = memory[(start_address + 1) & address_mask];
+
+  if (opcode == 0xF2 || opcode == 0xF3) {
+    // mod_rm is the repeated instruction here
+    cycle_counter.account_repeated(mod_rm, sequential ? fetched : 0,
+                                   rep_iterations);
+    return;
+  }
+
+  uint8_t count = 1;
+  if (opcode == 0xD2 || opcode == 0xD3) {
+    count = start_CL;
+  } else if (opcode == 0xC0 || opcode == 0xC1) {
+    // RET on the 8086, no count
+    count = 0;
+    if (cpu_mode >= CPU_MODE::CPU_80186 && sequential) {
+      // imm8 is always the last byte
+      count = memory[(start_address + fetched - 1) & address_mask];
+    }
+  }
+  if (cpu_mode >= CPU_MODE::CPU_80286) {
+    count &= 0b11111;
+  }
+
+  cycle_counter.account(opcode, mod_rm, sequential ? fetched : 0,
+                        last_ea_offset, count);
+}
@@ -0,0 +1,274 @@
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include "../../Utils/TraceFormat.h"
+#include "../../Utils/TraceWriter.h"
+#include "../CPU8068.h"
+
+namespace {
+// Bytes an instruction writes through its ModRM operand, 0 for none
+uint16_t rm_write_size(const uint8_t* code) {
+  uint8_t opcode = code[0];
+  if (opcode == 0xF2 || opcode == 0xF3) {
+    opcode = *++code;
+  }
+  // 80286 system instructions, SLDT / STR and SGDT / SIDT / SMSW
+  if (opcode == 0x0F) {
+    const uint8_t mod_rm = code[2];
+    const uint8_t reg = mod_rm >> 3 & 7;
+    if (mod_rm >> 6 == 3) {
+      return 0;
+    }
+    if (code[1] == 0x00) {
+      return reg < 2 ? 2 : 0;
+    }
+    if (code[1] == 0x01) {
+      return reg < 2 ? 6 : reg == 4 ? 2 : 0;
+    }
+    return 0;
+  }
+
+  const uint8_t mod_rm = code[1];
+  if (mod_rm >> 6 == 3) {
+    return 0;
+  }
+  const uint8_t reg = mod_rm >> 3 & 7;
+  const uint16_t width = opcode & 1 ? 2 : 1;
+  if (opcode < 0x40 && (opcode & 7) < 2) {
+    // ALU r/m, reg: all but CMP write back
+    return opcode >> 3 == 7 ? 0 : width;
+  }
+  switch (opcode) {
+    case 0x80:
+    case 0x81:
+    case 0x82:
+    case 0x83:
+      return reg == 7 ? 0 : opcode == 0x80 || opcode == 0x82 ? 1 : 2;
+    case 0x86:
+    case 0x87:
+    case 0x88:
+    case 0x89:
+    case 0xC0:
+    case 0xC1:
+    case 0xC6:
+    case 0xC7:
+    case 0xD0:
+    case 0xD1:
+    case 0xD2:
+    case 0xD3:
+      return width;
+    case 0x8C:
+    case 0x8F:
+      return 2;
+      // NOT and NEG
+    case 0xF6:
+    case 0xF7:
+      return reg == 2 || reg == 3 ? width : 0;
+      // INC and DEC
+    case 0xFE:
+    case 0xFF:
+      return reg < 2 ? width : 0;
+      // FPU stores: FST(P), FIST(P), FBSTP, control and status words, state
+    case 0xD9:
+      return reg == 2 || reg == 3 ? 4 : reg == 6 ? 14 : reg == 7 ? 2 : 0;
+    case 0xDB:
+      return reg == 2 || reg == 3 ? 4 : reg == 7 ? 10 : 0;
+    case 0xDD:
+      return reg == 2 || reg == 3 ? 8 : reg == 6 ? 94 : reg == 7 ? 2 : 0;
+    case 0xDF:
+      return reg == 2 || reg == 3 ? 2 : reg == 6 ? 10 : reg == 7 ? 8 : 0;
+    default:
+      return 0;
+  }
+}
+
+// MOV moffs, AL and AX, which write at DS:imm16, 0 for anything else
+uint16_t moffs_write_size(const uint8_t* code) {
+  return code[0] == 0xA2 ? 1 : code[0] == 0xA3 ? 2 : 0;
+}
+
+// Instructions that push onto the stack, so SP going down means writes
+bool pushes(const uint8_t* code) {
+  const uint8_t opcode = code[0];
+  switch (opcode) {
+    case 0x06:
+    case 0x0E:
+    case 0x16:
+    case 0x1E:
+    case 0x60:
+    case 0x68:
+    case 0x6A:
+    case 0x9A:
+    case 0x9C:
+    case 0xC8:
+    case 0xCC:
+    case 0xCD:
+    case 0xCE:
+    case 0xE8:
+      return true;
+    case 0xFF: {
+      const uint8_t reg = code[1] >> 3 & 7;
+      return reg == 2 || reg == 3 || reg == 6;
+    }
+    default:
+      return opcode >= 0x50 && opcode <= 0x57;
+  }
+}
+
+// MOVS, STOS and INS, which write at ES:DI, 0 for anything else
+uint16_t string_write_size(const uint8_t* code) {
+  uint8_t opcode = code[0];
+  if (opcode == 0xF2 || opcode == 0xF3) {
+    opcode = code[1];
+  }
+  switch (opcode) {
+    case 0x6C:
+    case 0xA4:
+    case 0xAA:
+      return 1;
+    case 0x6D:
+    case 0xA5:
+    case 0xAB:
+      return 2;
+    default:
+      return 0;
+  }
+}
+
+void put16(uint8_t*& out, const uint16_t value) {
+  *out++ = static_cast<uint8_t>(value);
+  *out++ = static_cast<uint8_t>(value >> 8);
+}
+}  // namespace
+
+void CPU8068::enable_trace(std::unique_ptr<TraceWriter> writer,
+                           const uint32_t first, const uint32_t last) {
+  trace = std::move(writer);
+  trace_first = first;
+  trace_last = last;
+  trace_started = false;
+  trace_frame_size = 0;
+}
+
+void CPU8068::trace_events(const uint16_t event_SP) {
+  if (SP == event_SP) {
+    return;
+  }
+  // IRQ frames nest downwards, the last one pushed is the lowest
+  const uint16_t size = static_cast<uint16_t>(event_SP - SP);
+  trace_frame = linear_address(Sreg::SS, SP);
+  trace_frame_size = static_cast<uint16_t>(trace_frame_size + size);
+}
+
+void CPU8068::trace_instruction(const uint16_t start_CS,
+                                const uint16_t start_IP) {
+  const uint32_t address = trace_address;
+  if (address < trace_first || address > trace_last) {
+    // A frame waiting here goes with a record that is not written
+    trace_frame_size = 0;
+    return;
+  }
+
+  // Where the next instruction starts tells the length, unless it jumped
+  const uint16_t advance = IP - start_IP;
+  const uint8_t length = !jump_taken && CS == start_CS && advance >= 1 &&
+                                 advance <= TraceFormat::LENGTH_MASK
+                             ? static_cast<uint8_t>(advance)
+                             : TraceFormat::UNKNOWN_LENGTH;
+  uint8_t code[TraceFormat::LENGTH_MASK + 2]{};
+  for (uint8_t i = 0; i < length; i++) {
+    code[i] = memory[(address + i) & address_mask];
+  }
+
+  const RegisterSet after = register_set();
+  uint16_t changed = 0;
+  for (size_t i = 0; i < after.size(); i++) {
+    if (!trace_started || after[i] != trace_registers[i]) {
+      changed |= 1 << i;
+    }
+  }
+
+  /*
+    At most four areas: the ModRM or moffs operand, the stack, ES:DI and
+    interrupt frames pushed since the last record. Sizes are known from
+    the instruction and where SP and DI moved to.
+  */
+  struct Area {
+    uint32_t address;
+    uint32_t size;
+  };
+  Area areas[4];
+  uint8_t count = 0;
+  if (trace_frame_size) {
+    areas[count++] = {trace_frame, trace_frame_size};
+    trace_frame_size = 0;
+  }
+  if (const uint16_t size = rm_write_size(code)) {
+    areas[count++] = {linear_address(last_ea_segment, last_ea_offset), size};
+  } else if (const uint16_t moffs_size = moffs_write_size(code)) {
+    const auto offset = static_cast<uint16_t>(code[1] | code[2] << 8);
+    areas[count++] = {linear_address(Sreg::DS, offset), moffs_size};
+  }
+  const RegisterSet& before = trace_before;
+  if (pushes(code) && SS == before[10] && SP < before[4]) {
+    areas[count++] = {linear_address(Sreg::SS, SP),
+                      static_cast<uint32_t>(before[4] - SP)};
+  }
+  const uint16_t element = string_write_size(code);
+  if (element && DI != before[7]) {
+    // Counting down the last element written starts just above DI
+    const bool down = FLAGS & DF_MASK;
+    const uint16_t low = down ? DI + element : before[7];
+    areas[count++] = {linear_address(Sreg::ES, low),
+                      static_cast<uint16_t>(down ? before[7] - DI
+                                                 : DI - before[7])};
+  }
+
+  uint8_t record[1 + 2 + 2 + sizeof(code) + 2 + 2 * 12 + 1];
+  uint8_t* out = record + 1;
+  uint8_t tag = length;
+  if (!trace_started || start_CS != trace_CS) {
+    tag |= TraceFormat::HAS_CS;
+    put16(out, start_CS);
+  }
+  if (!trace_started || start_IP != trace_IP) {
+    tag |= TraceFormat::HAS_IP;
+    put16(out, start_IP);
+  }
+  out = std::copy(code, code + length, out);
+  if (changed) {
+    tag |= TraceFormat::HAS_REGISTERS;
+    put16(out, changed);
+    for (size_t i = 0; i < after.size(); i++) {
+      if (changed & 1 << i) {
+        put16(out, after[i]);
+      }
+    }
+  }
+  if (count) {
+    tag |= TraceFormat::HAS_WRITES;
+    *out++ = count;
+  }
+  record[0] = tag;
+  trace->write(record, static_cast<size_t>(out - record));
+
+  for (uint8_t i = 0; i < count; i++) {
+    // Clipped to memory, a write wrapping the top of it is rare enough
+    const uint32_t start = areas[i].address;
+    const uint32_t size = std::min<uint32_t>(
+        areas[i].size, static_cast<uint32_t>(memory.size()) - start);
+    const uint8_t entry[5] = {
+        static_cast<uint8_t>(start), static_cast<uint8_t>(start >> 8),
+        static_cast<uint8_t>(start >> 16), static_cast<uint8_t>(size),
+        static_cast<uint8_t>(size >> 8)};
+    trace->write(entry, sizeof(entry));
+    trace->write(&memory[start], size);
+  }
+
+  trace_started = true;
+  trace_CS = start_CS;
+  trace_IP = static_cast<uint16_t>(start_IP + length);
+  trace_registers = after;
+}
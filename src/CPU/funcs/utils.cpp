@@ -28,9 +28,9 @@ uint16_t CPU8068::sign_extend(const uint8_t val) {
  *  111     [BX]        [BX+disp8]      [BX+disp16]     BH / DI
  */
 bool CPU8068::get_address_mode_rm(const uint8_t mode, const uint8_t r_m,
-                                  uint16_t& segment,
+                                  Sreg& segment,
                                   uint16_t& address) {
-  segment = DS;
+  segment = Sreg::DS;
   switch (r_m) {
     case 0b000:
       address = BX + SI;
@@ -40,11 +40,11 @@ bool CPU8068::get_address_mode_rm(const uint8_t mode, const uint8_t r_m,
       break;
     case 0b010:
       address = BP + SI;
-      segment = SS;
+      segment = Sreg::SS;
       break;
     case 0b011:
       address = BP + DI;
-      segment = SS;
+      segment = Sreg::SS;
       break;
     case 0b100:
       address = SI;
@@ -55,11 +55,11 @@ bool CPU8068::get_address_mode_rm(const uint8_t mode, const uint8_t r_m,
     case 0b110: {
       if (mode == 0b01 || mode == 0b10) {
         address = BP;
-        segment = SS;
+        segment = Sreg::SS;
         break;
       }
       if (mode == 0b00) {
-        address = mem16(CS, IP);
+        address = mem16(Sreg::CS, IP);
         IP += 2;
         break;
       }
@@ -72,9 +72,9 @@ bool CPU8068::get_address_mode_rm(const uint8_t mode, const uint8_t r_m,
       return false;
   }
   if (mode == 0b01) {
-    address += static_cast<int8_t>(mem8(CS, IP++));
+    address += static_cast<int8_t>(mem8(Sreg::CS, IP++));
   } else if (mode == 0b10) {
-    address += static_cast<int16_t>(mem16(CS, IP));
+    address += static_cast<int16_t>(mem16(Sreg::CS, IP));
     IP += 2;
   } else if (mode == 0b00)
     ; // No calculation for this
@@ -82,9 +82,15 @@ bool CPU8068::get_address_mode_rm(const uint8_t mode, const uint8_t r_m,
     return false; // Just a fail-safe
   }
 
+  last_ea_segment = segment;
+  last_ea_offset = address;
   return true;
 }
 
+CPU8068::RegisterSet CPU8068::register_set() const {
+  return {AX, BX, CX, DX, SP, BP, SI, DI, DS, ES, SS, FLAGS};
+}
+
 uint32_t CPU8068::ROL(uint32_t val, uint8_t width, uint8_t count,
                       uint8_t& last_bit_rotated) {
   if (width != 8 && width != 16) {
@@ -260,13 +266,3 @@ uint32_t CPU8068::SAR(uint32_t val, uint8_t width, uint8_t count,
 
   return result;
 }
-
-void CPU8068::update_segment_register(uint16_t reg) {
-  if (cpu_mode == CPU_MODE::CPU_8086 || cpu_mode == CPU_MODE::CPU_80186) {
-    mylog("CPU8068::update_segment_register called with reg: %ld",
-          static_cast<long int>(reg));
-  } else if (cpu_mode == CPU_MODE::CPU_80286) {
-    mylog("CPU8068::update_segment_register called with reg: %ld",
-          static_cast<long int>(reg));
-  }
-}
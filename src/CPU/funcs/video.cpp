@@ -0,0 +1,516 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "../../Devices/BiosDataArea.h"
+#include "../../Devices/Framebuffer.h"
+#include "../../Devices/TextDisplay.h"
+#include "../../Utils/logger.h"
+#include "../CPU8068.h"
+
+namespace {
+struct VideoMode {
+  uint8_t mode;
+  uint8_t columns;
+  bool text;
+  uint16_t page_size;
+};
+
+constexpr VideoMode VIDEO_MODES[] = {
+    {0x00, 40, true, 0x0800},  {0x01, 40, true, 0x0800},
+    {0x02, 80, true, 0x1000},  {0x03, 80, true, 0x1000},
+    {0x04, 40, false, 0x4000}, {0x05, 40, false, 0x4000},
+    {0x06, 80, false, 0x4000}, {0x07, 80, true, 0x1000},
+    {0x0D, 40, false, 0x2000}, {0x0E, 80, false, 0x4000},
+    {0x0F, 80, false, 0x8000}, {0x10, 80, false, 0x8000},
+    {0x11, 80, false, 0xA000}, {0x12, 80, false, 0xA000},
+    {0x13, 40, false, 0xFA00},
+};
+
+// Text memory a mode set clears, all eight pages
+constexpr uint32_t TEXT_MEMORY_SIZE = 0x8000;
+// Graphics memory a mode set clears, CGA modes and the rest
+constexpr uint32_t CGA_MEMORY = 0xB8000;
+constexpr uint32_t CGA_MEMORY_SIZE = 0x4000;
+constexpr uint32_t GRAPHICS_MEMORY = 0xA0000;
+constexpr uint32_t GRAPHICS_MEMORY_SIZE = 0x10000;
+constexpr uint8_t BLANK = ' ';
+constexpr uint8_t DEFAULT_ATTRIBUTE = 0x07;
+// Scan lines of the cursor, start and end
+constexpr uint8_t COLOR_CURSOR[2] = {6, 7};
+constexpr uint8_t MONOCHROME_CURSOR[2] = {11, 12};
+
+uint16_t read16(const Memory& memory, const uint32_t address) {
+  return memory[address] | memory[address + 1] << 8;
+}
+
+void write16(Memory& memory, const uint32_t address, const uint16_t value) {
+  memory[address] = static_cast<uint8_t>(value);
+  memory[address + 1] = static_cast<uint8_t>(value >> 8);
+}
+}  // namespace
+
+bool CPU8068::text_screen(const uint8_t page, TextScreen& screen) const {
+  const uint8_t mode = memory[BiosDataArea::VIDEO_MODE];
+  if (mode > 3 && mode != TextDisplay::MONOCHROME_MODE) {
+    return false;
+  }
+
+  // A blank data area, before any mode set, reads as 80x25
+  const uint16_t page_size = read16(memory, BiosDataArea::PAGE_SIZE);
+  screen.base = mode == TextDisplay::MONOCHROME_MODE
+                    ? TextDisplay::MONOCHROME_TEXT
+                    : TextDisplay::COLOR_TEXT;
+  screen.base += (page & (BiosDataArea::PAGES - 1)) *
+                 (page_size ? page_size : 0x1000);
+  screen.columns = memory[BiosDataArea::COLUMNS] == 40 ? 40 : 80;
+  const uint8_t last_row = memory[BiosDataArea::LAST_ROW];
+  screen.rows = last_row ? last_row + 1 : 25;
+  return true;
+}
+
+void CPU8068::set_video_mode(const uint8_t value) {
+  const uint8_t mode = value & 0x7F;
+  const VideoMode* found = nullptr;
+  for (const VideoMode& candidate : VIDEO_MODES) {
+    if (candidate.mode == mode) {
+      found = &candidate;
+    }
+  }
+  if (!found) {
+    mylog("Unsupported video mode %02X", mode);
+    return;
+  }
+
+  memory[BiosDataArea::VIDEO_MODE] = mode;
+  write16(memory, BiosDataArea::COLUMNS, found->columns);
+  write16(memory, BiosDataArea::PAGE_SIZE, found->page_size);
+  write16(memory, BiosDataArea::PAGE_OFFSET, 0);
+  std::memset(&memory[BiosDataArea::CURSOR], 0, BiosDataArea::PAGES * 2);
+  memory[BiosDataArea::ACTIVE_PAGE] = 0;
+  memory[BiosDataArea::LAST_ROW] = 24;
+  write16(memory, BiosDataArea::CHARACTER_HEIGHT, 16);
+  const uint8_t* shape =
+      mode == TextDisplay::MONOCHROME_MODE ? MONOCHROME_CURSOR : COLOR_CURSOR;
+  memory[BiosDataArea::CURSOR_SHAPE] = shape[1];
+  memory[BiosDataArea::CURSOR_SHAPE + 1] = shape[0];
+  framebuffer.reset(mode);
+
+  if (!found->text) {
+    // Character rows of the graphics screen, for teletype output
+    const bool cga = mode >= 0x04 && mode <= 0x06;
+    const uint8_t height = mode == 0x10 ? 14 : mode == 0x12 ? 16 : 8;
+    const uint16_t lines = mode == 0x10 ? 350 : mode == 0x12 ? 480 : 200;
+    write16(memory, BiosDataArea::CHARACTER_HEIGHT, height);
+    memory[BiosDataArea::LAST_ROW] = lines / height - 1;
+    if (!(value & 0x80)) {
+      std::memset(&memory[cga ? CGA_MEMORY : GRAPHICS_MEMORY], 0,
+                  cga ? CGA_MEMORY_SIZE : GRAPHICS_MEMORY_SIZE);
+    }
+    return;
+  }
+
+  TextScreen screen{};
+  if (!text_screen(0, screen)) {
+    return;
+  }
+  // Bit 7 keeps what is in video memory
+  if (!(value & 0x80)) {
+    for (uint32_t cell = 0; cell < TEXT_MEMORY_SIZE; cell += 2) {
+      memory[screen.base + cell] = BLANK;
+      memory[screen.base + cell + 1] = DEFAULT_ATTRIBUTE;
+    }
+  }
+  if (display) {
+    display->sync(screen.base, screen.rows * screen.columns * 2);
+  }
+}
+
+void CPU8068::scroll_text(const uint8_t page, const uint8_t lines,
+                          const uint8_t attribute, const uint8_t top,
+                          const uint8_t left, uint8_t bottom, uint8_t right,
+                          const bool up) {
+  TextScreen screen{};
+  if (!text_screen(page, screen) || top > bottom || left > right ||
+      top >= screen.rows || left >= screen.columns) {
+    return;
+  }
+  bottom = std::min<uint8_t>(bottom, screen.rows - 1);
+  right = std::min<uint8_t>(right, screen.columns - 1);
+
+  const uint32_t row_size = screen.columns * 2;
+  const uint32_t width = (right - left + 1) * 2;
+  const int height = bottom - top + 1;
+  // 0 clears the whole window
+  const int count = lines == 0 || lines > height ? height : lines;
+  const int kept = height - count;
+  uint8_t* window = memory.data() + screen.base + top * row_size + left * 2;
+
+  if (width == row_size) {
+    // Whole rows are contiguous, the move is a single memmove
+    if (up) {
+      std::memmove(window, window + count * row_size, kept * row_size);
+    } else {
+      std::memmove(window + count * row_size, window, kept * row_size);
+    }
+  } else if (up) {
+    for (int row = 0; row < kept; row++) {
+      std::memmove(window + row * row_size, window + (row + count) * row_size,
+                   width);
+    }
+  } else {
+    for (int row = kept - 1; row >= 0; row--) {
+      std::memmove(window + (row + count) * row_size, window + row * row_size,
+                   width);
+    }
+  }
+
+  const int first_blank = up ? kept : 0;
+  for (int row = first_blank; row < first_blank + count; row++) {
+    uint8_t* cells = window + row * row_size;
+    for (uint32_t cell = 0; cell < width; cell += 2) {
+      cells[cell] = BLANK;
+      cells[cell + 1] = attribute;
+    }
+  }
+
+  if (display) {
+    display->sync(screen.base + top * row_size, height * row_size);
+  }
+}
+
+void CPU8068::teletype(const uint8_t page, const uint8_t character,
+                       const int attribute, std::string* stream) {
+  const uint32_t cursor = BiosDataArea::CURSOR + (page & 7) * 2;
+  uint8_t& column = memory[cursor];
+  uint8_t& row = memory[cursor + 1];
+
+  TextScreen screen{};
+  const bool text = text_screen(page, screen);
+  if (!text) {
+    // No cells to write to, the terminal still gets the text
+    screen.columns = memory[BiosDataArea::COLUMNS];
+    screen.rows = memory[BiosDataArea::LAST_ROW] + 1;
+  }
+
+  switch (character) {
+    case '\a':
+      if (stream) *stream += '\a';
+      return;
+    case '\b':
+      if (column) column--;
+      if (stream) *stream += '\b';
+      return;
+    case '\r':
+      column = 0;
+      if (stream) *stream += '\r';
+      return;
+    case '\n':
+      row++;
+      if (stream) *stream += '\n';
+      break;
+    default: {
+      if (text) {
+        const uint32_t cell =
+            screen.base + (row * screen.columns + column) * 2;
+        memory[cell] = character;
+        if (attribute >= 0) {
+          memory[cell + 1] = static_cast<uint8_t>(attribute);
+        }
+        if (display) {
+          display->sync(cell, 2);
+        }
+      }
+      if (stream) TextDisplay::append_glyph(*stream, character);
+
+      if (++column >= screen.columns) {
+        column = 0;
+        row++;
+        // CR ends the terminal's pending wrap, so this is right at any width
+        if (stream) *stream += "\r\n";
+      }
+      break;
+    }
+  }
+
+  if (row >= screen.rows) {
+    row = screen.rows - 1;
+    // The new line takes the attribute under the cursor
+    const uint8_t fill =
+        text ? memory[screen.base + (row * screen.columns + column) * 2 + 1]
+             : DEFAULT_ATTRIBUTE;
+    scroll_text(page, 1, fill, 0, 0, row, screen.columns - 1, true);
+  }
+}
+
+std::string* CPU8068::video_stream(const uint8_t page) {
+  // Output to a page nobody is looking at, or a screen drawn cell by cell
+  if (page != memory[BiosDataArea::ACTIVE_PAGE] ||
+      (display && !display->streaming())) {
+    return nullptr;
+  }
+  stream_buffer.clear();
+  return &stream_buffer;
+}
+
+void CPU8068::video_interrupt() {
+  const uint8_t page = BH & 7;
+  const uint32_t cursor = BiosDataArea::CURSOR + page * 2;
+
+  switch (AH) {
+      // Set video mode
+    case 0x00: {
+      set_video_mode(AL);
+      break;
+    }
+      // Set cursor shape, CH start line, CL end line
+    case 0x01: {
+      memory[BiosDataArea::CURSOR_SHAPE] = CL;
+      memory[BiosDataArea::CURSOR_SHAPE + 1] = CH;
+      break;
+    }
+      // Set cursor position
+    case 0x02: {
+      memory[cursor] = DL;
+      memory[cursor + 1] = DH;
+      break;
+    }
+      // Get cursor position and shape
+    case 0x03: {
+      DL = memory[cursor];
+      DH = memory[cursor + 1];
+      CL = memory[BiosDataArea::CURSOR_SHAPE];
+      CH = memory[BiosDataArea::CURSOR_SHAPE + 1];
+      break;
+    }
+      // Select active page
+    case 0x05: {
+      const uint8_t active = AL & 7;
+      memory[BiosDataArea::ACTIVE_PAGE] = active;
+      write16(memory, BiosDataArea::PAGE_OFFSET,
+              active * read16(memory, BiosDataArea::PAGE_SIZE));
+      TextScreen screen{};
+      if (display && text_screen(active, screen)) {
+        display->sync(screen.base, screen.rows * screen.columns * 2);
+      }
+      break;
+    }
+      // Scroll window up, scroll window down
+      // AL lines, BH attribute, CH/CL top left, DH/DL bottom right
+    case 0x06:
+    case 0x07: {
+      scroll_text(memory[BiosDataArea::ACTIVE_PAGE], AL, BH, CH, CL, DH, DL,
+                  AH == 0x06);
+      break;
+    }
+      // Read character and attribute at cursor
+    case 0x08: {
+      TextScreen screen{};
+      if (!text_screen(page, screen)) {
+        AX = 0;
+        break;
+      }
+      const uint32_t cell =
+          screen.base +
+          (memory[cursor + 1] * screen.columns + memory[cursor]) * 2;
+      AL = memory[cell];
+      AH = memory[cell + 1];
+      break;
+    }
+      // Write character and attribute, write character only
+      // CX times from the cursor, which stays where it is
+    case 0x09:
+    case 0x0A: {
+      TextScreen screen{};
+      if (!text_screen(page, screen)) {
+        break;
+      }
+      const uint32_t first =
+          memory[cursor + 1] * screen.columns + memory[cursor];
+      const uint32_t last = std::min<uint32_t>(
+          first + CX, screen.rows * screen.columns);
+      for (uint32_t cell = first; cell < last; cell++) {
+        memory[screen.base + cell * 2] = AL;
+        if (AH == 0x09) {
+          memory[screen.base + cell * 2 + 1] = BL;
+        }
+      }
+      break;
+    }
+      // CGA colour select, BH 0 background (foreground in 06h), 1 palette
+    case 0x0B: {
+      if (BH == 0) {
+        framebuffer.set_cga_background(BL);
+      } else if (BH == 1) {
+        framebuffer.set_cga_palette(BL);
+      }
+      break;
+    }
+      // Write pixel AL at CX/DX, read pixel
+    case 0x0C: {
+      framebuffer.write_pixel(CX, DX, AL);
+      break;
+    }
+    case 0x0D: {
+      AL = framebuffer.read_pixel(CX, DX);
+      break;
+    }
+      // Teletype output
+    case 0x0E: {
+      const uint8_t active = memory[BiosDataArea::ACTIVE_PAGE];
+      std::string* stream = video_stream(active);
+      teletype(active, AL, -1, stream);
+      if (stream) {
+        std::cout << *stream;
+      }
+      break;
+    }
+      // Get video mode
+    case 0x0F: {
+      AL = memory[BiosDataArea::VIDEO_MODE];
+      AH = memory[BiosDataArea::COLUMNS];
+      BH = memory[BiosDataArea::ACTIVE_PAGE];
+      break;
+    }
+      // Palette registers and DAC
+    case 0x10: {
+      video_palette();
+      break;
+    }
+      // Character generator: 8x8 font for 50 rows, 8x16 for 25
+    case 0x11: {
+      uint8_t height;
+      if (AL == 0x02 || AL == 0x12) {
+        height = 8;
+      } else if (AL == 0x04 || AL == 0x14) {
+        height = 16;
+      } else if (AL == 0x30) {
+        CX = read16(memory, BiosDataArea::CHARACTER_HEIGHT);
+        DL = memory[BiosDataArea::LAST_ROW];
+        // No font tables in guest memory
+        ES = BP = 0;
+        break;
+      } else {
+        mylog("Unsupported interrupt");
+        break;
+      }
+      write16(memory, BiosDataArea::CHARACTER_HEIGHT, height);
+      memory[BiosDataArea::LAST_ROW] = 400 / height - 1;
+      TextScreen screen{};
+      if (display && text_screen(memory[BiosDataArea::ACTIVE_PAGE], screen)) {
+        display->sync(screen.base, screen.rows * screen.columns * 2);
+      }
+      break;
+    }
+      // EGA information, colour adapter with 256K
+    case 0x12: {
+      if (BL == 0x10) {
+        BH = 0;
+        BL = 3;
+        CX = 0;
+      }
+      break;
+    }
+      /*
+        Write string at DH/DL, ES:BP, CX characters. AL bit 0 leaves the
+        cursor after it, bit 1 means character and attribute pairs,
+        otherwise BL is the attribute.
+      */
+    case 0x13: {
+      const uint8_t saved_column = memory[cursor];
+      const uint8_t saved_row = memory[cursor + 1];
+      memory[cursor] = DL;
+      memory[cursor + 1] = DH;
+
+      std::string* stream = video_stream(page);
+      const bool pairs = AL & 0x02;
+      uint16_t offset = BP;
+      for (uint16_t i = 0; i < CX; i++) {
+        const uint8_t character = mem8(Sreg::ES, offset++);
+        const uint8_t attribute = pairs ? mem8(Sreg::ES, offset++) : BL;
+        teletype(page, character, attribute, stream);
+      }
+      if (stream) {
+        std::cout << *stream;
+      }
+
+      if (!(AL & 0x01)) {
+        memory[cursor] = saved_column;
+        memory[cursor + 1] = saved_row;
+      }
+      break;
+    }
+      // Display combination, VGA with colour display
+    case 0x1A: {
+      if (AL == 0x00) {
+        AL = 0x1A;
+        BX = 0x0008;
+      }
+      break;
+    }
+    default:
+      mylog("Unsupported interrupt");
+      break;
+  }
+}
+
+void CPU8068::video_palette() {
+  switch (AL) {
+      // Set one palette register, BL to BH
+    case 0x00: {
+      framebuffer.set_palette_register(BL, BH);
+      break;
+    }
+      // Overscan and blink, nothing shows either
+    case 0x01:
+    case 0x03:
+      break;
+      // Set all palette registers and overscan from ES:DX
+    case 0x02: {
+      for (uint8_t i = 0; i < 16; i++) {
+        framebuffer.set_palette_register(i, mem8(Sreg::ES, DX + i));
+      }
+      break;
+    }
+      // Read palette register BL into BH
+    case 0x07: {
+      BH = framebuffer.palette_register(BL);
+      break;
+    }
+      // Set DAC register BX to DH/CH/CL
+    case 0x10: {
+      framebuffer.set_dac(BL, DH, CH, CL);
+      break;
+    }
+      // Set CX DAC registers from BX, ES:DX red green blue triples
+    case 0x12: {
+      for (uint16_t i = 0; i < CX && BX + i < 256; i++) {
+        const uint16_t entry = DX + i * 3;
+        framebuffer.set_dac(static_cast<uint8_t>(BX + i),
+                            mem8(Sreg::ES, entry), mem8(Sreg::ES, entry + 1),
+                            mem8(Sreg::ES, entry + 2));
+      }
+      break;
+    }
+      // Read DAC register BX into DH/CH/CL
+    case 0x15: {
+      framebuffer.get_dac(BL, DH, CH, CL);
+      break;
+    }
+      // Read CX DAC registers from BX to ES:DX
+    case 0x17: {
+      for (uint16_t i = 0; i < CX && BX + i < 256; i++) {
+        const uint16_t entry = DX + i * 3;
+        framebuffer.get_dac(static_cast<uint8_t>(BX + i),
+                            mem8(Sreg::ES, entry), mem8(Sreg::ES, entry + 1),
+                            mem8(Sreg::ES, entry + 2));
+      }
+      break;
+    }
+    default:
+      mylog("Unsupported interrupt");
+      break;
+  }
+}
@@ -0,0 +1,17 @@
+#ifndef DOSERROR_H
+#define DOSERROR_H
+
+#include <cstdint>
+
+// Error codes INT 21h hands back in AX with CF set
+enum class DosError : uint16_t {
+  NONE = 0,
+  INVALID_FUNCTION = 1,
+  FILE_NOT_FOUND = 2,
+  ARENA_TRASHED = 7,
+  NOT_ENOUGH_MEMORY = 8,
+  INVALID_BLOCK = 9,
+  INVALID_FORMAT = 11,
+};
+
+#endif  // DOSERROR_H
@@ -0,0 +1,33 @@
+#include "HostPath.h"
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+std::string to_host_path(const std::string_view dos_path) {
+  std::string path{dos_path};
+  if (path.size() >= 2 && path[1] == ':') {
+    path.erase(0, 2);
+  }
+  std::replace(path.begin(), path.end(), '\\', '/');
+  // The root of a drive is the working directory too
+  path.erase(0, path.find_first_not_of('/'));
+
+  std::string lower = path;
+  std::transform(lower.begin(), lower.end(), lower.begin(),
+                 [](const unsigned char c) { return std::tolower(c); });
+  std::string upper = path;
+  std::transform(upper.begin(), upper.end(), upper.begin(),
+                 [](const unsigned char c) { return std::toupper(c); });
+
+  for (const std::string& candidate : {path, lower, upper}) {
+    std::error_code error;
+    if (std::filesystem::is_regular_file(candidate, error)) {
+      return candidate;
+    }
+  }
+  return path;
+}
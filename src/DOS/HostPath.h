@@ -0,0 +1,15 @@
+#ifndef HOSTPATH_H
+#define HOSTPATH_H
+
+#include <string>
+#include <string_view>
+
+/*
+  Host file for a DOS path. The root of every drive is the host working
+  directory, backslashes become slashes, and as DOS names are case
+  insensitive the name is also tried in lower and upper case. Returns
+  the path as given when none of these exist.
+*/
+std::string to_host_path(std::string_view dos_path);
+
+#endif  // HOSTPATH_H
@@ -0,0 +1,70 @@
+#include "ImageCache.h"
+
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+#include "../ExecutableFiles/COM.h"
+#include "../ExecutableFiles/MZExe.h"
+#include "ProgramImage.h"
+
+std::shared_ptr<const ProgramImage> ImageCache::get(
+    const std::string_view path) {
+  const std::string key{path};
+
+  std::error_code error;
+  const std::filesystem::file_time_type modified =
+      std::filesystem::last_write_time(key, error);
+  if (error) {
+    entries.erase(key);
+    return nullptr;
+  }
+  const uintmax_t size = std::filesystem::file_size(key, error);
+  if (error) {
+    entries.erase(key);
+    return nullptr;
+  }
+
+  const auto it = entries.find(key);
+  if (it != entries.end() && it->second.modified == modified &&
+      it->second.size == size) {
+    return it->second.image;
+  }
+
+  std::shared_ptr<const ProgramImage> image = read(path);
+  if (!image) {
+    entries.erase(key);
+    return nullptr;
+  }
+  entries[key] = Entry{modified, size, image};
+  return image;
+}
+
+std::shared_ptr<const ProgramImage> ImageCache::read(
+    const std::string_view path) {
+  const std::optional<COM> file{COM::open(path)};
+  if (!file) {
+    return nullptr;
+  }
+
+  const bool is_mz = file->buffer.size() >= 2 &&
+                     ((file->buffer[0] == 'M' && file->buffer[1] == 'Z') ||
+                      (file->buffer[0] == 'Z' && file->buffer[1] == 'M'));
+  std::optional<ProgramImage> image;
+  if (is_mz) {
+    const std::optional<MZExe> mz{MZExe::open(path)};
+    if (mz) {
+      image = ProgramImage::from_mz(mz.value());
+    }
+  } else {
+    image = ProgramImage::from_com(file.value());
+  }
+
+  if (!image) {
+    return nullptr;
+  }
+  return std::make_shared<const ProgramImage>(std::move(image.value()));
+}
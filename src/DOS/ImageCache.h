@@ -0,0 +1,37 @@
+#ifndef IMAGECACHE_H
+#define IMAGECACHE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "ProgramImage.h"
+
+/*
+  Programs loaded by EXEC, by host path. An entry is used as long as the
+  file keeps its modification time and size, so a child that a batch
+  loop runs over and over is read and relocated once.
+
+  COM or MZ is decided by the signature, not the extension, like DOS.
+*/
+class ImageCache {
+ public:
+  // nullptr when the file cannot be read or is not a valid program
+  std::shared_ptr<const ProgramImage> get(std::string_view path);
+
+  static std::shared_ptr<const ProgramImage> read(std::string_view path);
+
+ private:
+  struct Entry {
+    std::filesystem::file_time_type modified;
+    uintmax_t size;
+    std::shared_ptr<const ProgramImage> image;
+  };
+
+  std::unordered_map<std::string, Entry> entries;
+};
+
+#endif  // IMAGECACHE_H
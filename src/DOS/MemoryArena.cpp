@@ -0,0 +1,249 @@
+#include "MemoryArena.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <vector>
+
+#include "../CPU/Memory.h"
+#include "DosError.h"
+
+MemoryArena::MemoryArena(Memory& memory) : memory(memory), valid(false) {}
+
+void MemoryArena::format() {
+  blocks.clear();
+  free_blocks.clear();
+
+  blocks[FIRST_SEGMENT] = Block{0, END_SEGMENT - FIRST_SEGMENT - 1};
+  free_blocks.insert(FIRST_SEGMENT);
+  write(FIRST_SEGMENT, blocks[FIRST_SEGMENT]);
+  valid = true;
+}
+
+bool MemoryArena::rebuild() {
+  blocks.clear();
+  free_blocks.clear();
+  valid = false;
+
+  uint32_t mcb = FIRST_SEGMENT;
+  while (mcb < END_SEGMENT) {
+    const size_t address = mcb * 16;
+    const uint8_t type = memory[address];
+    if (type != TYPE_MIDDLE && type != TYPE_LAST) {
+      break;
+    }
+
+    const Block block{
+        static_cast<uint16_t>(memory[address + 1] | (memory[address + 2] << 8)),
+        static_cast<uint16_t>(memory[address + 3] |
+                              (memory[address + 4] << 8))};
+    blocks[static_cast<uint16_t>(mcb)] = block;
+    if (block.owner == 0) {
+      free_blocks.insert(static_cast<uint16_t>(mcb));
+    }
+
+    if (type == TYPE_LAST) {
+      valid = true;
+      return true;
+    }
+    mcb += block.size + 1;
+  }
+
+  blocks.clear();
+  free_blocks.clear();
+  return false;
+}
+
+bool MemoryArena::matches(const uint16_t mcb, const Block& block) const {
+  const size_t address = mcb * 16;
+  const uint8_t expected_type =
+      mcb == blocks.rbegin()->first ? TYPE_LAST : TYPE_MIDDLE;
+  return memory[address] == expected_type &&
+         (memory[address + 1] | (memory[address + 2] << 8)) == block.owner &&
+         (memory[address + 3] | (memory[address + 4] << 8)) == block.size;
+}
+
+std::map<uint16_t, MemoryArena::Block>::iterator MemoryArena::find(
+    const uint16_t mcb) {
+  if (valid) {
+    const auto it = blocks.find(mcb);
+    if (it != blocks.end() && matches(it->first, it->second)) {
+      return it;
+    }
+  }
+  if (!rebuild()) {
+    return blocks.end();
+  }
+  return blocks.find(mcb);
+}
+
+void MemoryArena::write(const uint16_t mcb, const Block& block) {
+  const size_t address = mcb * 16;
+  memory[address] = mcb == blocks.rbegin()->first ? TYPE_LAST : TYPE_MIDDLE;
+  memory[address + 1] = block.owner & 0xFF;
+  memory[address + 2] = block.owner >> 8;
+  memory[address + 3] = block.size & 0xFF;
+  memory[address + 4] = block.size >> 8;
+}
+
+void MemoryArena::set_owner(const std::map<uint16_t, Block>::iterator it,
+                            const uint16_t owner) {
+  it->second.owner = owner;
+  if (owner == 0) {
+    free_blocks.insert(it->first);
+  } else {
+    free_blocks.erase(it->first);
+  }
+  write(it->first, it->second);
+}
+
+void MemoryArena::merge_next(const std::map<uint16_t, Block>::iterator it) {
+  const auto next = std::next(it);
+  if (next == blocks.end() || next->second.owner != 0 ||
+      !matches(next->first, next->second)) {
+    return;
+  }
+
+  it->second.size += next->second.size + 1;
+  free_blocks.erase(next->first);
+  blocks.erase(next);
+  write(it->first, it->second);
+}
+
+void MemoryArena::split(const std::map<uint16_t, Block>::iterator it,
+                        const uint16_t paragraphs) {
+  if (it->second.size <= paragraphs) {
+    return;
+  }
+
+  const uint16_t rest = it->first + paragraphs + 1;
+  const auto rest_it =
+      blocks.emplace(rest, Block{0, static_cast<uint16_t>(
+                                        it->second.size - paragraphs - 1)})
+          .first;
+  free_blocks.insert(rest);
+  it->second.size = paragraphs;
+
+  write(it->first, it->second);
+  write(rest, rest_it->second);
+  merge_next(rest_it);
+}
+
+DosError MemoryArena::try_allocate(const uint16_t paragraphs,
+                                   const uint16_t owner, uint16_t& segment,
+                                   uint16_t& largest) {
+  largest = 0;
+  for (const uint16_t mcb : free_blocks) {
+    const auto it = blocks.find(mcb);
+    if (!matches(mcb, it->second)) {
+      return DosError::ARENA_TRASHED;
+    }
+    if (it->second.size >= paragraphs) {
+      split(it, paragraphs);
+      set_owner(it, owner);
+      segment = mcb + 1;
+      return DosError::NONE;
+    }
+    largest = std::max(largest, it->second.size);
+  }
+  return DosError::NOT_ENOUGH_MEMORY;
+}
+
+DosError MemoryArena::allocate(const uint16_t paragraphs, const uint16_t owner,
+                               uint16_t& segment, uint16_t& largest) {
+  if (!valid && !rebuild()) {
+    return DosError::ARENA_TRASHED;
+  }
+
+  const DosError error = try_allocate(paragraphs, owner, segment, largest);
+  if (error != DosError::ARENA_TRASHED) {
+    return error;
+  }
+  if (!rebuild()) {
+    return DosError::ARENA_TRASHED;
+  }
+  return try_allocate(paragraphs, owner, segment, largest);
+}
+
+DosError MemoryArena::free(const uint16_t segment) {
+  const auto it = find(segment - 1);
+  if (it == blocks.end()) {
+    return valid ? DosError::INVALID_BLOCK : DosError::ARENA_TRASHED;
+  }
+
+  set_owner(it, 0);
+  merge_next(it);
+  if (it != blocks.begin()) {
+    const auto prev = std::prev(it);
+    if (prev->second.owner == 0 && matches(prev->first, prev->second)) {
+      merge_next(prev);
+    }
+  }
+  return DosError::NONE;
+}
+
+DosError MemoryArena::resize(const uint16_t segment, const uint16_t paragraphs,
+                             uint16_t& largest) {
+  auto it = find(segment - 1);
+  if (it == blocks.end()) {
+    return valid ? DosError::INVALID_BLOCK : DosError::ARENA_TRASHED;
+  }
+
+  if (paragraphs <= it->second.size) {
+    split(it, paragraphs);
+    return DosError::NONE;
+  }
+
+  auto next = std::next(it);
+  if (next != blocks.end() && !matches(next->first, next->second)) {
+    if (!rebuild()) {
+      return DosError::ARENA_TRASHED;
+    }
+    it = blocks.find(segment - 1);
+    if (it == blocks.end()) {
+      return DosError::INVALID_BLOCK;
+    }
+    next = std::next(it);
+  }
+
+  uint32_t available = it->second.size;
+  if (next != blocks.end() && next->second.owner == 0) {
+    available += next->second.size + 1;
+  }
+  if (paragraphs > available) {
+    largest = static_cast<uint16_t>(available);
+    return DosError::NOT_ENOUGH_MEMORY;
+  }
+
+  merge_next(it);
+  split(it, paragraphs);
+  return DosError::NONE;
+}
+
+DosError MemoryArena::change_owner(const uint16_t segment,
+                                   const uint16_t owner) {
+  const auto it = find(segment - 1);
+  if (it == blocks.end()) {
+    return valid ? DosError::INVALID_BLOCK : DosError::ARENA_TRASHED;
+  }
+  set_owner(it, owner);
+  return DosError::NONE;
+}
+
+void MemoryArena::free_owned_by(const uint16_t owner) {
+  if (!valid && !rebuild()) {
+    return;
+  }
+
+  // Freeing merges blocks, so collect them first
+  std::vector<uint16_t> owned;
+  for (const auto& [mcb, block] : blocks) {
+    if (block.owner == owner) {
+      owned.push_back(mcb);
+    }
+  }
+  for (const uint16_t mcb : owned) {
+    free(mcb + 1);
+  }
+}
@@ -0,0 +1,85 @@
+#ifndef MEMORYARENA_H
+#define MEMORYARENA_H
+
+#include <cstdint>
+#include <map>
+#include <set>
+#include <vector>
+
+#include "../CPU/Memory.h"
+#include "DosError.h"
+
+/*
+  DOS memory arena: the chain of memory control blocks in guest memory,
+  exactly as DOS lays it out, so programs that walk it themselves see
+  what they expect.
+
+    MCB (one paragraph, right before the block it describes)
+      u8 type ('M', 'Z' on the last one)  u16 owner PSP (0 = free)
+      u16 size in paragraphs  u8 reserved[3]  char name[8]
+
+  The chain in guest memory is the authority. Next to it sits an index
+  of every block and of the free ones, so allocating, resizing and
+  freeing never walk the chain. Every block an operation touches is
+  checked against its MCB first; when the guest changed the chain
+  behind our back the index is rebuilt from it.
+*/
+class MemoryArena {
+ public:
+  // First MCB, above the interrupt table, BIOS and DOS data
+  static constexpr uint16_t FIRST_SEGMENT = 0x0100;
+  // Top of conventional memory, 640 KiB
+  static constexpr uint16_t END_SEGMENT = 0xA000;
+  // Owner DOS puts on blocks it allocates for itself
+  static constexpr uint16_t OWNER_DOS = 0x0008;
+
+  explicit MemoryArena(Memory& memory);
+
+  // A single free block covering the whole arena
+  void format();
+  // Reads the chain back from guest memory, false when it is broken
+  bool rebuild();
+
+  /*
+    segment is the first paragraph of the block, the MCB is right before
+    it. On NOT_ENOUGH_MEMORY largest is the biggest size that would work.
+  */
+  DosError allocate(uint16_t paragraphs, uint16_t owner, uint16_t& segment,
+                    uint16_t& largest);
+  DosError free(uint16_t segment);
+  DosError resize(uint16_t segment, uint16_t paragraphs, uint16_t& largest);
+  DosError change_owner(uint16_t segment, uint16_t owner);
+  // Everything a terminating program leaves behind
+  void free_owned_by(uint16_t owner);
+
+ private:
+  static constexpr uint8_t TYPE_MIDDLE = 'M';
+  static constexpr uint8_t TYPE_LAST = 'Z';
+
+  struct Block {
+    uint16_t owner;
+    uint16_t size;
+  };
+
+  [[nodiscard]] bool matches(uint16_t mcb, const Block& block) const;
+  // Checks mcb, rebuilding the index once if the guest moved things
+  std::map<uint16_t, Block>::iterator find(uint16_t mcb);
+  void write(uint16_t mcb, const Block& block);
+  void set_owner(std::map<uint16_t, Block>::iterator it, uint16_t owner);
+  // Merges the block at it with the free block after it, if there is one
+  void merge_next(std::map<uint16_t, Block>::iterator it);
+  // Cuts a free block of what is past paragraphs off the block at it
+  void split(std::map<uint16_t, Block>::iterator it, uint16_t paragraphs);
+
+  DosError try_allocate(uint16_t paragraphs, uint16_t owner,
+                        uint16_t& segment, uint16_t& largest);
+
+  Memory& memory;
+  // Every block by MCB segment
+  std::map<uint16_t, Block> blocks;
+  // MCB segments of the free blocks, in address order for first fit
+  std::set<uint16_t> free_blocks;
+  bool valid;
+};
+
+#endif  // MEMORYARENA_H
@@ -0,0 +1,87 @@
+#include "ProgramImage.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "../ExecutableFiles/COM.h"
+#include "../ExecutableFiles/MZExe.h"
+#include "../Utils/logger.h"
+
+std::optional<ProgramImage> ProgramImage::from_com(const COM& com) {
+  ProgramImage image;
+  image.load_module = com.buffer;
+  return image;
+}
+
+std::optional<ProgramImage> ProgramImage::from_mz(const MZExe& mz) {
+  const size_t header_size =
+      static_cast<size_t>(mz.NumHeaderParagraphs) * MZExe::PARAGRAPH_SIZE;
+
+  // The last page is only partly used when NumLastPageBytes is not 0
+  size_t image_size = static_cast<size_t>(mz.NumPages) * MZExe::PAGE_SIZE;
+  if (mz.NumLastPageBytes && image_size >= MZExe::PAGE_SIZE) {
+    image_size -= MZExe::PAGE_SIZE - mz.NumLastPageBytes;
+  }
+  image_size = std::min(image_size, mz.buffer.size());
+  if (header_size > image_size) {
+    mylog("MZ header is larger than the file");
+    return std::nullopt;
+  }
+
+  const size_t table_end =
+      mz.RelocationTableOffset + static_cast<size_t>(mz.RelocationItems) * 4;
+  if (table_end > mz.buffer.size()) {
+    mylog("MZ relocation table is past the end of the file");
+    return std::nullopt;
+  }
+
+  ProgramImage image;
+  image.is_exe = true;
+  image.load_module.assign(mz.buffer.begin() + header_size,
+                           mz.buffer.begin() + image_size);
+
+  image.relocations.reserve(mz.RelocationItems);
+  for (size_t pos = mz.RelocationTableOffset; pos < table_end; pos += 4) {
+    image.relocations.push_back(Relocation{
+        static_cast<uint16_t>(mz.buffer[pos] | (mz.buffer[pos + 1] << 8)),
+        static_cast<uint16_t>(mz.buffer[pos + 2] |
+                              (mz.buffer[pos + 3] << 8))});
+  }
+
+  image.min_paragraphs = mz.NumMinParagraphRequired;
+  image.max_paragraphs = mz.NumMaxParagraphRequested;
+  image.initial_CS = mz.InitialCS;
+  image.initial_IP = mz.InitialIP;
+  image.initial_SS = mz.InitialSS;
+  image.initial_SP = mz.InitialSP;
+  return image;
+}
+
+const std::vector<uint8_t>& ProgramImage::relocated(
+    const uint16_t segment) const {
+  if (relocations.empty()) {
+    return load_module;
+  }
+  if (relocated_segment == segment) {
+    return relocated_module;
+  }
+
+  relocated_module = load_module;
+  for (const Relocation& relocation : relocations) {
+    const size_t address =
+        static_cast<size_t>(relocation.segment) * 16 + relocation.offset;
+    // Entries pointing past the module would patch memory we never load
+    if (address + 1 >= relocated_module.size()) {
+      continue;
+    }
+    const uint16_t value = static_cast<uint16_t>(
+        relocated_module[address] | (relocated_module[address + 1] << 8));
+    const uint16_t fixed = value + segment;
+    relocated_module[address] = fixed & 0xFF;
+    relocated_module[address + 1] = fixed >> 8;
+  }
+  relocated_segment = segment;
+  return relocated_module;
+}
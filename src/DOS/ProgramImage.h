@@ -0,0 +1,49 @@
+#ifndef PROGRAMIMAGE_H
+#define PROGRAMIMAGE_H
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "../ExecutableFiles/COM.h"
+#include "../ExecutableFiles/MZExe.h"
+
+/*
+  What loading a program needs from its file, ready to be copied into
+  guest memory: the load module, its relocations and, for an MZ file,
+  the memory requirements and initial registers from the header.
+*/
+class ProgramImage {
+ public:
+  static std::optional<ProgramImage> from_com(const COM& com);
+  static std::optional<ProgramImage> from_mz(const MZExe& mz);
+
+  /*
+    The load module with every relocation applied for a load at
+    segment. The last one is kept, a program that is run again and
+    again usually lands on the same segment.
+  */
+  [[nodiscard]] const std::vector<uint8_t>& relocated(uint16_t segment) const;
+
+  struct Relocation {
+    uint16_t offset;
+    uint16_t segment;
+  };
+
+  bool is_exe{false};
+  std::vector<uint8_t> load_module;
+  std::vector<Relocation> relocations;
+
+  // Paragraphs wanted past the end of the load module
+  uint16_t min_paragraphs{0};
+  uint16_t max_paragraphs{0xFFFF};
+  // Relative to the load segment, MZ only
+  uint16_t initial_CS{0}, initial_IP{0};
+  uint16_t initial_SS{0}, initial_SP{0};
+
+ private:
+  mutable std::vector<uint8_t> relocated_module;
+  mutable std::optional<uint16_t> relocated_segment;
+};
+
+#endif  // PROGRAMIMAGE_H
@@ -0,0 +1,61 @@
+#ifndef BIOSDATAAREA_H
+#define BIOSDATAAREA_H
+
+#include <cstdint>
+
+/*
+  Fields of the BIOS data area at 0040:0000 that the emulated BIOS
+  keeps, as linear addresses. Programs read these directly, so they
+  hold the real state rather than a copy of it.
+*/
+namespace BiosDataArea {
+constexpr uint32_t BASE = 0x400;
+// First byte past the data area, where DOS memory would start
+constexpr uint32_t END = 0x500;
+// u16, bit 0 a floppy drive, bit 1 an FPU, bits 4-5 the first video mode
+constexpr uint32_t EQUIPMENT = 0x410;
+constexpr uint16_t EQUIPMENT_FLOPPY = 0x01;
+constexpr uint16_t EQUIPMENT_FPU = 0x02;
+constexpr uint16_t EQUIPMENT_COLOR_80 = 0x20;
+// u16, conventional memory in KB
+constexpr uint32_t MEMORY_SIZE = 0x413;
+// Shift, Ctrl, Alt and the lock keys
+constexpr uint32_t SHIFT_FLAGS = 0x417;
+// u16 each, offsets from BASE of the next key and of the free slot
+constexpr uint32_t KEYBOARD_HEAD = 0x41A;
+constexpr uint32_t KEYBOARD_TAIL = 0x41C;
+constexpr uint16_t KEYBOARD_BUFFER = 0x1E;
+constexpr uint16_t KEYBOARD_BUFFER_END = 0x3E;
+constexpr uint32_t VIDEO_MODE = 0x449;
+// u16
+constexpr uint32_t COLUMNS = 0x44A;
+// u16, bytes per video page
+constexpr uint32_t PAGE_SIZE = 0x44C;
+// u16, start of the active page in video memory
+constexpr uint32_t PAGE_OFFSET = 0x44E;
+// Column and row for each of the 8 pages
+constexpr uint32_t CURSOR = 0x450;
+constexpr uint8_t PAGES = 8;
+// End scan line, then start scan line
+constexpr uint32_t CURSOR_SHAPE = 0x460;
+constexpr uint32_t ACTIVE_PAGE = 0x462;
+// u16, index port of the CRT controller
+constexpr uint32_t CRTC_PORT = 0x463;
+// u32, IRQ0 ticks since midnight
+constexpr uint32_t TIMER_TICKS = 0x46C;
+constexpr uint32_t TICKS_PER_DAY = 0x1800B0;
+// Set when TIMER_TICKS passes midnight, cleared by INT 1Ah 00h
+constexpr uint32_t TIMER_OVERFLOW = 0x470;
+constexpr uint32_t HARD_DISKS = 0x475;
+// u16 each, where programs may move the keyboard buffer to
+constexpr uint32_t KEYBOARD_START = 0x480;
+constexpr uint32_t KEYBOARD_END = 0x482;
+// Rows minus one, 0 on adapters before the EGA
+constexpr uint32_t LAST_ROW = 0x484;
+// u16, scan lines per character
+constexpr uint32_t CHARACTER_HEIGHT = 0x485;
+// Bit 1, the last scan code was an E0 prefix
+constexpr uint32_t KEYBOARD_STATUS = 0x496;
+}  // namespace BiosDataArea
+
+#endif  // BIOSDATAAREA_H
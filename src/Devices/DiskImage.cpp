@@ -0,0 +1,253 @@
+#include "DiskImage.h"
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "../Utils/logger.h"
+
+#ifdef _WIN32
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+struct FloppyFormat {
+  size_t size;
+  uint16_t cylinders;
+  uint8_t heads;
+  uint8_t sectors;
+  uint8_t type;
+};
+
+constexpr FloppyFormat FLOPPY_FORMATS[] = {
+    {163'840, 40, 1, 8, 1},    {184'320, 40, 1, 9, 1},
+    {327'680, 40, 2, 8, 1},    {368'640, 40, 2, 9, 1},
+    {737'280, 80, 2, 9, 3},    {1'228'800, 80, 2, 15, 2},
+    {1'474'560, 80, 2, 18, 4}, {2'949'120, 80, 2, 36, 6},
+};
+
+// Where the heads and sectors are unknown, what most BIOSes translate to
+constexpr uint16_t DEFAULT_HEADS = 16;
+constexpr uint8_t DEFAULT_SECTORS = 63;
+constexpr uint16_t MAX_CYLINDERS = 1024;
+
+constexpr size_t PARTITION_TABLE = 0x1BE;
+constexpr size_t PARTITION_ENTRY_SIZE = 16;
+constexpr size_t PARTITION_COUNT = 4;
+constexpr size_t BOOT_SIGNATURE = 0x1FE;
+
+bool is_fat_partition(const uint8_t type) {
+  // FAT12, FAT16 below 32 MiB, FAT16, FAT16 with LBA
+  return type == 0x01 || type == 0x04 || type == 0x06 || type == 0x0E;
+}
+
+uint32_t read_u32(const uint8_t* bytes) {
+  return bytes[0] | bytes[1] << 8 | bytes[2] << 16 |
+         static_cast<uint32_t>(bytes[3]) << 24;
+}
+}  // namespace
+
+#ifdef _WIN32
+
+std::unique_ptr<DiskImage> DiskImage::open(const std::string_view path,
+                                           const bool copy_on_write) {
+  const std::string name{path};
+  std::ifstream file(name, std::ios::binary | std::ios::ate);
+  if (!file) {
+    mylog("Cannot open disk image '%s'", name.c_str());
+    return nullptr;
+  }
+  const size_t size = static_cast<size_t>(file.tellg());
+  if (size < SECTOR_SIZE) {
+    mylog("Disk image '%s' is smaller than a sector", name.c_str());
+    return nullptr;
+  }
+
+  std::unique_ptr<DiskImage> image{new DiskImage};
+  image->copy.reset(new uint8_t[size]);
+  file.seekg(0);
+  if (!file.read(reinterpret_cast<char*>(image->copy.get()),
+                 static_cast<std::streamsize>(size))) {
+    mylog("Cannot read disk image '%s'", name.c_str());
+    return nullptr;
+  }
+  image->view = image->copy.get();
+  image->image_size = size;
+  image->file_path = copy_on_write ? std::string{} : name;
+  image->writable =
+      copy_on_write ||
+      static_cast<bool>(std::fstream(name, std::ios::binary | std::ios::in |
+                                               std::ios::out));
+  image->detect_geometry();
+  return image;
+}
+
+DiskImage::~DiskImage() = default;
+
+bool DiskImage::write(const uint32_t lba, const uint32_t count,
+                      const uint8_t* source) {
+  if (!writable || !in_range(lba, count)) {
+    return false;
+  }
+  const size_t offset = static_cast<size_t>(lba) * SECTOR_SIZE;
+  const size_t length = static_cast<size_t>(count) * SECTOR_SIZE;
+  std::memcpy(view + offset, source, length);
+
+  if (!file_path.empty()) {
+    std::fstream file(file_path,
+                      std::ios::binary | std::ios::in | std::ios::out);
+    file.seekp(static_cast<std::streamoff>(offset));
+    if (!file.write(reinterpret_cast<const char*>(source),
+                    static_cast<std::streamsize>(length))) {
+      mylog("Cannot write disk image '%s'", file_path.c_str());
+      return false;
+    }
+  }
+  return true;
+}
+
+#else
+
+std::unique_ptr<DiskImage> DiskImage::open(const std::string_view path,
+                                           const bool copy_on_write) {
+  const std::string name{path};
+
+  // A private mapping never reaches the file, read access is all it needs
+  bool writable = true;
+  int fd = copy_on_write ? ::open(name.c_str(), O_RDONLY | O_CLOEXEC)
+                         : ::open(name.c_str(), O_RDWR | O_CLOEXEC);
+  if (fd < 0 && !copy_on_write) {
+    writable = false;
+    fd = ::open(name.c_str(), O_RDONLY | O_CLOEXEC);
+  }
+  if (fd < 0) {
+    mylog("Cannot open disk image '%s'", name.c_str());
+    return nullptr;
+  }
+
+  struct stat info {};
+  if (fstat(fd, &info) != 0 ||
+      static_cast<size_t>(info.st_size) < SECTOR_SIZE) {
+    mylog("Disk image '%s' is smaller than a sector", name.c_str());
+    close(fd);
+    return nullptr;
+  }
+  const size_t size = static_cast<size_t>(info.st_size);
+
+  const int protection = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+  const int flags = copy_on_write ? MAP_PRIVATE : MAP_SHARED;
+  void* mapping = mmap(nullptr, size, protection, flags, fd, 0);
+  // The mapping keeps its own reference to the file
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    mylog("Cannot map disk image '%s'", name.c_str());
+    return nullptr;
+  }
+
+  std::unique_ptr<DiskImage> image{new DiskImage};
+  image->view = static_cast<uint8_t*>(mapping);
+  image->image_size = size;
+  image->mapping_size = size;
+  image->writable = writable;
+  image->detect_geometry();
+  return image;
+}
+
+DiskImage::~DiskImage() {
+  if (view) {
+    munmap(view, mapping_size);
+  }
+}
+
+bool DiskImage::write(const uint32_t lba, const uint32_t count,
+                      const uint8_t* source) {
+  if (!writable || !in_range(lba, count)) {
+    return false;
+  }
+  std::memcpy(view + static_cast<size_t>(lba) * SECTOR_SIZE, source,
+              static_cast<size_t>(count) * SECTOR_SIZE);
+  return true;
+}
+
+#endif
+
+bool DiskImage::read(const uint32_t lba, const uint32_t count,
+                     uint8_t* destination) const {
+  if (!in_range(lba, count)) {
+    return false;
+  }
+  std::memcpy(destination, view + static_cast<size_t>(lba) * SECTOR_SIZE,
+              static_cast<size_t>(count) * SECTOR_SIZE);
+  return true;
+}
+
+bool DiskImage::to_lba(const uint16_t cylinder, const uint8_t head,
+                       const uint8_t sector, uint32_t& lba) const {
+  // Sectors count from 1
+  if (sector == 0 || sector > track_sectors || head >= head_count) {
+    return false;
+  }
+  lba = (static_cast<uint32_t>(cylinder) * head_count + head) * track_sectors +
+        sector - 1;
+  return lba < sectors_total;
+}
+
+bool DiskImage::in_range(const uint32_t lba, const uint32_t count) const {
+  return lba <= sectors_total && count <= sectors_total - lba;
+}
+
+void DiskImage::detect_geometry() {
+  // A partial sector at the end is not addressable
+  sectors_total = static_cast<uint32_t>(image_size / SECTOR_SIZE);
+
+  for (const FloppyFormat& format : FLOPPY_FORMATS) {
+    if (format.size == image_size) {
+      floppy = true;
+      cylinder_count = format.cylinders;
+      head_count = format.heads;
+      track_sectors = format.sectors;
+      drive_type = format.type;
+      volume_first_sector = 0;
+      return;
+    }
+  }
+
+  head_count = DEFAULT_HEADS;
+  track_sectors = DEFAULT_SECTORS;
+  volume_first_sector = 0;
+
+  const uint8_t* boot = view;
+  if (boot[BOOT_SIGNATURE] == 0x55 && boot[BOOT_SIGNATURE + 1] == 0xAA) {
+    for (size_t i = 0; i < PARTITION_COUNT; i++) {
+      const uint8_t* entry = boot + PARTITION_TABLE + i * PARTITION_ENTRY_SIZE;
+      const uint32_t start = read_u32(entry + 8);
+      if (!is_fat_partition(entry[4]) || start == 0 ||
+          start >= sectors_total) {
+        continue;
+      }
+
+      // Ending CHS of the partition tells the geometry it was made for
+      const uint8_t end_head = entry[5];
+      const uint8_t end_sector = entry[6] & 0x3F;
+      if (end_sector != 0) {
+        head_count = static_cast<uint16_t>(end_head + 1);
+        track_sectors = end_sector;
+      }
+      volume_first_sector = start;
+      break;
+    }
+  }
+
+  const uint32_t cylinders =
+      sectors_total / (static_cast<uint32_t>(head_count) * track_sectors);
+  cylinder_count = static_cast<uint16_t>(
+      cylinders > MAX_CYLINDERS ? MAX_CYLINDERS : cylinders == 0 ? 1
+                                                                 : cylinders);
+}
@@ -0,0 +1,78 @@
+#ifndef DISKIMAGE_H
+#define DISKIMAGE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+/*
+  Floppy or hard disk image file, mapped into the host address space so
+  a transfer of any number of sectors is a single memcpy between the
+  mapping and guest memory.
+
+  With copy_on_write the mapping is private: the guest can write to it,
+  but the changes only live in memory and the file is never modified.
+  Otherwise writes go through to the file, or fail when it is read-only.
+
+  Geometry comes from the size for the standard floppy formats. Anything
+  else is a hard disk, its heads and sectors per track taken from the
+  partition table when it has one.
+*/
+class DiskImage {
+ public:
+  constexpr static size_t SECTOR_SIZE = 512;
+
+  static std::unique_ptr<DiskImage> open(std::string_view path,
+                                         bool copy_on_write);
+  ~DiskImage();
+  DiskImage(const DiskImage&) = delete;
+  DiskImage& operator=(const DiskImage&) = delete;
+
+  [[nodiscard]] bool is_floppy() const { return floppy; }
+  [[nodiscard]] bool is_writable() const { return writable; }
+  [[nodiscard]] uint32_t sector_count() const { return sectors_total; }
+  [[nodiscard]] uint16_t cylinders() const { return cylinder_count; }
+  [[nodiscard]] uint16_t heads() const { return head_count; }
+  [[nodiscard]] uint8_t sectors_per_track() const { return track_sectors; }
+  // First sector of the FAT volume DOS sees, 0 on a floppy
+  [[nodiscard]] uint32_t volume_start() const { return volume_first_sector; }
+  // BIOS floppy type for INT 13h 08h, 0 for hard disks
+  [[nodiscard]] uint8_t floppy_type() const { return drive_type; }
+
+  // Sector number of a CHS address, false when it is off the disk
+  bool to_lba(uint16_t cylinder, uint8_t head, uint8_t sector,
+              uint32_t& lba) const;
+
+  // False when any of the sectors is past the end, nothing is copied then
+  bool read(uint32_t lba, uint32_t count, uint8_t* destination) const;
+  bool write(uint32_t lba, uint32_t count, const uint8_t* source);
+
+ private:
+  DiskImage() = default;
+
+  bool in_range(uint32_t lba, uint32_t count) const;
+  void detect_geometry();
+
+  uint8_t* view{nullptr};
+  size_t image_size{0};
+  bool writable{false};
+#ifdef _WIN32
+  // Without mmap the image is read whole, written back sector by sector
+  std::unique_ptr<uint8_t[]> copy;
+  std::string file_path;
+#else
+  size_t mapping_size{0};
+#endif
+
+  bool floppy{false};
+  uint32_t sectors_total{0};
+  uint16_t cylinder_count{0};
+  uint16_t head_count{0};
+  uint8_t track_sectors{0};
+  uint32_t volume_first_sector{0};
+  uint8_t drive_type{0};
+};
+
+#endif  // DISKIMAGE_H
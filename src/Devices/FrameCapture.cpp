@@ -0,0 +1,64 @@
+#include "FrameCapture.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "../Utils/PngWriter.h"
+#include "../Utils/logger.h"
+#include "Framebuffer.h"
+
+std::unique_ptr<FrameCapture> FrameCapture::open(
+    const std::string_view png_prefix, const std::string_view raw_path) {
+  std::unique_ptr<FrameCapture> capture{new FrameCapture};
+  capture->png_prefix = png_prefix;
+  if (!raw_path.empty()) {
+    capture->raw = std::fopen(std::string{raw_path}.c_str(), "wb");
+    if (!capture->raw) {
+      mylog("Cannot open '%s'", std::string{raw_path}.c_str());
+      return nullptr;
+    }
+  }
+  return capture;
+}
+
+FrameCapture::~FrameCapture() {
+  if (raw) {
+    std::fclose(raw);
+  }
+}
+
+void FrameCapture::capture(Framebuffer& framebuffer) {
+  const uint32_t number = interval++;
+  bool changed = false;
+  if (!framebuffer.update(changed)) {
+    return;
+  }
+
+  if (!png_prefix.empty() && changed) {
+    char name[16];
+    std::snprintf(name, sizeof(name), "%06u.png", number);
+    write_png(png_prefix + name, framebuffer.rgb(), framebuffer.width(),
+              framebuffer.height());
+  }
+
+  if (raw) {
+    if (!raw_width) {
+      raw_width = framebuffer.width();
+      raw_height = framebuffer.height();
+      mylog("Raw video is %ux%u RGB24", raw_width, raw_height);
+    }
+    if (framebuffer.width() != raw_width ||
+        framebuffer.height() != raw_height) {
+      return;
+    }
+    const size_t size = static_cast<size_t>(raw_width) * raw_height * 3;
+    if (std::fwrite(framebuffer.rgb(), 1, size, raw) != size) {
+      mylog("Cannot write raw video");
+      std::fclose(raw);
+      raw = nullptr;
+    }
+  }
+}
@@ -0,0 +1,42 @@
+#ifndef FRAMECAPTURE_H
+#define FRAMECAPTURE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "Framebuffer.h"
+
+/*
+  Writes the graphics screen to disk once per capture interval, for
+  regression tests that run without a display.
+
+  PNG frames go to <prefix>NNNNNN.png, numbered by interval so gaps show
+  where nothing changed; only frames that differ from the previous one
+  are written. The raw stream gets every frame as packed RGB24, the size
+  of the first frame captured; frames of another size are skipped.
+  Nothing is written while the screen is in a text mode.
+*/
+class FrameCapture {
+ public:
+  static std::unique_ptr<FrameCapture> open(std::string_view png_prefix,
+                                            std::string_view raw_path);
+  ~FrameCapture();
+  FrameCapture(const FrameCapture&) = delete;
+  FrameCapture& operator=(const FrameCapture&) = delete;
+
+  void capture(Framebuffer& framebuffer);
+
+ private:
+  FrameCapture() = default;
+
+  std::string png_prefix;
+  std::FILE* raw{nullptr};
+  uint16_t raw_width{0};
+  uint16_t raw_height{0};
+  uint32_t interval{0};
+};
+
+#endif  // FRAMECAPTURE_H
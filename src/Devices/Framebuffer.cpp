@@ -0,0 +1,580 @@
+#include "Framebuffer.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "../CPU/Memory.h"
+#include "BiosDataArea.h"
+
+namespace {
+constexpr Framebuffer::Mode MODES[] = {
+    {0x04, 320, 200, Framebuffer::Layout::CGA_2BPP},
+    {0x05, 320, 200, Framebuffer::Layout::CGA_2BPP},
+    {0x06, 640, 200, Framebuffer::Layout::CGA_1BPP},
+    {0x0D, 320, 200, Framebuffer::Layout::PLANAR},
+    {0x0E, 640, 200, Framebuffer::Layout::PLANAR},
+    {0x10, 640, 350, Framebuffer::Layout::PLANAR},
+    {0x12, 640, 480, Framebuffer::Layout::PLANAR},
+    {0x13, 320, 200, Framebuffer::Layout::LINEAR},
+};
+
+constexpr uint32_t GRAPHICS_WINDOW = 0xA0000;
+constexpr uint32_t CGA_WINDOW = 0xB8000;
+// Odd scanlines of CGA modes start 8K into the buffer
+constexpr uint32_t CGA_ODD_LINES = 0x2000;
+constexpr uint32_t CGA_BYTES_PER_LINE = 80;
+
+// What the BIOS loads, rgbRGB colours giving the 16 CGA ones
+constexpr uint8_t DEFAULT_PALETTE[16] = {0x00, 0x01, 0x02, 0x03, 0x04, 0x05,
+                                         0x14, 0x07, 0x38, 0x39, 0x3A, 0x3B,
+                                         0x3C, 0x3D, 0x3E, 0x3F};
+// Colour select after a mode set: intensity on, black background
+constexpr uint8_t CGA_DEFAULT_BACKGROUND = 0x10;
+constexpr uint8_t CGA_INTENSITY = 0x10;
+constexpr uint8_t CGA_WHITE = 15;
+
+// VGA default palette, 16 to 31 grey ramp, then 24 hues at 3 intensities
+// and 3 saturations, each from the five levels of its row
+constexpr uint8_t GREYS[16] = {0,  5,  8,  11, 14, 17, 20, 24,
+                               28, 32, 36, 40, 45, 50, 56, 63};
+constexpr uint8_t HUE_LEVELS[9][5] = {
+    {0, 16, 31, 47, 63},  {31, 39, 47, 55, 63}, {45, 49, 54, 58, 63},
+    {0, 7, 14, 21, 28},   {14, 17, 21, 24, 28}, {20, 22, 24, 26, 28},
+    {0, 4, 8, 12, 16},    {8, 10, 12, 14, 16},  {11, 12, 13, 15, 16},
+};
+// Level of red, green and blue around the colour wheel, from blue
+constexpr uint8_t HUE_WHEEL[24][3] = {
+    {0, 0, 4}, {1, 0, 4}, {2, 0, 4}, {3, 0, 4}, {4, 0, 4}, {4, 0, 3},
+    {4, 0, 2}, {4, 0, 1}, {4, 0, 0}, {4, 1, 0}, {4, 2, 0}, {4, 3, 0},
+    {4, 4, 0}, {3, 4, 0}, {2, 4, 0}, {1, 4, 0}, {0, 4, 0}, {0, 4, 1},
+    {0, 4, 2}, {0, 4, 3}, {0, 4, 4}, {0, 3, 4}, {0, 2, 4}, {0, 1, 4},
+};
+
+std::array<uint8_t, 3> ega_colour(const uint8_t value) {
+  return {static_cast<uint8_t>((value >> 2 & 1) * 0xAA + (value >> 5 & 1) * 0x55),
+          static_cast<uint8_t>((value >> 1 & 1) * 0xAA + (value >> 4 & 1) * 0x55),
+          static_cast<uint8_t>((value & 1) * 0xAA + (value >> 3 & 1) * 0x55)};
+}
+
+std::array<uint8_t, 3> cga_colour(const uint8_t index) {
+  return ega_colour(DEFAULT_PALETTE[index & 0x0F]);
+}
+
+// 6-bit DAC level to 8 bits, 63 becomes 255
+uint8_t dac_level(const uint8_t value) {
+  return static_cast<uint8_t>(value << 2 | value >> 4);
+}
+
+std::array<std::array<uint8_t, 3>, 256> default_dac() {
+  std::array<std::array<uint8_t, 3>, 256> dac{};
+  for (int i = 0; i < 16; i++) {
+    // Back from 8 to 6 bits
+    for (int channel = 0; channel < 3; channel++) {
+      dac[i][channel] = cga_colour(i)[channel] >> 2;
+    }
+  }
+  for (int i = 0; i < 16; i++) {
+    dac[16 + i] = {GREYS[i], GREYS[i], GREYS[i]};
+  }
+  for (int group = 0; group < 9; group++) {
+    for (int hue = 0; hue < 24; hue++) {
+      for (int channel = 0; channel < 3; channel++) {
+        dac[32 + group * 24 + hue][channel] =
+            HUE_LEVELS[group][HUE_WHEEL[hue][channel]];
+      }
+    }
+  }
+  // 248 to 255 stay black
+  return dac;
+}
+}  // namespace
+
+Framebuffer::Framebuffer(Memory& memory)
+    : memory(memory),
+      mode(nullptr),
+      all_dirty(true),
+      dac(default_dac()),
+      dac_read_index(0),
+      dac_write_index(0),
+      dac_channel(0),
+      dac_staged{},
+      dac_reading(false),
+      palette_registers{},
+      cga_background(CGA_DEFAULT_BACKGROUND),
+      cga_palette(1),
+      colours{},
+      colours_stale(true) {
+  std::memcpy(palette_registers.data(), DEFAULT_PALETTE,
+              sizeof(DEFAULT_PALETTE));
+}
+
+bool Framebuffer::is_graphics(const uint8_t number) {
+  for (const Mode& candidate : MODES) {
+    if (candidate.number == number) {
+      return true;
+    }
+  }
+  return false;
+}
+
+const Framebuffer::Mode* Framebuffer::current_mode() const {
+  const uint8_t number = memory[BiosDataArea::VIDEO_MODE];
+  for (const Mode& candidate : MODES) {
+    if (candidate.number == number) {
+      return &candidate;
+    }
+  }
+  return nullptr;
+}
+
+uint16_t Framebuffer::width() const { return mode ? mode->width : 0; }
+
+uint16_t Framebuffer::height() const { return mode ? mode->height : 0; }
+
+uint32_t Framebuffer::bytes_per_line() const {
+  switch (mode->layout) {
+    case Layout::LINEAR:
+      return mode->width;
+    case Layout::PLANAR:
+      return mode->width / 8;
+    default:
+      return CGA_BYTES_PER_LINE;
+  }
+}
+
+uint8_t* Framebuffer::line_memory(const uint16_t y) {
+  if (mode->layout == Layout::LINEAR) {
+    return memory.data() + GRAPHICS_WINDOW + y * bytes_per_line();
+  }
+  return memory.data() + CGA_WINDOW + (y & 1) * CGA_ODD_LINES +
+         (y >> 1) * CGA_BYTES_PER_LINE;
+}
+
+void Framebuffer::reset(const uint8_t number) {
+  dac = default_dac();
+  std::memcpy(palette_registers.data(), DEFAULT_PALETTE,
+              sizeof(DEFAULT_PALETTE));
+  cga_background = number == 0x06 ? CGA_WHITE : CGA_DEFAULT_BACKGROUND;
+  cga_palette = 1;
+  colours_stale = true;
+  // Sizes follow on the next update
+  mode = nullptr;
+  for (std::vector<uint8_t>& plane : planes) {
+    plane.clear();
+  }
+  window_shadow.clear();
+}
+
+bool Framebuffer::update(bool& changed) {
+  changed = false;
+  const Mode* now = current_mode();
+  if (!now) {
+    return false;
+  }
+
+  if (now != mode) {
+    mode = now;
+    const uint32_t plane_size = bytes_per_line() * mode->height;
+    const uint32_t line_size =
+        bytes_per_line() * (mode->layout == Layout::PLANAR ? 4 : 1);
+    image.assign(static_cast<size_t>(mode->width) * mode->height * 3, 0);
+    shadow.assign(static_cast<size_t>(line_size) * mode->height, 0);
+    if (mode->layout == Layout::PLANAR && window_shadow.size() != plane_size) {
+      for (std::vector<uint8_t>& plane : planes) {
+        plane.assign(plane_size, 0);
+      }
+      window_shadow.assign(plane_size, 0);
+    }
+    colours_stale = true;
+  }
+  if (colours_stale) {
+    build_colours();
+    colours_stale = false;
+    all_dirty = true;
+  }
+  if (mode->layout == Layout::PLANAR) {
+    absorb_window();
+  }
+
+  for (uint16_t y = 0; y < mode->height; y++) {
+    if (line_changed(y) || all_dirty) {
+      convert_line(y);
+      changed = true;
+    }
+  }
+  all_dirty = false;
+  return true;
+}
+
+bool Framebuffer::line_changed(const uint16_t y) {
+  const uint32_t size = bytes_per_line();
+  if (mode->layout != Layout::PLANAR) {
+    uint8_t* seen = shadow.data() + y * size;
+    const uint8_t* line = line_memory(y);
+    if (std::memcmp(line, seen, size) == 0) {
+      return false;
+    }
+    std::memcpy(seen, line, size);
+    return true;
+  }
+
+  bool changed = false;
+  for (int plane = 0; plane < 4; plane++) {
+    uint8_t* seen = shadow.data() + (y * 4 + plane) * size;
+    const uint8_t* line = planes[plane].data() + y * size;
+    if (std::memcmp(line, seen, size) != 0) {
+      std::memcpy(seen, line, size);
+      changed = true;
+    }
+  }
+  return changed;
+}
+
+void Framebuffer::convert_line(const uint16_t y) {
+  uint8_t* out = image.data() + static_cast<size_t>(y) * mode->width * 3;
+  const auto put = [&out, this](const uint8_t colour) {
+    std::memcpy(out, colours[colour].data(), 3);
+    out += 3;
+  };
+  const uint32_t size = bytes_per_line();
+
+  switch (mode->layout) {
+    case Layout::LINEAR: {
+      const uint8_t* line = line_memory(y);
+      for (uint32_t x = 0; x < size; x++) {
+        put(line[x]);
+      }
+      break;
+    }
+    case Layout::CGA_2BPP: {
+      const uint8_t* line = line_memory(y);
+      for (uint32_t i = 0; i < size; i++) {
+        for (int shift = 6; shift >= 0; shift -= 2) {
+          put(line[i] >> shift & 3);
+        }
+      }
+      break;
+    }
+    case Layout::CGA_1BPP: {
+      const uint8_t* line = line_memory(y);
+      for (uint32_t i = 0; i < size; i++) {
+        for (int shift = 7; shift >= 0; shift--) {
+          put(line[i] >> shift & 1);
+        }
+      }
+      break;
+    }
+    case Layout::PLANAR: {
+      const uint32_t start = y * size;
+      for (uint32_t i = start; i < start + size; i++) {
+        for (int shift = 7; shift >= 0; shift--) {
+          put(static_cast<uint8_t>(
+              (planes[0][i] >> shift & 1) | (planes[1][i] >> shift & 1) << 1 |
+              (planes[2][i] >> shift & 1) << 2 |
+              (planes[3][i] >> shift & 1) << 3));
+        }
+      }
+      break;
+    }
+  }
+}
+
+void Framebuffer::build_colours() {
+  switch (mode->layout) {
+    case Layout::LINEAR: {
+      for (int i = 0; i < 256; i++) {
+        colours[i] = {dac_level(dac[i][0]), dac_level(dac[i][1]),
+                      dac_level(dac[i][2])};
+      }
+      break;
+    }
+    case Layout::CGA_2BPP: {
+      // Mode 05h has the colour burst off, cyan, red and white on RGB
+      static constexpr uint8_t SETS[3][3] = {{2, 4, 6}, {3, 5, 7}, {3, 4, 7}};
+      const uint8_t* set = SETS[mode->number == 0x05 ? 2 : cga_palette & 1];
+      const uint8_t intensity = cga_background & CGA_INTENSITY ? 8 : 0;
+      colours[0] = cga_colour(cga_background);
+      for (int i = 0; i < 3; i++) {
+        colours[i + 1] = cga_colour(set[i] | intensity);
+      }
+      break;
+    }
+    case Layout::CGA_1BPP: {
+      colours[0] = cga_colour(0);
+      colours[1] = cga_colour(cga_background);
+      break;
+    }
+    case Layout::PLANAR: {
+      for (int i = 0; i < 16; i++) {
+        colours[i] = ega_colour(palette_registers[i]);
+      }
+      break;
+    }
+  }
+}
+
+void Framebuffer::absorb_window_byte(const uint32_t offset) {
+  const uint8_t value = memory[GRAPHICS_WINDOW + offset];
+  if (value == window_shadow[offset]) {
+    return;
+  }
+  for (std::vector<uint8_t>& plane : planes) {
+    plane[offset] = value;
+  }
+  window_shadow[offset] = value;
+}
+
+void Framebuffer::absorb_window() {
+  const uint8_t* window = memory.data() + GRAPHICS_WINDOW;
+  const uint32_t size = static_cast<uint32_t>(window_shadow.size());
+  constexpr uint32_t BLOCK = 64;
+  for (uint32_t start = 0; start < size; start += BLOCK) {
+    const uint32_t length = size - start < BLOCK ? size - start : BLOCK;
+    if (std::memcmp(window + start, window_shadow.data() + start, length) ==
+        0) {
+      continue;
+    }
+    for (uint32_t offset = start; offset < start + length; offset++) {
+      absorb_window_byte(offset);
+    }
+  }
+}
+
+void Framebuffer::write_pixel(const uint16_t x, const uint16_t y,
+                              const uint8_t colour) {
+  const Mode* now = current_mode();
+  if (!now || x >= now->width || y >= now->height) {
+    return;
+  }
+  if (now != mode) {
+    bool changed;
+    update(changed);
+  }
+  const bool exclusive_or = colour & 0x80;
+
+  switch (mode->layout) {
+    case Layout::LINEAR: {
+      // All 8 bits are colour
+      line_memory(y)[x] = colour;
+      break;
+    }
+    case Layout::CGA_2BPP: {
+      uint8_t& byte = line_memory(y)[x / 4];
+      const int shift = (3 - x % 4) * 2;
+      if (!exclusive_or) {
+        byte &= ~(3 << shift);
+      }
+      byte ^= (colour & 3) << shift;
+      break;
+    }
+    case Layout::CGA_1BPP: {
+      uint8_t& byte = line_memory(y)[x / 8];
+      const int shift = 7 - x % 8;
+      if (!exclusive_or) {
+        byte &= ~(1 << shift);
+      }
+      byte ^= (colour & 1) << shift;
+      break;
+    }
+    case Layout::PLANAR: {
+      const uint32_t offset = y * bytes_per_line() + x / 8;
+      absorb_window_byte(offset);
+      const uint8_t bit = 0x80 >> (x % 8);
+      for (int plane = 0; plane < 4; plane++) {
+        uint8_t& byte = planes[plane][offset];
+        if (!exclusive_or) {
+          byte &= ~bit;
+        }
+        if (colour >> plane & 1) {
+          byte ^= bit;
+        }
+      }
+      memory[GRAPHICS_WINDOW + offset] = planes[0][offset];
+      window_shadow[offset] = planes[0][offset];
+      break;
+    }
+  }
+}
+
+uint8_t Framebuffer::read_pixel(const uint16_t x, const uint16_t y) {
+  const Mode* now = current_mode();
+  if (!now || x >= now->width || y >= now->height) {
+    return 0;
+  }
+  if (now != mode) {
+    bool changed;
+    update(changed);
+  }
+
+  switch (mode->layout) {
+    case Layout::LINEAR:
+      return line_memory(y)[x];
+    case Layout::CGA_2BPP:
+      return line_memory(y)[x / 4] >> (3 - x % 4) * 2 & 3;
+    case Layout::CGA_1BPP:
+      return line_memory(y)[x / 8] >> (7 - x % 8) & 1;
+    case Layout::PLANAR: {
+      const uint32_t offset = y * bytes_per_line() + x / 8;
+      absorb_window_byte(offset);
+      const int shift = 7 - x % 8;
+      uint8_t colour = 0;
+      for (int plane = 0; plane < 4; plane++) {
+        colour |= (planes[plane][offset] >> shift & 1) << plane;
+      }
+      return colour;
+    }
+  }
+  return 0;
+}
+
+void Framebuffer::set_dac(const uint8_t index, const uint8_t red,
+                          const uint8_t green, const uint8_t blue) {
+  dac[index] = {static_cast<uint8_t>(red & 0x3F),
+                static_cast<uint8_t>(green & 0x3F),
+                static_cast<uint8_t>(blue & 0x3F)};
+  colours_stale = true;
+}
+
+void Framebuffer::get_dac(const uint8_t index, uint8_t& red, uint8_t& green,
+                          uint8_t& blue) const {
+  red = dac[index][0];
+  green = dac[index][1];
+  blue = dac[index][2];
+}
+
+uint8_t Framebuffer::read_dac_port(const uint16_t port) {
+  switch (port) {
+    case 0x3C7:
+      return dac_reading ? 0x03 : 0x00;
+    case 0x3C8:
+      return dac_write_index;
+    case 0x3C9: {
+      const uint8_t value = dac[dac_read_index][dac_channel];
+      if (++dac_channel == 3) {
+        dac_channel = 0;
+        dac_read_index++;
+      }
+      return value;
+    }
+    default:
+      // Pixel mask, every bit passes
+      return 0xFF;
+  }
+}
+
+void Framebuffer::write_dac_port(const uint16_t port, const uint8_t value) {
+  switch (port) {
+    case 0x3C7:
+      dac_read_index = value;
+      dac_channel = 0;
+      dac_reading = true;
+      break;
+    case 0x3C8:
+      dac_write_index = value;
+      dac_channel = 0;
+      dac_reading = false;
+      break;
+    case 0x3C9:
+      dac_staged[dac_channel] = value;
+      if (++dac_channel == 3) {
+        dac_channel = 0;
+        set_dac(dac_write_index++, dac_staged[0], dac_staged[1],
+                dac_staged[2]);
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+void Framebuffer::set_palette_register(const uint8_t index,
+                                       const uint8_t value) {
+  palette_registers[index & 0x0F] = value & 0x3F;
+  colours_stale = true;
+}
+
+uint8_t Framebuffer::palette_register(const uint8_t index) const {
+  return palette_registers[index & 0x0F];
+}
+
+void Framebuffer::set_cga_background(const uint8_t colour) {
+  cga_background = colour & 0x1F;
+  colours_stale = true;
+}
+
+void Framebuffer::set_cga_palette(const uint8_t palette) {
+  cga_palette = palette & 1;
+  colours_stale = true;
+}
+
+/*
+  u8 version, DAC 256 x RGB, u8 read index, write index, channel, staged
+  RGB, reading, 16 palette registers, u8 CGA background and palette, u32
+  plane size, then planes 0 to 3 and the window shadow
+*/
+void Framebuffer::save_state(std::vector<uint8_t>& out) const {
+  out.push_back(STATE_VERSION);
+  for (const std::array<uint8_t, 3>& entry : dac) {
+    out.insert(out.end(), entry.begin(), entry.end());
+  }
+  out.insert(out.end(), {dac_read_index, dac_write_index, dac_channel});
+  out.insert(out.end(), dac_staged.begin(), dac_staged.end());
+  out.push_back(dac_reading);
+  out.insert(out.end(), palette_registers.begin(), palette_registers.end());
+  out.push_back(cga_background);
+  out.push_back(cga_palette);
+  const uint32_t plane_size = static_cast<uint32_t>(window_shadow.size());
+  for (int shift = 0; shift < 32; shift += 8) {
+    out.push_back(static_cast<uint8_t>(plane_size >> shift));
+  }
+  for (const std::vector<uint8_t>& plane : planes) {
+    out.insert(out.end(), plane.begin(), plane.end());
+  }
+  out.insert(out.end(), window_shadow.begin(), window_shadow.end());
+}
+
+bool Framebuffer::load_state(const uint8_t* in, const size_t length) {
+  constexpr size_t FIXED_SIZE = 1 + 256 * 3 + 7 + 16 + 2 + 4;
+  if (length < FIXED_SIZE || in[0] != STATE_VERSION) {
+    return false;
+  }
+  const uint8_t* end = in + length;
+  in++;
+  for (std::array<uint8_t, 3>& entry : dac) {
+    for (uint8_t& level : entry) {
+      level = *in++ & 0x3F;
+    }
+  }
+  dac_read_index = *in++;
+  dac_write_index = *in++;
+  dac_channel = *in++ % 3;
+  for (uint8_t& value : dac_staged) {
+    value = *in++;
+  }
+  dac_reading = *in++;
+  for (uint8_t& value : palette_registers) {
+    value = *in++ & 0x3F;
+  }
+  cga_background = *in++ & 0x1F;
+  cga_palette = *in++ & 1;
+  const uint32_t plane_size =
+      in[0] | in[1] << 8 | in[2] << 16 | static_cast<uint32_t>(in[3]) << 24;
+  in += 4;
+  if (static_cast<size_t>(end - in) < static_cast<size_t>(plane_size) * 5) {
+    return false;
+  }
+  for (std::vector<uint8_t>& plane : planes) {
+    plane.assign(in, in + plane_size);
+    in += plane_size;
+  }
+  window_shadow.assign(in, in + plane_size);
+
+  // Sizes and colours follow on the next update, the planes are kept
+  mode = nullptr;
+  colours_stale = true;
+  all_dirty = true;
+  return true;
+}
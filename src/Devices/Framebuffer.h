@@ -0,0 +1,120 @@
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "../CPU/Memory.h"
+
+/*
+  Graphics modes converted to a 24-bit RGB image, with no display
+  attached: 320x200 256 colours (13h), CGA 320x200x4 (04h/05h) and
+  640x200x2 (06h), EGA/VGA 16 colours (0Dh, 0Eh, 10h, 12h).
+
+  Each conversion compares the video memory behind every scanline with
+  a shadow of what was converted last time and only redoes the lines
+  that differ, through a lookup table from colour number to RGB that is
+  rebuilt when the palette changes.
+
+  EGA memory is four planes behind one address window. There is no
+  graphics controller to route CPU stores, so the planes are kept here
+  and the window in guest memory holds plane 0, what a read with the
+  default read map returns. A store to the window is found by comparing
+  it with its own shadow and goes to all four planes, as with the
+  default map mask. BIOS pixel writes set each plane separately.
+*/
+class Framebuffer {
+ public:
+  explicit Framebuffer(Memory& memory);
+
+  // Default palette and blank planes for a mode the BIOS just set
+  void reset(uint8_t mode);
+  [[nodiscard]] static bool is_graphics(uint8_t mode);
+
+  /*
+    Converts what changed since the last call. False in text modes,
+    changed tells whether the image differs from the previous one.
+  */
+  bool update(bool& changed);
+  [[nodiscard]] const uint8_t* rgb() const { return image.data(); }
+  [[nodiscard]] uint16_t width() const;
+  [[nodiscard]] uint16_t height() const;
+
+  // INT 10h 0Ch and 0Dh. Bit 7 of colour XORs it in
+  void write_pixel(uint16_t x, uint16_t y, uint8_t colour);
+  [[nodiscard]] uint8_t read_pixel(uint16_t x, uint16_t y);
+
+  // VGA DAC, 6 bits per channel
+  void set_dac(uint8_t index, uint8_t red, uint8_t green, uint8_t blue);
+  void get_dac(uint8_t index, uint8_t& red, uint8_t& green,
+               uint8_t& blue) const;
+  /*
+    DAC ports: 3C6h pixel mask, 3C7h read index (reads back the state),
+    3C8h write index, 3C9h red, green, blue of one entry after another
+  */
+  uint8_t read_dac_port(uint16_t port);
+  void write_dac_port(uint16_t port, uint8_t value);
+  constexpr static uint16_t DAC_FIRST_PORT = 0x3C6;
+  constexpr static uint16_t DAC_LAST_PORT = 0x3C9;
+  // EGA palette registers, rgbRGB colours out of 64
+  void set_palette_register(uint8_t index, uint8_t value);
+  [[nodiscard]] uint8_t palette_register(uint8_t index) const;
+  // CGA colour select: background (or mode 06h foreground), palette 0/1
+  void set_cga_background(uint8_t colour);
+  void set_cga_palette(uint8_t palette);
+
+  /*
+    For snapshots: DAC and its port state, palette registers, CGA colour
+    select and the EGA planes. load_state is false on a malformed image
+  */
+  void save_state(std::vector<uint8_t>& out) const;
+  bool load_state(const uint8_t* in, size_t length);
+  constexpr static uint8_t STATE_VERSION = 1;
+
+  enum class Layout { LINEAR, CGA_2BPP, CGA_1BPP, PLANAR };
+  struct Mode {
+    uint8_t number;
+    uint16_t width;
+    uint16_t height;
+    Layout layout;
+  };
+
+ private:
+  [[nodiscard]] const Mode* current_mode() const;
+  [[nodiscard]] uint32_t bytes_per_line() const;
+  uint8_t* line_memory(uint16_t y);
+  void absorb_window_byte(uint32_t offset);
+  void absorb_window();
+  bool line_changed(uint16_t y);
+  void convert_line(uint16_t y);
+  void build_colours();
+
+  Memory& memory;
+  const Mode* mode;
+
+  std::vector<uint8_t> image;
+  // Source bytes of every line as last converted, planes one after another
+  std::vector<uint8_t> shadow;
+  bool all_dirty;
+
+  std::array<std::array<uint8_t, 3>, 256> dac;
+  uint8_t dac_read_index;
+  uint8_t dac_write_index;
+  // Channel the next data port access is for, and the entry being written
+  uint8_t dac_channel;
+  std::array<uint8_t, 3> dac_staged;
+  bool dac_reading;
+  std::array<uint8_t, 16> palette_registers;
+  uint8_t cga_background;
+  uint8_t cga_palette;
+  // Colour number to RGB for the current mode and palette
+  std::array<std::array<uint8_t, 3>, 256> colours;
+  bool colours_stale;
+
+  std::array<std::vector<uint8_t>, 4> planes;
+  std::vector<uint8_t> window_shadow;
+};
+
+#endif  // FRAMEBUFFER_H
@@ -0,0 +1,245 @@
+#include "IntervalTimer.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace {
+uint16_t to_bcd(uint32_t value) {
+  uint16_t bcd = 0;
+  for (int shift = 0; shift < 16; shift += 4) {
+    bcd |= static_cast<uint16_t>(value % 10 << shift);
+    value /= 10;
+  }
+  return bcd;
+}
+
+uint32_t from_bcd(const uint16_t bcd) {
+  return (bcd >> 12 & 0xF) * 1000 + (bcd >> 8 & 0xF) * 100 +
+         (bcd >> 4 & 0xF) * 10 + (bcd & 0xF);
+}
+
+void put(uint8_t* out, const uint64_t value, const size_t bytes) {
+  for (size_t i = 0; i < bytes; i++) {
+    out[i] = static_cast<uint8_t>(value >> (i * 8));
+  }
+}
+
+uint64_t get(const uint8_t* in, const size_t bytes) {
+  uint64_t value = 0;
+  for (size_t i = 0; i < bytes; i++) {
+    value |= static_cast<uint64_t>(in[i]) << (i * 8);
+  }
+  return value;
+}
+
+// Control word fields
+constexpr uint8_t READ_BACK = 3;
+constexpr uint8_t LATCH = 0;
+constexpr uint8_t LOW_BYTE = 1;
+constexpr uint8_t HIGH_BYTE = 2;
+}  // namespace
+
+IntervalTimer::IntervalTimer() : channels{}, irq_due(NEVER) { reset(0); }
+
+void IntervalTimer::reset(const uint64_t now) {
+  // 18.2 Hz time of day tick, 15 us refresh, 896 Hz beep
+  constexpr uint8_t MODES[3] = {3, 2, 3};
+  constexpr uint8_t ACCESS[3] = {3, LOW_BYTE, 3};
+  constexpr uint16_t RELOAD[3] = {0, 18, 0x0533};
+  for (size_t i = 0; i < channels.size(); i++) {
+    channels[i] = Channel{MODES[i], ACCESS[i], false, RELOAD[i], now,
+                          false, false, false, false, 0, 0};
+  }
+  schedule_irq(now);
+}
+
+uint32_t IntervalTimer::period(const Channel& channel) {
+  if (channel.bcd) {
+    const uint32_t reload = from_bcd(channel.reload);
+    return reload ? reload : 10000;
+  }
+  return channel.reload ? channel.reload : 0x10000;
+}
+
+uint16_t IntervalTimer::count(const Channel& channel, const uint64_t now) {
+  if (channel.stopped) {
+    return channel.reload;
+  }
+  const uint32_t length = period(channel);
+  const uint64_t elapsed = now - channel.loaded_at;
+  const uint32_t wrap = channel.bcd ? 10000 : 0x10000;
+
+  uint32_t value = 0;
+  switch (channel.mode) {
+    case 2:
+      value = length - static_cast<uint32_t>(elapsed % length);
+      break;
+    case 3:
+      // Down by two, twice a period
+      value = (length - static_cast<uint32_t>(elapsed * 2 % length)) & ~1u;
+      break;
+    default:
+      // Past the terminal count the counter keeps wrapping around
+      value = static_cast<uint32_t>(
+          (length + wrap - elapsed % wrap) % wrap);
+      break;
+  }
+  value %= wrap;
+  return channel.bcd ? to_bcd(value) : static_cast<uint16_t>(value);
+}
+
+void IntervalTimer::schedule_irq(const uint64_t now) {
+  const Channel& timer = channels[0];
+  if (timer.stopped) {
+    irq_due = NEVER;
+    return;
+  }
+  const uint32_t length = period(timer);
+  switch (timer.mode) {
+    case 0:
+    case 4:
+      // A single edge at the terminal count
+      irq_due = timer.loaded_at + length;
+      break;
+    case 2:
+    case 3:
+      irq_due = timer.loaded_at +
+                ((now - timer.loaded_at) / length + 1) * length;
+      break;
+    default:
+      // Modes 1 and 5 wait for a gate trigger that never comes
+      irq_due = NEVER;
+      break;
+  }
+}
+
+bool IntervalTimer::irq(const uint64_t now) {
+  if (now < irq_due) {
+    return false;
+  }
+  const Channel& timer = channels[0];
+  if (timer.mode == 0 || timer.mode == 4) {
+    irq_due = NEVER;
+  } else {
+    schedule_irq(now);
+  }
+  return true;
+}
+
+uint8_t IntervalTimer::read(const uint16_t port, const uint64_t now) {
+  if (port == CONTROL_PORT) {
+    return 0xFF;
+  }
+  Channel& channel = channels[port - FIRST_PORT];
+  const uint16_t value = channel.latched ? channel.latch : count(channel, now);
+
+  bool high = channel.access == HIGH_BYTE;
+  bool done = true;
+  if (channel.access == 3) {
+    high = channel.read_high;
+    done = high;
+    channel.read_high = !channel.read_high;
+  }
+  if (done) {
+    channel.latched = false;
+  }
+  return static_cast<uint8_t>(high ? value >> 8 : value);
+}
+
+void IntervalTimer::write(const uint16_t port, const uint8_t value,
+                          const uint64_t now) {
+  if (port != CONTROL_PORT) {
+    Channel& channel = channels[port - FIRST_PORT];
+    if (channel.access == LOW_BYTE) {
+      channel.reload = value;
+    } else if (channel.access == HIGH_BYTE) {
+      channel.reload = static_cast<uint16_t>(value << 8);
+    } else if (!channel.write_high) {
+      channel.low_written = value;
+      channel.write_high = true;
+      return;
+    } else {
+      channel.reload = static_cast<uint16_t>(channel.low_written | value << 8);
+      channel.write_high = false;
+    }
+    channel.loaded_at = now;
+    channel.stopped = false;
+    if (port == FIRST_PORT) {
+      schedule_irq(now);
+    }
+    return;
+  }
+
+  const uint8_t select = value >> 6;
+  const uint8_t access = value >> 4 & 3;
+  if (select == READ_BACK) {
+    // 8254 read back, bit 5 clear latches the counts of the channels given
+    for (size_t i = 0; i < channels.size(); i++) {
+      Channel& channel = channels[i];
+      if (!(value & 0x20) && value & 2 << i && !channel.latched) {
+        channel.latch = count(channel, now);
+        channel.latched = true;
+        channel.read_high = false;
+      }
+    }
+    return;
+  }
+
+  Channel& channel = channels[select];
+  if (access == LATCH) {
+    if (!channel.latched) {
+      channel.latch = count(channel, now);
+      channel.latched = true;
+    }
+    return;
+  }
+  channel.access = access;
+  // 6 and 7 are aliases of 2 and 3
+  channel.mode = value >> 1 & 7;
+  if (channel.mode > 5) {
+    channel.mode -= 4;
+  }
+  channel.bcd = value & 1;
+  channel.stopped = true;
+  channel.write_high = false;
+  channel.read_high = false;
+  channel.latched = false;
+  if (select == 0) {
+    irq_due = NEVER;
+  }
+}
+
+void IntervalTimer::save_state(uint8_t* out) const {
+  for (const Channel& channel : channels) {
+    out[0] = channel.mode;
+    out[1] = channel.access;
+    out[2] = channel.bcd;
+    put(out + 3, channel.reload, 2);
+    put(out + 5, channel.loaded_at, 8);
+    out[13] = static_cast<uint8_t>(channel.stopped | channel.write_high << 1 |
+                                   channel.read_high << 2 |
+                                   channel.latched << 3);
+    put(out + 14, channel.latch, 2);
+    out[16] = channel.low_written;
+    out += CHANNEL_STATE_SIZE;
+  }
+  put(out, irq_due, 8);
+}
+
+void IntervalTimer::load_state(const uint8_t* in) {
+  for (Channel& channel : channels) {
+    channel.mode = in[0] % 6;
+    channel.access = in[1] & 3;
+    channel.bcd = in[2];
+    channel.reload = static_cast<uint16_t>(get(in + 3, 2));
+    channel.loaded_at = get(in + 5, 8);
+    channel.stopped = in[13] & 1;
+    channel.write_high = in[13] & 2;
+    channel.read_high = in[13] & 4;
+    channel.latched = in[13] & 8;
+    channel.latch = static_cast<uint16_t>(get(in + 14, 2));
+    channel.low_written = in[16];
+    in += CHANNEL_STATE_SIZE;
+  }
+  irq_due = get(in, 8);
+}
@@ -0,0 +1,76 @@
+#ifndef INTERVALTIMER_H
+#define INTERVALTIMER_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/*
+  8253/8254 programmable interval timer, ports 40h-43h.
+
+  Nothing here runs per clock. Each channel remembers the clock its count
+  was loaded at, and the count, output and the time of the next IRQ0 are
+  worked out from that when asked. Clocks are the timer's 1.193182 MHz
+  input as the caller counts them.
+
+  Channel 0 drives IRQ0 through its rising output edges: once for a
+  terminal count in modes 0 and 4, every period in modes 2 and 3.
+  Channels 1 (DRAM refresh) and 2 (speaker) only count, gate 2 is
+  taken as always high.
+*/
+class IntervalTimer {
+ public:
+  IntervalTimer();
+
+  // Counts the BIOS programs at power on, channel 0 at 18.2 Hz
+  void reset(uint64_t now);
+
+  uint8_t read(uint16_t port, uint64_t now);
+  void write(uint16_t port, uint8_t value, uint64_t now);
+
+  /*
+    True when channel 0 raised IRQ0 since the last call, ticks missed in
+    between count as one the way the interrupt controller latches them.
+  */
+  bool irq(uint64_t now);
+  // Clock of the next IRQ0, NEVER if none is coming
+  [[nodiscard]] uint64_t next_irq() const { return irq_due; }
+  constexpr static uint64_t NEVER = UINT64_MAX;
+
+  // For snapshots, STATE_SIZE bytes
+  void save_state(uint8_t* out) const;
+  void load_state(const uint8_t* in);
+  constexpr static size_t CHANNEL_STATE_SIZE = 17;
+  constexpr static size_t STATE_SIZE = 3 * CHANNEL_STATE_SIZE + 8;
+
+  constexpr static uint32_t FREQUENCY = 1'193'182;
+  constexpr static uint16_t FIRST_PORT = 0x40;
+  constexpr static uint16_t CONTROL_PORT = 0x43;
+
+ private:
+  struct Channel {
+    uint8_t mode;
+    // 1 low byte, 2 high byte, 3 low then high
+    uint8_t access;
+    bool bcd;
+    // 0 stands for 65536 (10000 in BCD)
+    uint16_t reload;
+    uint64_t loaded_at;
+    // No count written since the mode was set, the counter is stopped
+    bool stopped;
+    bool write_high;
+    bool read_high;
+    bool latched;
+    uint16_t latch;
+    uint8_t low_written;
+  };
+
+  [[nodiscard]] static uint32_t period(const Channel& channel);
+  [[nodiscard]] static uint16_t count(const Channel& channel, uint64_t now);
+  void schedule_irq(uint64_t now);
+
+  std::array<Channel, 3> channels;
+  uint64_t irq_due;
+};
+
+#endif  // INTERVALTIMER_H
@@ -0,0 +1,371 @@
+#include "Keyboard.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "../Utils/logger.h"
+
+namespace {
+// US layout, indexed by scan code up to Space
+constexpr char NORMAL[] =
+    "\0\x1b"
+    "1234567890-=\b\tqwertyuiop[]\r\0asdfghjkl;'`\0\\zxcvbnm,./\0*\0 ";
+constexpr char SHIFTED[] =
+    "\0\x1b"
+    "!@#$%^&*()_+\b\0QWERTYUIOP{}\r\0ASDFGHJKL:\"~\0|ZXCVBNM<>?\0*\0 ";
+static_assert(sizeof(NORMAL) == Keyboard::LAST_MAIN_KEY + 2 &&
+              sizeof(SHIFTED) == Keyboard::LAST_MAIN_KEY + 2);
+
+constexpr uint8_t BREAK = 0x80;
+constexpr uint8_t EXTENDED = 0xE0;
+constexpr uint8_t LEFT_SHIFT = 0x2A;
+constexpr uint8_t CTRL = 0x1D;
+constexpr uint8_t ALT = 0x38;
+
+struct NamedKey {
+  std::string_view name;
+  uint8_t scan;
+  bool extended;
+};
+constexpr NamedKey NAMED_KEYS[] = {
+    {"Enter", 0x1C, false},     {"Esc", 0x01, false},
+    {"Tab", 0x0F, false},       {"Backspace", 0x0E, false},
+    {"Space", 0x39, false},     {"F1", 0x3B, false},
+    {"F2", 0x3C, false},        {"F3", 0x3D, false},
+    {"F4", 0x3E, false},        {"F5", 0x3F, false},
+    {"F6", 0x40, false},        {"F7", 0x41, false},
+    {"F8", 0x42, false},        {"F9", 0x43, false},
+    {"F10", 0x44, false},       {"F11", 0x57, false},
+    {"F12", 0x58, false},       {"CapsLock", 0x3A, false},
+    {"NumLock", 0x45, false},   {"ScrollLock", 0x46, false},
+    {"Up", 0x48, true},         {"Down", 0x50, true},
+    {"Left", 0x4B, true},       {"Right", 0x4D, true},
+    {"Home", 0x47, true},       {"End", 0x4F, true},
+    {"PgUp", 0x49, true},       {"PgDn", 0x51, true},
+    {"Ins", 0x52, true},        {"Del", 0x53, true},
+};
+
+// Controller commands, port 64h
+constexpr uint8_t READ_COMMAND_BYTE = 0x20;
+constexpr uint8_t WRITE_COMMAND_BYTE = 0x60;
+constexpr uint8_t SELF_TEST = 0xAA;
+constexpr uint8_t INTERFACE_TEST = 0xAB;
+constexpr uint8_t DISABLE_KEYBOARD = 0xAD;
+constexpr uint8_t ENABLE_KEYBOARD = 0xAE;
+constexpr uint8_t READ_OUTPUT_PORT = 0xD0;
+constexpr uint8_t WRITE_OUTPUT_PORT = 0xD1;
+// Keyboard commands, port 60h
+constexpr uint8_t SET_LEDS = 0xED;
+constexpr uint8_t ECHO = 0xEE;
+constexpr uint8_t SCAN_CODE_SET = 0xF0;
+constexpr uint8_t IDENTIFY = 0xF2;
+constexpr uint8_t TYPEMATIC = 0xF3;
+constexpr uint8_t RESET = 0xFF;
+constexpr uint8_t ACK = 0xFA;
+
+// IRQ1 enabled, system flag, set 1 translation
+constexpr uint8_t DEFAULT_COMMAND_BYTE = 0x45;
+constexpr uint8_t KEYBOARD_DISABLED = 0x10;
+// Processor out of reset with A20 held low, as at DOS start-up
+constexpr uint8_t DEFAULT_OUTPUT_PORT = 0x01;
+
+void put(uint8_t* out, const uint64_t value, const size_t bytes) {
+  for (size_t i = 0; i < bytes; i++) {
+    out[i] = static_cast<uint8_t>(value >> (i * 8));
+  }
+}
+
+uint64_t get(const uint8_t* in, const size_t bytes) {
+  uint64_t value = 0;
+  for (size_t i = 0; i < bytes; i++) {
+    value |= static_cast<uint64_t>(in[i]) << (i * 8);
+  }
+  return value;
+}
+
+bool find(const char* table, const uint8_t character, uint8_t& scan) {
+  for (uint8_t i = 1; i <= Keyboard::LAST_MAIN_KEY; i++) {
+    if (static_cast<uint8_t>(table[i]) == character) {
+      scan = i;
+      return true;
+    }
+  }
+  return false;
+}
+
+void stroke(const uint8_t scan, const bool extended, const uint8_t modifier,
+            std::vector<uint8_t>& codes) {
+  if (modifier) {
+    codes.push_back(modifier);
+  }
+  if (extended) {
+    codes.push_back(EXTENDED);
+  }
+  codes.push_back(scan);
+  if (extended) {
+    codes.push_back(EXTENDED);
+  }
+  codes.push_back(scan | BREAK);
+  if (modifier) {
+    codes.push_back(modifier | BREAK);
+  }
+}
+}  // namespace
+
+Keyboard::Keyboard()
+    : keys{},
+      replies{},
+      output(0),
+      output_ready(false),
+      ready_at(0),
+      command_byte(DEFAULT_COMMAND_BYTE),
+      controller_command(0),
+      keyboard_command(0),
+      output_port(DEFAULT_OUTPUT_PORT),
+      last_write_command(false) {}
+
+void Keyboard::reset() { *this = Keyboard{}; }
+
+void Keyboard::push(Queue& queue, const uint8_t value, const size_t capacity) {
+  if (queue.count == capacity) {
+    return;
+  }
+  queue.bytes[(queue.head + queue.count++) % capacity] = value;
+}
+
+uint8_t Keyboard::pop(Queue& queue, const size_t capacity) {
+  const uint8_t value = queue.bytes[queue.head];
+  queue.head = static_cast<uint8_t>((queue.head + 1) % capacity);
+  queue.count--;
+  return value;
+}
+
+void Keyboard::reply(const uint8_t value) {
+  push(replies, value, REPLY_SIZE);
+}
+
+uint8_t Keyboard::read(const uint16_t port, const uint64_t now) {
+  if (port == STATUS_PORT) {
+    // Bit 4 set, the keyboard is not inhibited by the key lock
+    return static_cast<uint8_t>(output_ready | 0x04 |
+                                (last_write_command ? 0x08 : 0) | 0x10);
+  }
+  // Reading an empty buffer gives the last byte again and frees nothing
+  if (output_ready) {
+    output_ready = false;
+    ready_at = now + BYTE_CLOCKS;
+  }
+  return output;
+}
+
+void Keyboard::write(const uint16_t port, const uint8_t value) {
+  last_write_command = port == STATUS_PORT;
+  if (port == STATUS_PORT) {
+    controller_command = 0;
+    switch (value) {
+      case READ_COMMAND_BYTE:
+        reply(command_byte);
+        break;
+      case WRITE_COMMAND_BYTE:
+      case WRITE_OUTPUT_PORT:
+        controller_command = value;
+        break;
+      case SELF_TEST:
+        reply(0x55);
+        break;
+      case INTERFACE_TEST:
+        reply(0x00);
+        break;
+      case DISABLE_KEYBOARD:
+        command_byte |= KEYBOARD_DISABLED;
+        break;
+      case ENABLE_KEYBOARD:
+        command_byte &= ~KEYBOARD_DISABLED;
+        break;
+      case READ_OUTPUT_PORT:
+        // Output buffer full is tied to IRQ1
+        reply(static_cast<uint8_t>(output_port | (output_ready ? 0x10 : 0)));
+        break;
+      default:
+        mylog("Unsupported keyboard controller command %02X", value);
+        break;
+    }
+    return;
+  }
+
+  if (controller_command) {
+    if (controller_command == WRITE_COMMAND_BYTE) {
+      command_byte = value;
+    } else {
+      // Of the output port only the A20 gate does anything here
+      output_port =
+          static_cast<uint8_t>((value & A20_GATE) | DEFAULT_OUTPUT_PORT);
+    }
+    controller_command = 0;
+    return;
+  }
+  if (keyboard_command) {
+    // Data byte of a keyboard command: LEDs, rate or scan code set
+    keyboard_command = 0;
+    reply(ACK);
+    return;
+  }
+  switch (value) {
+    case SET_LEDS:
+    case SCAN_CODE_SET:
+    case TYPEMATIC:
+      keyboard_command = value;
+      reply(ACK);
+      break;
+    case ECHO:
+      reply(ECHO);
+      break;
+    case IDENTIFY:
+      // MF2 keyboard, translated
+      reply(ACK);
+      reply(0xAB);
+      reply(0x41);
+      break;
+    case RESET:
+      keys.count = 0;
+      reply(ACK);
+      reply(0xAA);
+      break;
+    default:
+      // Enable, disable, set defaults and the rest only need an ACK
+      reply(ACK);
+      break;
+  }
+}
+
+bool Keyboard::send(const std::vector<uint8_t>& codes) {
+  if (codes.size() > room()) {
+    return false;
+  }
+  for (const uint8_t code : codes) {
+    push(keys, code, BUFFER_SIZE);
+  }
+  return true;
+}
+
+size_t Keyboard::room() const { return BUFFER_SIZE - keys.count; }
+
+bool Keyboard::load(const uint64_t now) {
+  if (next_load() > now) {
+    return false;
+  }
+  output = replies.count ? pop(replies, REPLY_SIZE) : pop(keys, BUFFER_SIZE);
+  output_ready = true;
+  return command_byte & 1;
+}
+
+uint64_t Keyboard::next_load() const {
+  const bool waiting =
+      replies.count || (keys.count && !(command_byte & KEYBOARD_DISABLED));
+  return output_ready || !waiting ? NEVER : ready_at;
+}
+
+bool Keyboard::encode_character(const uint8_t character,
+                                std::vector<uint8_t>& codes) {
+  uint8_t scan = 0;
+  if (character == '\n') {
+    stroke(0x1C, false, 0, codes);
+  } else if (find(NORMAL, character, scan)) {
+    stroke(scan, false, 0, codes);
+  } else if (find(SHIFTED, character, scan)) {
+    stroke(scan, false, LEFT_SHIFT, codes);
+  } else if (character >= 1 && character <= 26 &&
+             find(NORMAL, static_cast<uint8_t>('a' + character - 1), scan)) {
+    stroke(scan, false, CTRL, codes);
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool Keyboard::encode_key(std::string_view name, std::vector<uint8_t>& codes) {
+  // Modifiers are held around the key, at most one of them
+  uint8_t modifier = 0;
+  constexpr std::pair<std::string_view, uint8_t> MODIFIERS[] = {
+      {"Ctrl+", CTRL}, {"Alt+", ALT}, {"Shift+", LEFT_SHIFT}};
+  for (const auto& [prefix, scan] : MODIFIERS) {
+    if (name.size() > prefix.size() && name.substr(0, prefix.size()) == prefix) {
+      modifier = scan;
+      name.remove_prefix(prefix.size());
+      break;
+    }
+  }
+
+  for (const NamedKey& key : NAMED_KEYS) {
+    if (key.name == name) {
+      stroke(key.scan, key.extended, modifier, codes);
+      return true;
+    }
+  }
+  if (name.size() != 1) {
+    return false;
+  }
+  // A single character names the key it is on, Alt+X is Alt+x
+  uint8_t character = static_cast<uint8_t>(name[0]);
+  if (character >= 'A' && character <= 'Z') {
+    character = static_cast<uint8_t>(character - 'A' + 'a');
+  }
+  uint8_t scan = 0;
+  if (!find(NORMAL, character, scan) && !find(SHIFTED, character, scan)) {
+    return false;
+  }
+  stroke(scan, false, modifier, codes);
+  return true;
+}
+
+uint8_t Keyboard::character(const uint8_t scan, const bool shifted) {
+  if (scan > LAST_MAIN_KEY) {
+    return 0;
+  }
+  return static_cast<uint8_t>(shifted ? SHIFTED[scan] : NORMAL[scan]);
+}
+
+void Keyboard::save_state(uint8_t* out) const {
+  put(out, ready_at, 8);
+  out[8] = output;
+  out[9] = static_cast<uint8_t>(output_ready | last_write_command << 1 |
+                                (output_port & A20_GATE) << 1);
+  out[10] = command_byte;
+  out[11] = controller_command;
+  out[12] = keyboard_command;
+  out += 13;
+  out[0] = replies.count;
+  for (size_t i = 0; i < REPLY_SIZE; i++) {
+    out[1 + i] = replies.bytes[(replies.head + i) % REPLY_SIZE];
+  }
+  out += 1 + REPLY_SIZE;
+  out[0] = keys.count;
+  for (size_t i = 0; i < BUFFER_SIZE; i++) {
+    out[1 + i] = keys.bytes[(keys.head + i) % BUFFER_SIZE];
+  }
+}
+
+void Keyboard::load_state(const uint8_t* in) {
+  ready_at = get(in, 8);
+  output = in[8];
+  output_ready = in[9] & 1;
+  last_write_command = in[9] & 2;
+  output_port =
+      static_cast<uint8_t>((in[9] >> 1 & A20_GATE) | DEFAULT_OUTPUT_PORT);
+  command_byte = in[10];
+  controller_command = in[11];
+  keyboard_command = in[12];
+  in += 13;
+  replies = Queue{};
+  for (size_t i = 0; i < in[0] && i < REPLY_SIZE; i++) {
+    push(replies, in[1 + i], REPLY_SIZE);
+  }
+  in += 1 + REPLY_SIZE;
+  keys = Queue{};
+  for (size_t i = 0; i < in[0] && i < BUFFER_SIZE; i++) {
+    push(keys, in[1 + i], BUFFER_SIZE);
+  }
+}
@@ -0,0 +1,99 @@
+#ifndef KEYBOARD_H
+#define KEYBOARD_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+/*
+  8042 keyboard controller and the keyboard behind it, ports 60h and 64h.
+
+  Keys arrive as scan code set 1 bytes, the way the controller passes
+  them on after translation. The keyboard holds them in its own buffer
+  and sends one at a time: a byte moves into the output buffer once the
+  previous one has been read and the line has been free for BYTE_CLOCKS,
+  which raises IRQ1 when the command byte enables it. Answers to
+  commands go out ahead of keys waiting to be sent.
+
+  As with the interval timer nothing runs per clock, the caller passes
+  the clock in and asks when the next byte is due.
+*/
+class Keyboard {
+ public:
+  Keyboard();
+
+  void reset();
+
+  uint8_t read(uint16_t port, uint64_t now);
+  void write(uint16_t port, uint8_t value);
+
+  /*
+    Queues the scan codes of one key stroke, all or nothing. False when
+    they do not fit in the keyboard's buffer.
+  */
+  bool send(const std::vector<uint8_t>& codes);
+  // Room left in the keyboard's buffer, in bytes
+  [[nodiscard]] size_t room() const;
+
+  // Moves the next byte into the output buffer if due, true on IRQ1
+  bool load(uint64_t now);
+  // Clock the next byte can be loaded at, NEVER if none is waiting
+  [[nodiscard]] uint64_t next_load() const;
+  [[nodiscard]] bool output_full() const { return output_ready; }
+  // Output port bit 1, address line 20 passes through when set
+  [[nodiscard]] bool a20_enabled() const { return output_port & A20_GATE; }
+
+  /*
+    Make and break codes for typing character, shifted or with Ctrl
+    held as it needs, or for a key named the way the key scripts name
+    them: Enter, Esc, F1, Up, Ctrl+C, Alt+X, Shift+Tab...
+  */
+  static bool encode_character(uint8_t character, std::vector<uint8_t>& codes);
+  static bool encode_key(std::string_view name, std::vector<uint8_t>& codes);
+  // The layout behind both, ASCII of the main block keys, 0 for none
+  [[nodiscard]] static uint8_t character(uint8_t scan, bool shifted);
+  constexpr static uint8_t LAST_MAIN_KEY = 0x39;
+
+  // For snapshots, STATE_SIZE bytes
+  void save_state(uint8_t* out) const;
+  void load_state(const uint8_t* in);
+
+  constexpr static uint16_t DATA_PORT = 0x60;
+  constexpr static uint16_t STATUS_PORT = 0x64;
+  constexpr static uint64_t NEVER = UINT64_MAX;
+  // 11 bits at the keyboard's 10 kHz clock, about a millisecond
+  constexpr static uint64_t BYTE_CLOCKS = 1193;
+  constexpr static size_t BUFFER_SIZE = 32;
+  constexpr static size_t REPLY_SIZE = 4;
+  constexpr static uint8_t A20_GATE = 0x02;
+  constexpr static size_t STATE_SIZE = 8 + 5 + 1 + REPLY_SIZE + 1 + BUFFER_SIZE;
+
+ private:
+  struct Queue {
+    uint8_t bytes[BUFFER_SIZE];
+    uint8_t head;
+    uint8_t count;
+  };
+  static void push(Queue& queue, uint8_t value, size_t capacity);
+  static uint8_t pop(Queue& queue, size_t capacity);
+  void reply(uint8_t value);
+
+  Queue keys;
+  Queue replies;
+  uint8_t output;
+  bool output_ready;
+  uint64_t ready_at;
+  // Controller command byte, bit 0 enables IRQ1, bit 4 disables the keyboard
+  uint8_t command_byte;
+  // Controller or keyboard command waiting for its data byte, 0 if none
+  uint8_t controller_command;
+  uint8_t keyboard_command;
+  // Bit 0 keeps the processor out of reset, bit 1 gates A20
+  uint8_t output_port;
+  // Last port 60h/64h write, status bit 3
+  bool last_write_command;
+};
+
+#endif  // KEYBOARD_H
@@ -0,0 +1,278 @@
+#include "TextDisplay.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "../CPU/Memory.h"
+#include "BiosDataArea.h"
+
+namespace {
+// Unchanged cells a run of changes carries over rather than move the cursor
+constexpr int MAX_GAP = 4;
+
+// CGA colour numbers in ANSI order
+constexpr uint8_t ANSI_COLOR[8] = {0, 4, 2, 6, 1, 5, 3, 7};
+
+// Code page 437 where it differs from ASCII
+constexpr char16_t CONTROL_GLYPHS[32] = {
+    u' ',      u'☺', u'☻', u'♥', u'♦', u'♣',
+    u'♠', u'•', u'◘', u'○', u'◙', u'♂',
+    u'♀', u'♪', u'♫', u'☼', u'►', u'◄',
+    u'↕', u'‼', u'¶', u'§', u'▬', u'↨',
+    u'↑', u'↓', u'→', u'←', u'∟', u'↔',
+    u'▲', u'▼'};
+constexpr char16_t DELETE_GLYPH = u'⌂';
+constexpr char16_t HIGH_GLYPHS[128] = {
+    u'Ç', u'ü', u'é', u'â', u'ä', u'à',
+    u'å', u'ç', u'ê', u'ë', u'è', u'ï',
+    u'î', u'ì', u'Ä', u'Å', u'É', u'æ',
+    u'Æ', u'ô', u'ö', u'ò', u'û', u'ù',
+    u'ÿ', u'Ö', u'Ü', u'¢', u'£', u'¥',
+    u'₧', u'ƒ', u'á', u'í', u'ó', u'ú',
+    u'ñ', u'Ñ', u'ª', u'º', u'¿', u'⌐',
+    u'¬', u'½', u'¼', u'¡', u'«', u'»',
+    u'░', u'▒', u'▓', u'│', u'┤', u'╡',
+    u'╢', u'╖', u'╕', u'╣', u'║', u'╗',
+    u'╝', u'╜', u'╛', u'┐', u'└', u'┴',
+    u'┬', u'├', u'─', u'┼', u'╞', u'╟',
+    u'╚', u'╔', u'╩', u'╦', u'╠', u'═',
+    u'╬', u'╧', u'╨', u'╤', u'╥', u'╙',
+    u'╘', u'╒', u'╓', u'╫', u'╪', u'┘',
+    u'┌', u'█', u'▄', u'▌', u'▐', u'▀',
+    u'α', u'ß', u'Γ', u'π', u'Σ', u'σ',
+    u'µ', u'τ', u'Φ', u'Θ', u'Ω', u'δ',
+    u'∞', u'φ', u'ε', u'∩', u'≡', u'±',
+    u'≥', u'≤', u'⌠', u'⌡', u'÷', u'≈',
+    u'°', u'∙', u'·', u'√', u'ⁿ', u'²',
+    u'■', u' '};
+
+}  // namespace
+
+void TextDisplay::append_glyph(std::string& out, const uint8_t character) {
+  char16_t glyph;
+  if (character < 0x20) {
+    glyph = CONTROL_GLYPHS[character];
+  } else if (character < 0x7F) {
+    out += static_cast<char>(character);
+    return;
+  } else if (character == 0x7F) {
+    glyph = DELETE_GLYPH;
+  } else {
+    glyph = HIGH_GLYPHS[character - 0x80];
+  }
+
+  // All of them are in the basic plane, at most three bytes of UTF-8
+  if (glyph < 0x80) {
+    out += static_cast<char>(glyph);
+    return;
+  }
+  if (glyph < 0x800) {
+    out += static_cast<char>(0xC0 | glyph >> 6);
+  } else {
+    out += static_cast<char>(0xE0 | glyph >> 12);
+    out += static_cast<char>(0x80 | (glyph >> 6 & 0x3F));
+  }
+  out += static_cast<char>(0x80 | (glyph & 0x3F));
+}
+
+TextDisplay::TextDisplay(const Memory& memory, const double refresh_hz)
+    : memory(memory),
+      frame_interval(std::chrono::duration_cast<
+                     std::chrono::steady_clock::duration>(
+          std::chrono::duration<double>(1.0 / refresh_hz))),
+      next_frame(std::chrono::steady_clock::now()),
+      active(false),
+      shown{0, 0, 0},
+      attribute(-1),
+      cursor_row(-1),
+      cursor_column(-1) {}
+
+TextDisplay::~TextDisplay() {
+  refresh();
+  if (!active) {
+    return;
+  }
+  frame += "\x1b[0m";
+  move_cursor(shown.rows, 0);
+  std::cout.write(frame.data(), static_cast<std::streamsize>(frame.size()));
+  std::cout.flush();
+}
+
+void TextDisplay::tick() {
+  const std::chrono::steady_clock::time_point now =
+      std::chrono::steady_clock::now();
+  if (now < next_frame) {
+    return;
+  }
+  next_frame = now + frame_interval;
+  if (!active) {
+    // Teletype output goes out as it is written, at the frame rate
+    std::cout.flush();
+  }
+  refresh();
+}
+
+void TextDisplay::sync(const uint32_t address, const size_t length) {
+  if (active) {
+    return;
+  }
+  Layout layout{};
+  if (!read_layout(layout)) {
+    return;
+  }
+  const size_t size = layout.rows * layout.columns * 2;
+  if (!(layout == shown) || shadow.size() != size) {
+    // A new mode while streaming, whatever it shows is on the terminal
+    shown = layout;
+    shadow.assign(memory.data() + layout.base,
+                  memory.data() + layout.base + size);
+    return;
+  }
+
+  const uint32_t start = address > layout.base ? address : layout.base;
+  const uint32_t end = address + length < layout.base + size
+                           ? static_cast<uint32_t>(address + length)
+                           : static_cast<uint32_t>(layout.base + size);
+  if (start < end) {
+    std::memcpy(shadow.data() + (start - layout.base), memory.data() + start,
+                end - start);
+  }
+}
+
+bool TextDisplay::read_layout(Layout& layout) const {
+  const uint8_t mode = memory[BiosDataArea::VIDEO_MODE];
+  // Graphics modes have no cells to draw
+  if (mode > 3 && mode != MONOCHROME_MODE) {
+    return false;
+  }
+
+  layout.base = mode == MONOCHROME_MODE ? MONOCHROME_TEXT : COLOR_TEXT;
+  layout.base += memory[BiosDataArea::PAGE_OFFSET] |
+                 memory[BiosDataArea::PAGE_OFFSET + 1] << 8;
+  layout.columns = memory[BiosDataArea::COLUMNS] == 40 ? 40 : 80;
+  const int rows = memory[BiosDataArea::LAST_ROW] + 1;
+  layout.rows = rows == 43 || rows == 50 ? rows : 25;
+
+  return layout.base + layout.rows * layout.columns * 2 <= memory.size();
+}
+
+void TextDisplay::refresh() {
+  Layout layout{};
+  if (!read_layout(layout)) {
+    return;
+  }
+  const uint8_t* cells = memory.data() + layout.base;
+  const size_t row_size = layout.columns * 2;
+  const size_t size = layout.rows * row_size;
+
+  bool full = false;
+  if (!(layout == shown) || shadow.size() != size) {
+    shown = layout;
+    shadow.assign(size, 0);
+    full = active;
+  }
+  if (!active) {
+    // Blank or teletype output only, which the terminal already shows
+    if (std::memcmp(cells, shadow.data(), size) == 0) {
+      return;
+    }
+    active = true;
+    full = true;
+  }
+  if (full) {
+    frame += "\x1b[0m\x1b[2J";
+    attribute = -1;
+    cursor_row = cursor_column = -1;
+  }
+
+  for (int row = 0; row < layout.rows; row++) {
+    const uint8_t* line = cells + row * row_size;
+    uint8_t* shadow_line = shadow.data() + row * row_size;
+    if (full || std::memcmp(line, shadow_line, row_size) != 0) {
+      draw_row(line, row, full);
+      std::memcpy(shadow_line, line, row_size);
+    }
+  }
+
+  const uint8_t page = memory[BiosDataArea::ACTIVE_PAGE] & 7;
+  const uint8_t column = memory[BiosDataArea::CURSOR + page * 2];
+  const uint8_t row = memory[BiosDataArea::CURSOR + page * 2 + 1];
+  if (row < layout.rows && column < layout.columns) {
+    move_cursor(row, column);
+  }
+
+  if (frame.empty()) {
+    return;
+  }
+  std::cout.write(frame.data(), static_cast<std::streamsize>(frame.size()));
+  std::cout.flush();
+  frame.clear();
+}
+
+void TextDisplay::draw_row(const uint8_t* cells, const int row,
+                           const bool full) {
+  const uint8_t* old = shadow.data() + row * shown.columns * 2;
+  const auto changed = [&](const int column) {
+    return full || cells[column * 2] != old[column * 2] ||
+           cells[column * 2 + 1] != old[column * 2 + 1];
+  };
+
+  int column = 0;
+  while (column < shown.columns) {
+    if (!changed(column)) {
+      column++;
+      continue;
+    }
+
+    int last = column;
+    for (int next = column + 1;
+         next < shown.columns && next - last <= MAX_GAP; next++) {
+      if (changed(next)) {
+        last = next;
+      }
+    }
+
+    move_cursor(row, column);
+    for (; column <= last; column++) {
+      set_attribute(cells[column * 2 + 1]);
+      append_glyph(frame, cells[column * 2]);
+    }
+    // Past the last column the terminal is about to wrap, position unknown
+    cursor_column = column < shown.columns ? column : -1;
+  }
+}
+
+void TextDisplay::move_cursor(const int row, const int column) {
+  if (row == cursor_row && column == cursor_column) {
+    return;
+  }
+  frame += "\x1b[";
+  frame += std::to_string(row + 1);
+  frame += ';';
+  frame += std::to_string(column + 1);
+  frame += 'H';
+  cursor_row = row;
+  cursor_column = column;
+}
+
+void TextDisplay::set_attribute(const uint8_t value) {
+  if (value == attribute) {
+    return;
+  }
+  // Foreground with its intensity bit, background, blink
+  const uint8_t foreground = value & 0x0F;
+  const uint8_t background = value >> 4 & 0x07;
+  frame += "\x1b[0;";
+  frame += std::to_string((foreground & 0x08 ? 90 : 30) +
+                          ANSI_COLOR[foreground & 0x07]);
+  frame += ';';
+  frame += std::to_string(40 + ANSI_COLOR[background]);
+  if (value & 0x80) {
+    frame += ";5";
+  }
+  frame += 'm';
+  attribute = value;
+}
@@ -0,0 +1,86 @@
+#ifndef TEXTDISPLAY_H
+#define TEXTDISPLAY_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../CPU/Memory.h"
+
+/*
+  Text mode screen, drawn on the host terminal with ANSI sequences.
+
+  The guest writes video memory like any other memory, so rather than
+  intercepting every store, each frame compares the visible page with a
+  shadow copy of what the terminal shows and redraws only the cells that
+  differ. A row that did not change costs one memcmp.
+
+  Mode, size, active page and cursor are read from the BIOS data area,
+  80x25 when it is blank. 25, 43 and 50 rows are supported.
+
+  Until the guest writes to the screen directly the terminal is left to
+  scroll on its own: BIOS teletype output is streamed to it as text and
+  passed to sync, so it does not count as a change. The first direct
+  write clears the terminal and from then on the screen is drawn
+  cell by cell.
+*/
+class TextDisplay {
+ public:
+  constexpr static uint32_t COLOR_TEXT = 0xB8000;
+  constexpr static uint32_t MONOCHROME_TEXT = 0xB0000;
+  constexpr static uint8_t MONOCHROME_MODE = 0x07;
+
+  TextDisplay(const Memory& memory, double refresh_hz);
+  // Draws the last frame and leaves the cursor below it
+  ~TextDisplay();
+  TextDisplay(const TextDisplay&) = delete;
+  TextDisplay& operator=(const TextDisplay&) = delete;
+
+  // Draws a frame when one is due at the refresh rate
+  void tick();
+  // Draws a frame now
+  void refresh();
+
+  // Whether the terminal still only shows streamed teletype output
+  [[nodiscard]] bool streaming() const { return !active; }
+  // Video memory the caller wrote and streamed itself, linear addresses
+  void sync(uint32_t address, size_t length);
+
+  // Code page 437 character as UTF-8
+  static void append_glyph(std::string& out, uint8_t character);
+
+ private:
+  struct Layout {
+    uint32_t base;
+    uint8_t columns;
+    uint8_t rows;
+
+    bool operator==(const Layout& other) const {
+      return base == other.base && columns == other.columns &&
+             rows == other.rows;
+    }
+  };
+
+  [[nodiscard]] bool read_layout(Layout& layout) const;
+  void draw_row(const uint8_t* cells, int row, bool full);
+  void move_cursor(int row, int column);
+  void set_attribute(uint8_t attribute);
+
+  const Memory& memory;
+  std::chrono::steady_clock::duration frame_interval;
+  std::chrono::steady_clock::time_point next_frame;
+
+  bool active;
+  Layout shown;
+  // Characters and attributes as the terminal shows them
+  std::vector<uint8_t> shadow;
+  // Terminal state, -1 when unknown
+  int attribute;
+  int cursor_row, cursor_column;
+  // Reused between frames, written out in one go
+  std::string frame;
+};
+
+#endif  // TEXTDISPLAY_H
@@ -39,7 +39,7 @@ bool MZExe::get_mz_header(std::ifstream& file) {
 }
 
 std::optional<MZExe> MZExe::open(const std::string_view& path) {
-  std::ifstream file{path.data()};
+  std::ifstream file{path.data(), std::ios::binary};
   if (!file.is_open()) return std::nullopt;
   if (!get_mz_header(file)) return std::nullopt;
 
@@ -73,9 +73,10 @@ std::optional<MZExe> MZExe::open(const std::string_view& path) {
   read(file, mz.OverlayInformation);
   mylog("0x1C: %d", static_cast<int>(mz.OverlayInformation));
 
-  file.seekg(std::ios::end);
+  // The whole file, header included
+  file.seekg(0, std::ios::end);
   const std::streampos size = file.tellg();
-  file.seekg(std::ios::beg);
+  file.seekg(0, std::ios::beg);
   mz.buffer.resize(size);
   read(file, mz.buffer);
   return mz;
@@ -0,0 +1,19 @@
+#include "FPU.h"
+
+#include <memory>
+
+#include "FPUCore.h"
+#include "FPUMode.h"
+#include "Float80.h"
+
+std::unique_ptr<FPU> FPU::create(const FPU_MODE fpu_mode) {
+  switch (fpu_mode) {
+    case FPU_MODE::FAST:
+      return std::make_unique<FPUCore<double>>();
+    case FPU_MODE::EXACT:
+      return std::make_unique<FPUCore<Float80>>();
+    case FPU_MODE::NONE:
+    default:
+      return nullptr;
+  }
+}
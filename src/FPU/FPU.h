@@ -0,0 +1,37 @@
+#ifndef FPU_H
+#define FPU_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "FPUMode.h"
+
+/*
+  8087 numeric coprocessor, driven by the CPU for every ESC (D8-DF)
+  instruction. The CPU decodes the ModR/M byte and hands over a pointer
+  to the memory operand, so the FPU never deals with segments.
+*/
+class FPU {
+ public:
+  virtual ~FPU() = default;
+
+  // nullptr for FPU_MODE::NONE
+  static std::unique_ptr<FPU> create(FPU_MODE fpu_mode);
+
+  /*
+    operand is the memory operand in guest memory, nullptr for the
+    register forms (mod == 0b11). Returns false on an unknown encoding.
+  */
+  virtual bool execute(uint8_t opcode, uint8_t mod_rm, uint8_t* operand) = 0;
+  [[nodiscard]] virtual uint16_t status_word() const = 0;
+  // FINIT
+  virtual void reset() = 0;
+
+  // Whole state in the FSAVE layout, for snapshots
+  constexpr static size_t STATE_SIZE = 94;
+  virtual void save_state(uint8_t* out) const = 0;
+  virtual void load_state(const uint8_t* in) = 0;
+};
+
+#endif  // FPU_H
@@ -0,0 +1,927 @@
+#include "FPUCore.h"
+
+#include <cmath>
+#include <cstdint>
+
+#include "FPUReal.h"
+#include "Float80.h"
+
+namespace {
+
+uint64_t get(const uint8_t* in, const uint8_t size) {
+  uint64_t value = 0;
+  for (int i = size - 1; i >= 0; i--) {
+    value = (value << 8) | in[i];
+  }
+  return value;
+}
+
+void put(uint8_t* out, uint64_t value, const uint8_t size) {
+  for (uint8_t i = 0; i < size; i++) {
+    out[i] = static_cast<uint8_t>(value & 0xFF);
+    value >>= 8;
+  }
+}
+
+Float80 constant(const uint16_t sign_exponent, const uint64_t mantissa) {
+  Float80 value;
+  value.mantissa = mantissa;
+  value.sign_exponent = sign_exponent;
+  return value;
+}
+
+// FLD1 FLDL2T FLDL2E FLDPI FLDLG2 FLDLN2 FLDZ, as the 8087 rounds them
+const Float80 CONSTANTS[] = {
+    constant(0x3FFF, 0x8000000000000000), constant(0x4000, 0xD49A784BCD1B8AFE),
+    constant(0x3FFF, 0xB8AA3B295C17F0BC), constant(0x4000, 0xC90FDAA22168C235),
+    constant(0x3FFD, 0x9A209A84FBCFF799), constant(0x3FFE, 0xB17217F7D1CF79AC),
+    constant(0x0000, 0x0000000000000000)};
+
+constexpr uint16_t CONTROL_DEFAULT = 0x037F;
+// 8087 only, FDISI / FENI
+constexpr uint16_t CONTROL_INTERRUPT_MASK = 1 << 7;
+
+constexpr double LN2 = 0.693147180559945309417;
+
+constexpr int64_t BCD_LIMIT = 1'000'000'000'000'000'000;
+
+}  // namespace
+
+template <typename Real>
+FPUCore<Real>::FPUCore() {
+  reset();
+}
+
+template <typename Real>
+void FPUCore<Real>::reset() {
+  control = CONTROL_DEFAULT;
+  status = 0;
+  for (uint8_t i = 0; i < 8; i++) {
+    registers[i] = FPUReal<Real>::from_int64(0);
+    tags[i] = TAG_EMPTY;
+  }
+}
+
+template <typename Real>
+uint16_t FPUCore<Real>::status_word() const {
+  return status;
+}
+
+template <typename Real>
+uint8_t FPUCore<Real>::top() const {
+  return (status & SW_TOP_MASK) >> SW_TOP_SHIFT;
+}
+
+template <typename Real>
+void FPUCore<Real>::set_top(const uint8_t top) {
+  status = static_cast<uint16_t>((status & ~SW_TOP_MASK) |
+                                 ((top & 0b111) << SW_TOP_SHIFT));
+}
+
+template <typename Real>
+uint8_t FPUCore<Real>::physical(const uint8_t i) const {
+  return (top() + i) & 0b111;
+}
+
+template <typename Real>
+FloatEnvironment FPUCore<Real>::environment() const {
+  FloatEnvironment env;
+  env.rounding = static_cast<FloatEnvironment::Rounding>((control >> 10) & 0b11);
+  // Precision control, 01 is reserved
+  constexpr uint8_t PRECISION[] = {24, 64, 53, 64};
+  env.precision = PRECISION[(control >> 8) & 0b11];
+  return env;
+}
+
+template <typename Real>
+void FPUCore<Real>::raise(const FloatEnvironment& env) {
+  status |= env.exceptions & SW_EXCEPTIONS;
+  if (status & ~control & SW_EXCEPTIONS) {
+    status |= SW_ERROR_SUMMARY | SW_BUSY;
+  }
+}
+
+template <typename Real>
+void FPUCore<Real>::set_condition(const uint16_t condition) {
+  status = static_cast<uint16_t>((status & ~SW_CONDITION) | condition);
+}
+
+template <typename Real>
+uint8_t FPUCore<Real>::tag_for(const Real& value) {
+  const Float80 bits = FPUReal<Real>::to_float80(value);
+  if (bits.is_zero()) {
+    return TAG_ZERO;
+  }
+  if (bits.exponent() == 0 || bits.exponent() == Float80::MAX_EXPONENT ||
+      !(bits.mantissa >> 63)) {
+    return TAG_SPECIAL;
+  }
+  return TAG_VALID;
+}
+
+/*
+  An empty register reads as the indefinite NaN after flagging a stack
+  underflow, so callers carry on with the masked response
+*/
+template <typename Real>
+bool FPUCore<Real>::read(const uint8_t i, Real& value) {
+  const uint8_t reg = physical(i);
+  if (tags[reg] == TAG_EMPTY) {
+    FloatEnvironment env;
+    value = FPUReal<Real>::from_float80(Float80::indefinite(), env);
+    status = static_cast<uint16_t>((status | SW_STACK_FAULT) & ~SW_C1);
+    env.exceptions = FloatEnvironment::IE;
+    raise(env);
+    return false;
+  }
+  value = registers[reg];
+  return true;
+}
+
+template <typename Real>
+void FPUCore<Real>::write(const uint8_t i, const Real& value) {
+  const uint8_t reg = physical(i);
+  registers[reg] = value;
+  tags[reg] = tag_for(value);
+}
+
+template <typename Real>
+void FPUCore<Real>::push(const Real& value) {
+  set_top(top() - 1);
+  if (tags[physical(0)] != TAG_EMPTY) {
+    FloatEnvironment env;
+    write(0, FPUReal<Real>::from_float80(Float80::indefinite(), env));
+    status |= SW_STACK_FAULT | SW_C1;
+    env.exceptions = FloatEnvironment::IE;
+    raise(env);
+    return;
+  }
+  write(0, value);
+}
+
+template <typename Real>
+void FPUCore<Real>::pop() {
+  tags[physical(0)] = TAG_EMPTY;
+  set_top(top() + 1);
+}
+
+template <typename Real>
+void FPUCore<Real>::compare(const Real& lhs, const Real& rhs,
+                            FloatEnvironment& env) {
+  switch (FPUReal<Real>::compare(lhs, rhs)) {
+    case Float80::Ordering::GREATER:
+      set_condition(0);
+      break;
+    case Float80::Ordering::LESS:
+      set_condition(SW_C0);
+      break;
+    case Float80::Ordering::EQUAL:
+      set_condition(SW_C3);
+      break;
+    case Float80::Ordering::UNORDERED:
+      set_condition(SW_C3 | SW_C2 | SW_C0);
+      env.exceptions |= FloatEnvironment::IE;
+      break;
+  }
+}
+
+// ST(dest) = ST(dest) op src, COM / COMP only compare
+template <typename Real>
+void FPUCore<Real>::arithmetic(const Operation operation, const uint8_t dest,
+                               const Real& src) {
+  Real lhs;
+  read(dest, lhs);
+
+  FloatEnvironment env = environment();
+  Real result;
+  switch (operation) {
+    case ADD:
+      result = FPUReal<Real>::add(lhs, src, env);
+      break;
+    case MUL:
+      result = FPUReal<Real>::mul(lhs, src, env);
+      break;
+    case SUB:
+      result = FPUReal<Real>::sub(lhs, src, env);
+      break;
+    case SUBR:
+      result = FPUReal<Real>::sub(src, lhs, env);
+      break;
+    case DIV:
+      result = FPUReal<Real>::div(lhs, src, env);
+      break;
+    case DIVR:
+      result = FPUReal<Real>::div(src, lhs, env);
+      break;
+    case COM:
+    case COMP:
+    default:
+      compare(lhs, src, env);
+      raise(env);
+      return;
+  }
+  write(dest, result);
+  raise(env);
+}
+
+// Memory operand of the arithmetic group
+template <typename Real>
+Real FPUCore<Real>::load_memory(const uint8_t opcode,
+                                const uint8_t* operand) const {
+  switch (opcode) {
+    case 0xD8:
+      return FPUReal<Real>::from_float32(static_cast<uint32_t>(get(operand, 4)));
+    case 0xDA:
+      return FPUReal<Real>::from_int64(
+          static_cast<int32_t>(static_cast<uint32_t>(get(operand, 4))));
+    case 0xDC:
+      return FPUReal<Real>::from_float64(get(operand, 8));
+    case 0xDE:
+    default:
+      return FPUReal<Real>::from_int64(
+          static_cast<int16_t>(static_cast<uint16_t>(get(operand, 2))));
+  }
+}
+
+// Out of range values store the integer indefinite, the lowest value
+template <typename Real>
+void FPUCore<Real>::store_integer(const Real& value, uint8_t* operand,
+                                  const uint8_t size, FloatEnvironment& env) {
+  const int64_t lowest = static_cast<int64_t>(~0ULL << (size * 8 - 1));
+  int64_t integer;
+  if (!FPUReal<Real>::to_int64(value, env, integer) || integer < lowest ||
+      integer > -(lowest + 1)) {
+    env.exceptions |= FloatEnvironment::IE;
+    integer = lowest;
+  }
+  put(operand, static_cast<uint64_t>(integer), size);
+}
+
+// 18 packed digits, least significant byte first, sign in bit 79
+template <typename Real>
+Real FPUCore<Real>::load_bcd(const uint8_t* operand) const {
+  int64_t value = 0;
+  for (int i = 8; i >= 0; i--) {
+    value = value * 100 + (operand[i] >> 4) * 10 + (operand[i] & 0x0F);
+  }
+  const Real magnitude = FPUReal<Real>::from_int64(value);
+  return (operand[9] & 0x80) ? FPUReal<Real>::negate(magnitude) : magnitude;
+}
+
+template <typename Real>
+void FPUCore<Real>::store_bcd(const Real& value, uint8_t* operand,
+                              FloatEnvironment& env) {
+  int64_t integer;
+  if (!FPUReal<Real>::to_int64(value, env, integer) ||
+      integer <= -BCD_LIMIT || integer >= BCD_LIMIT) {
+    env.exceptions |= FloatEnvironment::IE;
+    put(operand, 0, 7);
+    put(operand + 7, 0xFFFFC0, 3);
+    return;
+  }
+
+  const bool sign = FPUReal<Real>::to_float80(value).sign();
+  uint64_t magnitude = static_cast<uint64_t>(integer < 0 ? -integer : integer);
+  for (uint8_t i = 0; i < 9; i++) {
+    const uint8_t low = magnitude % 10;
+    magnitude /= 10;
+    const uint8_t high = magnitude % 10;
+    magnitude /= 10;
+    operand[i] = static_cast<uint8_t>((high << 4) | low);
+  }
+  operand[9] = sign ? 0x80 : 0x00;
+}
+
+/*
+  Real mode FSTENV layout, 7 words: control, status, tag, then the
+  instruction and operand pointers which are not tracked and saved as 0
+*/
+template <typename Real>
+void FPUCore<Real>::store_environment(uint8_t* out) const {
+  uint16_t tag_word = 0;
+  for (uint8_t i = 0; i < 8; i++) {
+    tag_word |= static_cast<uint16_t>(tags[i] << (i * 2));
+  }
+  put(out, control, 2);
+  put(out + 2, status_word(), 2);
+  put(out + 4, tag_word, 2);
+  put(out + 6, 0, 8);
+}
+
+template <typename Real>
+void FPUCore<Real>::load_environment(const uint8_t* in) {
+  control = static_cast<uint16_t>(get(in, 2));
+  status = static_cast<uint16_t>(get(in + 2, 2));
+  const uint16_t tag_word = static_cast<uint16_t>(get(in + 4, 2));
+  for (uint8_t i = 0; i < 8; i++) {
+    const uint8_t tag = (tag_word >> (i * 2)) & 0b11;
+    tags[i] = tag == TAG_EMPTY ? TAG_EMPTY : tag_for(registers[i]);
+  }
+}
+
+// FSAVE layout, the environment then ST(0)..ST(7) as 80-bit reals
+template <typename Real>
+void FPUCore<Real>::save_state(uint8_t* out) const {
+  store_environment(out);
+  for (uint8_t i = 0; i < 8; i++) {
+    FPUReal<Real>::to_float80(registers[physical(i)]).to_bytes(out + 14 + i * 10);
+  }
+}
+
+template <typename Real>
+void FPUCore<Real>::load_state(const uint8_t* in) {
+  // TOP comes from the saved status word
+  status = static_cast<uint16_t>(get(in + 2, 2));
+  FloatEnvironment env;
+  for (uint8_t i = 0; i < 8; i++) {
+    registers[physical(i)] =
+        FPUReal<Real>::from_float80(Float80::from_bytes(in + 14 + i * 10), env);
+  }
+  load_environment(in);
+}
+
+template <typename Real>
+bool FPUCore<Real>::execute(const uint8_t opcode, const uint8_t mod_rm,
+                            uint8_t* operand) {
+  const uint8_t reg = ((mod_rm >> 3) & 0b111);
+  const uint8_t r_m = ((mod_rm >> 0) & 0b111);
+
+  switch (opcode) {
+      // FADD FMUL FCOM FCOMP FSUB FSUBR FDIV FDIVR
+      // D8 m32real / ST(i),  DA m32int,  DC m64real / ST(i),  DE m16int / ST(i)
+    case 0xD8:
+    case 0xDA:
+    case 0xDC:
+    case 0xDE: {
+      auto operation = static_cast<Operation>(reg);
+      if (operand != nullptr) {
+        const Real src = load_memory(opcode, operand);
+        arithmetic(operation, 0, src);
+        if (operation == COMP) {
+          pop();
+        }
+        return true;
+      }
+
+      if (opcode == 0xDA) {
+        return false;
+      }
+      if (opcode == 0xD8) {
+        Real src;
+        read(r_m, src);
+        arithmetic(operation, 0, src);
+        if (operation == COMP) {
+          pop();
+        }
+        return true;
+      }
+
+      // DC / DE: ST(i) = ST(i) op ST(0), with SUB / SUBR and DIV / DIVR swapped
+      if (operation == COM || operation == COMP) {
+        // DE D9 is FCOMPP, the others are undocumented aliases
+        Real src;
+        read(r_m, src);
+        arithmetic(COM, 0, src);
+        if (operation == COMP) {
+          pop();
+          if (opcode == 0xDE) {
+            pop();
+          }
+        }
+        return true;
+      }
+      if (operation >= SUB) {
+        operation = static_cast<Operation>(operation ^ 1);
+      }
+      Real src;
+      read(0, src);
+      arithmetic(operation, r_m, src);
+      if (opcode == 0xDE) {
+        pop();
+      }
+      return true;
+    }
+    case 0xD9:
+      return execute_d9(mod_rm, operand);
+    case 0xDB:
+      return execute_db(mod_rm, operand);
+    case 0xDD:
+      return execute_dd(mod_rm, operand);
+    case 0xDF:
+      return execute_df(mod_rm, operand);
+    default:
+      return false;
+  }
+}
+
+template <typename Real>
+bool FPUCore<Real>::execute_d9(const uint8_t mod_rm, uint8_t* operand) {
+  const uint8_t reg = ((mod_rm >> 3) & 0b111);
+  const uint8_t r_m = ((mod_rm >> 0) & 0b111);
+
+  if (operand != nullptr) {
+    FloatEnvironment env = environment();
+    switch (reg) {
+        // FLD m32real
+      case 0b000:
+        push(FPUReal<Real>::from_float32(static_cast<uint32_t>(get(operand, 4))));
+        break;
+        // FST m32real  (0b010)
+        // FSTP m32real (0b011)
+      case 0b010:
+      case 0b011: {
+        Real value;
+        read(0, value);
+        put(operand, FPUReal<Real>::to_float32(value, env), 4);
+        if (reg == 0b011) {
+          pop();
+        }
+        break;
+      }
+        // FLDENV m14
+      case 0b100:
+        load_environment(operand);
+        return true;
+        // FLDCW m16
+      case 0b101:
+        control = static_cast<uint16_t>(get(operand, 2));
+        break;
+        // FSTENV m14
+      case 0b110:
+        store_environment(operand);
+        break;
+        // FSTCW m16
+      case 0b111:
+        put(operand, control, 2);
+        break;
+      default:
+        return false;
+    }
+    raise(env);
+    return true;
+  }
+
+  switch (reg) {
+      // FLD ST(i)
+    case 0b000: {
+      Real value;
+      read(r_m, value);
+      push(value);
+      return true;
+    }
+      // FXCH ST(i)
+      // D9 D8+i is an undocumented FSTP ST(i)
+    case 0b001:
+    case 0b011: {
+      Real st0;
+      Real sti;
+      read(0, st0);
+      if (reg == 0b011) {
+        write(r_m, st0);
+        pop();
+        return true;
+      }
+      read(r_m, sti);
+      write(0, sti);
+      write(r_m, st0);
+      return true;
+    }
+      // FNOP
+    case 0b010:
+      return r_m == 0;
+    case 0b100: {
+      Real value;
+      const bool present = read(0, value);
+      FloatEnvironment env = environment();
+      switch (r_m) {
+          // FCHS
+        case 0b000:
+          write(0, FPUReal<Real>::negate(value));
+          break;
+          // FABS
+        case 0b001:
+          write(0, FPUReal<Real>::abs(value));
+          break;
+          // FTST
+        case 0b100:
+          compare(value, FPUReal<Real>::from_int64(0), env);
+          break;
+          // FXAM
+        case 0b101: {
+          const Float80 bits = FPUReal<Real>::to_float80(value);
+          uint16_t condition;
+          if (!present) {
+            // Reading the empty register flagged an underflow, FXAM does not
+            status &= static_cast<uint16_t>(~(SW_STACK_FAULT | SW_EXCEPTIONS |
+                                              SW_ERROR_SUMMARY | SW_BUSY));
+            condition = SW_C3 | SW_C0;
+          } else if (bits.is_nan()) {
+            condition = SW_C0;
+          } else if (bits.is_infinity()) {
+            condition = SW_C2 | SW_C0;
+          } else if (bits.is_zero()) {
+            condition = SW_C3;
+          } else if (bits.is_denormal()) {
+            condition = SW_C3 | SW_C2;
+          } else if (bits.mantissa >> 63) {
+            condition = SW_C2;
+          } else {
+            // Unnormal
+            condition = 0;
+          }
+          set_condition(condition | (bits.sign() ? SW_C1 : 0));
+          return true;
+        }
+        default:
+          return false;
+      }
+      raise(env);
+      return true;
+    }
+      // FLD1 FLDL2T FLDL2E FLDPI FLDLG2 FLDLN2 FLDZ
+    case 0b101: {
+      if (r_m == 0b111) {
+        return false;
+      }
+      FloatEnvironment env = environment();
+      push(FPUReal<Real>::from_float80(CONSTANTS[r_m], env));
+      return true;
+    }
+    case 0b110:
+    case 0b111:
+    default:
+      return execute_transcendental(mod_rm);
+  }
+}
+
+/*
+  D9 F0-FF. Functions without a correctly rounded software version are
+  computed on the host double in both modes.
+*/
+template <typename Real>
+bool FPUCore<Real>::execute_transcendental(const uint8_t mod_rm) {
+  FloatEnvironment env = environment();
+  Real st0;
+  Real st1;
+
+  // Host function of ST(0), NaN out of a non NaN is invalid
+  const auto host = [&env](const double x, const double result) {
+    if (std::isnan(result) && !std::isnan(x)) {
+      env.exceptions |= FloatEnvironment::IE;
+      return FPUReal<Real>::from_float80(Float80::indefinite(), env);
+    }
+    return FPUReal<Real>::from_double(result);
+  };
+
+  switch (mod_rm) {
+      // F2XM1
+    case 0xF0: {
+      read(0, st0);
+      const double x = FPUReal<Real>::to_double(st0);
+      write(0, host(x, std::expm1(x * LN2)));
+      break;
+    }
+      // FYL2X      (0xF1)
+      // FYL2XP1    (0xF9)
+    case 0xF1:
+    case 0xF9: {
+      read(0, st0);
+      read(1, st1);
+      const double x = FPUReal<Real>::to_double(st0);
+      const double y = FPUReal<Real>::to_double(st1);
+      if (mod_rm == 0xF1 && x == 0.0) {
+        env.exceptions |= FloatEnvironment::ZE;
+      }
+      const double log2 =
+          mod_rm == 0xF1 ? std::log2(x) : std::log1p(x) / LN2;
+      write(1, host(x, y * log2));
+      pop();
+      break;
+    }
+      // FPTAN, pushes 1 so ST(1) / ST(0) is the tangent
+    case 0xF2: {
+      read(0, st0);
+      const double x = FPUReal<Real>::to_double(st0);
+      write(0, host(x, std::tan(x)));
+      push(FPUReal<Real>::from_int64(1));
+      status &= static_cast<uint16_t>(~SW_C2);
+      break;
+    }
+      // FPATAN
+    case 0xF3: {
+      read(0, st0);
+      read(1, st1);
+      const double x = FPUReal<Real>::to_double(st0);
+      const double y = FPUReal<Real>::to_double(st1);
+      write(1, host(x, std::atan2(y, x)));
+      pop();
+      break;
+    }
+      // FXTRACT, ST(1) = exponent, ST(0) = significand
+    case 0xF4: {
+      read(0, st0);
+      const Float80 bits = FPUReal<Real>::to_float80(st0);
+      Float80 exponent;
+      Float80 significand = bits;
+      if (bits.is_zero()) {
+        env.exceptions |= FloatEnvironment::ZE;
+        exponent = Float80::infinity(true);
+      } else if (bits.is_infinity()) {
+        exponent = Float80::infinity();
+      } else if (bits.is_nan()) {
+        exponent = bits;
+      } else {
+        int32_t unbiased = bits.exponent() - Float80::BIAS;
+        uint64_t mantissa = bits.mantissa;
+        if (bits.exponent() == 0) {
+          unbiased++;
+        }
+        while (!(mantissa >> 63)) {
+          mantissa <<= 1;
+          unbiased--;
+        }
+        exponent = Float80::from_int64(unbiased);
+        significand.mantissa = mantissa;
+        significand.sign_exponent =
+            static_cast<uint16_t>((bits.sign() ? 0x8000 : 0) | Float80::BIAS);
+      }
+      write(0, FPUReal<Real>::from_float80(exponent, env));
+      push(FPUReal<Real>::from_float80(significand, env));
+      break;
+    }
+      // FDECSTP
+    case 0xF6:
+      set_top(top() - 1);
+      status &= static_cast<uint16_t>(~SW_C1);
+      return true;
+      // FINCSTP
+    case 0xF7:
+      set_top(top() + 1);
+      status &= static_cast<uint16_t>(~SW_C1);
+      return true;
+      // FPREM, C2 set while the reduction is incomplete
+    case 0xF8: {
+      read(0, st0);
+      read(1, st1);
+      uint64_t quotient;
+      bool complete;
+      write(0, FPUReal<Real>::partial_remainder(st0, st1, quotient, complete,
+                                                env));
+      uint16_t condition = complete ? 0 : SW_C2;
+      if (complete) {
+        condition |= (quotient & 0b100) ? SW_C0 : 0;
+        condition |= (quotient & 0b010) ? SW_C3 : 0;
+        condition |= (quotient & 0b001) ? SW_C1 : 0;
+      }
+      set_condition(condition);
+      break;
+    }
+      // FSQRT
+    case 0xFA:
+      read(0, st0);
+      write(0, FPUReal<Real>::sqrt(st0, env));
+      break;
+      // FRNDINT
+    case 0xFC:
+      read(0, st0);
+      write(0, FPUReal<Real>::round_to_integer(st0, env));
+      break;
+      // FSCALE, ST(0) * 2^trunc(ST(1))
+    case 0xFD: {
+      read(0, st0);
+      read(1, st1);
+      const double n = std::trunc(FPUReal<Real>::to_double(st1));
+      const int32_t clamped =
+          n > (1 << 20) ? (1 << 20) : (n < -(1 << 20) ? -(1 << 20)
+                                                      : static_cast<int32_t>(n));
+      write(0, FPUReal<Real>::scale(st0, clamped, env));
+      break;
+    }
+      // FPREM1 FSINCOS FSIN FCOS are 80387 and later
+    default:
+      return false;
+  }
+
+  raise(env);
+  return true;
+}
+
+template <typename Real>
+bool FPUCore<Real>::execute_db(const uint8_t mod_rm, uint8_t* operand) {
+  const uint8_t reg = ((mod_rm >> 3) & 0b111);
+
+  if (operand == nullptr) {
+    switch (mod_rm) {
+        // FENI
+      case 0xE0:
+        control &= static_cast<uint16_t>(~CONTROL_INTERRUPT_MASK);
+        return true;
+        // FDISI
+      case 0xE1:
+        control |= CONTROL_INTERRUPT_MASK;
+        return true;
+        // FCLEX
+      case 0xE2:
+        status &= static_cast<uint16_t>(~(SW_EXCEPTIONS | SW_STACK_FAULT |
+                                          SW_ERROR_SUMMARY | SW_BUSY));
+        return true;
+        // FINIT
+      case 0xE3:
+        reset();
+        return true;
+        // FSETPM, nothing to do for a real mode FPU
+      case 0xE4:
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  FloatEnvironment env = environment();
+  switch (reg) {
+      // FILD m32int
+    case 0b000:
+      push(FPUReal<Real>::from_int64(
+          static_cast<int32_t>(static_cast<uint32_t>(get(operand, 4)))));
+      break;
+      // FIST m32int  (0b010)
+      // FISTP m32int (0b011)
+    case 0b010:
+    case 0b011: {
+      Real value;
+      read(0, value);
+      store_integer(value, operand, 4, env);
+      if (reg == 0b011) {
+        pop();
+      }
+      break;
+    }
+      // FLD m80real
+    case 0b101:
+      push(FPUReal<Real>::from_float80(Float80::from_bytes(operand), env));
+      break;
+      // FSTP m80real
+    case 0b111: {
+      Real value;
+      read(0, value);
+      FPUReal<Real>::to_float80(value).to_bytes(operand);
+      pop();
+      break;
+    }
+    default:
+      return false;
+  }
+  raise(env);
+  return true;
+}
+
+template <typename Real>
+bool FPUCore<Real>::execute_dd(const uint8_t mod_rm, uint8_t* operand) {
+  const uint8_t reg = ((mod_rm >> 3) & 0b111);
+  const uint8_t r_m = ((mod_rm >> 0) & 0b111);
+
+  if (operand == nullptr) {
+    switch (reg) {
+        // FFREE ST(i)
+      case 0b000:
+        tags[physical(r_m)] = TAG_EMPTY;
+        return true;
+        // Undocumented FXCH ST(i)
+      case 0b001: {
+        Real st0;
+        Real sti;
+        read(0, st0);
+        read(r_m, sti);
+        write(0, sti);
+        write(r_m, st0);
+        return true;
+      }
+        // FST ST(i)  (0b010)
+        // FSTP ST(i) (0b011)
+      case 0b010:
+      case 0b011: {
+        Real value;
+        read(0, value);
+        write(r_m, value);
+        if (reg == 0b011) {
+          pop();
+        }
+        return true;
+      }
+      default:
+        return false;
+    }
+  }
+
+  FloatEnvironment env = environment();
+  switch (reg) {
+      // FLD m64real
+    case 0b000:
+      push(FPUReal<Real>::from_float64(get(operand, 8)));
+      break;
+      // FST m64real  (0b010)
+      // FSTP m64real (0b011)
+    case 0b010:
+    case 0b011: {
+      Real value;
+      read(0, value);
+      put(operand, FPUReal<Real>::to_float64(value, env), 8);
+      if (reg == 0b011) {
+        pop();
+      }
+      break;
+    }
+      // FRSTOR m94
+    case 0b100:
+      load_state(operand);
+      return true;
+      // FSAVE m94, leaves the FPU initialized
+    case 0b110:
+      save_state(operand);
+      reset();
+      return true;
+      // FSTSW m16
+    case 0b111:
+      put(operand, status_word(), 2);
+      return true;
+    default:
+      return false;
+  }
+  raise(env);
+  return true;
+}
+
+template <typename Real>
+bool FPUCore<Real>::execute_df(const uint8_t mod_rm, uint8_t* operand) {
+  const uint8_t reg = ((mod_rm >> 3) & 0b111);
+  const uint8_t r_m = ((mod_rm >> 0) & 0b111);
+
+  if (operand == nullptr) {
+    // Undocumented FFREEP, FXCH and FSTP aliases
+    switch (reg) {
+      case 0b000:
+        tags[physical(r_m)] = TAG_EMPTY;
+        pop();
+        return true;
+      case 0b001:
+      case 0b010:
+      case 0b011:
+        return execute_dd(static_cast<uint8_t>(reg == 0b001 ? mod_rm : (0xD8 | r_m)),
+                          nullptr);
+      default:
+        return false;
+    }
+  }
+
+  FloatEnvironment env = environment();
+  switch (reg) {
+      // FILD m16int
+    case 0b000:
+      push(FPUReal<Real>::from_int64(
+          static_cast<int16_t>(static_cast<uint16_t>(get(operand, 2)))));
+      break;
+      // FIST m16int  (0b010)
+      // FISTP m16int (0b011)
+    case 0b010:
+    case 0b011: {
+      Real value;
+      read(0, value);
+      store_integer(value, operand, 2, env);
+      if (reg == 0b011) {
+        pop();
+      }
+      break;
+    }
+      // FBLD m80bcd
+    case 0b100:
+      push(load_bcd(operand));
+      break;
+      // FILD m64int
+    case 0b101:
+      push(FPUReal<Real>::from_int64(static_cast<int64_t>(get(operand, 8))));
+      break;
+      // FBSTP m80bcd
+    case 0b110: {
+      Real value;
+      read(0, value);
+      store_bcd(value, operand, env);
+      pop();
+      break;
+    }
+      // FISTP m64int
+    case 0b111: {
+      Real value;
+      read(0, value);
+      store_integer(value, operand, 8, env);
+      pop();
+      break;
+    }
+    default:
+      return false;
+  }
+  raise(env);
+  return true;
+}
+
+template class FPUCore<double>;
+template class FPUCore<Float80>;
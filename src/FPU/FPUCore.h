@@ -0,0 +1,86 @@
+#ifndef FPUCORE_H
+#define FPUCORE_H
+
+#include <cstdint>
+
+#include "FPU.h"
+#include "Float80.h"
+
+/*
+  8087 instruction set over a register type, see FPUReal for the two
+  flavours. Exceptions always get the masked response (the result is
+  written); unmasked ones only set ES and B in the status word, as
+  there is no interrupt line to the CPU.
+*/
+template <typename Real>
+class FPUCore final : public FPU {
+ public:
+  FPUCore();
+
+  bool execute(uint8_t opcode, uint8_t mod_rm, uint8_t* operand) override;
+  [[nodiscard]] uint16_t status_word() const override;
+  void reset() override;
+
+  void save_state(uint8_t* out) const override;
+  void load_state(const uint8_t* in) override;
+
+ private:
+  static constexpr uint16_t SW_EXCEPTIONS = 0x003F;
+  static constexpr uint16_t SW_STACK_FAULT = 1 << 6;
+  static constexpr uint16_t SW_ERROR_SUMMARY = 1 << 7;
+  static constexpr uint16_t SW_C0 = 1 << 8;
+  static constexpr uint16_t SW_C1 = 1 << 9;
+  static constexpr uint16_t SW_C2 = 1 << 10;
+  static constexpr uint16_t SW_TOP_SHIFT = 11;
+  static constexpr uint16_t SW_TOP_MASK = 0b111 << SW_TOP_SHIFT;
+  static constexpr uint16_t SW_C3 = 1 << 14;
+  static constexpr uint16_t SW_BUSY = 1 << 15;
+  static constexpr uint16_t SW_CONDITION = SW_C0 | SW_C1 | SW_C2 | SW_C3;
+
+  static constexpr uint8_t TAG_VALID = 0b00;
+  static constexpr uint8_t TAG_ZERO = 0b01;
+  static constexpr uint8_t TAG_SPECIAL = 0b10;
+  static constexpr uint8_t TAG_EMPTY = 0b11;
+
+  // Arithmetic group, the reg field of D8 / DA / DC / DE
+  enum Operation : uint8_t { ADD, MUL, COM, COMP, SUB, SUBR, DIV, DIVR };
+
+  [[nodiscard]] uint8_t top() const;
+  void set_top(uint8_t top);
+  [[nodiscard]] uint8_t physical(uint8_t i) const;
+
+  [[nodiscard]] FloatEnvironment environment() const;
+  void raise(const FloatEnvironment& env);
+  void set_condition(uint16_t condition);
+
+  static uint8_t tag_for(const Real& value);
+  bool read(uint8_t i, Real& value);
+  void write(uint8_t i, const Real& value);
+  void push(const Real& value);
+  void pop();
+
+  void arithmetic(Operation operation, uint8_t dest, const Real& src);
+  void compare(const Real& lhs, const Real& rhs, FloatEnvironment& env);
+
+  Real load_memory(uint8_t opcode, const uint8_t* operand) const;
+  void store_integer(const Real& value, uint8_t* operand, uint8_t size,
+                     FloatEnvironment& env);
+  Real load_bcd(const uint8_t* operand) const;
+  void store_bcd(const Real& value, uint8_t* operand, FloatEnvironment& env);
+
+  void store_environment(uint8_t* out) const;
+  void load_environment(const uint8_t* in);
+
+  bool execute_d9(uint8_t mod_rm, uint8_t* operand);
+  bool execute_db(uint8_t mod_rm, uint8_t* operand);
+  bool execute_dd(uint8_t mod_rm, uint8_t* operand);
+  bool execute_df(uint8_t mod_rm, uint8_t* operand);
+  bool execute_transcendental(uint8_t mod_rm);
+
+  Real registers[8];
+  uint8_t tags[8];
+  uint16_t control;
+  uint16_t status;
+};
+
+#endif  // FPUCORE_H
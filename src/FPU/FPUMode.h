@@ -0,0 +1,12 @@
+#pragma once
+
+/*
+  NONE  -> no coprocessor, ESC instructions only fetch their operand
+  FAST  -> register stack on host doubles
+  EXACT -> software 80-bit extended precision, bit exact with an 8087
+*/
+enum class FPU_MODE {
+  NONE,
+  FAST,
+  EXACT
+};
@@ -0,0 +1,226 @@
+#ifndef FPUREAL_H
+#define FPUREAL_H
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include "Float80.h"
+
+/*
+  Arithmetic the FPU core needs from its register type. Both flavours
+  convert to and from Float80 exactly in the direction that matters
+  (double -> Float80), which is what loads / stores of m80 and the bit
+  level instructions (FXAM, FXTRACT) go through.
+*/
+template <typename Real>
+struct FPUReal;
+
+/*
+  Exact mode, every operation is correctly rounded in the environment.
+  Transcendentals go through the host double in both modes.
+*/
+template <>
+struct FPUReal<Float80> {
+  static Float80 from_float80(const Float80& value, FloatEnvironment&) {
+    return value;
+  }
+  static Float80 to_float80(const Float80& value) { return value; }
+  static Float80 from_double(const double value) {
+    return Float80::from_double(value);
+  }
+  static double to_double(const Float80& value) { return value.to_double(); }
+
+  static Float80 from_float32(const uint32_t bits) {
+    return Float80::from_float32(bits);
+  }
+  static Float80 from_float64(const uint64_t bits) {
+    return Float80::from_float64(bits);
+  }
+  static uint32_t to_float32(const Float80& value, FloatEnvironment& env) {
+    return value.to_float32(env);
+  }
+  static uint64_t to_float64(const Float80& value, FloatEnvironment& env) {
+    return value.to_float64(env);
+  }
+  static Float80 from_int64(const int64_t value) {
+    return Float80::from_int64(value);
+  }
+  static bool to_int64(const Float80& value, FloatEnvironment& env,
+                       int64_t& result) {
+    return value.to_int64(env, result);
+  }
+
+  static Float80 add(const Float80& a, const Float80& b,
+                     FloatEnvironment& env) {
+    return Float80::add(a, b, env);
+  }
+  static Float80 sub(const Float80& a, const Float80& b,
+                     FloatEnvironment& env) {
+    return Float80::sub(a, b, env);
+  }
+  static Float80 mul(const Float80& a, const Float80& b,
+                     FloatEnvironment& env) {
+    return Float80::mul(a, b, env);
+  }
+  static Float80 div(const Float80& a, const Float80& b,
+                     FloatEnvironment& env) {
+    return Float80::div(a, b, env);
+  }
+  static Float80 sqrt(const Float80& a, FloatEnvironment& env) {
+    return Float80::sqrt(a, env);
+  }
+  static Float80 round_to_integer(const Float80& a, FloatEnvironment& env) {
+    return Float80::round_to_integer(a, env);
+  }
+  static Float80 scale(const Float80& a, const int32_t n,
+                       FloatEnvironment& env) {
+    return Float80::scale(a, n, env);
+  }
+  static Float80 partial_remainder(const Float80& a, const Float80& b,
+                                   uint64_t& quotient, bool& complete,
+                                   FloatEnvironment& env) {
+    return Float80::partial_remainder(a, b, quotient, complete, env);
+  }
+  static Float80::Ordering compare(const Float80& a, const Float80& b) {
+    return Float80::compare(a, b);
+  }
+  static Float80 negate(const Float80& a) { return a.negate(); }
+  static Float80 abs(const Float80& a) { return a.abs(); }
+};
+
+/*
+  Fast mode, host doubles. Results are rounded to 53 bits in the host's
+  rounding mode whatever the control word says; only FRNDINT and the
+  integer stores honour the rounding control.
+*/
+template <>
+struct FPUReal<double> {
+  static double from_float80(const Float80& value, FloatEnvironment& env) {
+    FloatEnvironment nearest;
+    const uint64_t bits = value.to_float64(nearest);
+    env.exceptions |= nearest.exceptions & FloatEnvironment::IE;
+    return from_float64(bits);
+  }
+  static Float80 to_float80(const double value) {
+    return Float80::from_double(value);
+  }
+  static double from_double(const double value) { return value; }
+  static double to_double(const double value) { return value; }
+
+  static double from_float32(const uint32_t bits) {
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+  static double from_float64(const uint64_t bits) {
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+  static uint32_t to_float32(const double value, FloatEnvironment& env) {
+    const float narrowed = static_cast<float>(value);
+    if (std::isinf(narrowed) && !std::isinf(value)) {
+      env.exceptions |= FloatEnvironment::OE | FloatEnvironment::PE;
+    }
+    uint32_t bits;
+    std::memcpy(&bits, &narrowed, sizeof(bits));
+    return bits;
+  }
+  static uint64_t to_float64(const double value, FloatEnvironment&) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+  }
+  static double from_int64(const int64_t value) {
+    return static_cast<double>(value);
+  }
+  static bool to_int64(const double value, FloatEnvironment& env,
+                       int64_t& result) {
+    const double rounded = round_to_integer(value, env);
+    // 2^63, the first value that does not fit
+    constexpr double LIMIT = 9223372036854775808.0;
+    if (std::isnan(rounded) || rounded >= LIMIT || rounded < -LIMIT) {
+      return false;
+    }
+    result = static_cast<int64_t>(rounded);
+    return true;
+  }
+
+  static double add(const double a, const double b, FloatEnvironment& env) {
+    return check(a + b, a, b, env);
+  }
+  static double sub(const double a, const double b, FloatEnvironment& env) {
+    return check(a - b, a, b, env);
+  }
+  static double mul(const double a, const double b, FloatEnvironment& env) {
+    return check(a * b, a, b, env);
+  }
+  static double div(const double a, const double b, FloatEnvironment& env) {
+    if (b == 0.0 && a != 0.0 && !std::isnan(a)) {
+      env.exceptions |= FloatEnvironment::ZE;
+    }
+    return check(a / b, a, b, env);
+  }
+  static double sqrt(const double a, FloatEnvironment& env) {
+    return check(std::sqrt(a), a, a, env);
+  }
+  static double round_to_integer(const double a, FloatEnvironment& env) {
+    double rounded;
+    switch (env.rounding) {
+      case FloatEnvironment::DOWN:
+        rounded = std::floor(a);
+        break;
+      case FloatEnvironment::UP:
+        rounded = std::ceil(a);
+        break;
+      case FloatEnvironment::ZERO:
+        rounded = std::trunc(a);
+        break;
+      case FloatEnvironment::NEAREST:
+      default:
+        rounded = std::nearbyint(a);
+        break;
+    }
+    if (rounded != a && !std::isnan(a)) {
+      env.exceptions |= FloatEnvironment::PE;
+    }
+    return rounded;
+  }
+  static double scale(const double a, const int32_t n, FloatEnvironment&) {
+    return std::ldexp(a, n);
+  }
+  static double partial_remainder(const double a, const double b,
+                                  uint64_t& quotient, bool& complete,
+                                  FloatEnvironment& env) {
+    complete = true;
+    // fmod is exact, the low quotient bits come from a remainder by 8b
+    const double remainder = check(std::fmod(a, b), a, b, env);
+    const double by_eight = std::fmod(std::fabs(a), 8.0 * std::fabs(b));
+    quotient = std::isfinite(by_eight)
+                   ? static_cast<uint64_t>(by_eight / std::fabs(b)) & 7
+                   : 0;
+    return remainder;
+  }
+  static Float80::Ordering compare(const double a, const double b) {
+    if (std::isnan(a) || std::isnan(b)) return Float80::Ordering::UNORDERED;
+    if (a < b) return Float80::Ordering::LESS;
+    if (a > b) return Float80::Ordering::GREATER;
+    return Float80::Ordering::EQUAL;
+  }
+  static double negate(const double a) { return -a; }
+  static double abs(const double a) { return std::fabs(a); }
+
+ private:
+  // A NaN out of non NaN operands is an invalid operation
+  static double check(const double result, const double a, const double b,
+                      FloatEnvironment& env) {
+    if (std::isnan(result) && !std::isnan(a) && !std::isnan(b)) {
+      env.exceptions |= FloatEnvironment::IE;
+      return from_float80(Float80::indefinite(), env);
+    }
+    return result;
+  }
+};
+
+#endif  // FPUREAL_H
@@ -0,0 +1,796 @@
+#include "Float80.h"
+
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+namespace {
+
+constexpr uint64_t INTEGER_BIT = 1ULL << 63;
+constexpr uint64_t QUIET_BIT = 1ULL << 62;
+
+// 128-bit unsigned, MSVC has no __int128
+struct U128 {
+  uint64_t hi{0};
+  uint64_t lo{0};
+
+  [[nodiscard]] bool is_zero() const { return (hi | lo) == 0; }
+  bool operator>=(const U128& other) const {
+    return hi != other.hi ? hi > other.hi : lo >= other.lo;
+  }
+  bool operator>(const U128& other) const {
+    return hi != other.hi ? hi > other.hi : lo > other.lo;
+  }
+  U128 operator+(const U128& other) const {
+    U128 result{hi + other.hi, lo + other.lo};
+    result.hi += result.lo < lo;
+    return result;
+  }
+  U128 operator-(const U128& other) const {
+    U128 result{hi - other.hi, lo - other.lo};
+    result.hi -= lo < other.lo;
+    return result;
+  }
+  U128 operator>>(const int n) const {
+    if (n == 0) return *this;
+    if (n >= 128) return U128{};
+    if (n >= 64) return U128{0, hi >> (n - 64)};
+    return U128{hi >> n, (lo >> n) | (hi << (64 - n))};
+  }
+  U128 operator<<(const int n) const {
+    if (n == 0) return *this;
+    if (n >= 128) return U128{};
+    if (n >= 64) return U128{lo << (n - 64), 0};
+    return U128{(hi << n) | (lo >> (64 - n)), lo << n};
+  }
+};
+
+int leading_zeros(uint64_t value) {
+  if (value == 0) {
+    return 64;
+  }
+  int count = 0;
+  for (int step = 32; step > 0; step /= 2) {
+    if (!(value >> (64 - step))) {
+      count += step;
+      value <<= step;
+    }
+  }
+  return count;
+}
+
+int leading_zeros(const U128& value) {
+  return value.hi ? leading_zeros(value.hi) : 64 + leading_zeros(value.lo);
+}
+
+// Shifts right, ORing everything shifted out into the lowest bit
+U128 shift_right_sticky(const U128& value, const int n) {
+  if (n <= 0) {
+    return value;
+  }
+  const U128 shifted = value >> n;
+  const bool sticky = n >= 128 ? !value.is_zero()
+                               : !(value - (shifted << n)).is_zero();
+  return U128{shifted.hi, shifted.lo | static_cast<uint64_t>(sticky)};
+}
+
+U128 multiply(const uint64_t a, const uint64_t b) {
+  const uint64_t a_lo = a & 0xFFFFFFFF, a_hi = a >> 32;
+  const uint64_t b_lo = b & 0xFFFFFFFF, b_hi = b >> 32;
+
+  const uint64_t lo_lo = a_lo * b_lo;
+  const uint64_t hi_lo = a_hi * b_lo;
+  const uint64_t lo_hi = a_lo * b_hi;
+  const uint64_t hi_hi = a_hi * b_hi;
+
+  const uint64_t middle = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFF) + lo_hi;
+  return U128{hi_hi + (hi_lo >> 32) + (middle >> 32),
+              (middle << 32) | (lo_lo & 0xFFFFFFFF)};
+}
+
+bool round_up(const bool sign, const bool lsb, const bool round,
+              const bool sticky, const FloatEnvironment::Rounding rounding) {
+  switch (rounding) {
+    case FloatEnvironment::NEAREST:
+      return round && (sticky || lsb);
+    case FloatEnvironment::DOWN:
+      return (round || sticky) && sign;
+    case FloatEnvironment::UP:
+      return (round || sticky) && !sign;
+    case FloatEnvironment::ZERO:
+    default:
+      return false;
+  }
+}
+
+// Overflow goes to infinity or the largest finite value, by rounding mode
+bool overflows_to_infinity(const bool sign,
+                           const FloatEnvironment::Rounding rounding) {
+  return rounding == FloatEnvironment::NEAREST ||
+         (rounding == FloatEnvironment::DOWN && sign) ||
+         (rounding == FloatEnvironment::UP && !sign);
+}
+
+/*
+  Finite non zero value, normalized so the integer bit is set. The
+  exponent is biased but can go below 1 for denormals.
+*/
+struct Unpacked {
+  bool sign;
+  int32_t exponent;
+  uint64_t mantissa;
+};
+
+Unpacked unpack(const Float80& value, FloatEnvironment& env) {
+  Unpacked result{value.sign(), value.exponent(), value.mantissa};
+  if (result.exponent == 0) {
+    env.exceptions |= FloatEnvironment::DE;
+    result.exponent = 1;
+  }
+  // Denormals and 8087 unnormals
+  const int shift = leading_zeros(result.mantissa);
+  result.mantissa <<= shift;
+  result.exponent -= shift;
+  return result;
+}
+
+Float80 make(const bool sign, const uint16_t exponent,
+             const uint64_t mantissa) {
+  Float80 result;
+  result.mantissa = mantissa;
+  result.sign_exponent =
+      static_cast<uint16_t>((sign ? 0x8000 : 0) | (exponent & 0x7FFF));
+  return result;
+}
+
+/*
+  Rounds hi.lo * 2^(exponent - BIAS - 63) to the environment precision.
+  hi has the integer bit set, lo holds the bits below it.
+*/
+Float80 round_pack(const bool sign, int32_t exponent, U128 value,
+                   FloatEnvironment& env) {
+  if (value.is_zero()) {
+    return Float80::zero(sign);
+  }
+
+  bool tiny = false;
+  if (exponent <= 0) {
+    value = shift_right_sticky(value, 1 - exponent);
+    exponent = 0;
+    tiny = true;
+  }
+
+  const int dropped = 64 - env.precision;
+  bool round;
+  bool sticky;
+  if (dropped == 0) {
+    round = value.lo >> 63;
+    sticky = (value.lo << 1) != 0;
+  } else {
+    round = (value.hi >> (dropped - 1)) & 1;
+    sticky = (value.hi & ((1ULL << (dropped - 1)) - 1)) != 0 || value.lo != 0;
+    value.hi &= ~((1ULL << dropped) - 1);
+  }
+
+  uint64_t mantissa = value.hi;
+  if (round_up(sign, (mantissa >> dropped) & 1, round, sticky, env.rounding)) {
+    mantissa += 1ULL << dropped;
+    if (mantissa == 0) {
+      mantissa = INTEGER_BIT;
+      exponent++;
+    }
+  }
+  if (exponent == 0 && (mantissa & INTEGER_BIT)) {
+    exponent = 1;
+  }
+
+  if (round || sticky) {
+    env.exceptions |= FloatEnvironment::PE;
+    if (tiny) {
+      env.exceptions |= FloatEnvironment::UE;
+    }
+  }
+
+  if (exponent >= Float80::MAX_EXPONENT) {
+    env.exceptions |= FloatEnvironment::OE | FloatEnvironment::PE;
+    if (overflows_to_infinity(sign, env.rounding)) {
+      return Float80::infinity(sign);
+    }
+    return make(sign, Float80::MAX_EXPONENT - 1,
+                ~((1ULL << dropped) - 1));
+  }
+  return make(sign, static_cast<uint16_t>(exponent), mantissa);
+}
+
+Float80 round_pack(const Unpacked& value, FloatEnvironment& env) {
+  return round_pack(value.sign, value.exponent, U128{value.mantissa, 0}, env);
+}
+
+bool is_signaling(const Float80& value) {
+  return value.is_nan() && !(value.mantissa & QUIET_BIT);
+}
+
+Float80 propagate_nan(const Float80& a, const Float80& b,
+                      FloatEnvironment& env) {
+  if (is_signaling(a) || is_signaling(b)) {
+    env.exceptions |= FloatEnvironment::IE;
+  }
+
+  // The NaN with the larger significand wins
+  Float80 result = a;
+  if (!a.is_nan() ||
+      (b.is_nan() && (b.mantissa << 1) > (a.mantissa << 1))) {
+    result = b;
+  }
+  result.mantissa |= QUIET_BIT;
+  return result;
+}
+
+Float80 invalid(FloatEnvironment& env) {
+  env.exceptions |= FloatEnvironment::IE;
+  return Float80::indefinite();
+}
+
+// -1, 0, 1 on the magnitudes of two finite values
+int compare_magnitude(const Unpacked& a, const Unpacked& b) {
+  if (a.exponent != b.exponent) {
+    return a.exponent < b.exponent ? -1 : 1;
+  }
+  if (a.mantissa != b.mantissa) {
+    return a.mantissa < b.mantissa ? -1 : 1;
+  }
+  return 0;
+}
+
+/*
+  IEEE single / double with frac_bits stored significand bits.
+  NaNs keep their top payload bits and are always quiet.
+*/
+uint64_t pack_ieee(const Float80& value, const int frac_bits,
+                   const int32_t bias, const uint32_t max_exponent,
+                   FloatEnvironment& env) {
+  const uint64_t sign = static_cast<uint64_t>(value.sign())
+                        << (frac_bits + (max_exponent == 0xFF ? 8 : 11));
+  const uint64_t frac_mask = (1ULL << frac_bits) - 1;
+  const int dropped = 63 - frac_bits;
+
+  if (value.is_nan()) {
+    if (is_signaling(value)) {
+      env.exceptions |= FloatEnvironment::IE;
+    }
+    return sign | (static_cast<uint64_t>(max_exponent) << frac_bits) |
+           ((value.mantissa >> dropped) & frac_mask) |
+           (1ULL << (frac_bits - 1));
+  }
+  if (value.is_infinity()) {
+    return sign | (static_cast<uint64_t>(max_exponent) << frac_bits);
+  }
+  if (value.is_zero()) {
+    return sign;
+  }
+
+  const Unpacked u = unpack(value, env);
+  int32_t exponent = u.exponent - Float80::BIAS + bias;
+  U128 bits{u.mantissa, 0};
+  bool tiny = false;
+  if (exponent <= 0) {
+    bits = shift_right_sticky(bits, 1 - exponent);
+    exponent = 0;
+    tiny = true;
+  }
+
+  const bool round = (bits.hi >> (dropped - 1)) & 1;
+  const bool sticky =
+      (bits.hi & ((1ULL << (dropped - 1)) - 1)) != 0 || bits.lo != 0;
+  uint64_t mantissa = bits.hi >> dropped;
+  if (round_up(u.sign, mantissa & 1, round, sticky, env.rounding)) {
+    mantissa++;
+  }
+  // Rounding carried into the next exponent, or a denormal became normal
+  if (mantissa >> (frac_bits + 1)) {
+    mantissa >>= 1;
+    exponent++;
+  } else if (exponent == 0 && (mantissa >> frac_bits)) {
+    exponent = 1;
+  }
+
+  if (round || sticky) {
+    env.exceptions |= FloatEnvironment::PE;
+    if (tiny) {
+      env.exceptions |= FloatEnvironment::UE;
+    }
+  }
+
+  if (exponent >= static_cast<int32_t>(max_exponent)) {
+    env.exceptions |= FloatEnvironment::OE | FloatEnvironment::PE;
+    if (overflows_to_infinity(u.sign, env.rounding)) {
+      return sign | (static_cast<uint64_t>(max_exponent) << frac_bits);
+    }
+    return sign | (static_cast<uint64_t>(max_exponent - 1) << frac_bits) |
+           frac_mask;
+  }
+  return sign | (static_cast<uint64_t>(exponent) << frac_bits) |
+         (mantissa & frac_mask);
+}
+
+Float80 unpack_ieee(const uint64_t bits, const int frac_bits,
+                    const int32_t bias, const uint32_t max_exponent) {
+  const bool sign = (bits >> (frac_bits + (max_exponent == 0xFF ? 8 : 11))) & 1;
+  const uint32_t exponent = (bits >> frac_bits) & max_exponent;
+  const uint64_t frac = bits & ((1ULL << frac_bits) - 1);
+  const int dropped = 63 - frac_bits;
+
+  if (exponent == max_exponent) {
+    return make(sign, Float80::MAX_EXPONENT, INTEGER_BIT | (frac << dropped));
+  }
+  if (exponent == 0) {
+    if (frac == 0) {
+      return Float80::zero(sign);
+    }
+    const int shift = leading_zeros(frac);
+    return make(sign,
+                static_cast<uint16_t>(Float80::BIAS - bias + 1 - frac_bits +
+                                      63 - shift),
+                frac << shift);
+  }
+  return make(sign, static_cast<uint16_t>(exponent - bias + Float80::BIAS),
+              INTEGER_BIT | (frac << dropped));
+}
+
+}  // namespace
+
+Float80 Float80::zero(const bool negative) { return make(negative, 0, 0); }
+
+Float80 Float80::infinity(const bool negative) {
+  return make(negative, MAX_EXPONENT, INTEGER_BIT);
+}
+
+Float80 Float80::indefinite() {
+  return make(true, MAX_EXPONENT, INTEGER_BIT | QUIET_BIT);
+}
+
+Float80 Float80::from_bytes(const uint8_t* in) {
+  Float80 result;
+  for (int i = 7; i >= 0; i--) {
+    result.mantissa = (result.mantissa << 8) | in[i];
+  }
+  result.sign_exponent = static_cast<uint16_t>(in[8] | (in[9] << 8));
+  return result;
+}
+
+void Float80::to_bytes(uint8_t* out) const {
+  for (int i = 0; i < 8; i++) {
+    out[i] = static_cast<uint8_t>(mantissa >> (i * 8));
+  }
+  out[8] = static_cast<uint8_t>(sign_exponent & 0xFF);
+  out[9] = static_cast<uint8_t>(sign_exponent >> 8);
+}
+
+Float80 Float80::from_float32(const uint32_t bits) {
+  return unpack_ieee(bits, 23, 127, 0xFF);
+}
+
+Float80 Float80::from_float64(const uint64_t bits) {
+  return unpack_ieee(bits, 52, 1023, 0x7FF);
+}
+
+Float80 Float80::from_double(const double value) {
+  uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return from_float64(bits);
+}
+
+Float80 Float80::from_int64(const int64_t value) {
+  if (value == 0) {
+    return zero();
+  }
+  const bool sign = value < 0;
+  const uint64_t magnitude =
+      sign ? ~static_cast<uint64_t>(value) + 1 : static_cast<uint64_t>(value);
+  const int shift = leading_zeros(magnitude);
+  return make(sign, static_cast<uint16_t>(BIAS + 63 - shift),
+              magnitude << shift);
+}
+
+uint32_t Float80::to_float32(FloatEnvironment& env) const {
+  return static_cast<uint32_t>(pack_ieee(*this, 23, 127, 0xFF, env));
+}
+
+uint64_t Float80::to_float64(FloatEnvironment& env) const {
+  return pack_ieee(*this, 52, 1023, 0x7FF, env);
+}
+
+double Float80::to_double() const {
+  FloatEnvironment env;
+  const uint64_t bits = to_float64(env);
+  double value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+bool Float80::to_int64(FloatEnvironment& env, int64_t& value) const {
+  if (is_nan() || is_infinity()) {
+    return false;
+  }
+
+  const Float80 rounded = round_to_integer(*this, env);
+  if (rounded.is_zero()) {
+    value = 0;
+    return true;
+  }
+
+  const int32_t exponent = rounded.exponent() - BIAS;
+  if (exponent > 63) {
+    return false;
+  }
+  const uint64_t magnitude = rounded.mantissa >> (63 - exponent);
+  if (exponent == 63) {
+    // Only -2^63 fits
+    if (!rounded.sign() || magnitude != INTEGER_BIT) {
+      return false;
+    }
+    value = INT64_MIN;
+    return true;
+  }
+  value = rounded.sign() ? -static_cast<int64_t>(magnitude)
+                         : static_cast<int64_t>(magnitude);
+  return true;
+}
+
+bool Float80::is_zero() const { return exponent() == 0 && mantissa == 0; }
+
+bool Float80::is_infinity() const {
+  return exponent() == MAX_EXPONENT && (mantissa << 1) == 0;
+}
+
+bool Float80::is_nan() const {
+  return exponent() == MAX_EXPONENT && (mantissa << 1) != 0;
+}
+
+bool Float80::is_denormal() const { return exponent() == 0 && mantissa != 0; }
+
+Float80 Float80::negate() const {
+  Float80 result = *this;
+  result.sign_exponent ^= 0x8000;
+  return result;
+}
+
+Float80 Float80::abs() const {
+  Float80 result = *this;
+  result.sign_exponent &= 0x7FFF;
+  return result;
+}
+
+Float80 Float80::add(const Float80& a, const Float80& b,
+                     FloatEnvironment& env) {
+  if (a.is_nan() || b.is_nan()) {
+    return propagate_nan(a, b, env);
+  }
+  if (a.is_infinity()) {
+    if (b.is_infinity() && a.sign() != b.sign()) {
+      return invalid(env);
+    }
+    return a;
+  }
+  if (b.is_infinity()) {
+    return b;
+  }
+  if (a.is_zero() && b.is_zero()) {
+    // Exact zero sums are +0, except when rounding down
+    const bool sign = a.sign() == b.sign()
+                          ? a.sign()
+                          : env.rounding == FloatEnvironment::DOWN;
+    return zero(sign);
+  }
+  if (a.is_zero()) {
+    return round_pack(unpack(b, env), env);
+  }
+  if (b.is_zero()) {
+    return round_pack(unpack(a, env), env);
+  }
+
+  Unpacked big = unpack(a, env);
+  Unpacked small = unpack(b, env);
+  if (compare_magnitude(big, small) < 0) {
+    std::swap(big, small);
+  }
+
+  const U128 aligned =
+      shift_right_sticky(U128{small.mantissa, 0}, big.exponent - small.exponent);
+  int32_t exponent = big.exponent;
+  U128 sum;
+  if (big.sign == small.sign) {
+    sum = U128{big.mantissa, 0} + aligned;
+    if (sum.hi < big.mantissa) {
+      sum = shift_right_sticky(sum, 1);
+      sum.hi |= INTEGER_BIT;
+      exponent++;
+    }
+  } else {
+    sum = U128{big.mantissa, 0} - aligned;
+    if (sum.is_zero()) {
+      return zero(env.rounding == FloatEnvironment::DOWN);
+    }
+    const int shift = leading_zeros(sum);
+    sum = sum << shift;
+    exponent -= shift;
+  }
+  return round_pack(big.sign, exponent, sum, env);
+}
+
+Float80 Float80::sub(const Float80& a, const Float80& b,
+                     FloatEnvironment& env) {
+  if (a.is_nan() || b.is_nan()) {
+    return propagate_nan(a, b, env);
+  }
+  return add(a, b.negate(), env);
+}
+
+Float80 Float80::mul(const Float80& a, const Float80& b,
+                     FloatEnvironment& env) {
+  if (a.is_nan() || b.is_nan()) {
+    return propagate_nan(a, b, env);
+  }
+  const bool sign = a.sign() != b.sign();
+  if (a.is_infinity() || b.is_infinity()) {
+    if (a.is_zero() || b.is_zero()) {
+      return invalid(env);
+    }
+    return infinity(sign);
+  }
+  if (a.is_zero() || b.is_zero()) {
+    return zero(sign);
+  }
+
+  const Unpacked ua = unpack(a, env);
+  const Unpacked ub = unpack(b, env);
+  U128 product = multiply(ua.mantissa, ub.mantissa);
+  int32_t exponent = ua.exponent + ub.exponent - BIAS + 1;
+  if (!(product.hi & INTEGER_BIT)) {
+    product = product << 1;
+    exponent--;
+  }
+  return round_pack(sign, exponent, product, env);
+}
+
+Float80 Float80::div(const Float80& a, const Float80& b,
+                     FloatEnvironment& env) {
+  if (a.is_nan() || b.is_nan()) {
+    return propagate_nan(a, b, env);
+  }
+  const bool sign = a.sign() != b.sign();
+  if (a.is_infinity()) {
+    return b.is_infinity() ? invalid(env) : infinity(sign);
+  }
+  if (b.is_infinity()) {
+    return zero(sign);
+  }
+  if (b.is_zero()) {
+    if (a.is_zero()) {
+      return invalid(env);
+    }
+    env.exceptions |= FloatEnvironment::ZE;
+    return infinity(sign);
+  }
+  if (a.is_zero()) {
+    return zero(sign);
+  }
+
+  const Unpacked ua = unpack(a, env);
+  const Unpacked ub = unpack(b, env);
+
+  // Long division, bit 127 of the quotient is the units bit
+  U128 quotient;
+  uint64_t remainder = ua.mantissa;
+  bool carry = false;
+  for (int bit = 127; bit >= 0; bit--) {
+    if (carry || remainder >= ub.mantissa) {
+      remainder -= ub.mantissa;
+      if (bit >= 64) {
+        quotient.hi |= 1ULL << (bit - 64);
+      } else {
+        quotient.lo |= 1ULL << bit;
+      }
+    }
+    carry = remainder >> 63;
+    remainder <<= 1;
+  }
+  quotient.lo |= static_cast<uint64_t>(remainder != 0 || carry);
+
+  int32_t exponent = ua.exponent - ub.exponent + BIAS;
+  if (!(quotient.hi & INTEGER_BIT)) {
+    quotient = quotient << 1;
+    exponent--;
+  }
+  return round_pack(sign, exponent, quotient, env);
+}
+
+Float80 Float80::sqrt(const Float80& a, FloatEnvironment& env) {
+  if (a.is_nan()) {
+    return propagate_nan(a, a, env);
+  }
+  if (a.is_zero()) {
+    return a;
+  }
+  if (a.sign()) {
+    return invalid(env);
+  }
+  if (a.is_infinity()) {
+    return a;
+  }
+
+  /*
+    Integer square root of the significand scaled to 127 or 128 bits,
+    keeping the exponent even. The 64-bit root and its remainder give
+    the rounding bits, an exact half is impossible.
+  */
+  const Unpacked u = unpack(a, env);
+  const int32_t exponent = u.exponent - BIAS;
+  U128 radicand;
+  int32_t root_exponent;
+  if (exponent & 1) {
+    radicand = U128{u.mantissa, 0};
+    root_exponent = (exponent - 1) / 2;
+  } else {
+    radicand = U128{u.mantissa >> 1, u.mantissa << 63};
+    root_exponent = exponent / 2;
+  }
+
+  U128 root;
+  U128 bit{1ULL << 62, 0};
+  while (bit > radicand) {
+    bit = bit >> 2;
+  }
+  while (!bit.is_zero()) {
+    const U128 trial = root + bit;
+    if (radicand >= trial) {
+      radicand = radicand - trial;
+      root = (root >> 1) + bit;
+    } else {
+      root = root >> 1;
+    }
+    bit = bit >> 2;
+  }
+
+  const bool round = radicand > root;
+  const bool sticky = !radicand.is_zero();
+  const U128 value{root.lo, (round ? INTEGER_BIT : 0) | (sticky ? 1 : 0)};
+  return round_pack(false, root_exponent + BIAS, value, env);
+}
+
+Float80 Float80::round_to_integer(const Float80& a, FloatEnvironment& env) {
+  if (a.is_nan()) {
+    return propagate_nan(a, a, env);
+  }
+  if (a.is_infinity() || a.is_zero()) {
+    return a;
+  }
+
+  const Unpacked u = unpack(a, env);
+  const int32_t fraction_bits = BIAS + 63 - u.exponent;
+  if (fraction_bits <= 0) {
+    return a;
+  }
+
+  const U128 split = shift_right_sticky(U128{u.mantissa, 0}, fraction_bits);
+  const bool round = split.lo >> 63;
+  const bool sticky = (split.lo << 1) != 0;
+  uint64_t integer = split.hi;
+  if (round || sticky) {
+    env.exceptions |= FloatEnvironment::PE;
+  }
+  if (round_up(u.sign, integer & 1, round, sticky, env.rounding)) {
+    integer++;
+  }
+  if (integer == 0) {
+    return zero(u.sign);
+  }
+
+  const int shift = leading_zeros(integer);
+  return make(u.sign, static_cast<uint16_t>(BIAS + 63 - shift),
+              integer << shift);
+}
+
+Float80 Float80::scale(const Float80& a, int32_t n, FloatEnvironment& env) {
+  if (a.is_nan()) {
+    return propagate_nan(a, a, env);
+  }
+  if (a.is_infinity() || a.is_zero()) {
+    return a;
+  }
+
+  // Anything past this overflows or underflows anyway
+  constexpr int32_t LIMIT = 1 << 17;
+  n = n > LIMIT ? LIMIT : (n < -LIMIT ? -LIMIT : n);
+
+  Unpacked u = unpack(a, env);
+  u.exponent += n;
+  return round_pack(u, env);
+}
+
+Float80 Float80::partial_remainder(const Float80& a, const Float80& b,
+                                   uint64_t& quotient, bool& complete,
+                                   FloatEnvironment& env) {
+  quotient = 0;
+  complete = true;
+  if (a.is_nan() || b.is_nan()) {
+    return propagate_nan(a, b, env);
+  }
+  if (a.is_infinity() || b.is_zero()) {
+    return invalid(env);
+  }
+  if (b.is_infinity() || a.is_zero()) {
+    return a;
+  }
+
+  const Unpacked ua = unpack(a, env);
+  Unpacked ub = unpack(b, env);
+  int32_t difference = ua.exponent - ub.exponent;
+  if (difference < 0) {
+    return a;
+  }
+
+  /*
+    Too far apart for one step, reduce by b * 2^k instead with k a
+    multiple of 32, which keeps the low quotient bits of the final step
+    right. The caller loops on C2.
+  */
+  if (difference > 63) {
+    difference = 32 + (difference - 32) % 32;
+    ub.exponent = ua.exponent - difference;
+    complete = false;
+  }
+
+  uint64_t remainder = ua.mantissa;
+  bool carry = false;
+  for (int32_t bit = difference; bit >= 0; bit--) {
+    quotient <<= 1;
+    if (carry || remainder >= ub.mantissa) {
+      remainder -= ub.mantissa;
+      quotient |= 1;
+    }
+    if (bit > 0) {
+      carry = remainder >> 63;
+      remainder <<= 1;
+    }
+  }
+
+  if (remainder == 0) {
+    return zero(ua.sign);
+  }
+  // The remainder is exact, only denormal results need packing
+  const int shift = leading_zeros(remainder);
+  FloatEnvironment exact{env.rounding, 64, 0};
+  const Float80 result = round_pack(ua.sign, ub.exponent - shift,
+                                    U128{remainder << shift, 0}, exact);
+  env.exceptions |= exact.exceptions & FloatEnvironment::UE;
+  return result;
+}
+
+Float80::Ordering Float80::compare(const Float80& a, const Float80& b) {
+  if (a.is_nan() || b.is_nan()) {
+    return Ordering::UNORDERED;
+  }
+  if (a.is_zero() && b.is_zero()) {
+    return Ordering::EQUAL;
+  }
+  if (a.sign() != b.sign()) {
+    return a.sign() ? Ordering::LESS : Ordering::GREATER;
+  }
+
+  int order;
+  if (a.is_infinity() || b.is_infinity()) {
+    order = a.is_infinity() == b.is_infinity() ? 0 : (a.is_infinity() ? 1 : -1);
+  } else if (a.is_zero() || b.is_zero()) {
+    order = a.is_zero() ? -1 : 1;
+  } else {
+    FloatEnvironment ignored;
+    order = compare_magnitude(unpack(a, ignored), unpack(b, ignored));
+  }
+
+  if (a.sign()) {
+    order = -order;
+  }
+  return order < 0 ? Ordering::LESS
+                   : (order > 0 ? Ordering::GREATER : Ordering::EQUAL);
+}
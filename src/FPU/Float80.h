@@ -0,0 +1,90 @@
+#ifndef FLOAT80_H
+#define FLOAT80_H
+
+#include <cstdint>
+
+/*
+  Rounding, precision and sticky exception flags shared by every
+  operation, laid out like the x87 control / status word fields
+*/
+struct FloatEnvironment {
+  enum Rounding : uint8_t { NEAREST = 0, DOWN = 1, UP = 2, ZERO = 3 };
+
+  // Invalid, denormal, zero divide, overflow, underflow, precision
+  static constexpr uint16_t IE = 1 << 0;
+  static constexpr uint16_t DE = 1 << 1;
+  static constexpr uint16_t ZE = 1 << 2;
+  static constexpr uint16_t OE = 1 << 3;
+  static constexpr uint16_t UE = 1 << 4;
+  static constexpr uint16_t PE = 1 << 5;
+
+  Rounding rounding{NEAREST};
+  // Significand bits results are rounded to, 24, 53 or 64
+  uint8_t precision{64};
+  uint16_t exceptions{0};
+};
+
+/*
+  Software x87 extended precision number, bit for bit the 80-bit memory
+  format: explicit integer bit, 15-bit exponent biased by 16383.
+
+  Arithmetic is correctly rounded according to the environment, so
+  results match a real coprocessor.
+*/
+class Float80 {
+ public:
+  enum class Ordering { LESS, EQUAL, GREATER, UNORDERED };
+
+  uint64_t mantissa{0};
+  // Bit 15 is the sign
+  uint16_t sign_exponent{0};
+
+  static constexpr int32_t BIAS = 16383;
+  static constexpr uint16_t MAX_EXPONENT = 0x7FFF;
+
+  static Float80 zero(bool negative = false);
+  static Float80 infinity(bool negative = false);
+  // The "real indefinite" QNaN the x87 returns for invalid operations
+  static Float80 indefinite();
+
+  static Float80 from_bytes(const uint8_t* in);
+  void to_bytes(uint8_t* out) const;
+
+  static Float80 from_float32(uint32_t bits);
+  static Float80 from_float64(uint64_t bits);
+  static Float80 from_double(double value);
+  static Float80 from_int64(int64_t value);
+  [[nodiscard]] uint32_t to_float32(FloatEnvironment& env) const;
+  [[nodiscard]] uint64_t to_float64(FloatEnvironment& env) const;
+  [[nodiscard]] double to_double() const;
+  // false when the rounded value does not fit
+  bool to_int64(FloatEnvironment& env, int64_t& value) const;
+
+  [[nodiscard]] bool sign() const { return sign_exponent >> 15; }
+  [[nodiscard]] uint16_t exponent() const { return sign_exponent & 0x7FFF; }
+  [[nodiscard]] bool is_zero() const;
+  [[nodiscard]] bool is_infinity() const;
+  [[nodiscard]] bool is_nan() const;
+  [[nodiscard]] bool is_denormal() const;
+  [[nodiscard]] Float80 negate() const;
+  [[nodiscard]] Float80 abs() const;
+
+  static Float80 add(const Float80& a, const Float80& b, FloatEnvironment& env);
+  static Float80 sub(const Float80& a, const Float80& b, FloatEnvironment& env);
+  static Float80 mul(const Float80& a, const Float80& b, FloatEnvironment& env);
+  static Float80 div(const Float80& a, const Float80& b, FloatEnvironment& env);
+  static Float80 sqrt(const Float80& a, FloatEnvironment& env);
+  static Float80 round_to_integer(const Float80& a, FloatEnvironment& env);
+  // a * 2^n, n already truncated to an integer
+  static Float80 scale(const Float80& a, int32_t n, FloatEnvironment& env);
+  /*
+    Partial remainder as FPREM computes it: at most 63 quotient bits per
+    call, complete == false when the caller has to repeat
+  */
+  static Float80 partial_remainder(const Float80& a, const Float80& b,
+                                   uint64_t& quotient, bool& complete,
+                                   FloatEnvironment& env);
+  static Ordering compare(const Float80& a, const Float80& b);
+};
+
+#endif  // FLOAT80_H
@@ -0,0 +1,152 @@
+#include "ConsoleInput.h"
+
+#include <cstdint>
+#include <cstdio>
+
+#ifdef _WIN32
+#include <conio.h>
+#include <io.h>
+#else
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#endif
+
+ConsoleInput::ConsoleInput()
+    : buffer_pos(0),
+      buffer_end(0),
+      detected(false),
+      redirected(false),
+      end_of_input(false),
+      after_cr(false)
+#ifndef _WIN32
+      ,
+      raw_mode(false),
+      saved_mode()
+#endif
+{
+}
+
+ConsoleInput::~ConsoleInput() {
+#ifndef _WIN32
+  if (raw_mode) {
+    tcsetattr(STDIN_FILENO, TCSANOW, &saved_mode);
+  }
+#endif
+}
+
+void ConsoleInput::detect() {
+  if (detected) {
+    return;
+  }
+  detected = true;
+#ifdef _WIN32
+  redirected = !_isatty(_fileno(stdin));
+#else
+  redirected = !isatty(STDIN_FILENO);
+#endif
+  buffer.resize(redirected ? BUFFER_SIZE : 256);
+}
+
+void ConsoleInput::enter_raw_mode() {
+#ifndef _WIN32
+  if (raw_mode || tcgetattr(STDIN_FILENO, &saved_mode) != 0) {
+    return;
+  }
+
+  termios mode = saved_mode;
+  mode.c_lflag &= ~(ICANON | ECHO);
+  mode.c_cc[VMIN] = 1;
+  mode.c_cc[VTIME] = 0;
+  raw_mode = tcsetattr(STDIN_FILENO, TCSANOW, &mode) == 0;
+#endif
+}
+
+bool ConsoleInput::fill(const bool block) {
+  if (end_of_input) {
+    return false;
+  }
+
+#ifdef _WIN32
+  if (!block && !redirected && !_kbhit()) {
+    return false;
+  }
+  const int n = redirected ? _read(_fileno(stdin), buffer.data(),
+                                   static_cast<unsigned>(buffer.size()))
+                           : _getch();
+  if (!redirected) {
+    buffer[0] = static_cast<uint8_t>(n);
+    buffer_pos = 0;
+    buffer_end = 1;
+    return true;
+  }
+#else
+  if (!redirected) {
+    enter_raw_mode();
+  }
+  if (!block) {
+    pollfd pending{STDIN_FILENO, POLLIN, 0};
+    if (poll(&pending, 1, 0) <= 0) {
+      return false;
+    }
+  }
+  const ssize_t n = ::read(STDIN_FILENO, buffer.data(), buffer.size());
+#endif
+
+  if (n <= 0) {
+    // A terminal never ends, only redirected input runs out
+    end_of_input = redirected;
+    return false;
+  }
+  buffer_pos = 0;
+  buffer_end = static_cast<size_t>(n);
+  return true;
+}
+
+bool ConsoleInput::read(uint8_t& byte) {
+  detect();
+
+  while (true) {
+    if (buffer_pos == buffer_end && !fill(true)) {
+      return false;
+    }
+
+    byte = buffer[buffer_pos++];
+    if (byte == '\n' && after_cr) {
+      after_cr = false;
+      continue;
+    }
+    after_cr = byte == '\r';
+    if (byte == '\n') {
+      byte = '\r';
+    } else if (byte == 0x7F && !redirected) {
+      // Terminals send DEL for the backspace key
+      byte = '\b';
+    }
+    return true;
+  }
+}
+
+bool ConsoleInput::ready() {
+  detect();
+
+  while (true) {
+    if (buffer_pos == buffer_end && !fill(false)) {
+      return false;
+    }
+    // The LF of a CR LF is not a key of its own
+    if (buffer[buffer_pos] == '\n' && after_cr) {
+      after_cr = false;
+      buffer_pos++;
+      continue;
+    }
+    return true;
+  }
+}
+
+void ConsoleInput::flush() {
+  detect();
+  if (!redirected) {
+    buffer_pos = buffer_end = 0;
+  }
+}
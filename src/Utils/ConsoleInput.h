@@ -0,0 +1,64 @@
+#ifndef CONSOLEINPUT_H
+#define CONSOLEINPUT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#ifndef _WIN32
+#include <termios.h>
+#endif
+
+/*
+  Host side of the DOS console input, standard input.
+
+  Redirected input (a file or a pipe) is read in large blocks and served
+  from a buffer, the terminal is never touched. A terminal is switched
+  to unbuffered, no echo mode on the first read only, so programs that
+  never read leave it alone, and is restored on destruction.
+
+  Whether input is redirected is decided on first use, not at
+  construction: the fork server swaps standard input in every run it
+  starts.
+
+  Line ends come out the way DOS reports the Enter key, as a single CR,
+  whether the host sent CR, LF or CR LF.
+*/
+class ConsoleInput {
+ public:
+  ConsoleInput();
+  ~ConsoleInput();
+  ConsoleInput(const ConsoleInput&) = delete;
+  ConsoleInput& operator=(const ConsoleInput&) = delete;
+
+  // Blocks for the next byte, false at the end of the input
+  bool read(uint8_t& byte);
+  // Whether read() would return right away with a byte
+  bool ready();
+  // Drops type-ahead, redirected input is never discarded
+  void flush();
+
+ private:
+  void detect();
+  // Refills the buffer, only waits for input when block is set
+  bool fill(bool block);
+  void enter_raw_mode();
+
+  constexpr static size_t BUFFER_SIZE = 64 * 1024;
+
+  std::vector<uint8_t> buffer;
+  size_t buffer_pos;
+  size_t buffer_end;
+  bool detected;
+  bool redirected;
+  bool end_of_input;
+  // Last byte read was a CR, an LF right after it belongs to it
+  bool after_cr;
+
+#ifndef _WIN32
+  bool raw_mode;
+  termios saved_mode;
+#endif
+};
+
+#endif  // CONSOLEINPUT_H
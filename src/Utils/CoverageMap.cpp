@@ -0,0 +1,206 @@
+#include "CoverageMap.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "logger.h"
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+#endif
+
+namespace {
+std::string expand_path(const std::string_view path) {
+  std::string name{path};
+  const size_t at = name.find("%p");
+  if (at != std::string::npos) {
+#ifdef _WIN32
+    const int pid = _getpid();
+#else
+    const int pid = static_cast<int>(getpid());
+#endif
+    name.replace(at, 2, std::to_string(pid));
+  }
+  return name;
+}
+}  // namespace
+
+CoverageMap::CoverageMap() : bits{} {}
+
+void CoverageMap::mark(const uint32_t first, uint32_t end) {
+  end = std::min(end, SIZE);
+  if (first >= end) {
+    return;
+  }
+  const uint32_t last = end - 1;
+  const uint64_t head = ~uint64_t{0} << (first % 64);
+  const uint64_t tail = ~uint64_t{0} >> (63 - last % 64);
+  const size_t first_word = first / 64;
+  const size_t last_word = last / 64;
+  if (first_word == last_word) {
+    bits[first_word] |= head & tail;
+    return;
+  }
+  bits[first_word] |= head;
+  for (size_t word = first_word + 1; word < last_word; word++) {
+    bits[word] = ~uint64_t{0};
+  }
+  bits[last_word] |= tail;
+}
+
+void CoverageMap::merge(const CoverageMap& other) {
+  for (size_t word = 0; word < bits.size(); word++) {
+    bits[word] |= other.bits[word];
+  }
+}
+
+bool CoverageMap::covered(const uint32_t address) const {
+  return address < SIZE && (bits[address / 64] >> (address % 64) & 1);
+}
+
+size_t CoverageMap::count() const {
+  size_t total = 0;
+  for (const uint64_t word : bits) {
+    total += static_cast<size_t>(std::popcount(word));
+  }
+  return total;
+}
+
+void CoverageMap::encode(uint8_t* out) const {
+  std::memcpy(out, MAGIC, sizeof(MAGIC));
+  out += sizeof(MAGIC);
+  for (const uint64_t word : bits) {
+    for (int shift = 0; shift < 64; shift += 8) {
+      *out++ = static_cast<uint8_t>(word >> shift);
+    }
+  }
+}
+
+bool CoverageMap::decode(const uint8_t* in) {
+  if (std::memcmp(in, MAGIC, sizeof(MAGIC)) != 0) {
+    return false;
+  }
+  in += sizeof(MAGIC);
+  for (uint64_t& word : bits) {
+    word = 0;
+    for (int shift = 0; shift < 64; shift += 8) {
+      word |= static_cast<uint64_t>(*in++) << shift;
+    }
+  }
+  return true;
+}
+
+std::optional<CoverageMap> CoverageMap::load(const std::string_view path) {
+  const std::string name{path};
+  std::FILE* file = std::fopen(name.c_str(), "rb");
+  if (!file) {
+    mylog("Cannot open coverage file '%s'", name.c_str());
+    return std::nullopt;
+  }
+  std::vector<uint8_t> data(FILE_SIZE);
+  const size_t got = std::fread(data.data(), 1, data.size(), file);
+  std::fclose(file);
+
+  CoverageMap map;
+  if (got != FILE_SIZE || !map.decode(data.data())) {
+    mylog("'%s' is not a coverage file", name.c_str());
+    return std::nullopt;
+  }
+  return map;
+}
+
+bool CoverageMap::save(const std::string_view path) const {
+  const std::string name{path};
+  std::vector<uint8_t> data(FILE_SIZE);
+  encode(data.data());
+  std::FILE* file = std::fopen(name.c_str(), "wb");
+  if (!file) {
+    mylog("Cannot create coverage file '%s'", name.c_str());
+    return false;
+  }
+  const bool written =
+      std::fwrite(data.data(), 1, data.size(), file) == data.size();
+  return std::fclose(file) == 0 && written;
+}
+
+#ifdef _WIN32
+
+// No file locks here, parallel runs need a file each (%p)
+bool CoverageMap::merge_into(const std::string_view path) const {
+  const std::string name = expand_path(path);
+  CoverageMap merged = *this;
+  if (std::FILE* file = std::fopen(name.c_str(), "rb")) {
+    std::fclose(file);
+    const std::optional<CoverageMap> existing{load(name)};
+    if (!existing) {
+      return false;
+    }
+    merged.merge(*existing);
+  }
+  return merged.save(name);
+}
+
+#else
+
+bool CoverageMap::merge_into(const std::string_view path) const {
+  const std::string name = expand_path(path);
+  const int fd = open(name.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd < 0) {
+    mylog("Cannot open coverage file '%s'", name.c_str());
+    return false;
+  }
+  // Released by close
+  if (flock(fd, LOCK_EX) != 0) {
+    mylog("Cannot lock coverage file '%s'", name.c_str());
+    close(fd);
+    return false;
+  }
+
+  std::vector<uint8_t> data(FILE_SIZE);
+  size_t got = 0;
+  while (got < data.size()) {
+    const ssize_t n = pread(fd, data.data() + got, data.size() - got,
+                            static_cast<off_t>(got));
+    if (n <= 0) {
+      break;
+    }
+    got += static_cast<size_t>(n);
+  }
+  CoverageMap merged = *this;
+  if (got) {
+    CoverageMap existing;
+    if (got != FILE_SIZE || !existing.decode(data.data())) {
+      mylog("'%s' is not a coverage file", name.c_str());
+      close(fd);
+      return false;
+    }
+    merged.merge(existing);
+  }
+
+  merged.encode(data.data());
+  size_t put = 0;
+  while (put < data.size()) {
+    const ssize_t n = pwrite(fd, data.data() + put, data.size() - put,
+                             static_cast<off_t>(put));
+    if (n <= 0) {
+      mylog("Cannot write coverage file '%s'", name.c_str());
+      close(fd);
+      return false;
+    }
+    put += static_cast<size_t>(n);
+  }
+  return close(fd) == 0;
+}
+
+#endif
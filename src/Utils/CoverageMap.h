@@ -0,0 +1,50 @@
+#ifndef COVERAGEMAP_H
+#define COVERAGEMAP_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+/*
+  Guest code coverage: one bit per byte of the first MiB of linear
+  addresses, set for every byte of an instruction that ran.
+
+  On disk it is MAGIC followed by the bitmap, bit i % 8 of byte i / 8
+  for address i. Runs are ORed into a file rather than replacing it, so
+  any number of runs, in parallel too, can add up into one file.
+  x8086cov merges files and lists the ranges they cover.
+*/
+class CoverageMap {
+ public:
+  CoverageMap();
+
+  // Marks [first, end), addresses past SIZE are dropped
+  void mark(uint32_t first, uint32_t end);
+  void merge(const CoverageMap& other);
+  [[nodiscard]] bool covered(uint32_t address) const;
+  // Number of addresses marked
+  [[nodiscard]] size_t count() const;
+
+  static std::optional<CoverageMap> load(std::string_view path);
+  bool save(std::string_view path) const;
+  /*
+    ORs this map into the file at path, creating it if needed, under an
+    exclusive lock where the host has one. %p in path is replaced with
+    the process id, for a file per run.
+  */
+  bool merge_into(std::string_view path) const;
+
+  constexpr static uint32_t SIZE = 1 << 20;
+  constexpr static char MAGIC[4] = {'X', '8', '6', 'C'};
+  constexpr static size_t FILE_SIZE = sizeof(MAGIC) + SIZE / 8;
+
+ private:
+  void encode(uint8_t* out) const;
+  bool decode(const uint8_t* in);
+
+  std::array<uint64_t, SIZE / 64> bits;
+};
+
+#endif  // COVERAGEMAP_H
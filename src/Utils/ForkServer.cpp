@@ -0,0 +1,108 @@
+#include "ForkServer.h"
+
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+
+#include "../Exceptions/ProgramExitedException.h"
+#include "logger.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+void ForkServer::serve(std::FILE*, std::FILE*, int) {
+  mylog("Fork server is not supported on this platform, running normally");
+}
+
+#else
+
+static void report(std::FILE* control_out, const std::string& input,
+                   const int status) {
+  if (WIFEXITED(status)) {
+    std::fprintf(control_out, "%s exit %d\n", input.c_str(),
+                 WEXITSTATUS(status));
+  } else if (WIFSIGNALED(status)) {
+    std::fprintf(control_out, "%s signal %d\n", input.c_str(),
+                 WTERMSIG(status));
+  }
+  std::fflush(control_out);
+}
+
+static bool redirect(const std::string& path, const int flags,
+                     const int target_fd) {
+  const int fd = open(path.c_str(), flags, 0644);
+  if (fd < 0) {
+    return false;
+  }
+  dup2(fd, target_fd);
+  close(fd);
+  return true;
+}
+
+void ForkServer::serve(std::FILE* control_in, std::FILE* control_out,
+                       const int max_jobs) {
+  std::map<pid_t, std::string> running;
+
+  const auto wait_one = [&]() {
+    int status = 0;
+    const pid_t pid = waitpid(-1, &status, 0);
+    if (pid <= 0) {
+      return;
+    }
+    const auto it = running.find(pid);
+    if (it != running.end()) {
+      report(control_out, it->second, status);
+      running.erase(it);
+    }
+  };
+
+  char line[4096];
+  while (std::fgets(line, sizeof(line), control_in)) {
+    std::istringstream request{line};
+    std::string input;
+    std::string output{"/dev/null"};
+    if (!(request >> input)) {
+      continue;
+    }
+    request >> output;
+
+    while (static_cast<int>(running.size()) >= max_jobs) {
+      wait_one();
+    }
+
+    // Nothing buffered may be written twice
+    std::cout.flush();
+    std::fflush(nullptr);
+
+    const pid_t pid = fork();
+    if (pid < 0) {
+      mylog("fork failed, fork server stopped");
+      break;
+    }
+    if (pid == 0) {
+      if (!redirect(input, O_RDONLY, STDIN_FILENO) ||
+          !redirect(output, O_WRONLY | O_CREAT | O_TRUNC, STDOUT_FILENO)) {
+        mylog("Cannot open '%s' or '%s' for a forked run", input.c_str(),
+              output.c_str());
+        _exit(126);
+      }
+      return;
+    }
+
+    running.emplace(pid, input);
+  }
+
+  while (!running.empty()) {
+    wait_one();
+  }
+  throw ProgramExitedException{0};
+}
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef FORKSERVER_H
+#define FORKSERVER_H
+
+#include <cstdio>
+
+/*
+  Turns the current process into a server that hands out copies of the
+  guest at its ready point. Meant to be called from the CPU ready hook:
+  the program has been loaded and run up to its first input request once,
+  every run after that starts from there in a fork() that shares all
+  pages it does not write.
+
+  Requests are read one per line from control_in:
+
+    <input file> [<output file>]
+
+  Each run gets the input file as stdin and the output file (default
+  /dev/null) as stdout. When a run finishes, a line is written to
+  control_out:
+
+    <input file> exit <code>
+    <input file> signal <number>
+
+  serve() only returns in the forked children, which then carry on
+  executing the guest. The server itself exits with code 0 once
+  control_in is closed and every run has finished.
+
+  Files the server has open are shared by every child, offset and stdio
+  buffer alike, so options that write or read one per run are refused
+  with --fork-server (see Options::parse).
+*/
+class ForkServer {
+ public:
+  static void serve(std::FILE* control_in, std::FILE* control_out,
+                    int max_jobs);
+};
+
+#endif  // FORKSERVER_H
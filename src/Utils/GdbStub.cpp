@@ -0,0 +1,241 @@
+#include "GdbStub.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "logger.h"
+
+#ifndef _WIN32
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+std::unique_ptr<GdbStub> GdbStub::listen(std::string_view) {
+  mylog("The debugger stub is not supported on this platform");
+  return nullptr;
+}
+
+GdbStub::GdbStub(const int fd) : fd(fd) {}
+
+GdbStub::~GdbStub() = default;
+
+bool GdbStub::receive(std::string&) { return false; }
+
+bool GdbStub::send(std::string_view) { return false; }
+
+bool GdbStub::interrupted() { return false; }
+
+#else
+
+namespace {
+constexpr uint8_t INTERRUPT = 0x03;
+constexpr char HEX[] = "0123456789abcdef";
+// A client that went away must not kill the emulator with SIGPIPE
+#ifdef MSG_NOSIGNAL
+constexpr int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+constexpr int SEND_FLAGS = 0;
+#endif
+
+int hex_digit(const char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+}  // namespace
+
+std::unique_ptr<GdbStub> GdbStub::listen(const std::string_view where) {
+  const std::string name{where};
+  const bool unix_socket = name.find('/') != std::string::npos;
+  const int server = socket(unix_socket ? AF_UNIX : AF_INET, SOCK_STREAM, 0);
+  if (server < 0) {
+    mylog("Cannot create the debugger socket");
+    return nullptr;
+  }
+
+  bool bound;
+  if (unix_socket) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (name.size() >= sizeof(address.sun_path)) {
+      mylog("Debugger socket path '%s' is too long", name.c_str());
+      close(server);
+      return nullptr;
+    }
+    std::memcpy(address.sun_path, name.c_str(), name.size() + 1);
+    unlink(name.c_str());
+    bound = bind(server, reinterpret_cast<sockaddr*>(&address),
+                 sizeof(address)) == 0;
+  } else {
+    char* end = nullptr;
+    const long port = std::strtol(name.c_str(), &end, 10);
+    if (name.empty() || *end != '\0' || port <= 0 || port > 0xFFFF) {
+      mylog("Bad debugger port '%s'", name.c_str());
+      close(server);
+      return nullptr;
+    }
+    const int reuse = 1;
+    setsockopt(server, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bound = bind(server, reinterpret_cast<sockaddr*>(&address),
+                 sizeof(address)) == 0;
+  }
+  if (!bound || ::listen(server, 1) != 0) {
+    mylog("Cannot listen for a debugger on '%s'", name.c_str());
+    close(server);
+    return nullptr;
+  }
+
+  // The terminal is where whoever starts gdb is looking
+  std::fprintf(stderr, "Waiting for a debugger on %s\n", name.c_str());
+  const int client = accept(server, nullptr, nullptr);
+  close(server);
+  if (unix_socket) {
+    unlink(name.c_str());
+  }
+  if (client < 0) {
+    mylog("Debugger connection failed");
+    return nullptr;
+  }
+#ifdef SO_NOSIGPIPE
+  const int no_sigpipe = 1;
+  setsockopt(client, SOL_SOCKET, SO_NOSIGPIPE, &no_sigpipe,
+             sizeof(no_sigpipe));
+#endif
+  return std::unique_ptr<GdbStub>(new GdbStub(client));
+}
+
+GdbStub::GdbStub(const int fd) : fd(fd) {}
+
+GdbStub::~GdbStub() { close(fd); }
+
+bool GdbStub::fill(const bool wait) {
+  if (input_head == input.size()) {
+    input.clear();
+    input_head = 0;
+  }
+
+  pollfd ready{fd, POLLIN, 0};
+  if (poll(&ready, 1, wait ? -1 : 0) <= 0) {
+    return false;
+  }
+  char chunk[4096];
+  const ssize_t got = read(fd, chunk, sizeof(chunk));
+  if (got <= 0) {
+    return false;
+  }
+
+  // An interrupt can come at any time, it is not part of a packet
+  for (ssize_t i = 0; i < got; i++) {
+    if (static_cast<uint8_t>(chunk[i]) == INTERRUPT) {
+      interrupt_seen = true;
+    } else {
+      input += chunk[i];
+    }
+  }
+  return true;
+}
+
+bool GdbStub::next_byte(uint8_t& byte) {
+  while (input_head == input.size()) {
+    if (!fill(true)) {
+      return false;
+    }
+  }
+  byte = static_cast<uint8_t>(input[input_head++]);
+  return true;
+}
+
+bool GdbStub::receive(std::string& packet) {
+  while (true) {
+    uint8_t byte;
+    if (!next_byte(byte)) {
+      return false;
+    }
+    if (byte == '-') {
+      if (!send(last_packet)) {
+        return false;
+      }
+      continue;
+    }
+    if (byte != '$') {
+      // Acks for what was sent, and noise between packets
+      continue;
+    }
+
+    packet.clear();
+    uint8_t sum = 0;
+    while (next_byte(byte) && byte != '#') {
+      packet += static_cast<char>(byte);
+      sum = static_cast<uint8_t>(sum + byte);
+    }
+    uint8_t high;
+    uint8_t low;
+    if (byte != '#' || !next_byte(high) || !next_byte(low)) {
+      return false;
+    }
+    const int given = hex_digit(static_cast<char>(high)) << 4 |
+                      hex_digit(static_cast<char>(low));
+    const char ack = given == sum ? '+' : '-';
+    if (::send(fd, &ack, 1, SEND_FLAGS) != 1) {
+      return false;
+    }
+    if (ack == '+') {
+      return true;
+    }
+  }
+}
+
+bool GdbStub::send(const std::string_view packet) {
+  uint8_t sum = 0;
+  for (const char c : packet) {
+    sum = static_cast<uint8_t>(sum + static_cast<uint8_t>(c));
+  }
+  last_packet = packet;
+  std::string framed = "$";
+  framed += packet;
+  framed += '#';
+  framed += HEX[sum >> 4];
+  framed += HEX[sum & 15];
+
+  size_t sent = 0;
+  while (sent < framed.size()) {
+    const ssize_t done = ::send(fd, framed.data() + sent,
+                                framed.size() - sent, SEND_FLAGS);
+    if (done <= 0) {
+      return false;
+    }
+    sent += static_cast<size_t>(done);
+  }
+  return true;
+}
+
+bool GdbStub::interrupted() {
+  while (fill(false)) {
+  }
+  const bool seen = interrupt_seen;
+  interrupt_seen = false;
+  return seen;
+}
+
+#endif
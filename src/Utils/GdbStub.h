@@ -0,0 +1,52 @@
+#ifndef GDBSTUB_H
+#define GDBSTUB_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+/*
+  Transport side of the GDB remote serial protocol: one client on a
+  local TCP port or a Unix socket, packet framing, checksums and acks.
+  What the packets mean is up to the CPU (funcs/debug.cpp).
+
+  Connect with
+
+    gdb -ex 'set architecture i8086' -ex 'target remote :<port>'
+
+  or 'target remote <path>' for a Unix socket.
+*/
+class GdbStub {
+ public:
+  /*
+    where is a port number to listen on 127.0.0.1, or a path (anything
+    with a '/') for a Unix socket. Blocks until a client connects.
+  */
+  static std::unique_ptr<GdbStub> listen(std::string_view where);
+  ~GdbStub();
+  GdbStub(const GdbStub&) = delete;
+  GdbStub& operator=(const GdbStub&) = delete;
+
+  // Next packet from the client, waiting for it. False once it is gone
+  bool receive(std::string& packet);
+  // False once the client is gone
+  bool send(std::string_view packet);
+  // Whether the client asked to stop (Ctrl-C) since the last call, without waiting
+  bool interrupted();
+
+ private:
+  explicit GdbStub(int fd);
+  // Moves whatever the socket has into input, waiting for it if wait is set
+  bool fill(bool wait);
+  bool next_byte(uint8_t& byte);
+
+  int fd;
+  std::string input;
+  size_t input_head{0};
+  // Sent again when the client answers with a '-'
+  std::string last_packet;
+  bool interrupt_seen{false};
+};
+
+#endif  // GDBSTUB_H
@@ -0,0 +1,151 @@
+#include "KeyScript.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../Devices/IntervalTimer.h"
+#include "../Devices/Keyboard.h"
+#include "logger.h"
+
+namespace {
+uint64_t to_clocks(const uint64_t ms) {
+  return ms * IntervalTimer::FREQUENCY / 1000;
+}
+
+void skip_blanks(std::string_view& text) {
+  while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) {
+    text.remove_prefix(1);
+  }
+}
+}  // namespace
+
+std::unique_ptr<KeyScript> KeyScript::open(const std::string_view path) {
+  const std::string name{path};
+  std::ifstream file(name);
+  if (!file) {
+    mylog("Cannot open key script '%s'", name.c_str());
+    return nullptr;
+  }
+
+  std::unique_ptr<KeyScript> script{new KeyScript};
+  uint64_t time_ms = 0;
+  std::string line;
+  for (uint32_t number = 1; std::getline(file, line); number++) {
+    if (!line.empty() && line.back() == '\r') {
+      line.pop_back();
+    }
+    if (!script->parse_line(line, time_ms)) {
+      mylog("Bad key script line %u in '%s'", number, name.c_str());
+      return nullptr;
+    }
+  }
+  return script;
+}
+
+bool KeyScript::parse_line(std::string_view line, uint64_t& time_ms) {
+  skip_blanks(line);
+  if (line.empty() || line.front() == '#') {
+    return true;
+  }
+
+  const bool relative = line.front() == '+';
+  if (relative) {
+    line.remove_prefix(1);
+  }
+  uint64_t ms = 0;
+  size_t digits = 0;
+  while (digits < line.size() && line[digits] >= '0' && line[digits] <= '9') {
+    ms = ms * 10 + static_cast<uint64_t>(line[digits++] - '0');
+  }
+  if (!digits) {
+    return false;
+  }
+  line.remove_prefix(digits);
+  time_ms = relative ? time_ms + ms : ms;
+
+  uint64_t stroke_ms = time_ms;
+  const auto add = [&](const std::vector<uint8_t>& codes) {
+    // A line timed before the strokes of the one above waits for them
+    const uint64_t clock = std::max(
+        to_clocks(stroke_ms), strokes.empty() ? 0 : strokes.back().clock);
+    strokes.push_back(Stroke{clock, codes});
+    stroke_ms += STROKE_GAP_MS;
+  };
+
+  while (true) {
+    skip_blanks(line);
+    if (line.empty() || line.front() == '#') {
+      break;
+    }
+
+    std::vector<uint8_t> codes;
+    if (line.front() == '<') {
+      const size_t end = line.find('>', 1);
+      if (end == std::string_view::npos ||
+          !Keyboard::encode_key(line.substr(1, end - 1), codes)) {
+        return false;
+      }
+      add(codes);
+      line.remove_prefix(end + 1);
+      continue;
+    }
+    if (line.front() != '"') {
+      return false;
+    }
+
+    line.remove_prefix(1);
+    while (!line.empty() && line.front() != '"') {
+      uint8_t character = static_cast<uint8_t>(line.front());
+      line.remove_prefix(1);
+      if (character == '\\' && !line.empty()) {
+        switch (line.front()) {
+          case 'n':
+          case 'r':
+            character = '\r';
+            break;
+          case 't':
+            character = '\t';
+            break;
+          case 'e':
+            character = 0x1B;
+            break;
+          default:
+            character = static_cast<uint8_t>(line.front());
+            break;
+        }
+        line.remove_prefix(1);
+      }
+      codes.clear();
+      if (!Keyboard::encode_character(character, codes)) {
+        return false;
+      }
+      add(codes);
+    }
+    if (line.empty()) {
+      return false;
+    }
+    line.remove_prefix(1);
+  }
+  return true;
+}
+
+void KeyScript::skip(const size_t count) {
+  position = std::min(count, strokes.size());
+}
+
+uint64_t KeyScript::next() const {
+  return position < strokes.size() ? strokes[position].clock : NEVER;
+}
+
+bool KeyScript::take(const uint64_t now, std::vector<uint8_t>& codes) {
+  if (next() > now) {
+    return false;
+  }
+  codes = strokes[position++].codes;
+  return true;
+}
@@ -0,0 +1,57 @@
+#ifndef KEYSCRIPT_H
+#define KEYSCRIPT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+/*
+  Keyboard input read from a file instead of the terminal, each key
+  stroke at a fixed point of virtual time, so runs of interactive
+  programs are the same every time and wait for nothing but the CPU.
+
+  One line per point in time, # starts a comment:
+
+    <time> <keys>...
+
+  Times are milliseconds of virtual time since power on, or after the
+  line before with a leading +. Keys are "quoted text" (with \" \\ \n
+  \r \t and \e escapes), typed one character after the other, or a key
+  name in angle brackets such as <Enter>, <F1>, <Up>, <Ctrl+C>. Strokes
+  on a line follow each other STROKE_GAP apart.
+
+    500 "dir" <Enter>
+    +2000 <Alt+X>
+*/
+class KeyScript {
+ public:
+  static std::unique_ptr<KeyScript> open(std::string_view path);
+
+  // Clock of the next stroke, NEVER when the script is done
+  [[nodiscard]] uint64_t next() const;
+  // Scan codes of the next stroke once it is due at now, and moves on
+  bool take(uint64_t now, std::vector<uint8_t>& codes);
+
+  // Strokes taken so far, for snapshots that are resumed with the same script
+  [[nodiscard]] size_t taken() const { return position; }
+  void skip(size_t count);
+
+  constexpr static uint64_t NEVER = UINT64_MAX;
+  constexpr static uint32_t STROKE_GAP_MS = 20;
+
+ private:
+  KeyScript() = default;
+
+  struct Stroke {
+    uint64_t clock;
+    std::vector<uint8_t> codes;
+  };
+  bool parse_line(std::string_view line, uint64_t& time_ms);
+
+  std::vector<Stroke> strokes;
+  size_t position{0};
+};
+
+#endif  // KEYSCRIPT_H
@@ -4,29 +4,32 @@
 
 #include "LoadToCpu.h"
 
-#include <algorithm>
+#include <string>
+#include <string_view>
 
 #include "../CPU/CPU8068.h"
-#include "../ExecutableFiles/COM.h"
+#include "../DOS/DosError.h"
+#include "../DOS/ProgramImage.h"
 #include "logger.h"
 
-void LoadToCPU::load(CPU8068& cpu, const COM& com) {
-  if (com.buffer.size() > 0x10000) {
-    mylog("COM file cannot exceed 64kB memory in size");
-    return;
-  }
-  if (com.buffer.size() > cpu.memory.size()) {
-    mylog("COM file cannot exceed CPU memory restriction");
-    return;
-  }
-
+bool LoadToCPU::load(CPU8068& cpu, const ProgramImage& image,
+                     const std::string_view path) {
   cpu.reset_registers();
 
-  cpu.CS = cpu.DS = cpu.ES = cpu.SS = 0;
-  cpu.IP = 0x100;  // as per specs
-  std::copy(com.buffer.begin(), com.buffer.end(), cpu.memory.begin() + cpu.IP);
-  cpu.SP = CPU8068::SEGMENT_SIZE - 1;
+  cpu.arena.format();
+  cpu.psp_segment = 0;
+  cpu.return_code = 0;
+
+  uint16_t psp = 0;
+  CPU8068::ProcessStart start{};
+  if (cpu.create_process(image, path, CPU8068::ExecArguments{}, psp, start) !=
+      DosError::NONE) {
+    mylog("Cannot load '%s'", std::string{path}.c_str());
+    return false;
+  }
+  cpu.enter_process(psp, start);
 
   // Interrupts enabled and reserved set to 1
   cpu.FLAGS = 0b0000'0010'0000'0010;
+  return true;
 }
@@ -5,12 +5,16 @@
 #ifndef LOADTOCPU_H
 #define LOADTOCPU_H
 
+#include <string_view>
+
 #include "../CPU/CPU8068.h"
-#include "../ExecutableFiles/COM.h"
+#include "../DOS/ProgramImage.h"
 
 class LoadToCPU {
  public:
-  static void load(CPU8068& cpu, const COM& com);
+  // Starts image as the first program, path is the name it sees for itself
+  static bool load(CPU8068& cpu, const ProgramImage& image,
+                   std::string_view path);
 };
 
 #endif  // LOADTOCPU_H
@@ -0,0 +1,230 @@
+#include "Options.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "../CPU/CPUMode.h"
+#include "logger.h"
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+// Screen frames written into a pipe or file would only be noise there
+bool stdout_is_terminal() {
+#ifdef _WIN32
+  return _isatty(_fileno(stdout));
+#else
+  return isatty(STDOUT_FILENO);
+#endif
+}
+}  // namespace
+
+std::optional<Options> Options::parse(const int argc, const char* argv[]) {
+  if (argc < 3) {
+    return std::nullopt;
+  }
+
+  Options options;
+  options.mode = argv[1][0];
+  options.input_filename = argv[2];
+  options.refresh_hz = stdout_is_terminal() ? DEFAULT_REFRESH_HZ : 0.0;
+
+  for (int i = 3; i < argc; i++) {
+    const std::string_view arg{argv[i]};
+    if (arg.substr(0, 2) != "--") {
+      mylog("Unknown argument '%s'", argv[i]);
+      return std::nullopt;
+    }
+
+    const size_t equals = arg.find('=');
+    const std::string_view name = arg.substr(2, equals - 2);
+    const std::string_view value =
+        equals == std::string_view::npos ? "" : arg.substr(equals + 1);
+    if (!options.parse_option(name, value)) {
+      mylog("Invalid option '%s'", argv[i]);
+      return std::nullopt;
+    }
+  }
+
+  /*
+    Forked runs would all write these through the server's open files
+    and buffers, or take turns reading its replay log. The trace writer
+    thread is not even there in a child.
+  */
+  if (options.fork_server_jobs) {
+    const std::pair<std::string_view, const char*> per_run[] = {
+        {options.record_path, "--record"},
+        {options.replay_path, "--replay"},
+        {options.stats_path, "--stats"},
+        {options.capture_prefix, "--capture"},
+        {options.capture_raw_path, "--capture-raw"},
+        {options.trace_path, "--trace"},
+    };
+    for (const auto& [path, name] : per_run) {
+      if (!path.empty()) {
+        mylog("%s cannot be used with --fork-server", name);
+        return std::nullopt;
+      }
+    }
+  }
+
+  return options;
+}
+
+bool Options::parse_option(const std::string_view name,
+                           const std::string_view value) {
+  if (name == "cpu") {
+    if (value == "8086" || value == "8088") {
+      cpu_mode = CPU_MODE::CPU_8086;
+    } else if (value == "80186" || value == "186") {
+      cpu_mode = CPU_MODE::CPU_80186;
+    } else if (value == "80286" || value == "286") {
+      cpu_mode = CPU_MODE::CPU_80286;
+    } else {
+      return false;
+    }
+    return true;
+  }
+  if (name == "fpu") {
+    if (value == "none") {
+      fpu_mode = FPU_MODE::NONE;
+    } else if (value == "fast") {
+      fpu_mode = FPU_MODE::FAST;
+    } else if (value == "exact") {
+      fpu_mode = FPU_MODE::EXACT;
+    } else {
+      return false;
+    }
+    return true;
+  }
+  if (name == "disk" && !value.empty()) {
+    for (std::string_view& path : disk_paths) {
+      if (path.empty()) {
+        path = value;
+        return true;
+      }
+    }
+    return false;
+  }
+  if (name == "disk-overlay") {
+    disk_overlay = true;
+    return true;
+  }
+  if (name == "refresh") {
+    const std::string number{value};
+    char* end = nullptr;
+    refresh_hz = std::strtod(number.c_str(), &end);
+    return !number.empty() && *end == '\0' && refresh_hz >= 0.0;
+  }
+  if (name == "capture" && !value.empty()) {
+    capture_prefix = value;
+    return true;
+  }
+  if (name == "capture-raw" && !value.empty()) {
+    capture_raw_path = value;
+    return true;
+  }
+  if (name == "capture-every") {
+    const std::string number{value};
+    char* end = nullptr;
+    const unsigned long every = std::strtoul(number.c_str(), &end, 10);
+    if (number.empty() || *end != '\0' || every == 0 || every > UINT32_MAX) {
+      return false;
+    }
+    capture_every = static_cast<uint32_t>(every);
+    return true;
+  }
+  if (name == "keys" && !value.empty()) {
+    key_script_path = value;
+    return true;
+  }
+  if (name == "trace" && !value.empty()) {
+    trace_path = value;
+    return true;
+  }
+  if (name == "trace-range") {
+    const std::string range{value};
+    char* end = nullptr;
+    const unsigned long first = std::strtoul(range.c_str(), &end, 16);
+    if (end == range.c_str() || *end != '-') {
+      return false;
+    }
+    const char* second = end + 1;
+    const unsigned long last = std::strtoul(second, &end, 16);
+    if (end == second || *end != '\0' || first > last || last > UINT32_MAX) {
+      return false;
+    }
+    trace_first = static_cast<uint32_t>(first);
+    trace_last = static_cast<uint32_t>(last);
+    return true;
+  }
+  if (name == "coverage" && !value.empty()) {
+    coverage_path = value;
+    return true;
+  }
+  if (name == "gdb" && !value.empty()) {
+    gdb_address = value;
+    return true;
+  }
+  if (name == "stats" && !value.empty()) {
+    stats_path = value;
+    return true;
+  }
+  if (name == "timing") {
+    timing = true;
+    return true;
+  }
+  if (name == "mhz") {
+    const std::string number{value};
+    char* end = nullptr;
+    target_mhz = std::strtod(number.c_str(), &end);
+    if (number.empty() || *end != '\0' || target_mhz <= 0.0) {
+      return false;
+    }
+    timing = true;
+    return true;
+  }
+  if (name == "record" && !value.empty() && replay_path.empty()) {
+    record_path = value;
+    return true;
+  }
+  if (name == "replay" && !value.empty() && record_path.empty()) {
+    replay_path = value;
+    return true;
+  }
+  if (name == "snapshot" && !value.empty()) {
+    snapshot_path = value;
+    return true;
+  }
+  if (name == "fork-server") {
+    if (value.empty()) {
+      fork_server_jobs = 1;
+      return true;
+    }
+    const std::string number{value};
+    char* end = nullptr;
+    fork_server_jobs = static_cast<int>(std::strtol(number.c_str(), &end, 10));
+    return *end == '\0' && fork_server_jobs > 0;
+  }
+  if (name == "ready") {
+    const std::string number{value};
+    char* end = nullptr;
+    const long function = std::strtol(number.c_str(), &end, 16);
+    if (number.empty() || *end != '\0' || function < 0 || function > 0xFF) {
+      return false;
+    }
+    ready_function = static_cast<int>(function);
+    return true;
+  }
+
+  return false;
+}
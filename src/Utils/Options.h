@@ -0,0 +1,94 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include <optional>
+#include <string_view>
+
+#include "../CPU/CPUMode.h"
+#include "../FPU/FPUMode.h"
+
+/*
+  x8086 <c|e|s> <filename> [--option[=value]]...
+
+  c -> COM program, e -> MZ executable, s -> resume a snapshot
+
+  --cpu=8086|80186|80286    ignored for a snapshot, which resumes on the
+                            CPU it was taken on
+  --fpu=none|fast|exact     no coprocessor, host doubles (default) or
+                            bit exact 80-bit arithmetic
+  --disk=<image>            floppy (standard sizes) or hard disk image
+                            for INT 13h and INT 25h/26h
+  --disk-overlay            keep disk writes in memory, the images are
+                            never modified
+  --refresh=<hz>            text screen frames per second, 30 by default
+                            when stdout is a terminal and 0 otherwise,
+                            0 leaves the screen undrawn
+  --capture=<prefix>        graphics frames as <prefix>NNNNNN.png
+  --capture-raw=<file>      graphics frames as a raw RGB24 stream
+  --capture-every=<n>       instructions between frames, 100000 by default
+  --keys=<script>           keyboard input from a script timed in virtual
+                            time instead of the terminal (see KeyScript)
+  --timing                  count cycles, running unthrottled
+  --mhz=<frequency>         count cycles, throttled to frequency
+  --stats=<file>            counters of the run as JSON when it exits,
+                            - for stderr
+  --trace=<file>            binary trace of every instruction, x8086trace
+                            turns it into text (see TraceFormat.h)
+  --trace-range=<a>-<b>     trace only instructions at linear addresses
+                            a to b, in hex
+  --coverage=<file>         OR the linear addresses of the code that ran
+                            into a coverage file, %p is the process id
+                            (see CoverageMap.h, x8086cov)
+  --gdb=<port|path>         wait for a GDB client on a local TCP port or
+                            a Unix socket before the first instruction
+  --record=<log>            log every external input to <log>
+  --replay=<log>            feed a recorded log back instead of live input
+  --snapshot=<file>         save a snapshot at the ready point
+  --ready=<function>        INT 21h function (hex) that marks the ready
+                            point, by default the first request for input
+  --fork-server[=<jobs>]    serve runs forked from the ready point,
+                            requests on stdin, results on stderr (see
+                            ForkServer); not with --record, --replay,
+                            --stats, --capture(-raw) or --trace
+*/
+class Options {
+ public:
+  static std::optional<Options> parse(int argc, const char* argv[]);
+
+ private:
+  bool parse_option(std::string_view name, std::string_view value);
+
+ public:
+  char mode{0};
+  std::string_view input_filename;
+
+  CPU_MODE cpu_mode{CPU_MODE::CPU_8086};
+  FPU_MODE fpu_mode{FPU_MODE::FAST};
+  // A floppy and a hard disk
+  std::string_view disk_paths[2];
+  bool disk_overlay{false};
+  // Set by parse() from whether stdout is a terminal, then the option
+  double refresh_hz{0.0};
+  constexpr static double DEFAULT_REFRESH_HZ = 30.0;
+  std::string_view capture_prefix;
+  std::string_view capture_raw_path;
+  uint32_t capture_every{100'000};
+  std::string_view key_script_path;
+  bool timing{false};
+  double target_mhz{0.0};
+  std::string_view stats_path;
+  std::string_view trace_path;
+  uint32_t trace_first{0};
+  uint32_t trace_last{UINT32_MAX};
+  std::string_view gdb_address;
+  std::string_view coverage_path;
+
+  std::string_view record_path;
+  std::string_view replay_path;
+
+  std::string_view snapshot_path;
+  int ready_function{-1};
+  int fork_server_jobs{0};
+};
+
+#endif  // OPTIONS_H
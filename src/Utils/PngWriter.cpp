@@ -0,0 +1,123 @@
+#include "PngWriter.h"
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "logger.h"
+
+namespace {
+constexpr uint8_t SIGNATURE[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+constexpr uint8_t COLOR_TYPE_RGB = 2;
+constexpr uint8_t FILTER_NONE = 0;
+// Largest stored deflate block
+constexpr size_t MAX_BLOCK = 0xFFFF;
+
+const std::array<uint32_t, 256>& crc_table() {
+  static const std::array<uint32_t, 256> table = [] {
+    std::array<uint32_t, 256> entries{};
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t value = i;
+      for (int bit = 0; bit < 8; bit++) {
+        value = value & 1 ? 0xEDB88320 ^ value >> 1 : value >> 1;
+      }
+      entries[i] = value;
+    }
+    return entries;
+  }();
+  return table;
+}
+
+uint32_t crc32(const uint8_t* data, const size_t size, uint32_t crc) {
+  const std::array<uint32_t, 256>& table = crc_table();
+  for (size_t i = 0; i < size; i++) {
+    crc = table[(crc ^ data[i]) & 0xFF] ^ crc >> 8;
+  }
+  return crc;
+}
+
+void put32(std::vector<uint8_t>& out, const uint32_t value) {
+  out.push_back(static_cast<uint8_t>(value >> 24));
+  out.push_back(static_cast<uint8_t>(value >> 16));
+  out.push_back(static_cast<uint8_t>(value >> 8));
+  out.push_back(static_cast<uint8_t>(value));
+}
+
+void put_chunk(std::vector<uint8_t>& out, const char type[4],
+               const std::vector<uint8_t>& data) {
+  put32(out, static_cast<uint32_t>(data.size()));
+  const size_t start = out.size();
+  out.insert(out.end(), type, type + 4);
+  out.insert(out.end(), data.begin(), data.end());
+  put32(out, crc32(out.data() + start, out.size() - start, 0xFFFFFFFF) ^
+                 0xFFFFFFFF);
+}
+}  // namespace
+
+bool write_png(const std::string_view path, const uint8_t* rgb,
+               const uint32_t width, const uint32_t height) {
+  std::vector<uint8_t> header;
+  put32(header, width);
+  put32(header, height);
+  // 8 bits per channel, deflate, adaptive filtering, no interlace
+  header.insert(header.end(), {8, COLOR_TYPE_RGB, 0, 0, 0});
+
+  // Every scanline starts with its filter type
+  const size_t row_size = static_cast<size_t>(width) * 3;
+  std::vector<uint8_t> raw;
+  raw.reserve((row_size + 1) * height);
+  for (uint32_t y = 0; y < height; y++) {
+    raw.push_back(FILTER_NONE);
+    raw.insert(raw.end(), rgb + y * row_size, rgb + (y + 1) * row_size);
+  }
+
+  // zlib stream: header, stored blocks, Adler-32 of the raw data
+  std::vector<uint8_t> data;
+  data.reserve(raw.size() + raw.size() / MAX_BLOCK * 5 + 16);
+  data.push_back(0x78);
+  data.push_back(0x01);
+  size_t offset = 0;
+  do {
+    const size_t length =
+        raw.size() - offset < MAX_BLOCK ? raw.size() - offset : MAX_BLOCK;
+    data.push_back(offset + length == raw.size() ? 1 : 0);
+    data.push_back(static_cast<uint8_t>(length));
+    data.push_back(static_cast<uint8_t>(length >> 8));
+    data.push_back(static_cast<uint8_t>(~length));
+    data.push_back(static_cast<uint8_t>(~length >> 8));
+    data.insert(data.end(), raw.begin() + offset,
+                raw.begin() + offset + length);
+    offset += length;
+  } while (offset < raw.size());
+
+  // 5552 bytes is the most that cannot overflow before the modulo
+  uint32_t a = 1;
+  uint32_t b = 0;
+  for (size_t i = 0; i < raw.size();) {
+    const size_t end = raw.size() - i < 5552 ? raw.size() : i + 5552;
+    for (; i < end; i++) {
+      a += raw[i];
+      b += a;
+    }
+    a %= 65521;
+    b %= 65521;
+  }
+  put32(data, b << 16 | a);
+
+  std::vector<uint8_t> out(SIGNATURE, SIGNATURE + sizeof(SIGNATURE));
+  put_chunk(out, "IHDR", header);
+  put_chunk(out, "IDAT", data);
+  put_chunk(out, "IEND", {});
+
+  std::ofstream file{std::string{path}, std::ios::binary};
+  if (!file.write(reinterpret_cast<const char*>(out.data()),
+                  static_cast<std::streamsize>(out.size()))) {
+    mylog("Cannot write '%s'", std::string{path}.c_str());
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,15 @@
+#ifndef PNGWRITER_H
+#define PNGWRITER_H
+
+#include <cstdint>
+#include <string_view>
+
+/*
+  24-bit RGB image as a PNG file. The pixel data goes into stored
+  deflate blocks, uncompressed, so writing a frame costs little more
+  than copying it and needs no zlib.
+*/
+bool write_png(std::string_view path, const uint8_t* rgb, uint32_t width,
+               uint32_t height);
+
+#endif  // PNGWRITER_H
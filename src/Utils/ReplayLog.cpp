@@ -0,0 +1,181 @@
+#include "ReplayLog.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#include "../CPU/CPUMode.h"
+#include "logger.h"
+
+ReplayLog::ReplayLog()
+    : log_mode(ReplayMode::OFF),
+      file(nullptr),
+      buffer_pos(0),
+      buffer_end(0),
+      last_clock(0),
+      entries(0) {}
+
+ReplayLog::~ReplayLog() { close(); }
+
+bool ReplayLog::record(const std::string_view path, const CPU_MODE cpu_mode) {
+  close();
+  file = std::fopen(std::string{path}.c_str(), "wb");
+  if (!file) {
+    mylog("Cannot open replay log '%s' for writing", std::string{path}.c_str());
+    return false;
+  }
+
+  buffer.resize(BUFFER_SIZE);
+  buffer_pos = 0;
+  for (const char c : MAGIC) {
+    buffer[buffer_pos++] = static_cast<uint8_t>(c);
+  }
+  buffer[buffer_pos++] = VERSION;
+  buffer[buffer_pos++] = static_cast<uint8_t>(cpu_mode);
+
+  log_mode = ReplayMode::RECORD;
+  return true;
+}
+
+bool ReplayLog::replay(const std::string_view path, const CPU_MODE cpu_mode) {
+  close();
+  file = std::fopen(std::string{path}.c_str(), "rb");
+  if (!file) {
+    mylog("Cannot open replay log '%s'", std::string{path}.c_str());
+    return false;
+  }
+
+  buffer.resize(BUFFER_SIZE);
+  buffer_pos = buffer_end = 0;
+  log_mode = ReplayMode::REPLAY;
+
+  uint8_t header[sizeof(MAGIC) + 2]{};
+  bool complete = true;
+  for (uint8_t& byte : header) {
+    if (!read_byte(byte)) {
+      complete = false;
+      break;
+    }
+  }
+  if (!complete || std::memcmp(header, MAGIC, sizeof(MAGIC)) != 0 ||
+      header[sizeof(MAGIC)] != VERSION) {
+    mylog("'%s' is not a replay log of this version",
+          std::string{path}.c_str());
+    close();
+    return false;
+  }
+  if (header[sizeof(MAGIC) + 1] != static_cast<uint8_t>(cpu_mode)) {
+    mylog("Replay log was recorded with a different CPU mode");
+    close();
+    return false;
+  }
+
+  return true;
+}
+
+void ReplayLog::close() {
+  if (log_mode == ReplayMode::RECORD) {
+    flush();
+  }
+  if (file) {
+    std::fclose(file);
+    file = nullptr;
+  }
+  log_mode = ReplayMode::OFF;
+  buffer_pos = buffer_end = 0;
+  last_clock = 0;
+}
+
+void ReplayLog::flush() {
+  if (log_mode != ReplayMode::RECORD || buffer_pos == 0) {
+    return;
+  }
+
+  if (std::fwrite(buffer.data(), 1, buffer_pos, file) != buffer_pos) {
+    mylog("Cannot write replay log, recording stopped");
+    std::fclose(file);
+    file = nullptr;
+    log_mode = ReplayMode::OFF;
+  }
+  buffer_pos = 0;
+}
+
+void ReplayLog::write_entry(const ReplayEvent event, const uint64_t value) {
+  // Tag + at most 10 bytes of LEB128
+  if (buffer_pos + 11 > buffer.size()) {
+    flush();
+    if (log_mode != ReplayMode::RECORD) {
+      return;
+    }
+  }
+
+  buffer[buffer_pos++] = static_cast<uint8_t>(event);
+  write_varint(value);
+  entries++;
+}
+
+bool ReplayLog::read_entry(const ReplayEvent event, uint64_t& value) {
+  uint8_t tag;
+  if (!read_byte(tag)) {
+    diverged("end of log");
+    return false;
+  }
+  if (tag != static_cast<uint8_t>(event)) {
+    diverged("unexpected event");
+    return false;
+  }
+  if (!read_varint(value)) {
+    diverged("truncated entry");
+    return false;
+  }
+
+  entries++;
+  return true;
+}
+
+void ReplayLog::write_varint(uint64_t value) {
+  do {
+    uint8_t byte = value & 0x7F;
+    value >>= 7;
+    if (value) {
+      byte |= 0x80;
+    }
+    buffer[buffer_pos++] = byte;
+  } while (value);
+}
+
+bool ReplayLog::read_varint(uint64_t& value) {
+  value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    uint8_t byte;
+    if (!read_byte(byte)) {
+      return false;
+    }
+    value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+    if (!(byte & 0x80)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ReplayLog::read_byte(uint8_t& byte) {
+  if (buffer_pos == buffer_end) {
+    buffer_end = std::fread(buffer.data(), 1, buffer.size(), file);
+    buffer_pos = 0;
+    if (buffer_end == 0) {
+      return false;
+    }
+  }
+
+  byte = buffer[buffer_pos++];
+  return true;
+}
+
+void ReplayLog::diverged(const char* reason) {
+  mylog("Replay diverged after %llu entries (%s), continuing live",
+        static_cast<unsigned long long>(entries), reason);
+  close();
+}
@@ -0,0 +1,99 @@
+#ifndef REPLAYLOG_H
+#define REPLAYLOG_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string_view>
+#include <vector>
+
+#include "../CPU/CPUMode.h"
+
+enum class ReplayMode { OFF, RECORD, REPLAY };
+
+/*
+  Every external input the guest can observe is tagged with one of these,
+  so a replay that asks for something else is caught as a divergence
+*/
+enum class ReplayEvent : uint8_t {
+  CLOCK = 1,
+  // A console byte, or 0x100 at the end of redirected input
+  CONSOLE_READ = 2,
+  // Whether a console byte was waiting, 0 or 1
+  CONSOLE_READY = 3,
+};
+
+/*
+  Log of everything nondeterministic the guest has seen.
+
+  Recording passes the live value through and appends it to the log,
+  replaying never calls the live source and hands back the logged value
+  instead. Each entry is a one byte tag followed by a LEB128 value, clock
+  readings are stored as a delta to the previous one.
+*/
+class ReplayLog {
+ public:
+  ReplayLog();
+  ~ReplayLog();
+  ReplayLog(const ReplayLog&) = delete;
+  ReplayLog& operator=(const ReplayLog&) = delete;
+
+  bool record(std::string_view path, CPU_MODE cpu_mode);
+  bool replay(std::string_view path, CPU_MODE cpu_mode);
+  void close();
+
+  [[nodiscard]] ReplayMode mode() const { return log_mode; }
+  [[nodiscard]] bool active() const { return log_mode != ReplayMode::OFF; }
+
+  template <typename LiveSource>
+  uint64_t input(const ReplayEvent event, LiveSource&& live) {
+    if (log_mode == ReplayMode::REPLAY) {
+      uint64_t value;
+      if (read_entry(event, value)) {
+        return value;
+      }
+    }
+
+    const uint64_t value = live();
+    if (log_mode == ReplayMode::RECORD) {
+      write_entry(event, value);
+    }
+    return value;
+  }
+
+  template <typename LiveSource>
+  uint64_t clock(LiveSource&& live) {
+    if (log_mode == ReplayMode::OFF) {
+      return live();
+    }
+
+    const uint64_t delta = input(ReplayEvent::CLOCK, [&]() -> uint64_t {
+      return live() - last_clock;
+    });
+    last_clock += delta;
+    return last_clock;
+  }
+
+  void flush();
+
+ private:
+  void write_entry(ReplayEvent event, uint64_t value);
+  bool read_entry(ReplayEvent event, uint64_t& value);
+  void write_varint(uint64_t value);
+  bool read_varint(uint64_t& value);
+  bool read_byte(uint8_t& byte);
+  void diverged(const char* reason);
+
+  constexpr static char MAGIC[4] = {'X', '8', '6', 'R'};
+  constexpr static uint8_t VERSION = 1;
+  constexpr static size_t BUFFER_SIZE = 64 * 1024;
+
+  ReplayMode log_mode;
+  std::FILE* file;
+  std::vector<uint8_t> buffer;
+  size_t buffer_pos;
+  size_t buffer_end;
+  uint64_t last_clock;
+  uint64_t entries;
+};
+
+#endif  // REPLAYLOG_H
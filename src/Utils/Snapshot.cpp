@@ -0,0 +1,453 @@
+#include "Snapshot.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../CPU/CPU8068.h"
+#include "../CPU/Memory.h"
+#include "../Devices/BiosDataArea.h"
+#include "../Devices/Framebuffer.h"
+#include "logger.h"
+
+static void put16(std::vector<uint8_t>& out, const uint16_t value) {
+  out.push_back(value & 0xFF);
+  out.push_back(value >> 8);
+}
+
+static void put32(std::vector<uint8_t>& out, const uint32_t value) {
+  put16(out, value & 0xFFFF);
+  put16(out, value >> 16);
+}
+
+static uint16_t get16(const uint8_t* in) {
+  return static_cast<uint16_t>(in[0] | (in[1] << 8));
+}
+
+static uint32_t get32(const uint8_t* in) {
+  return get16(in) | (static_cast<uint32_t>(get16(in + 2)) << 16);
+}
+
+static void put_descriptor(std::vector<uint8_t>& out,
+                           const SegmentDescriptor& descriptor) {
+  put16(out, descriptor.selector);
+  put32(out, descriptor.base);
+  put16(out, descriptor.limit);
+  out.push_back(descriptor.access);
+}
+
+static SegmentDescriptor get_descriptor(const uint8_t* in) {
+  return SegmentDescriptor{get16(in), get32(in + 2), get16(in + 6), in[8]};
+}
+
+// Bytes per descriptor in the "PM  " section
+constexpr static size_t DESCRIPTOR_SIZE = 9;
+
+static void put_section(std::vector<uint8_t>& out, const char* tag,
+                        const std::vector<uint8_t>& payload) {
+  out.insert(out.end(), tag, tag + 4);
+  put32(out, static_cast<uint32_t>(payload.size()));
+  out.insert(out.end(), payload.begin(), payload.end());
+}
+
+std::optional<Snapshot> Snapshot::capture(const CPU8068& cpu) {
+  Snapshot snapshot;
+  snapshot.cpu_mode = cpu.cpu_mode;
+  snapshot.AX = cpu.AX;
+  snapshot.BX = cpu.BX;
+  snapshot.CX = cpu.CX;
+  snapshot.DX = cpu.DX;
+  snapshot.SP = cpu.SP;
+  snapshot.BP = cpu.BP;
+  snapshot.SI = cpu.SI;
+  snapshot.DI = cpu.DI;
+  snapshot.CS = cpu.CS;
+  snapshot.DS = cpu.DS;
+  snapshot.SS = cpu.SS;
+  snapshot.ES = cpu.ES;
+  snapshot.IP = cpu.IP;
+  snapshot.FLAGS = cpu.FLAGS;
+  snapshot.interrupt_delay = cpu.interrupt_delay;
+
+  snapshot.MSW = cpu.MSW;
+  snapshot.GDTR = cpu.GDTR;
+  snapshot.IDTR = cpu.IDTR;
+  snapshot.LDTR = cpu.LDTR;
+  std::copy(std::begin(cpu.segment_cache), std::end(cpu.segment_cache),
+            std::begin(snapshot.segment_cache));
+  snapshot.has_descriptor_cache = true;
+
+  if (cpu.fpu) {
+    cpu.fpu->save_state(snapshot.fpu_state);
+    snapshot.has_fpu_state = true;
+  }
+
+  cpu.pit.save_state(snapshot.timer_state);
+  snapshot.event_deadline = cpu.event_deadline;
+  snapshot.event_countdown = cpu.event_countdown;
+  snapshot.irq0_pending = cpu.irq0_pending;
+  snapshot.interrupt_mask = cpu.interrupt_mask;
+  snapshot.system_control = cpu.system_control;
+  snapshot.has_timer_state = true;
+
+  cpu.keyboard.save_state(snapshot.keyboard_state);
+  snapshot.irq1_pending = cpu.irq1_pending;
+  snapshot.keyboard_host = cpu.keyboard_host;
+  snapshot.dos_extended = cpu.dos_extended;
+  snapshot.host_poll_at = cpu.host_poll_at;
+  snapshot.script_taken =
+      cpu.key_script ? static_cast<uint32_t>(cpu.key_script->taken()) : 0;
+  snapshot.has_keyboard_state = true;
+
+  cpu.framebuffer.save_state(snapshot.video_state);
+  snapshot.has_video_state = true;
+
+  snapshot.psp_segment = cpu.psp_segment;
+  snapshot.return_code = cpu.return_code;
+
+  snapshot.memory = SharedImage::create(cpu.memory.data(), cpu.memory.size());
+  if (!snapshot.memory) {
+    return std::nullopt;
+  }
+  return snapshot;
+}
+
+bool Snapshot::restore(CPU8068& cpu) const {
+  if (cpu.cpu_mode != cpu_mode) {
+    mylog("Snapshot was taken with a different CPU mode");
+    return false;
+  }
+
+  cpu.AX = AX;
+  cpu.BX = BX;
+  cpu.CX = CX;
+  cpu.DX = DX;
+  cpu.SP = SP;
+  cpu.BP = BP;
+  cpu.SI = SI;
+  cpu.DI = DI;
+  cpu.CS = CS;
+  cpu.DS = DS;
+  cpu.SS = SS;
+  cpu.ES = ES;
+  cpu.IP = IP;
+  cpu.FLAGS = FLAGS;
+  cpu.interrupt_delay = interrupt_delay;
+
+  cpu.MSW = MSW;
+  cpu.GDTR = GDTR;
+  cpu.IDTR = IDTR;
+  cpu.LDTR = LDTR;
+
+  cpu.memory.map_copy_on_write(*memory);
+  cpu.psp_segment = psp_segment;
+  cpu.return_code = return_code;
+  cpu.arena.rebuild();
+
+  if (has_timer_state) {
+    cpu.set_virtual_clock(event_deadline - event_countdown);
+    cpu.pit.load_state(timer_state);
+    cpu.irq0_pending = irq0_pending;
+    cpu.interrupt_mask = interrupt_mask;
+    cpu.system_control = system_control;
+    cpu.schedule_timer();
+  } else {
+    // Taken before the vector table was kept in memory, the data area holds
+    std::array<uint8_t, BiosDataArea::END - BiosDataArea::BASE> data{};
+    std::memcpy(data.data(), &cpu.memory[BiosDataArea::BASE], data.size());
+    cpu.install_bios();
+    std::memcpy(&cpu.memory[BiosDataArea::BASE], data.data(), data.size());
+    cpu.reset_timer();
+  }
+
+  if (has_keyboard_state) {
+    cpu.keyboard.load_state(keyboard_state);
+    cpu.gate_a20();
+    cpu.irq1_pending = irq1_pending;
+    // A key script given now takes over from the terminal
+    cpu.keyboard_host = keyboard_host && !cpu.key_script;
+    cpu.dos_extended = dos_extended;
+    cpu.host_poll_at = host_poll_at;
+    if (cpu.key_script) {
+      cpu.key_script->skip(script_taken);
+    }
+    cpu.schedule_keyboard();
+  } else {
+    cpu.reset_keyboard();
+  }
+
+  // Before execution, so the first captured frame has the guest's palette
+  if (has_video_state &&
+      !cpu.framebuffer.load_state(video_state.data(), video_state.size())) {
+    mylog("Truncated video state in snapshot");
+    return false;
+  }
+
+  if (has_descriptor_cache) {
+    std::copy(std::begin(segment_cache), std::end(segment_cache),
+              std::begin(cpu.segment_cache));
+  } else {
+    cpu.update_segment_registers();
+  }
+
+  if (cpu.fpu) {
+    if (has_fpu_state) {
+      cpu.fpu->load_state(fpu_state);
+    } else {
+      cpu.fpu->reset();
+    }
+  }
+  return true;
+}
+
+bool Snapshot::save(const std::string_view path) const {
+  std::vector<uint8_t> out;
+  out.insert(out.end(), {'X', '8', '6', 'S'});
+  put16(out, VERSION);
+
+  std::vector<uint8_t> cpu_section;
+  cpu_section.push_back(static_cast<uint8_t>(cpu_mode));
+  for (const uint16_t reg :
+       {AX, BX, CX, DX, SP, BP, SI, DI, CS, DS, SS, ES, IP, FLAGS}) {
+    put16(cpu_section, reg);
+  }
+  cpu_section.push_back(interrupt_delay);
+  put_section(out, "CPU ", cpu_section);
+
+  // u16 MSW, GDTR and IDTR as u32 base u16 limit, then LDTR, ES, CS, SS, DS
+  std::vector<uint8_t> pm_section;
+  put16(pm_section, MSW);
+  for (const DescriptorTableRegister& table : {GDTR, IDTR}) {
+    put32(pm_section, table.base);
+    put16(pm_section, table.limit);
+  }
+  put_descriptor(pm_section, LDTR);
+  for (const SegmentDescriptor& descriptor : segment_cache) {
+    put_descriptor(pm_section, descriptor);
+  }
+  put_section(out, "PM  ", pm_section);
+
+  if (has_fpu_state) {
+    put_section(out, "FPU ", {std::begin(fpu_state), std::end(fpu_state)});
+  }
+
+  /*
+    Timer state, then u32 deadline low, high, u32 countdown, u8 pending,
+    u8 interrupt mask, u8 port 61h
+  */
+  if (has_timer_state) {
+    std::vector<uint8_t> pit_section{std::begin(timer_state),
+                                     std::end(timer_state)};
+    put32(pit_section, static_cast<uint32_t>(event_deadline));
+    put32(pit_section, static_cast<uint32_t>(event_deadline >> 32));
+    put32(pit_section, event_countdown);
+    pit_section.push_back(irq0_pending);
+    pit_section.push_back(interrupt_mask);
+    pit_section.push_back(system_control);
+    put_section(out, "PIT ", pit_section);
+  }
+
+  /*
+    Controller state, then u8 IRQ1 pending and terminal polled bits,
+    u8 DOS extended key, u32 terminal poll clock low, high, u32 key
+    script strokes taken
+  */
+  if (has_keyboard_state) {
+    std::vector<uint8_t> keyboard_section{std::begin(keyboard_state),
+                                          std::end(keyboard_state)};
+    keyboard_section.push_back(
+        static_cast<uint8_t>(irq1_pending | keyboard_host << 1));
+    keyboard_section.push_back(dos_extended);
+    put32(keyboard_section, static_cast<uint32_t>(host_poll_at));
+    put32(keyboard_section, static_cast<uint32_t>(host_poll_at >> 32));
+    put32(keyboard_section, script_taken);
+    put_section(out, "KBD ", keyboard_section);
+  }
+
+  // Versioned by its first byte, other versions load with the default palette
+  if (has_video_state) {
+    put_section(out, "VID ", video_state);
+  }
+
+  std::vector<uint8_t> dos_section;
+  put16(dos_section, psp_segment);
+  put16(dos_section, return_code);
+  put_section(out, "DOS ", dos_section);
+
+  /*
+    u32 size, then a bitmap with one bit per page that is not all zero,
+    then those pages. Most of a freshly loaded machine is zero.
+  */
+  const uint8_t* data = memory->data();
+  const size_t size = memory->size();
+  const size_t pages = (size + PAGE_SIZE - 1) / PAGE_SIZE;
+  std::vector<uint8_t> mem_section;
+  put32(mem_section, static_cast<uint32_t>(size));
+  const size_t bitmap_offset = mem_section.size();
+  mem_section.resize(bitmap_offset + (pages + 7) / 8, 0);
+  for (size_t page = 0; page < pages; page++) {
+    const uint8_t* begin = data + page * PAGE_SIZE;
+    const uint8_t* end = data + std::min(size, (page + 1) * PAGE_SIZE);
+    if (std::all_of(begin, end, [](const uint8_t b) { return b == 0; })) {
+      continue;
+    }
+    mem_section[bitmap_offset + page / 8] |= 1 << (page % 8);
+    mem_section.insert(mem_section.end(), begin, end);
+  }
+  put_section(out, "MEM ", mem_section);
+  put_section(out, "END ", {});
+
+  std::ofstream file{std::string{path}, std::ios::binary};
+  if (!file.is_open()) {
+    mylog("Cannot open snapshot '%s' for writing", std::string{path}.c_str());
+    return false;
+  }
+  file.write(reinterpret_cast<const char*>(out.data()),
+             static_cast<std::streamsize>(out.size()));
+  return file.good();
+}
+
+std::optional<Snapshot> Snapshot::load(const std::string_view path) {
+  std::ifstream file{std::string{path}, std::ios::binary};
+  if (!file.is_open()) {
+    mylog("Cannot open snapshot '%s'", std::string{path}.c_str());
+    return std::nullopt;
+  }
+  const std::vector<uint8_t> in{std::istreambuf_iterator<char>{file},
+                                std::istreambuf_iterator<char>{}};
+
+  if (in.size() < 6 || std::memcmp(in.data(), "X86S", 4) != 0) {
+    mylog("'%s' is not a snapshot", std::string{path}.c_str());
+    return std::nullopt;
+  }
+  if (get16(in.data() + 4) > VERSION) {
+    mylog("Snapshot '%s' is from a newer version", std::string{path}.c_str());
+    return std::nullopt;
+  }
+
+  Snapshot snapshot;
+  bool has_cpu = false;
+  size_t pos = 6;
+  while (pos + 8 <= in.size()) {
+    const char* tag = reinterpret_cast<const char*>(in.data() + pos);
+    const uint32_t length = get32(in.data() + pos + 4);
+    const uint8_t* payload = in.data() + pos + 8;
+    pos += 8;
+    if (pos + length > in.size()) {
+      break;
+    }
+    pos += length;
+
+    if (std::memcmp(tag, "END ", 4) == 0) {
+      if (!has_cpu || !snapshot.memory) {
+        break;
+      }
+      return snapshot;
+    }
+
+    if (std::memcmp(tag, "CPU ", 4) == 0 && length >= 30) {
+      snapshot.cpu_mode = static_cast<CPU_MODE>(payload[0]);
+      uint16_t* regs[] = {&snapshot.AX, &snapshot.BX, &snapshot.CX,
+                          &snapshot.DX, &snapshot.SP, &snapshot.BP,
+                          &snapshot.SI, &snapshot.DI, &snapshot.CS,
+                          &snapshot.DS, &snapshot.SS, &snapshot.ES,
+                          &snapshot.IP, &snapshot.FLAGS};
+      for (size_t i = 0; i < std::size(regs); i++) {
+        *regs[i] = get16(payload + 1 + i * 2);
+      }
+      snapshot.interrupt_delay = payload[29];
+      has_cpu = true;
+    } else if (std::memcmp(tag, "PM  ", 4) == 0 &&
+               length >= 14 + 5 * DESCRIPTOR_SIZE) {
+      snapshot.MSW = get16(payload);
+      snapshot.GDTR = DescriptorTableRegister{get32(payload + 2),
+                                              get16(payload + 6)};
+      snapshot.IDTR = DescriptorTableRegister{get32(payload + 8),
+                                              get16(payload + 12)};
+      const uint8_t* descriptors = payload + 14;
+      snapshot.LDTR = get_descriptor(descriptors);
+      for (size_t i = 0; i < std::size(snapshot.segment_cache); i++) {
+        snapshot.segment_cache[i] =
+            get_descriptor(descriptors + (i + 1) * DESCRIPTOR_SIZE);
+      }
+      snapshot.has_descriptor_cache = true;
+    } else if (std::memcmp(tag, "FPU ", 4) == 0 &&
+               length >= FPU::STATE_SIZE) {
+      std::memcpy(snapshot.fpu_state, payload, FPU::STATE_SIZE);
+      snapshot.has_fpu_state = true;
+    } else if (std::memcmp(tag, "PIT ", 4) == 0 &&
+               length >= IntervalTimer::STATE_SIZE + 13) {
+      std::memcpy(snapshot.timer_state, payload, IntervalTimer::STATE_SIZE);
+      const uint8_t* clock = payload + IntervalTimer::STATE_SIZE;
+      snapshot.event_deadline =
+          get32(clock) | static_cast<uint64_t>(get32(clock + 4)) << 32;
+      snapshot.event_countdown = get32(clock + 8);
+      snapshot.irq0_pending = clock[12];
+      if (length >= IntervalTimer::STATE_SIZE + 14) {
+        snapshot.interrupt_mask = clock[13];
+      }
+      if (length >= IntervalTimer::STATE_SIZE + 15) {
+        snapshot.system_control = clock[14];
+      }
+      snapshot.has_timer_state = true;
+    } else if (std::memcmp(tag, "KBD ", 4) == 0 &&
+               length >= Keyboard::STATE_SIZE + 14) {
+      std::memcpy(snapshot.keyboard_state, payload, Keyboard::STATE_SIZE);
+      const uint8_t* rest = payload + Keyboard::STATE_SIZE;
+      snapshot.irq1_pending = rest[0] & 1;
+      snapshot.keyboard_host = rest[0] & 2;
+      snapshot.dos_extended = rest[1];
+      snapshot.host_poll_at =
+          get32(rest + 2) | static_cast<uint64_t>(get32(rest + 6)) << 32;
+      snapshot.script_taken = get32(rest + 10);
+      snapshot.has_keyboard_state = true;
+    } else if (std::memcmp(tag, "VID ", 4) == 0 && length >= 1 &&
+               payload[0] == Framebuffer::STATE_VERSION) {
+      snapshot.video_state.assign(payload, payload + length);
+      snapshot.has_video_state = true;
+    } else if (std::memcmp(tag, "DOS ", 4) == 0 && length >= 2) {
+      snapshot.psp_segment = get16(payload);
+      if (length >= 4) {
+        snapshot.return_code = get16(payload + 2);
+      }
+    } else if (std::memcmp(tag, "MEM ", 4) == 0 && length >= 4) {
+      const size_t size = get32(payload);
+      const size_t pages = (size + PAGE_SIZE - 1) / PAGE_SIZE;
+      if (4 + (pages + 7) / 8 > length) {
+        break;
+      }
+      const uint8_t* bitmap = payload + 4;
+      const uint8_t* page_data = bitmap + (pages + 7) / 8;
+      const uint8_t* payload_end = payload + length;
+
+      std::vector<uint8_t> image(size, 0);
+      for (size_t page = 0; page < pages; page++) {
+        if (!(bitmap[page / 8] & (1 << (page % 8)))) {
+          continue;
+        }
+        const size_t page_bytes = std::min(PAGE_SIZE, size - page * PAGE_SIZE);
+        if (page_data + page_bytes > payload_end) {
+          mylog("Truncated memory in snapshot '%s'", std::string{path}.c_str());
+          return std::nullopt;
+        }
+        std::memcpy(image.data() + page * PAGE_SIZE, page_data, page_bytes);
+        page_data += page_bytes;
+      }
+
+      snapshot.memory = SharedImage::create(image.data(), image.size());
+      if (!snapshot.memory) {
+        return std::nullopt;
+      }
+    }
+    // Sections from newer versions are skipped
+  }
+
+  mylog("Snapshot '%s' is incomplete", std::string{path}.c_str());
+  return std::nullopt;
+}
@@ -0,0 +1,95 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "../CPU/CPU8068.h"
+#include "../CPU/CPUMode.h"
+#include "../CPU/Descriptor.h"
+#include "../CPU/Memory.h"
+#include "../Devices/IntervalTimer.h"
+#include "../Devices/Keyboard.h"
+#include "../FPU/FPU.h"
+
+/*
+  Full machine state at one point in time.
+
+  Copies of a Snapshot share the same memory image, and restoring maps
+  that image copy-on-write, so starting many runs from one snapshot only
+  costs the pages each run writes to.
+
+  On disk it is a versioned list of tagged sections, so state of devices
+  added later can be appended without breaking older files:
+
+    "X86S" u16 version
+    { char tag[4]; u32 length; u8 payload[length]; }...
+    "END " 0
+*/
+class Snapshot {
+ public:
+  static std::optional<Snapshot> capture(const CPU8068& cpu);
+  // False when cpu is not the kind the snapshot was taken on
+  bool restore(CPU8068& cpu) const;
+
+  static std::optional<Snapshot> load(std::string_view path);
+  [[nodiscard]] bool save(std::string_view path) const;
+
+ public:
+  CPU_MODE cpu_mode{CPU_MODE::CPU_8086};
+  uint16_t AX{0}, BX{0}, CX{0}, DX{0};
+  uint16_t SP{0}, BP{0}, SI{0}, DI{0};
+  uint16_t CS{0}, DS{0}, SS{0}, ES{0};
+  uint16_t IP{0};
+  uint16_t FLAGS{0};
+  uint8_t interrupt_delay{0};
+
+  // 80286 state, older files without it restore into real mode
+  uint16_t MSW{0};
+  DescriptorTableRegister GDTR{0, 0xFFFF}, IDTR{0, 0xFFFF};
+  SegmentDescriptor LDTR{};
+  SegmentDescriptor segment_cache[4]{};
+  bool has_descriptor_cache{false};
+
+  // FSAVE image, only when the machine has a coprocessor
+  uint8_t fpu_state[FPU::STATE_SIZE]{};
+  bool has_fpu_state{false};
+
+  // Interval timer and the virtual clock, older files get a fresh BIOS
+  uint8_t timer_state[IntervalTimer::STATE_SIZE]{};
+  uint64_t event_deadline{0};
+  uint32_t event_countdown{0};
+  bool irq0_pending{false};
+  uint8_t interrupt_mask{0};
+  // Port 61h, the timer 2 gate and speaker bits
+  uint8_t system_control{0};
+  bool has_timer_state{false};
+
+  // Keyboard controller, older files get an empty keyboard buffer
+  uint8_t keyboard_state[Keyboard::STATE_SIZE]{};
+  bool irq1_pending{false};
+  bool keyboard_host{false};
+  uint8_t dos_extended{0};
+  uint64_t host_poll_at{0};
+  uint32_t script_taken{0};
+  bool has_keyboard_state{false};
+
+  // Framebuffer::save_state image, older files keep the default palette
+  std::vector<uint8_t> video_state;
+  bool has_video_state{false};
+
+  // DOS state, the memory arena itself is read back from the MCB chain
+  uint16_t psp_segment{0};
+  uint16_t return_code{0};
+
+  std::shared_ptr<const SharedImage> memory;
+
+  constexpr static uint16_t VERSION = 1;
+  // Granularity of the all-zero page elision in the memory section
+  constexpr static size_t PAGE_SIZE = 4096;
+};
+
+#endif  // SNAPSHOT_H
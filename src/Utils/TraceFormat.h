@@ -0,0 +1,48 @@
+#ifndef TRACEFORMAT_H
+#define TRACEFORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+  Execution trace files, written by x8086 --trace and read by x8086trace.
+
+  "X86T", u16 version, then one record per traced instruction, all
+  numbers little endian:
+
+    u8   tag              bits 0-3 instruction length, the flags below
+    u16  CS               HAS_CS, else the CS of the record before
+    u16  IP               HAS_IP, else IP + length of the record before
+    u8   code[length]     the instruction, or the bytes at CS:IP when it
+                          transferred control and its length is unknown
+    u16  mask, u16 value  HAS_REGISTERS, the registers that differ from
+         per set bit      the record before, bit n is REGISTER_NAMES[n]
+    u8   count            HAS_WRITES, memory the instruction wrote to,
+         u24 address,     and any interrupt frame pushed just before it:
+         u16 size, data   linear address, bytes, their values after the
+                          instruction, per area
+
+  The first record has every flag it can, so a trace decodes from the
+  start with nothing assumed.
+*/
+namespace TraceFormat {
+constexpr char MAGIC[4] = {'X', '8', '6', 'T'};
+constexpr uint16_t VERSION = 1;
+constexpr size_t HEADER_SIZE = 6;
+
+constexpr uint8_t LENGTH_MASK = 0x0F;
+constexpr uint8_t HAS_CS = 0x10;
+constexpr uint8_t HAS_IP = 0x20;
+constexpr uint8_t HAS_REGISTERS = 0x40;
+constexpr uint8_t HAS_WRITES = 0x80;
+
+constexpr size_t REGISTERS = 12;
+constexpr const char* REGISTER_NAMES[REGISTERS] = {
+    "AX", "BX", "CX", "DX", "SP", "BP", "SI", "DI", "DS", "ES", "SS", "FL"};
+constexpr uint16_t ALL_REGISTERS = (1 << REGISTERS) - 1;
+
+// Code bytes kept when the length could not be told from the next IP
+constexpr uint8_t UNKNOWN_LENGTH = 6;
+}  // namespace TraceFormat
+
+#endif  // TRACEFORMAT_H
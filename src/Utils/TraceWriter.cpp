@@ -0,0 +1,91 @@
+#include "TraceWriter.h"
+
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "TraceFormat.h"
+#include "logger.h"
+
+std::unique_ptr<TraceWriter> TraceWriter::open(const std::string_view path) {
+  std::FILE* file = std::fopen(std::string{path}.c_str(), "wb");
+  if (!file) {
+    mylog("Cannot open trace '%s' for writing", std::string{path}.c_str());
+    return nullptr;
+  }
+
+  std::unique_ptr<TraceWriter> writer{new TraceWriter(file)};
+  const uint8_t header[TraceFormat::HEADER_SIZE] = {
+      TraceFormat::MAGIC[0], TraceFormat::MAGIC[1],
+      TraceFormat::MAGIC[2], TraceFormat::MAGIC[3],
+      static_cast<uint8_t>(TraceFormat::VERSION),
+      static_cast<uint8_t>(TraceFormat::VERSION >> 8)};
+  writer->write(header, sizeof(header));
+  return writer;
+}
+
+TraceWriter::TraceWriter(std::FILE* file) : file(file) {
+  buffer.reserve(BUFFER_SIZE);
+  thread = std::thread(&TraceWriter::run, this);
+}
+
+TraceWriter::~TraceWriter() {
+  hand_off();
+  {
+    const std::lock_guard<std::mutex> guard(lock);
+    closing = true;
+  }
+  changed.notify_all();
+  thread.join();
+
+  if (std::fclose(file) != 0 || failed) {
+    mylog("Trace was not written completely");
+  }
+}
+
+void TraceWriter::hand_off() {
+  if (buffer.empty()) {
+    return;
+  }
+
+  std::unique_lock<std::mutex> guard(lock);
+  changed.wait(guard, [this]() { return pending.size() < MAX_PENDING; });
+  pending.push_back(std::move(buffer));
+  if (spare.empty()) {
+    buffer = std::vector<uint8_t>();
+    buffer.reserve(BUFFER_SIZE);
+  } else {
+    buffer = std::move(spare.back());
+    spare.pop_back();
+  }
+  guard.unlock();
+  changed.notify_all();
+}
+
+void TraceWriter::run() {
+  std::unique_lock<std::mutex> guard(lock);
+  while (true) {
+    changed.wait(guard, [this]() { return closing || !pending.empty(); });
+    if (pending.empty()) {
+      return;
+    }
+
+    std::vector<uint8_t> full = std::move(pending.front());
+    pending.pop_front();
+    guard.unlock();
+    changed.notify_all();
+
+    if (!failed &&
+        std::fwrite(full.data(), 1, full.size(), file) != full.size()) {
+      failed = true;
+    }
+    full.clear();
+
+    guard.lock();
+    spare.push_back(std::move(full));
+  }
+}
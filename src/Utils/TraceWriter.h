@@ -0,0 +1,56 @@
+#ifndef TRACEWRITER_H
+#define TRACEWRITER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+/*
+  Streams a trace file (see TraceFormat.h) from a background thread.
+  The CPU thread only appends to an in-memory buffer; full buffers go
+  to the writer thread and are reused once written. If the disk falls
+  behind by MAX_PENDING buffers the CPU waits rather than drop records.
+*/
+class TraceWriter {
+ public:
+  static std::unique_ptr<TraceWriter> open(std::string_view path);
+  // Writes what is left and stops the thread
+  ~TraceWriter();
+  TraceWriter(const TraceWriter&) = delete;
+  TraceWriter& operator=(const TraceWriter&) = delete;
+
+  void write(const uint8_t* data, size_t size) {
+    if (buffer.size() + size > BUFFER_SIZE) {
+      hand_off();
+    }
+    buffer.insert(buffer.end(), data, data + size);
+  }
+
+  constexpr static size_t BUFFER_SIZE = 1 << 20;
+  constexpr static size_t MAX_PENDING = 8;
+
+ private:
+  explicit TraceWriter(std::FILE* file);
+  void hand_off();
+  void run();
+
+  std::FILE* file;
+  std::vector<uint8_t> buffer;
+
+  std::mutex lock;
+  std::condition_variable changed;
+  std::deque<std::vector<uint8_t>> pending;
+  std::vector<std::vector<uint8_t>> spare;
+  bool closing{false};
+  bool failed{false};
+  std::thread thread;
+};
+
+#endif  // TRACEWRITER_H
@@ -1,25 +1,111 @@
-﻿#include <optional>
+﻿#include <cstdio>
+#include <memory>
+#include <optional>
 #include <string_view>
+#include <utility>
 
 #include "CPU/CPU8068.h"
 #include "CPU/CPUMode.h"
+#include "Devices/DiskImage.h"
+#include "Devices/FrameCapture.h"
+#include "DOS/ProgramImage.h"
 #include "Exceptions/ProgramExitedException.h"
 #include "ExecutableFiles/COM.h"
 #include "ExecutableFiles/MZExe.h"
 #include "Utils/EnableCursorControl.h"
+#include "Utils/ForkServer.h"
+#include "Utils/GdbStub.h"
+#include "Utils/KeyScript.h"
 #include "Utils/LoadToCpu.h"
+#include "Utils/Options.h"
+#include "Utils/Snapshot.h"
+#include "Utils/TraceWriter.h"
 #include "Utils/logger.h"
 
 int main(const int argc, const char* argv[]) {
-  if (argc < 3) {
-    mylog("Usage: %s <filename>", argv[0]);
+  const std::optional<Options> options{Options::parse(argc, argv)};
+  if (!options) {
+    mylog("Usage: %s <c|e|s> <filename> [--cpu=8086|80186|80286] "
+          "[--fpu=none|fast|exact] [--disk=<image>]... [--disk-overlay] "
+          "[--refresh=<hz>] [--capture=<prefix>] [--capture-raw=<file>] "
+          "[--capture-every=<instructions>] [--keys=<script>] [--timing] "
+          "[--mhz=<frequency>] [--stats=<file>] [--trace=<file>] "
+          "[--trace-range=<first>-<last>] [--coverage=<file>] "
+          "[--gdb=<port|path>] "
+          "[--record=<log>|--replay=<log>] "
+          "[--snapshot=<file>] [--ready=<function>] [--fork-server[=<jobs>]]",
+          argv[0]);
     return 1;
   }
 
-  const std::string_view input_filename{argv[2]};
-  const char mode = argv[1][0];
+  const std::string_view input_filename{options->input_filename};
+  const char mode = options->mode;
+
+  // A snapshot is restored into the kind of CPU it was taken on
+  std::optional<Snapshot> snapshot;
+  CPU_MODE cpu_mode = options->cpu_mode;
+  if (mode == 's') {
+    snapshot = Snapshot::load(input_filename);
+    if (!snapshot) {
+      return -1;
+    }
+    cpu_mode = snapshot->cpu_mode;
+  }
 
-  CPU8068 cpu(CPU_MODE::CPU_8086);
+  CPU8068 cpu(cpu_mode, options->fpu_mode);
+  for (const std::string_view path : options->disk_paths) {
+    if (path.empty()) {
+      continue;
+    }
+    std::unique_ptr<DiskImage> disk{
+        DiskImage::open(path, options->disk_overlay)};
+    if (!disk) {
+      return -1;
+    }
+    cpu.attach_disk(std::move(disk));
+  }
+  if (options->refresh_hz > 0.0) {
+    cpu.enable_display(options->refresh_hz);
+  }
+  if (!options->capture_prefix.empty() ||
+      !options->capture_raw_path.empty()) {
+    std::unique_ptr<FrameCapture> capture{FrameCapture::open(
+        options->capture_prefix, options->capture_raw_path)};
+    if (!capture) {
+      return -1;
+    }
+    cpu.enable_capture(std::move(capture), options->capture_every);
+  }
+  if (!options->key_script_path.empty()) {
+    std::unique_ptr<KeyScript> script{
+        KeyScript::open(options->key_script_path)};
+    if (!script) {
+      return -1;
+    }
+    cpu.enable_key_script(std::move(script));
+  }
+  if (options->timing) {
+    cpu.enable_timing(options->target_mhz);
+  }
+  if (!options->trace_path.empty()) {
+    std::unique_ptr<TraceWriter> trace{TraceWriter::open(options->trace_path)};
+    if (!trace) {
+      return -1;
+    }
+    cpu.enable_trace(std::move(trace), options->trace_first,
+                     options->trace_last);
+  }
+  if (!options->coverage_path.empty()) {
+    cpu.enable_coverage();
+  }
+  if (!options->record_path.empty() &&
+      !cpu.replay_log().record(options->record_path, cpu_mode)) {
+    return -1;
+  }
+  if (!options->replay_path.empty() &&
+      !cpu.replay_log().replay(options->replay_path, cpu_mode)) {
+    return -1;
+  }
   if (mode == 'c') {
     std::optional<COM> com{COM::open(input_filename)};
     if (!com) {
@@ -27,22 +113,87 @@ int main(const int argc, const char* argv[]) {
       return -1;
     }
 
-    LoadToCPU::load(cpu, com.value());
+    const std::optional<ProgramImage> image{ProgramImage::from_com(*com)};
+    if (!image || !LoadToCPU::load(cpu, *image, input_filename)) {
+      return -1;
+    }
   } else if (mode == 'e') {
     std::optional<MZExe> mz{MZExe::open(input_filename)};
     if (!mz) {
       mylog("Cannot open MZ file '%s'", input_filename.data());
       return -1;
     }
+
+    const std::optional<ProgramImage> image{ProgramImage::from_mz(*mz)};
+    if (!image || !LoadToCPU::load(cpu, *image, input_filename)) {
+      return -1;
+    }
+  } else if (mode == 's') {
+    if (!snapshot->restore(cpu)) {
+      return -1;
+    }
   } else {
     mylog("Usage: %s <filename>", argv[0]);
     return 1;
   }
 
+  if (!options->snapshot_path.empty() || options->fork_server_jobs) {
+    cpu.set_ready_hook(
+        [&cpu, &options]() {
+          if (!options->snapshot_path.empty()) {
+            const std::optional<Snapshot> snapshot{Snapshot::capture(cpu)};
+            if (!snapshot || !snapshot->save(options->snapshot_path)) {
+              mylog("Cannot save snapshot '%s'",
+                    options->snapshot_path.data());
+            }
+          }
+          if (options->fork_server_jobs) {
+            ForkServer::serve(stdin, stderr, options->fork_server_jobs);
+          }
+        },
+        options->ready_function);
+  }
+
+  if (!options->gdb_address.empty()) {
+    std::unique_ptr<GdbStub> stub{GdbStub::listen(options->gdb_address)};
+    if (!stub) {
+      return -1;
+    }
+    cpu.enable_debugger(std::move(stub));
+  }
+
+  const auto save_stats = [&cpu, &options]() {
+    if (!options->stats_path.empty()) {
+      cpu.update_stats();
+      cpu.stats().save(options->stats_path);
+    }
+  };
+
+  const auto save_coverage = [&cpu, &options]() {
+    if (!options->coverage_path.empty()) {
+      cpu.coverage().merge_into(options->coverage_path);
+    }
+  };
+
+  EnableCursorControl cursor_control;
   try {
-    EnableCursorControl _;
     cpu.execute();
+    cpu.close_debugger(0);
+    cpu.close_display();
+    cpu.close_capture();
+    save_stats();
+    save_coverage();
   } catch (const ProgramExitedException& e) {
+    cpu.close_debugger(e.code);
+    cpu.close_display();
+    cpu.close_capture();
+    save_stats();
+    save_coverage();
+    if (options->timing) {
+      mylog("Executed %llu instructions in %llu cycles",
+            static_cast<unsigned long long>(cpu.timing().instructions()),
+            static_cast<unsigned long long>(cpu.timing().cycles()));
+    }
     return e.code;
   }
 }
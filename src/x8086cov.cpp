@@ -0,0 +1,56 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <optional>
+
+#include "Utils/CoverageMap.h"
+
+/*
+  x8086cov [-o <merged>] <coverage>...
+
+  Merges coverage files written by x8086 --coverage and prints the
+  linear address ranges the union covers, one first-last pair in hex
+  per line, then the totals. With -o the union is also saved as a
+  coverage file.
+*/
+int main(const int argc, const char* argv[]) {
+  const char* output = nullptr;
+  int first_input = 1;
+  if (argc > 2 && std::strcmp(argv[1], "-o") == 0) {
+    output = argv[2];
+    first_input = 3;
+  }
+  if (first_input >= argc) {
+    std::fprintf(stderr, "Usage: %s [-o <merged>] <coverage>...\n", argv[0]);
+    return 1;
+  }
+
+  CoverageMap merged;
+  for (int i = first_input; i < argc; i++) {
+    const std::optional<CoverageMap> map{CoverageMap::load(argv[i])};
+    if (!map) {
+      std::fprintf(stderr, "Cannot read coverage file '%s'\n", argv[i]);
+      return 1;
+    }
+    merged.merge(*map);
+  }
+  if (output && !merged.save(output)) {
+    std::fprintf(stderr, "Cannot write '%s'\n", output);
+    return 1;
+  }
+
+  uint32_t ranges = 0;
+  for (uint32_t address = 0; address < CoverageMap::SIZE; address++) {
+    if (!merged.covered(address)) {
+      continue;
+    }
+    const uint32_t start = address;
+    while (address + 1 < CoverageMap::SIZE && merged.covered(address + 1)) {
+      address++;
+    }
+    std::printf("%05X-%05X\n", start, address);
+    ranges++;
+  }
+  std::printf("%zu bytes in %u ranges\n", merged.count(), ranges);
+  return 0;
+}
@@ -0,0 +1,179 @@
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "Utils/TraceFormat.h"
+
+/*
+  x8086trace <trace> [<first>-<last>]
+
+  Prints a trace written by x8086 --trace as text, one line per
+  instruction: CS:IP, the code bytes, the registers it changed and the
+  memory it wrote. With a range, in hex, only instructions starting at
+  a linear address in it are printed.
+*/
+namespace {
+// Write data past this many bytes is summed up, not listed
+constexpr uint32_t SHOWN_BYTES = 16;
+
+class Reader {
+ public:
+  explicit Reader(std::FILE* file) : file(file) {}
+
+  bool u8(uint8_t& value) {
+    const int c = std::getc(file);
+    value = static_cast<uint8_t>(c);
+    return c != EOF;
+  }
+  bool u16(uint16_t& value) {
+    uint8_t low;
+    uint8_t high;
+    if (!u8(low) || !u8(high)) {
+      return false;
+    }
+    value = static_cast<uint16_t>(low | high << 8);
+    return true;
+  }
+  bool bytes(uint8_t* out, const size_t size) {
+    return std::fread(out, 1, size, file) == size;
+  }
+
+ private:
+  std::FILE* file;
+};
+
+bool parse_range(const char* text, uint32_t& first, uint32_t& last) {
+  char* end = nullptr;
+  first = static_cast<uint32_t>(std::strtoul(text, &end, 16));
+  if (end == text || *end != '-') {
+    return false;
+  }
+  const char* second = end + 1;
+  last = static_cast<uint32_t>(std::strtoul(second, &end, 16));
+  return end != second && *end == '\0' && first <= last;
+}
+}  // namespace
+
+int main(const int argc, const char* argv[]) {
+  uint32_t first = 0;
+  uint32_t last = UINT32_MAX;
+  if (argc < 2 || argc > 3 ||
+      (argc == 3 && !parse_range(argv[2], first, last))) {
+    std::fprintf(stderr, "Usage: %s <trace> [<first>-<last>]\n", argv[0]);
+    return 1;
+  }
+
+  std::FILE* file = std::fopen(argv[1], "rb");
+  if (!file) {
+    std::fprintf(stderr, "Cannot open trace '%s'\n", argv[1]);
+    return 1;
+  }
+  Reader in(file);
+
+  uint8_t header[TraceFormat::HEADER_SIZE];
+  if (!in.bytes(header, sizeof(header)) ||
+      std::memcmp(header, TraceFormat::MAGIC, 4) != 0 ||
+      (header[4] | header[5] << 8) != TraceFormat::VERSION) {
+    std::fprintf(stderr, "'%s' is not a version %u trace\n", argv[1],
+                 TraceFormat::VERSION);
+    std::fclose(file);
+    return 1;
+  }
+
+  uint16_t CS = 0;
+  uint16_t IP = 0;
+  uint16_t registers[TraceFormat::REGISTERS]{};
+  std::string line;
+  std::string data;
+  bool complete = true;
+  uint8_t tag;
+  while (in.u8(tag)) {
+    complete = false;
+    const uint8_t length = tag & TraceFormat::LENGTH_MASK;
+    if ((tag & TraceFormat::HAS_CS && !in.u16(CS)) ||
+        (tag & TraceFormat::HAS_IP && !in.u16(IP))) {
+      break;
+    }
+    uint8_t code[TraceFormat::LENGTH_MASK];
+    if (!in.bytes(code, length)) {
+      break;
+    }
+
+    char text[64];
+    std::snprintf(text, sizeof(text), "%04X:%04X ", CS, IP);
+    line = text;
+    for (uint8_t i = 0; i < TraceFormat::UNKNOWN_LENGTH; i++) {
+      if (i < length) {
+        std::snprintf(text, sizeof(text), " %02X", code[i]);
+        line += text;
+      } else {
+        line += "   ";
+      }
+    }
+    line += length > TraceFormat::UNKNOWN_LENGTH ? "+" : " ";
+
+    uint16_t changed = 0;
+    if (tag & TraceFormat::HAS_REGISTERS) {
+      if (!in.u16(changed)) {
+        break;
+      }
+      bool read = true;
+      for (size_t i = 0; i < TraceFormat::REGISTERS && read; i++) {
+        if (changed & 1 << i) {
+          read = in.u16(registers[i]);
+          std::snprintf(text, sizeof(text), " %s=%04X",
+                        TraceFormat::REGISTER_NAMES[i], registers[i]);
+          line += text;
+        }
+      }
+      if (!read) {
+        break;
+      }
+    }
+
+    uint8_t count = 0;
+    if (tag & TraceFormat::HAS_WRITES && !in.u8(count)) {
+      break;
+    }
+    bool read = true;
+    for (uint8_t i = 0; i < count && read; i++) {
+      uint8_t entry[5];
+      read = in.bytes(entry, sizeof(entry));
+      const uint32_t address = entry[0] | entry[1] << 8 | entry[2] << 16;
+      const uint32_t size = entry[3] | entry[4] << 8;
+      data.resize(size);
+      read = read && in.bytes(reinterpret_cast<uint8_t*>(data.data()), size);
+      std::snprintf(text, sizeof(text), " [%06X]=", address);
+      line += text;
+      for (uint32_t j = 0; j < size && j < SHOWN_BYTES; j++) {
+        std::snprintf(text, sizeof(text), j ? " %02X" : "%02X",
+                      static_cast<uint8_t>(data[j]));
+        line += text;
+      }
+      if (size > SHOWN_BYTES) {
+        std::snprintf(text, sizeof(text), " ... %" PRIu32 " bytes", size);
+        line += text;
+      }
+    }
+    if (!read) {
+      break;
+    }
+    complete = true;
+
+    const uint32_t linear = (static_cast<uint32_t>(CS) << 4) + IP;
+    if (linear >= first && linear <= last) {
+      std::puts(line.c_str());
+    }
+    IP = static_cast<uint16_t>(IP + length);
+  }
+  std::fclose(file);
+
+  if (!complete) {
+    std::fprintf(stderr, "Trace ends in the middle of a record\n");
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,160 @@
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+
+#include "../src/FPU/FPU.h"
+#include "../src/FPU/FPUMode.h"
+#include "../src/FPU/Float80.h"
+
+/*
+  Float80 and the exact FPU against results taken from a real x87:
+  add, mul, div and sqrt in every rounding mode, precision control and
+  the masked responses to zero divide and invalid operations.
+*/
+namespace {
+int failures = 0;
+
+Float80 make(const uint16_t sign_exponent, const uint64_t mantissa) {
+  Float80 value;
+  value.sign_exponent = sign_exponent;
+  value.mantissa = mantissa;
+  return value;
+}
+
+void check(const char* what, const Float80& got, const uint16_t sign_exponent,
+           const uint64_t mantissa) {
+  if (got.sign_exponent == sign_exponent && got.mantissa == mantissa) {
+    return;
+  }
+  std::printf("%s: got %04X %016llX, want %04X %016llX\n", what,
+              got.sign_exponent, static_cast<unsigned long long>(got.mantissa),
+              sign_exponent, static_cast<unsigned long long>(mantissa));
+  failures++;
+}
+
+void check_flags(const char* what, const uint16_t got, const uint16_t want) {
+  if (got == want) {
+    return;
+  }
+  std::printf("%s: exceptions %02X, want %02X\n", what, got, want);
+  failures++;
+}
+
+struct Expected {
+  uint64_t third;
+  uint64_t minus_third;
+  uint64_t sqrt2;
+  uint64_t one_plus_half_ulp;
+  uint64_t ulp_square;
+};
+
+// Mantissas per rounding mode, in FloatEnvironment::Rounding order
+constexpr Expected EXPECTED[] = {
+    {0xAAAAAAAAAAAAAAAB, 0xAAAAAAAAAAAAAAAB, 0xB504F333F9DE6484,
+     0x8000000000000000, 0x8000000000000002},
+    {0xAAAAAAAAAAAAAAAA, 0xAAAAAAAAAAAAAAAB, 0xB504F333F9DE6484,
+     0x8000000000000000, 0x8000000000000002},
+    {0xAAAAAAAAAAAAAAAB, 0xAAAAAAAAAAAAAAAA, 0xB504F333F9DE6485,
+     0x8000000000000001, 0x8000000000000003},
+    {0xAAAAAAAAAAAAAAAA, 0xAAAAAAAAAAAAAAAA, 0xB504F333F9DE6484,
+     0x8000000000000000, 0x8000000000000002},
+};
+constexpr const char* ROUNDING_NAMES[] = {"nearest", "down", "up", "zero"};
+
+void check_rounding() {
+  const Float80 one = Float80::from_int64(1);
+  const Float80 two = Float80::from_int64(2);
+  const Float80 three = Float80::from_int64(3);
+  const Float80 half_ulp = make(Float80::BIAS - 64, 0x8000000000000000);
+  const Float80 one_plus_ulp = make(Float80::BIAS, 0x8000000000000001);
+
+  for (uint8_t mode = 0; mode < 4; mode++) {
+    const Expected& want = EXPECTED[mode];
+    char what[64];
+    FloatEnvironment env;
+    env.rounding = static_cast<FloatEnvironment::Rounding>(mode);
+
+    std::snprintf(what, sizeof(what), "1/3 %s", ROUNDING_NAMES[mode]);
+    check(what, Float80::div(one, three, env), 0x3FFD, want.third);
+    std::snprintf(what, sizeof(what), "1/-3 %s", ROUNDING_NAMES[mode]);
+    check(what, Float80::div(one, three.negate(), env), 0xBFFD,
+          want.minus_third);
+    std::snprintf(what, sizeof(what), "sqrt 2 %s", ROUNDING_NAMES[mode]);
+    check(what, Float80::sqrt(two, env), 0x3FFF, want.sqrt2);
+    std::snprintf(what, sizeof(what), "1 + 2^-64 %s", ROUNDING_NAMES[mode]);
+    check(what, Float80::add(one, half_ulp, env), 0x3FFF,
+          want.one_plus_half_ulp);
+    std::snprintf(what, sizeof(what), "(1 + 2^-63)^2 %s",
+                  ROUNDING_NAMES[mode]);
+    check(what, Float80::mul(one_plus_ulp, one_plus_ulp, env), 0x3FFF,
+          want.ulp_square);
+    check_flags(what, env.exceptions, FloatEnvironment::PE);
+  }
+}
+
+void check_precision() {
+  const Float80 one = Float80::from_int64(1);
+  const Float80 three = Float80::from_int64(3);
+  FloatEnvironment env;
+  env.precision = 53;
+  check("1/3 double precision", Float80::div(one, three, env), 0x3FFD,
+        0xAAAAAAAAAAAAA800);
+  env.precision = 24;
+  check("1/3 single precision", Float80::div(one, three, env), 0x3FFD,
+        0xAAAAAB0000000000);
+
+  // Exact results raise nothing
+  env = FloatEnvironment{};
+  check("1 + 2", Float80::add(one, Float80::from_int64(2), env), 0x4000,
+        0xC000000000000000);
+  check_flags("1 + 2", env.exceptions, 0);
+}
+
+void check_masked_responses() {
+  FloatEnvironment env;
+  check("1/0", Float80::div(Float80::from_int64(1), Float80::zero(), env),
+        0x7FFF, 0x8000000000000000);
+  check_flags("1/0", env.exceptions, FloatEnvironment::ZE);
+
+  env = FloatEnvironment{};
+  check("sqrt -1", Float80::sqrt(Float80::from_int64(-1), env), 0xFFFF,
+        0xC000000000000000);
+  check_flags("sqrt -1", env.exceptions, FloatEnvironment::IE);
+}
+
+// FLDCW, FLD1, FLD m80, FDIVR and FSTP m80 through the exact FPU
+void check_fpu() {
+  const std::unique_ptr<FPU> fpu = FPU::create(FPU_MODE::EXACT);
+  // Round up, everything masked
+  uint8_t control[2] = {0x7F, 0x0B};
+  uint8_t operand[10];
+  Float80::from_int64(3).to_bytes(operand);
+
+  bool ok = fpu->execute(0xD9, 0x2E, control) &&
+            fpu->execute(0xD9, 0xE8, nullptr) &&
+            fpu->execute(0xDB, 0x2E, operand) &&
+            fpu->execute(0xD8, 0xF9, nullptr) &&
+            fpu->execute(0xDB, 0x3E, operand);
+  if (!ok) {
+    std::printf("FPU rejected an instruction\n");
+    failures++;
+    return;
+  }
+  check("FPU 1/3 up", Float80::from_bytes(operand), 0x3FFD,
+        0xAAAAAAAAAAAAAAAB);
+  check_flags("FPU 1/3 up", fpu->status_word() & 0x3F, FloatEnvironment::PE);
+}
+}  // namespace
+
+int main() {
+  check_rounding();
+  check_precision();
+  check_masked_responses();
+  check_fpu();
+  if (failures) {
+    std::printf("%d Float80 checks failed\n", failures);
+    return 1;
+  }
+  std::printf("Float80 checks passed\n");
+  return 0;
+}